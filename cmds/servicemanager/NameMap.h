@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace android {
+
+// Map from service name to T, used for the lookup tables of ServiceManager, which are read on
+// every getService/checkService call and written far less often.
+//
+// Names are hashed once per call and kept in an open addressed table with linear probing next to
+// the hash of every entry, so a lookup usually touches one cache line of the table and compares a
+// single string. Entries are allocated separately and never move, so references to them stay
+// valid until they are erased, as they do with std::map. Erasing leaves a tombstone rather than
+// moving other entries, so erase(iterator) can be used while iterating.
+//
+// Unlike std::map, iteration order is unspecified.
+template <typename T>
+class NameMap {
+public:
+    using value_type = std::pair<const std::string, T>;
+
+    template <typename Map, typename Value>
+    class Iterator {
+    public:
+        Value& operator*() const { return *mMap->mSlots[mIndex].entry; }
+        Value* operator->() const { return mMap->mSlots[mIndex].entry.get(); }
+
+        Iterator& operator++() {
+            mIndex = mMap->nextOccupied(mIndex + 1);
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const Iterator& other) const { return mIndex == other.mIndex; }
+        bool operator!=(const Iterator& other) const { return mIndex != other.mIndex; }
+
+    private:
+        friend class NameMap;
+        Iterator(Map* map, size_t index) : mMap(map), mIndex(index) {}
+
+        Map* mMap;
+        size_t mIndex;
+    };
+
+    using iterator = Iterator<NameMap, value_type>;
+    using const_iterator = Iterator<const NameMap, const value_type>;
+
+    iterator begin() { return iterator(this, nextOccupied(0)); }
+    iterator end() { return iterator(this, mSlots.size()); }
+    const_iterator begin() const { return const_iterator(this, nextOccupied(0)); }
+    const_iterator end() const { return const_iterator(this, mSlots.size()); }
+
+    size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+
+    iterator find(std::string_view name) {
+        return iterator(this, findIndex(name, hashName(name)));
+    }
+    const_iterator find(std::string_view name) const {
+        return const_iterator(this, findIndex(name, hashName(name)));
+    }
+
+    size_t count(std::string_view name) const { return find(name) != end() ? 1 : 0; }
+
+    // Returns the entry for name, inserting a value initialized one if there is none.
+    T& operator[](std::string_view name) {
+        const size_t hash = hashName(name);
+        size_t index = findIndex(name, hash);
+        if (index != mSlots.size()) {
+            return mSlots[index].entry->second;
+        }
+
+        if ((mSize + mTombstones + 1) * 4 > mSlots.size() * 3) {
+            // Grow if mostly full of entries, otherwise just clear the tombstones out.
+            rehash(mSize * 2 >= mSlots.size() ? std::max<size_t>(kMinCapacity, mSlots.size() * 2)
+                                              : mSlots.size());
+        }
+        index = insertIndex(hash);
+        Slot& slot = mSlots[index];
+        if (slot.tombstone) {
+            slot.tombstone = false;
+            mTombstones--;
+        }
+        slot.hash = hash;
+        slot.entry = std::make_unique<value_type>(std::string(name), T());
+        mSize++;
+        return slot.entry->second;
+    }
+
+    // Erases the entry at it, and returns an iterator to the entry after it.
+    iterator erase(iterator it) {
+        Slot& slot = mSlots[it.mIndex];
+        slot.entry.reset();
+        slot.tombstone = true;
+        mSize--;
+        mTombstones++;
+        return ++it;
+    }
+
+    size_t erase(std::string_view name) {
+        iterator it = find(name);
+        if (it == end()) {
+            return 0;
+        }
+        erase(it);
+        return 1;
+    }
+
+    void clear() {
+        mSlots.clear();
+        mSize = 0;
+        mTombstones = 0;
+    }
+
+private:
+    static constexpr size_t kMinCapacity = 16;
+
+    struct Slot {
+        size_t hash = 0;
+        // null if the slot is free or a tombstone
+        std::unique_ptr<value_type> entry;
+        // erased entry, lookups must probe past it
+        bool tombstone = false;
+    };
+
+    static size_t hashName(std::string_view name) { return std::hash<std::string_view>{}(name); }
+
+    size_t nextOccupied(size_t index) const {
+        while (index < mSlots.size() && mSlots[index].entry == nullptr) {
+            index++;
+        }
+        return index;
+    }
+
+    // Returns the slot holding name, or mSlots.size() if there is none.
+    size_t findIndex(std::string_view name, size_t hash) const {
+        if (mSlots.empty()) {
+            return 0;
+        }
+        const size_t mask = mSlots.size() - 1;
+        for (size_t index = hash & mask;; index = (index + 1) & mask) {
+            const Slot& slot = mSlots[index];
+            if (slot.entry == nullptr) {
+                if (!slot.tombstone) {
+                    return mSlots.size();
+                }
+            } else if (slot.hash == hash && slot.entry->first == name) {
+                return index;
+            }
+        }
+    }
+
+    // Returns the first free slot or tombstone for hash. There must be one.
+    size_t insertIndex(size_t hash) const {
+        const size_t mask = mSlots.size() - 1;
+        size_t index = hash & mask;
+        while (mSlots[index].entry != nullptr) {
+            index = (index + 1) & mask;
+        }
+        return index;
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<Slot> old = std::exchange(mSlots, std::vector<Slot>(capacity));
+        mTombstones = 0;
+        for (Slot& slot : old) {
+            if (slot.entry != nullptr) {
+                Slot& dest = mSlots[insertIndex(slot.hash)];
+                dest.hash = slot.hash;
+                dest.entry = std::move(slot.entry);
+            }
+        }
+    }
+
+    // Capacity is zero or a power of two, and at most three quarters of the slots are entries or
+    // tombstones, so probing always ends at a free slot.
+    std::vector<Slot> mSlots;
+    size_t mSize = 0;
+    size_t mTombstones = 0;
+};
+
+} // namespace android
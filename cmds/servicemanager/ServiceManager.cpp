@@ -25,6 +25,7 @@
 #include <binder/Stability.h>
 #include <cutils/android_filesystem_config.h>
 #include <cutils/multiuser.h>
+#include <algorithm>
 #include <thread>
 
 #ifndef VENDORSERVICEMANAGER
@@ -520,6 +521,8 @@ Status ServiceManager::listServices(int32_t dumpPriority, std::vector<std::strin
             outList->push_back(name);
         }
     }
+    // mNameToService is unordered, keep the list sorted for callers
+    std::sort(outList->begin(), outList->end());
 
     return Status::ok();
 }
@@ -984,6 +987,8 @@ Status ServiceManager::getServiceDebugInfo(std::vector<ServiceDebugInfo>* outRet
 
         outReturn->push_back(std::move(info));
     }
+    std::sort(outReturn->begin(), outReturn->end(),
+              [](const ServiceDebugInfo& a, const ServiceDebugInfo& b) { return a.name < b.name; });
 
     return Status::ok();
 }
@@ -21,6 +21,7 @@
 #include <android/os/IServiceCallback.h>
 
 #include "Access.h"
+#include "NameMap.h"
 
 namespace android {
 
@@ -84,9 +85,9 @@ private:
         ~Service();
     };
 
-    using ServiceCallbackMap = std::map<std::string, std::vector<sp<IServiceCallback>>>;
-    using ClientCallbackMap = std::map<std::string, std::vector<sp<IClientCallback>>>;
-    using ServiceMap = std::map<std::string, Service>;
+    using ServiceCallbackMap = NameMap<std::vector<sp<IServiceCallback>>>;
+    using ClientCallbackMap = NameMap<std::vector<sp<IClientCallback>>>;
+    using ServiceMap = NameMap<Service>;
 
     // removes a callback from mNameToRegistrationCallback, removing it if the vector is empty
     // this updates iterator to the next location
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <binder/Binder.h>
+#include <binder/IServiceManager.h>
+
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Access.h"
+#include "NameMap.h"
+#include "ServiceManager.h"
+
+using android::Access;
+using android::BBinder;
+using android::IBinder;
+using android::NameMap;
+using android::ServiceManager;
+using android::sp;
+using android::os::IServiceManager;
+
+namespace {
+
+// Services looked up while a device boots and the first apps start, with the relative number of
+// lookups of each. Names that are never registered stand for checkService calls on optional and
+// lazy services, which miss.
+struct TraceEntry {
+    const char* name;
+    int lookups;
+};
+
+constexpr TraceEntry kBootTrace[] = {
+        {"activity", 400},
+        {"package", 320},
+        {"window", 180},
+        {"permissionmgr", 150},
+        {"user", 140},
+        {"display", 120},
+        {"media.audio_flinger", 90},
+        {"SurfaceFlinger", 90},
+        {"SurfaceFlingerAIDL", 80},
+        {"power", 70},
+        {"connectivity", 70},
+        {"appops", 65},
+        {"input", 60},
+        {"sensorservice", 50},
+        {"batterystats", 45},
+        {"phone", 40},
+        {"package_native", 40},
+        {"media.audio_policy", 35},
+        {"media.player", 30},
+        {"media.camera", 30},
+        {"vold", 25},
+        {"netd", 25},
+        {"alarm", 25},
+        {"notification", 25},
+        {"uimode", 20},
+        {"audio", 20},
+        {"content", 20},
+        {"account", 18},
+        {"clipboard", 15},
+        {"statusbar", 15},
+        {"jobscheduler", 15},
+        {"wifi", 12},
+        {"location", 12},
+        {"telephony.registry", 12},
+        {"storagestats", 10},
+        {"gpu", 10},
+        {"android.hardware.graphics.allocator.IAllocator/default", 10},
+        {"android.hardware.power.IPower/default", 8},
+        {"android.hardware.light.ILights/default", 6},
+        {"android.hardware.vibrator.IVibrator/default", 6},
+        {"android.hardware.health.IHealth/default", 5},
+        {"android.hardware.memtrack.IMemtrack/default", 5},
+        {"android.hardware.biometrics.fingerprint.IFingerprint/default", 4},
+        {"android.hardware.security.keymint.IKeyMintDevice/default", 4},
+        {"android.system.keystore2.IKeystoreService/default", 4},
+        {"media.extractor", 4},
+        {"media.metrics", 4},
+        {"stats", 4},
+        {"incidentcompanion", 2},
+        {"dropbox", 2},
+        {"android.hardware.camera.provider.ICameraProvider/virtual/0", 3},
+        {"android.hardware.gnss.IGnss/default", 3},
+        {"android.hardware.dumpstate.IDumpstateDevice/default", 2},
+        {"android.hardware.boot.IBootControl/default", 2},
+        {"android.hardware.thermal.IThermal/default", 2},
+        {"android.hardware.nfc.INfc/default", 2},
+};
+
+constexpr size_t kMissingServices = 8;  // the last entries of kBootTrace are never registered
+constexpr size_t kOtherServices = 200;  // registered, but not looked up during the trace
+constexpr size_t kTraceLength = 4096;
+
+struct Trace {
+    std::vector<std::string> registered;
+    std::vector<std::string> lookups;
+};
+
+const Trace& bootTrace() {
+    static const Trace trace = [] {
+        Trace trace;
+        std::vector<int> weights;
+        for (const TraceEntry& entry : kBootTrace) {
+            weights.push_back(entry.lookups);
+        }
+        const size_t count = std::size(kBootTrace);
+        for (size_t i = 0; i < count - kMissingServices; i++) {
+            trace.registered.push_back(kBootTrace[i].name);
+        }
+        for (size_t i = 0; i < kOtherServices; i++) {
+            trace.registered.push_back("vendor.example.hardware.IService" + std::to_string(i) +
+                                       "/default");
+        }
+
+        std::mt19937 rng(1);
+        std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+        for (size_t i = 0; i < kTraceLength; i++) {
+            trace.lookups.push_back(kBootTrace[pick(rng)].name);
+        }
+        return trace;
+    }();
+    return trace;
+}
+
+// Replays the lookups of the trace against the same table type ServiceManager used to use,
+// to compare with NameMap.
+void BM_replayStdMap(benchmark::State& state) {
+    const Trace& trace = bootTrace();
+    std::map<std::string, int> map;
+    for (const auto& name : trace.registered) {
+        map[name] = 1;
+    }
+    for (auto _ : state) {
+        int found = 0;
+        for (const auto& name : trace.lookups) {
+            found += map.find(name) != map.end();
+        }
+        benchmark::DoNotOptimize(found);
+    }
+    state.SetItemsProcessed(state.iterations() * trace.lookups.size());
+}
+BENCHMARK(BM_replayStdMap);
+
+void BM_replayNameMap(benchmark::State& state) {
+    const Trace& trace = bootTrace();
+    NameMap<int> map;
+    for (const auto& name : trace.registered) {
+        map[name] = 1;
+    }
+    for (auto _ : state) {
+        int found = 0;
+        for (const auto& name : trace.lookups) {
+            found += map.find(name) != map.end();
+        }
+        benchmark::DoNotOptimize(found);
+    }
+    state.SetItemsProcessed(state.iterations() * trace.lookups.size());
+}
+BENCHMARK(BM_replayNameMap);
+
+class PermissiveAccess : public Access {
+public:
+    CallingContext getCallingContext() override { return CallingContext{}; }
+    bool canFind(const CallingContext&, const std::string&) override { return true; }
+    bool canAdd(const CallingContext&, const std::string&) override { return true; }
+    bool canList(const CallingContext&) override { return true; }
+};
+
+// Replays the trace through ServiceManager::checkService, as binder would deliver it.
+void BM_replayCheckService(benchmark::State& state) {
+    const Trace& trace = bootTrace();
+    auto sm = sp<ServiceManager>::make(std::make_unique<PermissiveAccess>());
+    for (const auto& name : trace.registered) {
+        if (!sm->addService(name, sp<BBinder>::make(), false /*allowIsolated*/,
+                            IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT)
+                     .isOk()) {
+            state.SkipWithError("addService failed");
+            return;
+        }
+    }
+    for (auto _ : state) {
+        for (const auto& name : trace.lookups) {
+            sp<IBinder> binder;
+            sm->checkService(name, &binder);
+            benchmark::DoNotOptimize(binder);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * trace.lookups.size());
+    sm->clear();
+}
+BENCHMARK(BM_replayCheckService);
+
+} // namespace
+
+BENCHMARK_MAIN();
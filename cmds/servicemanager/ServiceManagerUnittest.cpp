@@ -16,6 +16,10 @@
 
 #include <gtest/gtest.h>
 
+#include <map>
+#include <string>
+
+#include "NameMap.h"
 #include "NameUtil.h"
 
 namespace android {
@@ -36,4 +40,73 @@ TEST(ServiceManager, NativeName_Malformed) {
     EXPECT_FALSE(NativeName::fill("aidl.like.IType/default", &nname));
 }
 
+TEST(ServiceManager, NameMap) {
+    NameMap<int> map;
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.end(), map.find("foo"));
+
+    map["foo"] = 1;
+    map["bar"] = 2;
+    EXPECT_EQ(2u, map.size());
+    ASSERT_NE(map.end(), map.find("foo"));
+    EXPECT_EQ("foo", map.find("foo")->first);
+    EXPECT_EQ(1, map.find("foo")->second);
+    EXPECT_EQ(1u, map.count("bar"));
+    EXPECT_EQ(0u, map.count("baz"));
+
+    // operator[] returns the existing entry
+    map["foo"] += 10;
+    EXPECT_EQ(11, map.find("foo")->second);
+    EXPECT_EQ(2u, map.size());
+
+    EXPECT_EQ(1u, map.erase("foo"));
+    EXPECT_EQ(0u, map.erase("foo"));
+    EXPECT_EQ(map.end(), map.find("foo"));
+    EXPECT_EQ(2, map.find("bar")->second);
+
+    map.clear();
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.begin(), map.end());
+}
+
+TEST(ServiceManager, NameMap_MatchesStdMap) {
+    NameMap<int> map;
+    std::map<std::string, int> expected;
+
+    // Enough churn to grow the table and to reuse and rehash away tombstones.
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < 200; i++) {
+            std::string name = "android.service.IFoo/" + std::to_string((i * 7 + round) % 300);
+            map[name] = i;
+            expected[name] = i;
+        }
+        for (auto it = map.begin(); it != map.end();) {
+            if (it->second % 3 == round % 3) {
+                expected.erase(it->first);
+                it = map.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        ASSERT_EQ(expected.size(), map.size());
+        std::map<std::string, int> contents;
+        for (const auto& [name, value] : map) {
+            contents[name] = value;
+        }
+        EXPECT_EQ(expected, contents);
+    }
+}
+
+TEST(ServiceManager, NameMap_ReferencesSurviveGrowth) {
+    NameMap<int> map;
+    int& first = map["first"];
+    first = 42;
+    for (int i = 0; i < 1000; i++) {
+        map["service" + std::to_string(i)] = i;
+    }
+    EXPECT_EQ(&first, &map.find("first")->second);
+    EXPECT_EQ(42, first);
+}
+
 } // namespace android
@@ -28,8 +28,10 @@
  * The InputConsumer is used by the application to receive events from the input dispatcher.
  */
 
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <android-base/chrono_utils.h>
 #include <android-base/result.h>
@@ -265,6 +267,23 @@ public:
      */
     status_t sendMessage(const InputMessage* msg);
 
+    /* Send several messages to the other endpoint, in order, with as few system calls as possible.
+     * Each message is still received on its own by receiveMessage.
+     *
+     * Unlike sendMessage, the messages are sent exactly as they are, so they should be sanitized
+     * copies made with InputMessage::getSanitizedCopy.
+     *
+     * Sets outSentCount to the number of messages that were sent, which are the first ones.
+     * Return OK if all of the messages were sent.
+     * Otherwise, return the error of the first message that was not sent, as sendMessage would.
+     */
+    status_t sendMessages(const InputMessage* msgs, size_t count, size_t* outSentCount);
+
+    /* Maximum number of messages sent by a single system call of sendMessages. Larger batches take
+     * several calls.
+     */
+    static constexpr size_t MAX_MESSAGES_PER_SEND = 64;
+
     /* Receive a message sent by the other endpoint.
      *
      * If there is no message present, try again after poll() indicates that the fd
@@ -412,6 +431,22 @@ public:
      */
     status_t publishTouchModeEvent(uint32_t seq, int32_t eventId, bool isInTouchMode);
 
+    /* Starts a batch. Until endBatch is called, the publish methods only check and stage the
+     * events, and return OK once they are staged.
+     */
+    void beginBatch();
+
+    /* Publishes the events staged since beginBatch, in order, with as few system calls as
+     * possible, and ends the batch.
+     *
+     * Sets outPublishedCount to the number of events that were published, which are the first
+     * ones. The others are dropped, and may be published again.
+     * Returns OK if all of the events were published.
+     * Otherwise, returns the error of the first event that was not published, which is one of
+     * the errors of the publish methods.
+     */
+    status_t endBatch(size_t* outPublishedCount);
+
     struct Finished {
         uint32_t seq;
         bool handled;
@@ -449,6 +484,13 @@ public:
 private:
     std::shared_ptr<InputChannel> mChannel;
     InputVerifier mInputVerifier;
+
+    // Sends the message, or stages it if a batch was started.
+    status_t sendMessage(const InputMessage& msg);
+
+    bool mBatching = false;
+    // Sanitized copies of the messages staged in the current batch.
+    std::vector<InputMessage> mBatchedMessages;
 };
 
 /*
@@ -536,8 +578,12 @@ private:
 
     std::shared_ptr<InputChannel> mChannel;
 
-    // The current input message.
-    InputMessage mMsg;
+    // The current input message. Messages are large, so they are received in place and handed to
+    // the batches without being copied.
+    std::unique_ptr<InputMessage> mMsg;
+
+    // Messages that have been consumed, kept to receive the next messages without allocating.
+    std::vector<std::unique_ptr<InputMessage>> mRecycledMessages;
 
     // True if mMsg contains a valid input message that was deferred from the previous
     // call to consume and that still needs to be handled.
@@ -545,7 +591,7 @@ private:
 
     // Batched motion events per device and source.
     struct Batch {
-        std::vector<InputMessage> samples;
+        std::vector<std::unique_ptr<InputMessage>> samples;
     };
     std::vector<Batch> mBatches;
 
@@ -658,6 +704,9 @@ private:
     status_t consumeSamples(InputEventFactoryInterface* factory,
             Batch& batch, size_t count, uint32_t* outSeq, InputEvent** outEvent);
 
+    std::unique_ptr<InputMessage> obtainMessage();
+    void recycleSamples(Batch& batch, size_t count);
+
     void updateTouchState(InputMessage& msg);
     void resampleTouchState(nsecs_t frameTime, MotionEvent* event,
             const InputMessage *next);
@@ -21,7 +21,9 @@
 #include <input/RingBuffer.h>
 #include <utils/BitSet.h>
 #include <utils/Timers.h>
+#include <array>
 #include <map>
+#include <optional>
 #include <set>
 
 namespace android {
@@ -123,11 +125,13 @@ private:
     // When default strategy is specified, then each axis will use a potentially different strategy
     // based on a hardcoded mapping.
     const Strategy mOverrideStrategy;
-    // Maps axes to their respective VelocityTrackerStrategy instances.
-    // Note that, only axes that have had MotionEvents (and not all supported axes) will be here.
-    std::map<int32_t /*axis*/, std::unique_ptr<VelocityTrackerStrategy>> mConfiguredStrategies;
+    // The VelocityTrackerStrategy instance of each axis, indexed by axis.
+    // Note that, only axes that have had MotionEvents (and not all supported axes) will have one.
+    std::array<std::unique_ptr<VelocityTrackerStrategy>, AMOTION_EVENT_MAXIMUM_VALID_AXIS_VALUE + 1>
+            mConfiguredStrategies;
 
     void configureStrategy(int32_t axis);
+    void clearStrategies();
 
     // Generates a VelocityTrackerStrategy instance for the given Strategy type.
     // The `deltaValues` parameter indicates whether or not the created strategy should treat motion
@@ -185,7 +189,15 @@ protected:
      * addition of a new movement.
      */
     const bool mMaintainHorizonDuringAdd;
-    std::map<int32_t /*pointerId*/, RingBuffer<Movement>> mMovements;
+
+    // Returns the movements of the pointer in chronological order, or nullptr if the pointer has
+    // never had any.
+    const RingBuffer<Movement>* findMovements(int32_t pointerId) const;
+
+private:
+    // The movements of each pointer, indexed by pointer id. A buffer is allocated the first time
+    // its pointer id is used, and is kept when the pointer is cleared.
+    std::array<std::optional<RingBuffer<Movement>>, MAX_POINTER_ID + 1> mMovements;
 };
 
 /*
@@ -220,7 +232,7 @@ private:
     // changes in direction.
     static const nsecs_t HORIZON = 100 * 1000000; // 100 ms
 
-    float chooseWeight(int32_t pointerId, uint32_t index) const;
+    float chooseWeight(const RingBuffer<Movement>& movements, uint32_t index) const;
     /**
      * An optimized least-squares solver for degree 2 and no weight (i.e. `Weighting.NONE`).
      * The provided container of movements shall NOT be empty, and shall have the movements in
@@ -2902,6 +2902,18 @@ status_t Parcel::growData(size_t len)
             : continueWrite(std::max(newSize, (size_t) 128));
 }
 
+status_t Parcel::reserveWrite(size_t len)
+{
+    if (len > INT32_MAX) {
+        // don't accept size_t values which may have come from an
+        // inadvertent conversion from a negative int.
+        return BAD_VALUE;
+    }
+
+    if (mDataPos + len <= mDataCapacity) return NO_ERROR;
+    return growData(std::max(mDataPos, mDataSize) + len - mDataSize);
+}
+
 static uint8_t* reallocZeroFree(uint8_t* data, size_t oldCapacity, size_t newCapacity, bool zero) {
     if (!zero) {
         return (uint8_t*)realloc(data, newCapacity);
@@ -291,6 +291,36 @@ status_t RpcSession::sendDecStrongToTarget(uint64_t address, size_t target) {
                                           address, target);
 }
 
+RpcSession::OnewayBatch::OnewayBatch(const sp<RpcSession>& session) : mSession(session) {
+    auto connection = std::make_unique<ExclusiveConnection>();
+    if (status_t status =
+                ExclusiveConnection::find(session, ConnectionUse::CLIENT_ASYNC, connection.get());
+        status != OK) {
+        ALOGW("Cannot keep a connection to batch oneway transactions on, sending them one by "
+              "one: %s",
+              statusToString(status).c_str());
+        return;
+    }
+    // an outer batch on this thread already queues them
+    if (connection->get()->batchOneway) return;
+
+    connection->get()->batchOneway = true;
+    mConnection = std::move(connection);
+}
+
+RpcSession::OnewayBatch::~OnewayBatch() {
+    if (mConnection == nullptr) return;
+    if (status_t status = flush(); status != OK) {
+        ALOGE("Failed to send batched oneway transactions: %s", statusToString(status).c_str());
+    }
+    mConnection->get()->batchOneway = false;
+}
+
+status_t RpcSession::OnewayBatch::flush() {
+    if (mConnection == nullptr) return OK;
+    return mSession->state()->flushOneway(mConnection->get(), mSession);
+}
+
 status_t RpcSession::readId() {
     {
         RpcMutexLockGuard _l(mMutex);
@@ -361,6 +361,74 @@ status_t RpcState::rpcSend(const sp<RpcSession::RpcConnection>& connection,
                            const sp<RpcSession>& session, const char* what, iovec* iovs, int niovs,
                            const std::optional<SmallFunction<status_t()>>& altPoll,
                            const std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) {
+    if (connection->pendingOneway.empty()) {
+        return rpcSendIovs(connection, session, what, iovs, niovs, altPoll, ancillaryFds);
+    }
+
+    // Taken off the connection first, since altPoll may also send on it. The
+    // binders the transactions go to are kept until they are sent.
+    std::vector<uint8_t> pending = std::exchange(connection->pendingOneway, {});
+    auto pendingTransactions = std::exchange(connection->pendingOnewayTransactions, {});
+    iovec pendingIov{pending.data(), pending.size()};
+
+    status_t status = numberPendingOneway(session, &pending, pendingTransactions);
+    if (status == OK) {
+        // File descriptors are received with the first bytes of the write carrying
+        // them, so they would be taken for those of the queued transactions.
+        if (niovs == 0 || (ancillaryFds != nullptr && !ancillaryFds->empty())) {
+            status = rpcSendIovs(connection, session, "queued oneway transactions", &pendingIov,
+                                 1, altPoll, nullptr);
+            if (status == OK) {
+                if (niovs == 0) return OK;
+                return rpcSendIovs(connection, session, what, iovs, niovs, altPoll,
+                                   ancillaryFds);
+            }
+        } else {
+            std::vector<iovec> allIovs;
+            allIovs.reserve(niovs + 1);
+            allIovs.push_back(pendingIov);
+            allIovs.insert(allIovs.end(), iovs, iovs + niovs);
+            status = rpcSendIovs(connection, session, what, allIovs.data(),
+                                 static_cast<int>(allIovs.size()), altPoll, ancillaryFds);
+        }
+    }
+
+    // for the batch which queued them
+    if (status != OK && connection->pendingOnewayError == OK) {
+        connection->pendingOnewayError = status;
+    }
+    return status;
+}
+
+status_t RpcState::numberPendingOneway(
+        const sp<RpcSession>& session, std::vector<uint8_t>* pending,
+        const std::vector<RpcSession::RpcConnection::PendingOnewayTransaction>& transactions) {
+    RpcMutexUniqueLock _l(mNodeMutex);
+    if (mTerminated) return DEAD_OBJECT; // avoid fatal only, otherwise races
+
+    for (const auto& transaction : transactions) {
+        auto it = mNodeForAddress.find(transaction.address);
+        LOG_ALWAYS_FATAL_IF(it == mNodeForAddress.end(),
+                            "Sending queued transact on unknown address %" PRIu64,
+                            transaction.address);
+
+        const uint64_t asyncNumber = it->second.asyncNumber;
+        if (!nodeProgressAsyncNumber(&it->second)) {
+            _l.unlock();
+            (void)session->shutdownAndWait(false);
+            return DEAD_OBJECT;
+        }
+        memcpy(pending->data() + transaction.asyncNumberOffset, &asyncNumber,
+               sizeof(asyncNumber));
+    }
+    return OK;
+}
+
+status_t RpcState::rpcSendIovs(const sp<RpcSession::RpcConnection>& connection,
+                               const sp<RpcSession>& session, const char* what, iovec* iovs,
+                               int niovs, const std::optional<SmallFunction<status_t()>>& altPoll,
+                               const std::vector<std::variant<unique_fd, borrowed_fd>>*
+                                       ancillaryFds) {
     for (int i = 0; i < niovs; i++) {
         LOG_RPC_DETAIL("Sending %s (part %d of %d) on RpcTransport %p: %s",
                        what, i + 1, niovs, connection->rpcTransport.get(),
@@ -543,7 +611,35 @@ status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connecti
     LOG_ALWAYS_FATAL_IF(!data.isForRpc());
     LOG_ALWAYS_FATAL_IF(data.objectsCount() != 0);
 
+    auto* rpcFields = data.maybeRpcFields();
+    LOG_ALWAYS_FATAL_IF(rpcFields == nullptr);
+
+    Span<const uint32_t> objectTableSpan = Span<const uint32_t>{rpcFields->mObjectPositions.data(),
+                                                                rpcFields->mObjectPositions.size()};
+
+    uint32_t bodySize;
+    LOG_ALWAYS_FATAL_IF(__builtin_add_overflow(sizeof(RpcWireTransaction), data.dataSize(),
+                                               &bodySize) ||
+                                __builtin_add_overflow(objectTableSpan.byteSize(), bodySize,
+                                                       &bodySize),
+                        "Too much data %zu", data.dataSize());
+
+    const bool hasFds = rpcFields->mFds != nullptr && !rpcFields->mFds->empty();
+    bool queue = address != 0 && (flags & IBinder::FLAG_ONEWAY) && connection->batchOneway &&
+            !hasFds &&
+            connection->pendingOneway.size() + sizeof(RpcWireHeader) + bodySize <=
+                    RpcSession::kMaxOnewayBatchBytes;
+
+    // Queued transactions take their async numbers when they are sent. A oneway
+    // transaction which is not queued takes its own now, so they go first.
+    if ((flags & IBinder::FLAG_ONEWAY) && !queue && !connection->pendingOneway.empty()) {
+        if (status_t status = sendPendingOneway(connection, session); status != OK) {
+            return status;
+        }
+    }
+
     uint64_t asyncNumber = 0;
+    sp<IBinder> queuedBinder;
 
     if (address != 0) {
         RpcMutexUniqueLock _l(mNodeMutex);
@@ -552,7 +648,13 @@ status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connecti
         LOG_ALWAYS_FATAL_IF(it == mNodeForAddress.end(),
                             "Sending transact on unknown address %" PRIu64, address);
 
-        if (flags & IBinder::FLAG_ONEWAY) {
+        if (queue) {
+            // Keeps the node until the transaction is sent. If nothing else holds the
+            // binder, nothing to it is queued either, so it may as well be sent now.
+            queuedBinder = it->second.binder.promote();
+            queue = queuedBinder != nullptr;
+        }
+        if ((flags & IBinder::FLAG_ONEWAY) && !queue) {
             asyncNumber = it->second.asyncNumber;
             if (!nodeProgressAsyncNumber(&it->second)) {
                 _l.unlock();
@@ -562,18 +664,6 @@ status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connecti
         }
     }
 
-    auto* rpcFields = data.maybeRpcFields();
-    LOG_ALWAYS_FATAL_IF(rpcFields == nullptr);
-
-    Span<const uint32_t> objectTableSpan = Span<const uint32_t>{rpcFields->mObjectPositions.data(),
-                                                                rpcFields->mObjectPositions.size()};
-
-    uint32_t bodySize;
-    LOG_ALWAYS_FATAL_IF(__builtin_add_overflow(sizeof(RpcWireTransaction), data.dataSize(),
-                                               &bodySize) ||
-                                __builtin_add_overflow(objectTableSpan.byteSize(), bodySize,
-                                                       &bodySize),
-                        "Too much data %zu", data.dataSize());
     RpcWireHeader command{
             .command = RPC_COMMAND_TRANSACT,
             .bodySize = bodySize,
@@ -588,35 +678,35 @@ status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connecti
             .parcelDataSize = static_cast<uint32_t>(data.dataSize()),
     };
 
-    // Oneway calls have no sync point, so if many are sent before, whether this
-    // is a twoway or oneway transaction, they may have filled up the socket.
-    // So, make sure we drain them before polling
-    constexpr size_t kWaitMaxUs = 1000000;
-    constexpr size_t kWaitLogUs = 10000;
-    size_t waitUs = 0;
-
     iovec iovs[]{
             {&command, sizeof(RpcWireHeader)},
             {&transaction, sizeof(RpcWireTransaction)},
             {const_cast<uint8_t*>(data.data()), data.dataSize()},
             objectTableSpan.toIovec(),
     };
-    auto altPoll = [&] {
-        if (waitUs > kWaitLogUs) {
-            ALOGE("Cannot send command, trying to process pending refcounts. Waiting "
-                  "%zuus. Too many oneway calls?",
-                  waitUs);
-        }
 
-        if (waitUs > 0) {
-            usleep(waitUs);
-            waitUs = std::min(kWaitMaxUs, waitUs * 2);
-        } else {
-            waitUs = 1;
+    if (queue) {
+        connection->pendingOnewayTransactions.push_back({
+                .asyncNumberOffset = connection->pendingOneway.size() + sizeof(RpcWireHeader) +
+                        offsetof(RpcWireTransaction, asyncNumber),
+                .address = address,
+                .binder = std::move(queuedBinder),
+        });
+        for (const iovec& iov : iovs) {
+            const uint8_t* base = reinterpret_cast<const uint8_t*>(iov.iov_base);
+            connection->pendingOneway.insert(connection->pendingOneway.end(), base,
+                                             base + iov.iov_len);
         }
+        LOG_RPC_DETAIL("Queued oneway command, %zu bytes queued on RpcTransport %p",
+                       connection->pendingOneway.size(), connection->rpcTransport.get());
+        return OK;
+    }
 
-        return drainCommands(connection, session, CommandType::CONTROL_ONLY);
-    };
+    // Oneway calls have no sync point, so if many are sent before, whether this
+    // is a twoway or oneway transaction, they may have filled up the socket.
+    // So, make sure we drain them before polling
+    size_t waitUs = 0;
+    auto altPoll = [&] { return drainWhileSending(connection, session, &waitUs); };
     if (status_t status = rpcSend(connection, session, "transaction", iovs, countof(iovs),
                                   std::ref(altPoll), rpcFields->mFds.get());
         status != OK) {
@@ -639,6 +729,43 @@ status_t RpcState::transactAddress(const sp<RpcSession::RpcConnection>& connecti
     return waitForReply(connection, session, reply);
 }
 
+status_t RpcState::flushOneway(const sp<RpcSession::RpcConnection>& connection,
+                               const sp<RpcSession>& session) {
+    // any error is also kept in pendingOnewayError
+    (void)sendPendingOneway(connection, session);
+    return std::exchange(connection->pendingOnewayError, OK);
+}
+
+status_t RpcState::sendPendingOneway(const sp<RpcSession::RpcConnection>& connection,
+                                     const sp<RpcSession>& session) {
+    if (connection->pendingOneway.empty()) return OK;
+
+    size_t waitUs = 0;
+    auto altPoll = [&] { return drainWhileSending(connection, session, &waitUs); };
+    return rpcSend(connection, session, "oneway batch", nullptr, 0, std::ref(altPoll));
+}
+
+status_t RpcState::drainWhileSending(const sp<RpcSession::RpcConnection>& connection,
+                                     const sp<RpcSession>& session, size_t* waitUs) {
+    constexpr size_t kWaitMaxUs = 1000000;
+    constexpr size_t kWaitLogUs = 10000;
+
+    if (*waitUs > kWaitLogUs) {
+        ALOGE("Cannot send command, trying to process pending refcounts. Waiting "
+              "%zuus. Too many oneway calls?",
+              *waitUs);
+    }
+
+    if (*waitUs > 0) {
+        usleep(*waitUs);
+        *waitUs = std::min(kWaitMaxUs, *waitUs * 2);
+    } else {
+        *waitUs = 1;
+    }
+
+    return drainCommands(connection, session, CommandType::CONTROL_ONLY);
+}
+
 static void cleanup_reply_data(const uint8_t* data, size_t dataSize, const binder_size_t* objects,
                                size_t objectsCount) {
     delete[] const_cast<uint8_t*>(data);
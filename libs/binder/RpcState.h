@@ -90,6 +90,14 @@ public:
                                            const sp<RpcSession>& session, Parcel* reply,
                                            uint32_t flags);
 
+    /**
+     * Writes the oneway transactions queued on the connection by an
+     * RpcSession::OnewayBatch, if there are any. Returns the first error sending
+     * queued transactions since the last flush.
+     */
+    [[nodiscard]] status_t flushOneway(const sp<RpcSession::RpcConnection>& connection,
+                                       const sp<RpcSession>& session);
+
     /**
      * The ownership model here carries an implicit strong refcount whenever a
      * binder is sent across processes. Since we have a local strong count in
@@ -188,12 +196,29 @@ private:
         size_t mSize;
     };
 
+    // Sends any oneway transactions queued on the connection, then iovs.
     [[nodiscard]] status_t rpcSend(
             const sp<RpcSession::RpcConnection>& connection, const sp<RpcSession>& session,
             const char* what, iovec* iovs, int niovs,
             const std::optional<binder::impl::SmallFunction<status_t()>>& altPoll,
             const std::vector<std::variant<binder::unique_fd, binder::borrowed_fd>>* ancillaryFds =
                     nullptr);
+    // Takes the async numbers of the queued oneway transactions, in the order they
+    // were queued, and writes them into pending.
+    [[nodiscard]] status_t numberPendingOneway(
+            const sp<RpcSession>& session, std::vector<uint8_t>* pending,
+            const std::vector<RpcSession::RpcConnection::PendingOnewayTransaction>& transactions);
+    [[nodiscard]] status_t sendPendingOneway(const sp<RpcSession::RpcConnection>& connection,
+                                             const sp<RpcSession>& session);
+    [[nodiscard]] status_t rpcSendIovs(
+            const sp<RpcSession::RpcConnection>& connection, const sp<RpcSession>& session,
+            const char* what, iovec* iovs, int niovs,
+            const std::optional<binder::impl::SmallFunction<status_t()>>& altPoll,
+            const std::vector<std::variant<binder::unique_fd, binder::borrowed_fd>>* ancillaryFds);
+    // Used as altPoll while writing transactions: processes refcount commands from the other
+    // side, in case it is blocked writing them to us, backing off while there are none.
+    [[nodiscard]] status_t drainWhileSending(const sp<RpcSession::RpcConnection>& connection,
+                                             const sp<RpcSession>& session, size_t* waitUs);
     [[nodiscard]] status_t rpcRec(const sp<RpcSession::RpcConnection>& connection,
                                   const sp<RpcSession>& session, const char* what, iovec* iovs,
                                   int niovs,
@@ -0,0 +1,569 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "RpcShmTransport"
+#include <log/log.h>
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+
+#include <binder/RpcTransportRaw.h>
+#include <binder/RpcTransportShm.h>
+
+#include "FdTrigger.h"
+#include "OS.h"
+#include "RpcState.h"
+#include "RpcTransportUtils.h"
+
+namespace android {
+
+using namespace android::binder::impl;
+using android::binder::borrowed_fd;
+using android::binder::unique_fd;
+
+namespace {
+
+constexpr size_t kMinRingCapacity = 4 * 1024;
+constexpr size_t kMaxRingCapacity = 16 * 1024 * 1024;
+
+// How long to watch the ring before asking the other side for a doorbell. The
+// reply to a synchronous call usually comes within this, so neither side has
+// to touch the socket for it.
+constexpr std::chrono::microseconds kSpinTime{50};
+
+// Shared between both processes, at the start of each ring. The writer only
+// advances tail and the reader only advances head, both count bytes since the
+// connection was made.
+struct RingHeader {
+    alignas(64) std::atomic<uint64_t> tail;
+    // number of kFds control messages the writer sent so far
+    std::atomic<uint64_t> fdMessages;
+
+    alignas(64) std::atomic<uint64_t> head;
+
+    // set before sleeping until there is data (or room), once spinning for it
+    // timed out, so that the other side knows to send a doorbell on the socket
+    alignas(64) std::atomic<uint32_t> readerWaiting;
+    alignas(64) std::atomic<uint32_t> writerWaiting;
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+// Everything written to the socket, once the rings are set up.
+struct ControlMessage {
+    enum : uint32_t {
+        kHello = 1,
+        // the other side may have data, or room, for us
+        kDoorbell = 2,
+        // carries file descriptors for the byte of the stream at position
+        kFds = 3,
+    };
+
+    uint32_t type = 0;
+    // kHello: capacity of each ring
+    uint32_t value = 0;
+    // kHello: kHelloMagic, kFds: position in the stream
+    uint64_t position = 0;
+};
+static_assert(sizeof(ControlMessage) == 16);
+
+constexpr uint64_t kHelloMagic = 0x4d48'5350'5242'4e42; // "BNBRPSHM"
+
+struct Ring {
+    RingHeader* header = nullptr;
+    uint8_t* data = nullptr;
+    size_t capacity = 0;
+};
+
+size_t ringStride(size_t capacity) {
+    return sizeof(RingHeader) + capacity;
+}
+
+size_t mappingSize(size_t capacity) {
+    return 2 * ringStride(capacity);
+}
+
+// ring 0 goes from the client to the server, ring 1 from the server to the client
+Ring ringAt(uint8_t* mapping, size_t capacity, size_t index) {
+    uint8_t* base = mapping + index * ringStride(capacity);
+    return Ring{
+            .header = reinterpret_cast<RingHeader*>(base),
+            .data = base + sizeof(RingHeader),
+            .capacity = capacity,
+    };
+}
+
+bool isUnixDomainSocket(const RpcTransportFd& socket) {
+    int domain = 0;
+    socklen_t length = sizeof(domain);
+    if (getsockopt(socket.fd.get(), SOL_SOCKET, SO_DOMAIN, &domain, &length) != 0) {
+        return false;
+    }
+    return domain == AF_UNIX;
+}
+
+void relaxCpu() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield" ::: "memory");
+#endif
+}
+
+// Returns whether ready() became true within kSpinTime.
+template <typename Ready>
+bool spinUntil(const Ready& ready) {
+    const auto deadline = std::chrono::steady_clock::now() + kSpinTime;
+    do {
+        if (ready()) return true;
+        relaxCpu();
+    } while (std::chrono::steady_clock::now() < deadline);
+    return ready();
+}
+
+bool isValidRingCapacity(size_t capacity) {
+    return capacity >= kMinRingCapacity && capacity <= kMaxRingCapacity &&
+            (capacity & (capacity - 1)) == 0;
+}
+
+} // namespace
+
+// RpcTransport over a pair of rings in shared memory.
+class RpcTransportShm : public RpcTransport {
+public:
+    RpcTransportShm(android::RpcTransportFd socket, uint8_t* mapping, size_t capacity,
+                    bool isClient)
+          : mSocket(std::move(socket)),
+            mMapping(mapping),
+            mCapacity(capacity),
+            mTx(ringAt(mapping, capacity, isClient ? 0 : 1)),
+            mRx(ringAt(mapping, capacity, isClient ? 1 : 0)) {}
+
+    ~RpcTransportShm() { munmap(mMapping, mappingSize(mCapacity)); }
+
+    status_t pollRead(void) override {
+        if (mRx.header->tail.load(std::memory_order_acquire) != mRxHead) return OK;
+
+        // Also notices when the other side is gone.
+        if (status_t status = drainControl(); status != OK) return status;
+        return mRx.header->tail.load(std::memory_order_acquire) != mRxHead ? OK : WOULD_BLOCK;
+    }
+
+    status_t interruptableWriteFully(
+            FdTrigger* fdTrigger, iovec* iovs, int niovs,
+            const std::optional<SmallFunction<status_t()>>& altPoll,
+            const std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) override {
+        MAYBE_WAIT_IN_FLAKE_MODE;
+
+        if (niovs < 0) return BAD_VALUE;
+        if (fdTrigger->isTriggered()) return DEAD_OBJECT;
+
+        if (ancillaryFds != nullptr && !ancillaryFds->empty()) {
+            // Sent before the data they go with is in the ring, so they are already in
+            // the socket when the other side counts them.
+            ControlMessage message{.type = ControlMessage::kFds, .position = mTxTail};
+            if (status_t status = sendControl(fdTrigger, message, ancillaryFds); status != OK) {
+                return status;
+            }
+            mTx.header->fdMessages.store(++mFdMessagesSent, std::memory_order_release);
+        }
+
+        for (int i = 0; i < niovs; i++) {
+            const uint8_t* buffer = reinterpret_cast<const uint8_t*>(iovs[i].iov_base);
+            size_t size = iovs[i].iov_len;
+            while (size > 0) {
+                const uint64_t head = mTx.header->head.load(std::memory_order_acquire);
+                // head is written by the other side, check it before subtracting
+                if (head > mTxTail || mTxTail - head > mCapacity) {
+                    ALOGE("Shared memory ring is corrupt: head %" PRIu64 ", tail %" PRIu64, head,
+                          mTxTail);
+                    return BAD_VALUE;
+                }
+                const uint64_t used = mTxTail - head;
+                if (used == mCapacity) {
+                    if (status_t status = waitForRoom(fdTrigger, head, altPoll); status != OK) {
+                        return status;
+                    }
+                    continue;
+                }
+
+                const size_t count = std::min<size_t>(size, mCapacity - used);
+                copyToRing(buffer, count);
+                buffer += count;
+                size -= count;
+                mTxTail += count;
+                mTx.header->tail.store(mTxTail, std::memory_order_seq_cst);
+                if (status_t status = wakeOther(fdTrigger, &mTx.header->readerWaiting);
+                    status != OK) {
+                    return status;
+                }
+            }
+        }
+        return OK;
+    }
+
+    status_t interruptableReadFully(
+            FdTrigger* fdTrigger, iovec* iovs, int niovs,
+            const std::optional<SmallFunction<status_t()>>& altPoll,
+            std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) override {
+        MAYBE_WAIT_IN_FLAKE_MODE;
+
+        if (niovs < 0) return BAD_VALUE;
+        if (fdTrigger->isTriggered()) return DEAD_OBJECT;
+
+        for (int i = 0; i < niovs; i++) {
+            uint8_t* buffer = reinterpret_cast<uint8_t*>(iovs[i].iov_base);
+            size_t size = iovs[i].iov_len;
+            while (size > 0) {
+                const uint64_t tail = mRx.header->tail.load(std::memory_order_acquire);
+                // tail is written by the other side, check it before subtracting
+                if (tail < mRxHead || tail - mRxHead > mCapacity) {
+                    ALOGE("Shared memory ring is corrupt: head %" PRIu64 ", tail %" PRIu64,
+                          mRxHead, tail);
+                    return BAD_VALUE;
+                }
+                const uint64_t available = tail - mRxHead;
+                if (available == 0) {
+                    if (status_t status = waitForData(fdTrigger, altPoll); status != OK) {
+                        return status;
+                    }
+                    continue;
+                }
+
+                const size_t count = std::min<size_t>(size, available);
+                if (status_t status = takeFds(fdTrigger, count, ancillaryFds); status != OK) {
+                    return status;
+                }
+                copyFromRing(buffer, count);
+                buffer += count;
+                size -= count;
+                mRxHead += count;
+                mRx.header->head.store(mRxHead, std::memory_order_seq_cst);
+                if (status_t status = wakeOther(fdTrigger, &mRx.header->writerWaiting);
+                    status != OK) {
+                    return status;
+                }
+            }
+        }
+        return OK;
+    }
+
+    bool isWaiting() override { return mSocket.isInPollingState(); }
+
+private:
+    friend class RpcTransportCtxShm;
+
+    void copyToRing(const uint8_t* buffer, size_t count) {
+        const size_t offset = mTxTail & (mCapacity - 1);
+        const size_t first = std::min(count, mCapacity - offset);
+        memcpy(mTx.data + offset, buffer, first);
+        memcpy(mTx.data, buffer + first, count - first);
+    }
+
+    void copyFromRing(uint8_t* buffer, size_t count) {
+        const size_t offset = mRxHead & (mCapacity - 1);
+        const size_t first = std::min(count, mCapacity - offset);
+        memcpy(buffer, mRx.data + offset, first);
+        memcpy(buffer + first, mRx.data, count - first);
+    }
+
+    // Sends a doorbell if the other side said it is waiting.
+    status_t wakeOther(FdTrigger* fdTrigger, std::atomic<uint32_t>* waiting) {
+        if (waiting->exchange(0, std::memory_order_seq_cst) == 0) return OK;
+        return sendControl(fdTrigger, ControlMessage{.type = ControlMessage::kDoorbell}, nullptr);
+    }
+
+    status_t waitForData(FdTrigger* fdTrigger,
+                         const std::optional<SmallFunction<status_t()>>& altPoll) {
+        if (spinUntil([&] {
+                return mRx.header->tail.load(std::memory_order_acquire) != mRxHead;
+            })) {
+            return OK;
+        }
+
+        mRx.header->readerWaiting.store(1, std::memory_order_seq_cst);
+        // the writer may have added data before it could see the flag
+        if (mRx.header->tail.load(std::memory_order_seq_cst) != mRxHead) {
+            mRx.header->readerWaiting.store(0, std::memory_order_relaxed);
+            return OK;
+        }
+        return waitForControl(fdTrigger, altPoll);
+    }
+
+    status_t waitForRoom(FdTrigger* fdTrigger, uint64_t head,
+                         const std::optional<SmallFunction<status_t()>>& altPoll) {
+        if (spinUntil([&] { return mTx.header->head.load(std::memory_order_acquire) != head; })) {
+            return OK;
+        }
+
+        mTx.header->writerWaiting.store(1, std::memory_order_seq_cst);
+        if (mTx.header->head.load(std::memory_order_seq_cst) != head) {
+            mTx.header->writerWaiting.store(0, std::memory_order_relaxed);
+            return OK;
+        }
+        return waitForControl(fdTrigger, altPoll);
+    }
+
+    status_t waitForControl(FdTrigger* fdTrigger,
+                            const std::optional<SmallFunction<status_t()>>& altPoll) {
+        if (altPoll) {
+            if (status_t status = (*altPoll)(); status != OK) return status;
+            if (fdTrigger->isTriggered()) return DEAD_OBJECT;
+        } else {
+            if (status_t status = fdTrigger->triggerablePoll(mSocket, POLLIN); status != OK) {
+                return status;
+            }
+        }
+        return drainControl();
+    }
+
+    // Moves the file descriptors going with the next count bytes of the stream to
+    // ancillaryFds, or closes them if it is null.
+    status_t takeFds(FdTrigger* fdTrigger, size_t count,
+                     std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) {
+        while (mRx.header->fdMessages.load(std::memory_order_acquire) != mFdMessagesReceived) {
+            if (status_t status = drainControl(); status != OK) return status;
+            if (mRx.header->fdMessages.load(std::memory_order_acquire) == mFdMessagesReceived) {
+                break;
+            }
+            if (status_t status = fdTrigger->triggerablePoll(mSocket, POLLIN); status != OK) {
+                return status;
+            }
+        }
+
+        while (!mPendingFds.empty() && mPendingFds.front().position < mRxHead + count) {
+            if (ancillaryFds != nullptr) {
+                for (auto& fd : mPendingFds.front().fds) {
+                    ancillaryFds->push_back(std::move(fd));
+                }
+            }
+            mPendingFds.pop_front();
+        }
+        return OK;
+    }
+
+    status_t sendControl(FdTrigger* fdTrigger, ControlMessage message,
+                         const std::vector<std::variant<unique_fd, borrowed_fd>>* ancillaryFds) {
+        iovec iov{&message, sizeof(message)};
+        bool sentFds = false;
+        auto send = [&](iovec* iovs, int niovs) -> ssize_t {
+            ssize_t ret = binder::os::sendMessageOnSocket(mSocket, iovs, niovs,
+                                                          sentFds ? nullptr : ancillaryFds);
+            sentFds |= ret > 0;
+            return ret;
+        };
+        return interruptableReadOrWrite(mSocket, fdTrigger, &iov, 1, send, "sendmsg", POLLOUT,
+                                        std::nullopt);
+    }
+
+    // Reads whatever control messages are in the socket, without blocking.
+    status_t drainControl() {
+        while (true) {
+            iovec iov{reinterpret_cast<uint8_t*>(&mControl) + mControlSize,
+                      sizeof(mControl) - mControlSize};
+            ssize_t ret = binder::os::receiveMessageFromSocket(mSocket, &iov, 1, &mControlFds);
+            if (ret < 0) {
+                int savedErrno = errno;
+                if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) return OK;
+                LOG_RPC_DETAIL("RpcTransportShm recvmsg(): %s", strerror(savedErrno));
+                return -savedErrno;
+            }
+            if (ret == 0) return DEAD_OBJECT;
+
+            mControlSize += ret;
+            if (mControlSize < sizeof(mControl)) continue;
+            mControlSize = 0;
+
+            switch (mControl.type) {
+                case ControlMessage::kDoorbell:
+                    break;
+                case ControlMessage::kFds:
+                    mPendingFds.push_back(PendingFds{mControl.position, std::move(mControlFds)});
+                    mFdMessagesReceived++;
+                    break;
+                default:
+                    ALOGE("Unexpected control message %" PRIu32, mControl.type);
+                    return BAD_VALUE;
+            }
+            // any that came with a doorbell are dropped
+            mControlFds.clear();
+        }
+    }
+
+    struct PendingFds {
+        uint64_t position;
+        std::vector<std::variant<unique_fd, borrowed_fd>> fds;
+    };
+
+    android::RpcTransportFd mSocket;
+    uint8_t* const mMapping;
+    const size_t mCapacity;
+    const Ring mTx;
+    const Ring mRx;
+
+    // Our own copies of the positions, the shared ones may be written by the other side.
+    uint64_t mTxTail = 0;
+    uint64_t mRxHead = 0;
+    uint64_t mFdMessagesSent = 0;
+    uint64_t mFdMessagesReceived = 0;
+
+    // a control message may arrive in pieces
+    ControlMessage mControl{};
+    size_t mControlSize = 0;
+    std::vector<std::variant<unique_fd, borrowed_fd>> mControlFds;
+    std::deque<PendingFds> mPendingFds;
+};
+
+// RpcTransportCtx which sets up the rings when connecting over a Unix domain socket.
+class RpcTransportCtxShm : public RpcTransportCtx {
+public:
+    RpcTransportCtxShm(bool isClient, size_t ringCapacity)
+          : mIsClient(isClient),
+            mRingCapacity(ringCapacity),
+            mRawCtx(isClient ? RpcTransportCtxFactoryRaw::make()->newClientCtx()
+                             : RpcTransportCtxFactoryRaw::make()->newServerCtx()) {}
+
+    std::unique_ptr<RpcTransport> newTransport(android::RpcTransportFd socket,
+                                               FdTrigger* fdTrigger) const override {
+        if (!isUnixDomainSocket(socket)) {
+            return mRawCtx->newTransport(std::move(socket), fdTrigger);
+        }
+        return mIsClient ? connect(std::move(socket), fdTrigger)
+                         : accept(std::move(socket), fdTrigger);
+    }
+
+    std::vector<uint8_t> getCertificate(RpcCertificateFormat) const override { return {}; }
+
+private:
+    // Creates the rings and sends them to the server.
+    std::unique_ptr<RpcTransport> connect(android::RpcTransportFd socket,
+                                          FdTrigger* fdTrigger) const {
+        const size_t size = mappingSize(mRingCapacity);
+        unique_fd memfd(memfd_create("binder_rpc_shm", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+        if (!memfd.ok()) {
+            ALOGE("Could not create memfd: %s", strerror(errno));
+            return nullptr;
+        }
+        // The server checks for these seals, so that the memory can not be taken
+        // away from under it, which would fault on access.
+        if (ftruncate(memfd.get(), static_cast<off_t>(size)) != 0 ||
+            fcntl(memfd.get(), F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+            ALOGE("Could not size memfd: %s", strerror(errno));
+            return nullptr;
+        }
+        void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd.get(), 0);
+        if (mapping == MAP_FAILED) {
+            ALOGE("Could not map memfd: %s", strerror(errno));
+            return nullptr;
+        }
+        auto transport =
+                std::make_unique<RpcTransportShm>(std::move(socket),
+                                                  reinterpret_cast<uint8_t*>(mapping),
+                                                  mRingCapacity, true /*isClient*/);
+
+        ControlMessage hello{
+                .type = ControlMessage::kHello,
+                .value = static_cast<uint32_t>(mRingCapacity),
+                .position = kHelloMagic,
+        };
+        std::vector<std::variant<unique_fd, borrowed_fd>> fds;
+        fds.push_back(borrowed_fd(memfd.get()));
+        if (status_t status = transport->sendControl(fdTrigger, hello, &fds); status != OK) {
+            ALOGE("Could not send shared memory to server: %s", statusToString(status).c_str());
+            return nullptr;
+        }
+        return transport;
+    }
+
+    // Receives the rings from the client.
+    std::unique_ptr<RpcTransport> accept(android::RpcTransportFd socket,
+                                         FdTrigger* fdTrigger) const {
+        ControlMessage hello{};
+        iovec iov{&hello, sizeof(hello)};
+        std::vector<std::variant<unique_fd, borrowed_fd>> fds;
+        auto recv = [&](iovec* iovs, int niovs) -> ssize_t {
+            return binder::os::receiveMessageFromSocket(socket, iovs, niovs, &fds);
+        };
+        if (status_t status = interruptableReadOrWrite(socket, fdTrigger, &iov, 1, recv,
+                                                       "recvmsg", POLLIN, std::nullopt);
+            status != OK) {
+            ALOGE("Could not receive shared memory from client: %s",
+                  statusToString(status).c_str());
+            return nullptr;
+        }
+        if (hello.type != ControlMessage::kHello || hello.position != kHelloMagic ||
+            fds.size() != 1 || !isValidRingCapacity(hello.value)) {
+            ALOGE("Client did not set up shared memory, is it using RpcTransportCtxFactoryShm?");
+            return nullptr;
+        }
+
+        const size_t capacity = hello.value;
+        const size_t size = mappingSize(capacity);
+        const int memfd = std::get<unique_fd>(fds[0]).get();
+        struct stat st;
+        const int seals = fcntl(memfd, F_GET_SEALS);
+        if (fstat(memfd, &st) != 0 || static_cast<size_t>(st.st_size) != size || seals < 0 ||
+            (seals & (F_SEAL_SHRINK | F_SEAL_GROW)) != (F_SEAL_SHRINK | F_SEAL_GROW)) {
+            ALOGE("Shared memory from client is not usable");
+            return nullptr;
+        }
+        void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+        if (mapping == MAP_FAILED) {
+            ALOGE("Could not map shared memory from client: %s", strerror(errno));
+            return nullptr;
+        }
+        return std::make_unique<RpcTransportShm>(std::move(socket),
+                                                 reinterpret_cast<uint8_t*>(mapping), capacity,
+                                                 false /*isClient*/);
+    }
+
+    const bool mIsClient;
+    const size_t mRingCapacity;
+    const std::unique_ptr<RpcTransportCtx> mRawCtx;
+};
+
+std::unique_ptr<RpcTransportCtx> RpcTransportCtxFactoryShm::newServerCtx() const {
+    return std::make_unique<RpcTransportCtxShm>(false /*isClient*/, mRingCapacity);
+}
+
+std::unique_ptr<RpcTransportCtx> RpcTransportCtxFactoryShm::newClientCtx() const {
+    return std::make_unique<RpcTransportCtxShm>(true /*isClient*/, mRingCapacity);
+}
+
+const char* RpcTransportCtxFactoryShm::toCString() const {
+    return "shm";
+}
+
+std::unique_ptr<RpcTransportCtxFactory> RpcTransportCtxFactoryShm::make(size_t ringCapacity) {
+    LOG_ALWAYS_FATAL_IF(!isValidRingCapacity(ringCapacity), "Invalid ring capacity %zu",
+                        ringCapacity);
+    return std::unique_ptr<RpcTransportCtxFactoryShm>(
+            new RpcTransportCtxFactoryShm(ringCapacity));
+}
+
+} // namespace android
@@ -635,6 +635,9 @@ private:
     void                releaseObjects();
     void                acquireObjects();
     status_t            growData(size_t len);
+    // Make room for `len` more bytes at the data position, growing the data
+    // once instead of once per write while they are made.
+    status_t            reserveWrite(size_t len);
     // Clear the Parcel and set the capacity to `desired`.
     // Doesn't reset the RPC session association.
     status_t            restartWrite(size_t desired);
@@ -1007,10 +1010,17 @@ private:
         using T = first_template_type_t<CT>;  // The T in CT == C<T, ...>
         if (c.size() >  std::numeric_limits<int32_t>::max()) return BAD_VALUE;
         const auto size = static_cast<int32_t>(c.size());
-        writeData(size);
         if constexpr (is_pointer_equivalent_array_v<T>) {
             constexpr size_t limit = std::numeric_limits<size_t>::max() / sizeof(T);
             if (c.size() > limit) return BAD_VALUE;
+            // the size and the elements are written separately, grow for both at once.
+            (void)reserveWrite(sizeof(int32_t) + c.size() * sizeof(T));
+        } else if constexpr (std::is_same_v<T, bool>
+                || std::is_same_v<T, char16_t>) {
+            (void)reserveWrite(sizeof(int32_t) + c.size() * sizeof(int32_t));
+        }
+        writeData(size);
+        if constexpr (is_pointer_equivalent_array_v<T>) {
             // is_pointer_equivalent types do not have gaps which could leak info,
             // which is only a concern when writing through binder.
 
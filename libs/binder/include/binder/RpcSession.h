@@ -193,6 +193,32 @@ public:
     [[nodiscard]] status_t transact(const sp<IBinder>& binder, uint32_t code, const Parcel& data,
                                     Parcel* reply, uint32_t flags);
 
+    /**
+     * While an OnewayBatch is alive, oneway transactions this thread makes on
+     * the session are queued on one outgoing connection, which the batch keeps,
+     * and are written to it together instead of with one write each. They are
+     * sent when flush() is called or the batch is destroyed, ahead of any other
+     * command this thread sends (e.g. a synchronous transaction, in the same
+     * write), or once kMaxOnewayBatchBytes are queued.
+     *
+     * Synchronous transactions made by this thread in the meantime use the same
+     * connection, so they are processed after the queued oneway transactions.
+     * Queued transactions are ordered with oneway transactions to the same
+     * binder from other threads as of when they are sent, not when they are
+     * queued. Transactions carrying file descriptors are never queued.
+     *
+     * If no outgoing connection can be kept (e.g. the session has none),
+     * or this thread already has a batch, this does nothing.
+     *
+     * The batch keeps its connection for as long as it exists, even when
+     * nothing is queued. Calls from other threads on the session cannot use
+     * it, so with a single outgoing connection they block until the batch is
+     * destroyed. Do not wait on another thread that calls into the session
+     * while a batch is open, and keep batches short-lived.
+     */
+    class OnewayBatch;
+    static constexpr size_t kMaxOnewayBatchBytes = 64 * 1024;
+
     /**
      * Generally, you should not call this, unless you are testing error
      * conditions, as this is called automatically by BpBinders when they are
@@ -258,6 +284,24 @@ private:
         std::optional<uint64_t> exclusiveTid;
 
         bool allowNested = false;
+
+        // set while an OnewayBatch keeps this connection, for oneway
+        // transactions to be queued in pendingOneway
+        bool batchOneway = false;
+        // serialized commands, written ahead of the next one sent
+        std::vector<uint8_t> pendingOneway;
+        // The transactions in pendingOneway. Their async numbers are only taken
+        // when they are sent, so that oneway transactions to the same binder
+        // from other threads are not held behind them until then. The binder
+        // is kept until they are sent.
+        struct PendingOnewayTransaction {
+            size_t asyncNumberOffset;
+            uint64_t address;
+            sp<IBinder> binder;
+        };
+        std::vector<PendingOnewayTransaction> pendingOnewayTransactions;
+        // the first error sending pendingOneway, returned by OnewayBatch::flush()
+        status_t pendingOnewayError = OK;
     };
 
     [[nodiscard]] status_t readId();
@@ -394,4 +438,23 @@ private:
     } mConnections;
 };
 
+class RpcSession::OnewayBatch {
+public:
+    explicit OnewayBatch(const sp<RpcSession>& session);
+    ~OnewayBatch();
+
+    /**
+     * Sends the oneway transactions queued so far. Returns the first error
+     * sending any of them since the last flush, also when they went out ahead of
+     * another command. Errors sending them when the batch is destroyed can only
+     * be logged, so call this to check for them.
+     */
+    [[nodiscard]] status_t flush();
+
+private:
+    sp<RpcSession> mSession;
+    // null if the batch does nothing
+    std::unique_ptr<ExclusiveConnection> mConnection;
+};
+
 } // namespace android
@@ -41,10 +41,12 @@ struct RpcTransportFd;
 
 // for 'friend'
 class RpcTransportRaw;
+class RpcTransportShm;
 class RpcTransportTls;
 class RpcTransportTipcAndroid;
 class RpcTransportTipcTrusty;
 class RpcTransportCtxRaw;
+class RpcTransportCtxShm;
 class RpcTransportCtxTls;
 class RpcTransportCtxTipcAndroid;
 class RpcTransportCtxTipcTrusty;
@@ -114,6 +116,7 @@ private:
     // to add more transports.
 
     friend class ::android::RpcTransportRaw;
+    friend class ::android::RpcTransportShm;
     friend class ::android::RpcTransportTls;
     friend class ::android::RpcTransportTipcAndroid;
     friend class ::android::RpcTransportTipcTrusty;
@@ -145,6 +148,7 @@ public:
 private:
     // see comment on RpcTransport
     friend class ::android::RpcTransportCtxRaw;
+    friend class ::android::RpcTransportCtxShm;
     friend class ::android::RpcTransportCtxTls;
     friend class ::android::RpcTransportCtxTipcAndroid;
     friend class ::android::RpcTransportCtxTipcTrusty;
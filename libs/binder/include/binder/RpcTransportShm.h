@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Wraps the transport layer of RPC. Implementation uses a pair of rings in shared memory
+// for the data, and the socket for wakeups and file descriptors.
+// Note: don't use directly. You probably want newServerRpcTransportCtx / newClientRpcTransportCtx.
+
+#pragma once
+
+#include <memory>
+
+#include <binder/RpcTransport.h>
+
+namespace android {
+
+// RpcTransportCtxFactory for peers on the same host.
+//
+// When the connection is a Unix domain socket, the client creates a memfd holding one
+// ring for each direction and passes it to the server when connecting. Data then goes
+// through the rings and the socket is only written to in order to wake up a peer which
+// waits for data or for room, and to pass file descriptors. This is not zero-copy: each
+// side still copies the data once, into or out of the ring, as it would with a socket.
+// What is saved are the system calls for each read and write. A peer spins on the ring
+// for a few tens of microseconds before it sleeps, so a reply which comes quickly needs
+// no wake up. Other sockets (e.g. vsock or inet) are used as RpcTransportCtxFactoryRaw
+// would use them.
+//
+// Both sides of a session must use this factory. Bootstrap sockets
+// (RpcSession::setupUnixDomainSocketBootstrapClient) are not supported.
+class RpcTransportCtxFactoryShm : public RpcTransportCtxFactory {
+public:
+    static constexpr size_t kDefaultRingCapacity = 256 * 1024;
+
+    // ringCapacity is the size of the ring in each direction of each connection. It must
+    // be a power of two, from 4KB to 16MB.
+    static std::unique_ptr<RpcTransportCtxFactory> make(
+            size_t ringCapacity = kDefaultRingCapacity);
+
+    std::unique_ptr<RpcTransportCtx> newServerCtx() const override;
+    std::unique_ptr<RpcTransportCtx> newClientCtx() const override;
+    const char* toCString() const override;
+
+private:
+    explicit RpcTransportCtxFactoryShm(size_t ringCapacity) : mRingCapacity(ringCapacity) {}
+
+    const size_t mRingCapacity;
+};
+
+} // namespace android
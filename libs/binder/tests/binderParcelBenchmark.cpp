@@ -169,4 +169,76 @@ BENCHMARK(BM_CharVector)->Apply(VectorArgs);
 BENCHMARK(BM_Int32Vector)->Apply(VectorArgs);
 BENCHMARK(BM_Int64Vector)->Apply(VectorArgs);
 
+/*
+  The benchmarks below write into a new Parcel every iteration, so that the
+  cost of growing the data while it is written is part of what is measured.
+*/
+
+// A large payload written piecewise, e.g. a blob of data or a bitmap sent in
+// 4KB byte vectors. Arg is the payload size in KB.
+static void BM_ParcelLargePayload(benchmark::State& state) {
+    const size_t size = state.range(0) * 1024;
+    const std::vector<uint8_t> chunk(4096, 0x5a);
+    for (auto _ : state) {
+        android::Parcel p;
+        for (size_t written = 0; written < size; written += chunk.size()) {
+            p.writeByteVector(chunk);
+        }
+        benchmark::DoNotOptimize(p.data());
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_ParcelLargePayload)->RangeMultiplier(4)->Range(16, 1024);
+
+// Same as above, for a Parcel marked sensitive, which is zeroed whenever it grows.
+static void BM_ParcelLargePayloadSensitive(benchmark::State& state) {
+    const size_t size = state.range(0) * 1024;
+    const std::vector<uint8_t> chunk(4096, 0x5a);
+    for (auto _ : state) {
+        android::Parcel p;
+        p.markSensitive();
+        for (size_t written = 0; written < size; written += chunk.size()) {
+            p.writeByteVector(chunk);
+        }
+        benchmark::DoNotOptimize(p.data());
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_ParcelLargePayloadSensitive)->RangeMultiplier(4)->Range(16, 1024);
+
+// Many small fields, the way a generated parcelable with a lot of members is
+// written, including short vectors. Arg is the number of fields of each type.
+static void BM_ParcelManySmallFields(benchmark::State& state) {
+    const size_t fields = state.range(0);
+    const android::String16 name(u"com.example.field");
+    const std::vector<int32_t> ids = {1, 2, 3, 4};
+    const std::vector<bool> flags = {true, false, true};
+    for (auto _ : state) {
+        android::Parcel p;
+        for (size_t i = 0; i < fields; ++i) {
+            p.writeInt32(static_cast<int32_t>(i));
+            p.writeInt64(static_cast<int64_t>(i));
+            p.writeBool(i & 1);
+            p.writeString16(name);
+            p.writeInt32Vector(ids);
+            p.writeBoolVector(flags);
+        }
+        benchmark::DoNotOptimize(p.data());
+    }
+    state.SetItemsProcessed(state.iterations() * fields * 6);
+}
+BENCHMARK(BM_ParcelManySmallFields)->RangeMultiplier(4)->Range(16, 4096);
+
+// A large vector of a trivial type, written with a single copy after its size.
+static void BM_ParcelLargeInt64Vector(benchmark::State& state) {
+    const std::vector<int64_t> values(state.range(0));
+    for (auto _ : state) {
+        android::Parcel p;
+        p.writeInt64Vector(values);
+        benchmark::DoNotOptimize(p.data());
+    }
+    state.SetBytesProcessed(state.iterations() * values.size() * sizeof(int64_t));
+}
+BENCHMARK(BM_ParcelLargeInt64Vector)->RangeMultiplier(8)->Range(64, 64 * 1024);
+
 BENCHMARK_MAIN();
@@ -361,6 +361,38 @@ TEST_READ_WRITE_INVERSE(int8_t, Byte, {-1, 0, 1});
 TEST_READ_WRITE_INVERSE(String8, String8, {String8(), String8("a"), String8("asdf")});
 TEST_READ_WRITE_INVERSE(String16, String16, {String16(), String16("a"), String16("asdf")});
 
+TEST(Parcel, VectorsAfterOtherDataRoundTrip) {
+    // Vectors of trivial types, bool and char16_t reserve room for their size
+    // and elements before writing them, past whatever was written before.
+    const std::vector<int64_t> longs(1000, 0x0123456789abcdef);
+    const std::vector<bool> bools = {true, false, true, true, false};
+    const std::vector<char16_t> chars(333, u'x');
+
+    for (bool sensitive : {false, true}) {
+        Parcel p;
+        if (sensitive) p.markSensitive();
+        EXPECT_EQ(OK, p.writeInt32(42));
+        EXPECT_EQ(OK, p.writeInt64Vector(longs));
+        EXPECT_EQ(OK, p.writeBoolVector(bools));
+        EXPECT_EQ(OK, p.writeCharVector(chars));
+        EXPECT_EQ(OK, p.writeInt32(43));
+
+        p.setDataPosition(0);
+        EXPECT_EQ(42, p.readInt32());
+        std::vector<int64_t> longsOut;
+        EXPECT_EQ(OK, p.readInt64Vector(&longsOut));
+        EXPECT_EQ(longs, longsOut);
+        std::vector<bool> boolsOut;
+        EXPECT_EQ(OK, p.readBoolVector(&boolsOut));
+        EXPECT_EQ(bools, boolsOut);
+        std::vector<char16_t> charsOut;
+        EXPECT_EQ(OK, p.readCharVector(&charsOut));
+        EXPECT_EQ(chars, charsOut);
+        EXPECT_EQ(43, p.readInt32());
+        EXPECT_EQ(p.dataSize(), p.dataPosition());
+    }
+}
+
 TEST(Parcel, GetOpenAshmemSize) {
     constexpr size_t kSize = 1024;
     constexpr size_t kCount = 3;
@@ -28,9 +28,11 @@
 #include <binder/RpcTlsTestUtils.h>
 #include <binder/RpcTlsUtils.h>
 #include <binder/RpcTransportRaw.h>
+#include <binder/RpcTransportShm.h>
 #include <binder/RpcTransportTls.h>
 #include <openssl/ssl.h>
 
+#include <optional>
 #include <thread>
 
 #include <signal.h>
@@ -74,6 +76,9 @@ class MyBinderRpcBenchmark : public BnBinderRpcBenchmark {
         *out = bytes;
         return Status::ok();
     }
+    Status sendBytesOneway(const std::vector<uint8_t>& /*bytes*/) override {
+        return Status::ok();
+    }
 
     class CountedBinder : public BBinder {
     public:
@@ -118,6 +123,7 @@ enum Transport {
     KERNEL,
     RPC,
     RPC_TLS,
+    RPC_SHM,
 };
 
 static const std::initializer_list<int64_t> kTransportList = {
@@ -126,8 +132,20 @@ static const std::initializer_list<int64_t> kTransportList = {
 #endif
         Transport::RPC,
         Transport::RPC_TLS,
+        Transport::RPC_SHM,
 };
 
+static const std::initializer_list<int64_t> kRpcTransportList = {
+        Transport::RPC,
+        Transport::RPC_TLS,
+        Transport::RPC_SHM,
+};
+
+// Number of threads of the RPC servers used by the oneway benchmarks, and so of connections
+// each of their client sessions makes, for calls from several threads at once. The other
+// benchmarks use servers with the default single thread.
+static constexpr size_t kMaxClientThreads = 4;
+
 std::unique_ptr<RpcTransportCtxFactory> makeFactoryTls() {
     auto pkey = android::makeKeyPairForSelfSignedCert();
     CHECK_NE(pkey.get(), nullptr);
@@ -145,6 +163,15 @@ static sp<IBinder> gRpcBinder;
 // Skip certificate validation to simplify the setup process.
 static sp<RpcSession> gSessionTls = RpcSession::make(makeFactoryTls());
 static sp<IBinder> gRpcTlsBinder;
+static sp<RpcSession> gSessionShm = RpcSession::make(RpcTransportCtxFactoryShm::make());
+static sp<IBinder> gRpcShmBinder;
+// Sessions with kMaxClientThreads connections, for the oneway benchmarks.
+static sp<RpcSession> gOnewaySession = RpcSession::make();
+static sp<IBinder> gOnewayRpcBinder;
+static sp<RpcSession> gOnewaySessionTls = RpcSession::make(makeFactoryTls());
+static sp<IBinder> gOnewayRpcTlsBinder;
+static sp<RpcSession> gOnewaySessionShm = RpcSession::make(RpcTransportCtxFactoryShm::make());
+static sp<IBinder> gOnewayRpcShmBinder;
 #ifdef __BIONIC__
 static const String16 kKernelBinderInstance = String16(u"binderRpcBenchmark-control");
 static sp<IBinder> gKernelBinder;
@@ -161,12 +188,48 @@ static sp<IBinder> getBinderForOptions(benchmark::State& state) {
             return gRpcBinder;
         case RPC_TLS:
             return gRpcTlsBinder;
+        case RPC_SHM:
+            return gRpcShmBinder;
         default:
             LOG(FATAL) << "Unknown transport value: " << transport;
             return nullptr;
     }
 }
 
+static sp<IBinder> getOnewayBinderForOptions(benchmark::State& state) {
+    Transport transport = static_cast<Transport>(state.range(0));
+    switch (transport) {
+#ifdef __BIONIC__
+        case KERNEL:
+            return gKernelBinder;
+#endif
+        case RPC:
+            return gOnewayRpcBinder;
+        case RPC_TLS:
+            return gOnewayRpcTlsBinder;
+        case RPC_SHM:
+            return gOnewayRpcShmBinder;
+        default:
+            LOG(FATAL) << "Unknown transport value: " << transport;
+            return nullptr;
+    }
+}
+
+static sp<RpcSession> getOnewayRpcSessionForOptions(benchmark::State& state) {
+    Transport transport = static_cast<Transport>(state.range(0));
+    switch (transport) {
+        case RPC:
+            return gOnewaySession;
+        case RPC_TLS:
+            return gOnewaySessionTls;
+        case RPC_SHM:
+            return gOnewaySessionShm;
+        default:
+            LOG(FATAL) << "Not an RPC transport: " << transport;
+            return nullptr;
+    }
+}
+
 static void SetLabel(benchmark::State& state) {
     Transport transport = static_cast<Transport>(state.range(0));
     switch (transport) {
@@ -181,6 +244,9 @@ static void SetLabel(benchmark::State& state) {
         case RPC_TLS:
             state.SetLabel("rpc_tls");
             break;
+        case RPC_SHM:
+            state.SetLabel("rpc_shm");
+            break;
         default:
             LOG(FATAL) << "Unknown transport value: " << transport;
     }
@@ -250,6 +316,48 @@ BENCHMARK(BM_throughputForTransportAndBytes)
         ->ArgsProduct({kTransportList,
                        {64, 1024, 2048, 4096, 8182, 16364, 32728, 65535, 65536, 65537}});
 
+// Each benchmark thread sends state.range(2) oneway transactions of state.range(1)
+// bytes, then a synchronous one. With batch, the oneway transactions of each thread are
+// written to its connection together, in the same write as the synchronous one.
+static void onewayTransactions(benchmark::State& state, bool batch) {
+    sp<IBinder> binder = getOnewayBinderForOptions(state);
+    sp<IBinderRpcBenchmark> iface = interface_cast<IBinderRpcBenchmark>(binder);
+    CHECK(iface != nullptr);
+
+    const std::vector<uint8_t> bytes(state.range(1));
+    const size_t calls = state.range(2);
+
+    while (state.KeepRunning()) {
+        std::optional<RpcSession::OnewayBatch> onewayBatch;
+        if (batch) onewayBatch.emplace(getOnewayRpcSessionForOptions(state));
+
+        for (size_t i = 0; i < calls; i++) {
+            Status ret = iface->sendBytesOneway(bytes);
+            CHECK(ret.isOk()) << ret;
+        }
+        CHECK_EQ(OK, binder->pingBinder());
+    }
+
+    state.SetItemsProcessed(state.iterations() * calls);
+    SetLabel(state);
+}
+
+void BM_onewayTransactions(benchmark::State& state) {
+    onewayTransactions(state, false /*batch*/);
+}
+BENCHMARK(BM_onewayTransactions)
+        ->ArgsProduct({kTransportList, {64, 1024, 16384}, {1, 16, 64}})
+        ->ThreadRange(1, kMaxClientThreads)
+        ->UseRealTime();
+
+void BM_onewayTransactionsBatched(benchmark::State& state) {
+    onewayTransactions(state, true /*batch*/);
+}
+BENCHMARK(BM_onewayTransactionsBatched)
+        ->ArgsProduct({kRpcTransportList, {64, 1024, 16384}, {1, 16, 64}})
+        ->ThreadRange(1, kMaxClientThreads)
+        ->UseRealTime();
+
 void BM_collectProxies(benchmark::State& state) {
     sp<IBinder> binder = getBinderForOptions(state);
     sp<IBinderRpcBenchmark> iface = interface_cast<IBinderRpcBenchmark>(binder);
@@ -301,10 +409,11 @@ void BM_repeatBinder(benchmark::State& state) {
 }
 BENCHMARK(BM_repeatBinder)->ArgsProduct({kTransportList});
 
-void forkRpcServer(const char* addr, const sp<RpcServer>& server) {
+void forkRpcServer(const char* addr, const sp<RpcServer>& server, size_t maxThreads = 0) {
     if (0 == fork()) {
         prctl(PR_SET_PDEATHSIG, SIGHUP); // racey, okay
         server->setRootObject(sp<MyBinderRpcBenchmark>::make());
+        if (maxThreads != 0) server->setMaxThreads(maxThreads);
         CHECK_EQ(OK, server->setupUnixDomainServer(addr));
         server->join();
         exit(1);
@@ -356,6 +465,32 @@ int main(int argc, char** argv) {
     setupClient(gSessionTls, tlsAddr.c_str());
     gRpcTlsBinder = gSessionTls->getRootObject();
 
+    std::string shmAddr = tmp + "/binderRpcShmBenchmark";
+    (void)unlink(shmAddr.c_str());
+    forkRpcServer(shmAddr.c_str(), RpcServer::make(RpcTransportCtxFactoryShm::make()));
+    setupClient(gSessionShm, shmAddr.c_str());
+    gRpcShmBinder = gSessionShm->getRootObject();
+
+    std::string onewayAddr = tmp + "/binderRpcOnewayBenchmark";
+    (void)unlink(onewayAddr.c_str());
+    forkRpcServer(onewayAddr.c_str(), RpcServer::make(RpcTransportCtxFactoryRaw::make()),
+                  kMaxClientThreads);
+    setupClient(gOnewaySession, onewayAddr.c_str());
+    gOnewayRpcBinder = gOnewaySession->getRootObject();
+
+    std::string onewayTlsAddr = tmp + "/binderRpcOnewayTlsBenchmark";
+    (void)unlink(onewayTlsAddr.c_str());
+    forkRpcServer(onewayTlsAddr.c_str(), RpcServer::make(makeFactoryTls()), kMaxClientThreads);
+    setupClient(gOnewaySessionTls, onewayTlsAddr.c_str());
+    gOnewayRpcTlsBinder = gOnewaySessionTls->getRootObject();
+
+    std::string onewayShmAddr = tmp + "/binderRpcOnewayShmBenchmark";
+    (void)unlink(onewayShmAddr.c_str());
+    forkRpcServer(onewayShmAddr.c_str(), RpcServer::make(RpcTransportCtxFactoryShm::make()),
+                  kMaxClientThreads);
+    setupClient(gOnewaySessionShm, onewayShmAddr.c_str());
+    gOnewayRpcShmBinder = gOnewaySessionShm->getRootObject();
+
     ::benchmark::RunSpecifiedBenchmarks();
     return 0;
 }
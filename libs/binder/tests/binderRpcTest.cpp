@@ -28,6 +28,7 @@
 #include <dirent.h>
 #include <dlfcn.h>
 #include <poll.h>
+#include <sys/mman.h>
 #include <sys/prctl.h>
 #include <sys/socket.h>
 
@@ -629,6 +630,126 @@ TEST_P(BinderRpc, OnewayCallQueueing) {
     saturateThreadPool(1 + kNumExtraServerThreads, proc.rootIface);
 }
 
+TEST_P(BinderRpc, OnewayBatch) {
+    constexpr size_t kNumCalls = 100;
+
+    auto proc = createRpcTestSocketServerProcess({});
+    const sp<RpcSession>& session = proc.proc->sessions.at(0).session;
+
+    {
+        RpcSession::OnewayBatch batch(session);
+        for (size_t i = 0; i < kNumCalls; i++) {
+            EXPECT_OK(proc.rootIface->sendString("a"));
+        }
+
+        // sent along with the queued transactions
+        std::string doubled;
+        EXPECT_OK(proc.rootIface->doubleString("b", &doubled));
+        EXPECT_EQ("bb", doubled);
+
+        // more than fit in one batch
+        const std::string large(RpcSession::kMaxOnewayBatchBytes / 8, 'c');
+        for (size_t i = 0; i < 10; i++) {
+            EXPECT_OK(proc.rootIface->sendString(large));
+        }
+        EXPECT_EQ(OK, batch.flush());
+
+        for (size_t i = 0; i < kNumCalls; i++) {
+            EXPECT_OK(proc.rootIface->sendString("d"));
+        }
+    }
+
+    std::string doubled;
+    EXPECT_OK(proc.rootIface->doubleString("e", &doubled));
+    EXPECT_EQ("ee", doubled);
+}
+
+TEST_P(BinderRpc, OnewayBatchArrivesInOrder) {
+    if (clientOrServerSingleThreaded()) {
+        GTEST_SKIP() << "This test requires multiple threads";
+    }
+
+    constexpr size_t kNumCalls = 100;
+    constexpr size_t kNumServerThreads = 2;
+
+    // one server thread blocks in the batched calls while another receives from them
+    auto proc = createRpcTestSocketServerProcess({.numThreads = kNumServerThreads});
+    const sp<RpcSession>& session = proc.proc->sessions.at(0).session;
+
+    {
+        RpcSession::OnewayBatch batch(session);
+        for (size_t i = 0; i < kNumCalls; i++) {
+            EXPECT_OK(proc.rootIface->blockingSendIntOneway(i));
+        }
+    }
+    for (size_t i = 0; i < kNumCalls; i++) {
+        int n;
+        EXPECT_OK(proc.rootIface->blockingRecvInt(&n));
+        EXPECT_EQ(n, i);
+    }
+
+    saturateThreadPool(kNumServerThreads, proc.rootIface);
+}
+
+TEST_P(BinderRpc, OnewayBatchDoesNotHoldOtherThreads) {
+    if (clientOrServerSingleThreaded()) {
+        GTEST_SKIP() << "This test requires multiple threads";
+    }
+
+    constexpr size_t kNumServerThreads = 3;
+
+    auto proc = createRpcTestSocketServerProcess({.numThreads = kNumServerThreads});
+    const sp<RpcSession>& session = proc.proc->sessions.at(0).session;
+
+    {
+        RpcSession::OnewayBatch batch(session);
+        EXPECT_OK(proc.rootIface->blockingSendIntOneway(0));
+
+        // Sent on another connection while the call above is still queued. It must
+        // not be held on the server until the batch is sent.
+        std::thread other([&] {
+            EXPECT_OK(proc.rootIface->blockingSendIntOneway(1));
+            int n;
+            EXPECT_OK(proc.rootIface->blockingRecvInt(&n));
+            EXPECT_EQ(n, 1);
+        });
+        other.join();
+    }
+
+    int n;
+    EXPECT_OK(proc.rootIface->blockingRecvInt(&n));
+    EXPECT_EQ(n, 0);
+
+    saturateThreadPool(kNumServerThreads, proc.rootIface);
+}
+
+TEST_P(BinderRpc, OnewayBatchKeepsItsConnection) {
+    if (clientOrServerSingleThreaded()) {
+        GTEST_SKIP() << "This test requires multiple threads";
+    }
+
+    // a single outgoing connection, which the batch keeps
+    auto proc = createRpcTestSocketServerProcess({.numThreads = 1});
+    const sp<RpcSession>& session = proc.proc->sessions.at(0).session;
+
+    std::atomic<bool> otherDone = false;
+    std::thread other;
+    {
+        RpcSession::OnewayBatch batch(session);
+        EXPECT_OK(proc.rootIface->sendString("a"));
+
+        other = std::thread([&] {
+            EXPECT_OK(proc.rootIface->sendString("b"));
+            otherDone = true;
+        });
+        std::this_thread::sleep_for(100ms);
+        EXPECT_FALSE(otherDone) << "another thread used the connection of the batch";
+    }
+
+    other.join();
+    EXPECT_TRUE(otherDone);
+}
+
 TEST_P(BinderRpc, OnewayCallExhaustion) {
     if (clientOrServerSingleThreaded()) {
         GTEST_SKIP() << "This test requires multiple threads";
@@ -1275,7 +1396,7 @@ static std::vector<BinderRpc::ParamType> getBinderRpcParams() {
 
     for (const auto& type : testSocketTypes()) {
         if (full || type == SocketType::UNIX) {
-            for (const auto& security : RpcSecurityValues()) {
+            for (const auto& security : RpcSessionSecurityValues()) {
                 for (const auto& clientVersion : testVersions()) {
                     for (const auto& serverVersion : testVersions()) {
                         for (bool singleThreaded : {false, true}) {
@@ -1769,6 +1890,8 @@ public:
                             ret.emplace_back(socketType, rpcSecurity, RpcCertificateFormat::DER,
                                              serverVersion);
                         } break;
+                        case RpcSecurity::SHM:
+                            break;
                     }
                 }
             }
@@ -2022,6 +2145,107 @@ INSTANTIATE_TEST_CASE_P(BinderRpc, RpcTransportTest,
                         ::testing::ValuesIn(RpcTransportTest::getRpcTranportTestParams()),
                         RpcTransportTest::PrintParamInfo);
 
+// Plays the client of RpcTransportCtxFactoryShm by hand, so that it can write positions
+// into the ring headers which the real client never would.
+class RpcTransportShmCorruptRingTest : public testing::Test {
+protected:
+    // Layout of RpcTransportShm.cpp: two rings, each a 256 byte header followed by the
+    // data. The writer advances tail (offset 0) and the reader advances head (offset 64).
+    static constexpr size_t kCapacity = 4096;
+    static constexpr size_t kHeaderSize = 256;
+    static constexpr size_t kTailOffset = 0;
+    static constexpr size_t kHeadOffset = 64;
+    static constexpr size_t kStride = kHeaderSize + kCapacity;
+    static constexpr size_t kSize = 2 * kStride;
+
+    void SetUp() override {
+        int sockets[2];
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets))
+                << strerror(errno);
+        unique_fd client(sockets[0]);
+        unique_fd server(sockets[1]);
+
+        unique_fd memfd(memfd_create("corrupt_ring", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+        ASSERT_TRUE(memfd.ok()) << strerror(errno);
+        ASSERT_EQ(0, ftruncate(memfd.get(), kSize)) << strerror(errno);
+        ASSERT_EQ(0, fcntl(memfd.get(), F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW))
+                << strerror(errno);
+        void* mapping = mmap(nullptr, kSize, PROT_READ | PROT_WRITE, MAP_SHARED, memfd.get(), 0);
+        ASSERT_NE(MAP_FAILED, mapping) << strerror(errno);
+        mMapping = reinterpret_cast<uint8_t*>(mapping);
+
+        // ControlMessage kHello, with the ring capacity and kHelloMagic
+        struct {
+            uint32_t type = 1;
+            uint32_t value = kCapacity;
+            uint64_t position = 0x4d48'5350'5242'4e42;
+        } hello;
+        iovec iov{&hello, sizeof(hello)};
+        std::vector<std::variant<unique_fd, borrowed_fd>> fds;
+        fds.push_back(borrowed_fd(memfd.get()));
+        mClientSocket = RpcTransportFd(std::move(client));
+        ASSERT_EQ(static_cast<ssize_t>(sizeof(hello)),
+                  binder::os::sendMessageOnSocket(mClientSocket, &iov, 1, &fds));
+
+        mTransport = RpcTransportCtxFactoryShm::make(kCapacity)
+                             ->newServerCtx()
+                             ->newTransport(RpcTransportFd(std::move(server)), mFdTrigger.get());
+        ASSERT_NE(nullptr, mTransport);
+    }
+
+    void TearDown() override {
+        if (mMapping != nullptr) munmap(mMapping, kSize);
+    }
+
+    // ring 0 goes from the client to the server, ring 1 from the server to the client
+    std::atomic<uint64_t>* position(size_t ring, size_t offset) {
+        return reinterpret_cast<std::atomic<uint64_t>*>(mMapping + ring * kStride + offset);
+    }
+
+    std::unique_ptr<FdTrigger> mFdTrigger = FdTrigger::make();
+    RpcTransportFd mClientSocket;
+    uint8_t* mMapping = nullptr;
+    std::unique_ptr<RpcTransport> mTransport;
+};
+
+TEST_F(RpcTransportShmCorruptRingTest, TailBehindHead) {
+    memcpy(mMapping + kHeaderSize, "abcd", 4);
+    position(0, kTailOffset)->store(4);
+
+    char buffer[4];
+    iovec iov{buffer, sizeof(buffer)};
+    ASSERT_EQ(OK, mTransport->interruptableReadFully(mFdTrigger.get(), &iov, 1, std::nullopt,
+                                                     nullptr));
+    ASSERT_EQ(0, memcmp(buffer, "abcd", 4));
+
+    // the server has read up to 4, so the tail can not be before that
+    position(0, kTailOffset)->store(2);
+    ASSERT_EQ(BAD_VALUE,
+              mTransport->interruptableReadFully(mFdTrigger.get(), &iov, 1, std::nullopt,
+                                                 nullptr));
+}
+
+TEST_F(RpcTransportShmCorruptRingTest, TailTooFarAhead) {
+    position(0, kTailOffset)->store(kCapacity + 1);
+
+    char buffer[4];
+    iovec iov{buffer, sizeof(buffer)};
+    ASSERT_EQ(BAD_VALUE,
+              mTransport->interruptableReadFully(mFdTrigger.get(), &iov, 1, std::nullopt,
+                                                 nullptr));
+}
+
+TEST_F(RpcTransportShmCorruptRingTest, HeadAheadOfTail) {
+    // the server has not written anything, so nothing can have been read
+    position(1, kHeadOffset)->store(8);
+
+    char buffer[4] = {};
+    iovec iov{buffer, sizeof(buffer)};
+    ASSERT_EQ(BAD_VALUE,
+              mTransport->interruptableWriteFully(mFdTrigger.get(), &iov, 1, std::nullopt,
+                                                  nullptr));
+}
+
 class RpcTransportTlsKeyTest
       : public testing::TestWithParam<
                 std::tuple<SocketType, RpcCertificateFormat, RpcKeyFormat, uint32_t>> {
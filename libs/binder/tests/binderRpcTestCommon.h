@@ -46,6 +46,7 @@
 #include <binder/ProcessState.h>
 #include <binder/RpcTlsTestUtils.h>
 #include <binder/RpcTlsUtils.h>
+#include <binder/RpcTransportShm.h>
 #include <binder/RpcTransportTls.h>
 
 #include <signal.h>
@@ -67,12 +68,18 @@ namespace android {
 
 constexpr char kLocalInetAddress[] = "127.0.0.1";
 
-enum class RpcSecurity { RAW, TLS };
+enum class RpcSecurity { RAW, TLS, SHM };
 
 static inline std::vector<RpcSecurity> RpcSecurityValues() {
     return {RpcSecurity::RAW, RpcSecurity::TLS};
 }
 
+// RpcSecurityValues(), and transports which are only tested between sessions, since the
+// transport tests write to the socket directly.
+static inline std::vector<RpcSecurity> RpcSessionSecurityValues() {
+    return {RpcSecurity::RAW, RpcSecurity::TLS, RpcSecurity::SHM};
+}
+
 static inline bool hasExperimentalRpc() {
 #ifdef __ANDROID__
     return base::GetProperty("ro.build.version.codename", "") != "REL";
@@ -203,6 +210,8 @@ static inline std::unique_ptr<RpcTransportCtxFactory> newTlsFactory(
             }
             return RpcTransportCtxFactoryTls::make(std::move(verifier), std::move(auth));
         }
+        case RpcSecurity::SHM:
+            return RpcTransportCtxFactoryShm::make();
         default:
             LOG_ALWAYS_FATAL("Unknown RpcSecurity %d", rpcSecurity);
     }
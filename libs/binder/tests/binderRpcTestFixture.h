@@ -144,6 +144,9 @@ public:
         if (socketType() == SocketType::UNIX_BOOTSTRAP && rpcSecurity() == RpcSecurity::TLS) {
             GTEST_SKIP() << "Unix bootstrap not supported over a TLS transport";
         }
+        if (socketType() == SocketType::UNIX_BOOTSTRAP && rpcSecurity() == RpcSecurity::SHM) {
+            GTEST_SKIP() << "Unix bootstrap not supported over a shared memory transport";
+        }
     }
 
     BinderRpcTestProcessSession createRpcTestSocketServerProcess(const BinderRpcOptions& options) {
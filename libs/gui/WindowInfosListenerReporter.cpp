@@ -14,8 +14,14 @@
  * limitations under the License.
  */
 
+#define LOG_TAG "WindowInfosListenerReporter"
+
+#include <inttypes.h>
+#include <algorithm>
+
 #include <android/gui/ISurfaceComposer.h>
 #include <gui/AidlStatusUtil.h>
+#include <log/log.h>
 #include <gui/WindowInfosListenerReporter.h>
 #include "gui/WindowInfosUpdate.h"
 
@@ -78,6 +84,7 @@ status_t WindowInfosListenerReporter::removeWindowInfosListener(
             // stale values
             mLastWindowInfos.clear();
             mLastDisplayInfos.clear();
+            resetUpdateStateLocked();
         }
 
         if (status == OK) {
@@ -92,22 +99,71 @@ binder::Status WindowInfosListenerReporter::onWindowInfosChanged(
         const gui::WindowInfosUpdate& update) {
     std::unordered_set<sp<WindowInfosListener>, gui::SpHash<WindowInfosListener>>
             windowInfosListeners;
+    std::optional<gui::WindowInfosUpdate> snapshot;
+    std::vector<int64_t> vsyncIdsToAck;
 
     {
         std::scoped_lock lock(mListenersMutex);
+        const bool isResend = update.sequence <= mLastReceivedSequence;
+        mLastReceivedSequence = std::max(mLastReceivedSequence, update.sequence);
+
+        if (update.isDelta()) {
+            if (*update.baseSequence == mLastSequence) {
+                snapshot = update.applyDelta(mLastWindowInfos);
+            }
+            if (!snapshot) {
+                // The update is acked once the snapshot which replaces it is delivered.
+                mUnappliedUpdates.emplace_back(update.sequence, update.vsyncId);
+                if (!mSnapshotRequested) {
+                    ALOGW("Window infos update %" PRId64 " is based on %" PRId64
+                          ", but the last update is %" PRId64 ". Asking for a snapshot.",
+                          update.sequence, *update.baseSequence, mLastSequence);
+                    mSnapshotRequested = true;
+                    mWindowInfosPublisher->requestWindowInfosSnapshot(mListenerId);
+                }
+                return binder::Status::ok();
+            }
+        } else if (update.sequence < mLastSequence) {
+            // A snapshot which was requested before a newer update was applied.
+            mSnapshotRequested = !mUnappliedUpdates.empty();
+            return binder::Status::ok();
+        }
+
+        if (!isResend) {
+            vsyncIdsToAck.push_back(update.vsyncId);
+        }
+        if (!update.isDelta()) {
+            std::erase_if(mUnappliedUpdates, [&](const auto& unapplied) {
+                if (unapplied.first > update.sequence) {
+                    return false;
+                }
+                vsyncIdsToAck.push_back(unapplied.second);
+                return true;
+            });
+            mSnapshotRequested = false;
+            if (!mUnappliedUpdates.empty()) {
+                mSnapshotRequested = true;
+                mWindowInfosPublisher->requestWindowInfosSnapshot(mListenerId);
+            }
+        }
+
         for (auto listener : mWindowInfosListeners) {
             windowInfosListeners.insert(listener);
         }
 
-        mLastWindowInfos = update.windowInfos;
-        mLastDisplayInfos = update.displayInfos;
+        const gui::WindowInfosUpdate& current = snapshot ? *snapshot : update;
+        mLastWindowInfos = current.windowInfos;
+        mLastDisplayInfos = current.displayInfos;
+        mLastSequence = current.sequence;
     }
 
     for (auto listener : windowInfosListeners) {
-        listener->onWindowInfosChanged(update);
+        listener->onWindowInfosChanged(snapshot ? *snapshot : update);
     }
 
-    mWindowInfosPublisher->ackWindowInfosReceived(update.vsyncId, mListenerId);
+    for (int64_t vsyncId : vsyncIdsToAck) {
+        mWindowInfosPublisher->ackWindowInfosReceived(vsyncId, mListenerId);
+    }
 
     return binder::Status::ok();
 }
@@ -119,7 +175,16 @@ void WindowInfosListenerReporter::reconnect(const sp<gui::ISurfaceComposer>& com
         composerService->addWindowInfosListener(this, &listenerInfo);
         mWindowInfosPublisher = std::move(listenerInfo.windowInfosPublisher);
         mListenerId = listenerInfo.listenerId;
+        // The new publisher starts with a snapshot, and numbers its updates from the start.
+        resetUpdateStateLocked();
     }
 }
 
+void WindowInfosListenerReporter::resetUpdateStateLocked() {
+    mLastSequence = 0;
+    mLastReceivedSequence = 0;
+    mUnappliedUpdates.clear();
+    mSnapshotRequested = false;
+}
+
 } // namespace android
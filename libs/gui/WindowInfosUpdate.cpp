@@ -17,8 +17,81 @@
 #include <gui/WindowInfosUpdate.h>
 #include <private/gui/ParcelUtils.h>
 
+#include <cinttypes>
+#include <unordered_map>
+#include <unordered_set>
+
 namespace android::gui {
 
+namespace {
+
+// WindowInfo::operator== leaves out some of the fields which are sent to listeners, but a delta
+// must not leave out a window which changed in any of them.
+bool isSameWindow(const WindowInfo& a, const WindowInfo& b) {
+    return a == b && a.windowToken == b.windowToken && a.alpha == b.alpha &&
+            a.touchableRegionCropHandle == b.touchableRegionCropHandle &&
+            a.focusTransferTarget == b.focusTransferTarget;
+}
+
+} // namespace
+
+std::optional<WindowInfosUpdate> WindowInfosUpdate::makeDelta(const WindowInfosUpdate& base) const {
+    std::unordered_map<int32_t, const WindowInfo*> baseWindows;
+    baseWindows.reserve(base.windowInfos.size());
+    for (const WindowInfo& info : base.windowInfos) {
+        if (!baseWindows.emplace(info.id, &info).second) {
+            return std::nullopt;
+        }
+    }
+
+    WindowInfosUpdate delta({}, displayInfos, vsyncId, timestamp);
+    delta.sequence = sequence;
+    delta.baseSequence = base.sequence;
+    delta.windowIds.reserve(windowInfos.size());
+    std::unordered_set<int32_t> ids;
+    ids.reserve(windowInfos.size());
+    for (const WindowInfo& info : windowInfos) {
+        if (!ids.insert(info.id).second) {
+            return std::nullopt;
+        }
+        delta.windowIds.push_back(info.id);
+        auto it = baseWindows.find(info.id);
+        if (it == baseWindows.end() || !isSameWindow(*it->second, info)) {
+            delta.windowInfos.push_back(info);
+        }
+    }
+    return delta;
+}
+
+std::optional<WindowInfosUpdate> WindowInfosUpdate::applyDelta(
+        const std::vector<WindowInfo>& baseWindowInfos) const {
+    std::unordered_map<int32_t, const WindowInfo*> windows;
+    windows.reserve(baseWindowInfos.size() + windowInfos.size());
+    for (const WindowInfo& info : baseWindowInfos) {
+        windows[info.id] = &info;
+    }
+    std::vector<int32_t> changedIds;
+    changedIds.reserve(windowInfos.size());
+    for (const WindowInfo& info : windowInfos) {
+        windows[info.id] = &info;
+        changedIds.push_back(info.id);
+    }
+
+    WindowInfosUpdate snapshot({}, displayInfos, vsyncId, timestamp);
+    snapshot.sequence = sequence;
+    snapshot.windowInfos.reserve(windowIds.size());
+    for (int32_t id : windowIds) {
+        auto it = windows.find(id);
+        if (it == windows.end()) {
+            ALOGE("%s: Window %" PRId32 " is neither in the delta nor in its base", __func__, id);
+            return std::nullopt;
+        }
+        snapshot.windowInfos.push_back(*it->second);
+    }
+    snapshot.changedWindowIds = std::move(changedIds);
+    return snapshot;
+}
+
 status_t WindowInfosUpdate::readFromParcel(const android::Parcel* parcel) {
     if (parcel == nullptr) {
         ALOGE("%s: Null parcel", __func__);
@@ -44,6 +117,18 @@ status_t WindowInfosUpdate::readFromParcel(const android::Parcel* parcel) {
     SAFE_PARCEL(parcel->readInt64, &vsyncId);
     SAFE_PARCEL(parcel->readInt64, &timestamp);
 
+    SAFE_PARCEL(parcel->readInt64, &sequence);
+    bool hasBaseSequence;
+    SAFE_PARCEL(parcel->readBool, &hasBaseSequence);
+    if (hasBaseSequence) {
+        int64_t value;
+        SAFE_PARCEL(parcel->readInt64, &value);
+        baseSequence = value;
+    } else {
+        baseSequence.reset();
+    }
+    SAFE_PARCEL(parcel->readInt32Vector, &windowIds);
+
     return OK;
 }
 
@@ -66,6 +151,13 @@ status_t WindowInfosUpdate::writeToParcel(android::Parcel* parcel) const {
     SAFE_PARCEL(parcel->writeInt64, vsyncId);
     SAFE_PARCEL(parcel->writeInt64, timestamp);
 
+    SAFE_PARCEL(parcel->writeInt64, sequence);
+    SAFE_PARCEL(parcel->writeBool, baseSequence.has_value());
+    if (baseSequence) {
+        SAFE_PARCEL(parcel->writeInt64, *baseSequence);
+    }
+    SAFE_PARCEL(parcel->writeInt32Vector, windowIds);
+
     return OK;
 }
 
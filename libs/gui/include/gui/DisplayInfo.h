@@ -38,6 +38,9 @@ struct DisplayInfo : public Parcelable {
     // The display transform. This takes display coordinates to logical display coordinates.
     ui::Transform transform;
 
+    bool operator==(const DisplayInfo&) const;
+    bool operator!=(const DisplayInfo& other) const { return !(*this == other); }
+
     status_t writeToParcel(android::Parcel*) const override;
 
     status_t readFromParcel(const android::Parcel*) override;
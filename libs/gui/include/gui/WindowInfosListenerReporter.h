@@ -46,6 +46,18 @@ private:
 
     std::vector<gui::WindowInfo> mLastWindowInfos GUARDED_BY(mListenersMutex);
     std::vector<gui::DisplayInfo> mLastDisplayInfos GUARDED_BY(mListenersMutex);
+    // Number of the update which mLastWindowInfos come from, deltas must be based on it.
+    int64_t mLastSequence GUARDED_BY(mListenersMutex) = 0;
+    // Highest update number received from the publisher. A snapshot with a number which is not
+    // higher is a resend of an update which was already received.
+    int64_t mLastReceivedSequence GUARDED_BY(mListenersMutex) = 0;
+    // Updates which could not be applied. Their vsync ids are acked once the windows of a snapshot
+    // at least as recent as them were delivered to the listeners, so that every update is acked
+    // exactly once.
+    std::vector<std::pair<int64_t /*sequence*/, int64_t /*vsyncId*/>> mUnappliedUpdates
+            GUARDED_BY(mListenersMutex);
+    bool mSnapshotRequested GUARDED_BY(mListenersMutex) = false;
+    void resetUpdateStateLocked() REQUIRES(mListenersMutex);
 
     sp<gui::IWindowInfosPublisher> mWindowInfosPublisher;
     int64_t mListenerId;
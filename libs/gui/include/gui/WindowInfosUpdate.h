@@ -16,6 +16,9 @@
 
 #pragma once
 
+#include <optional>
+#include <vector>
+
 #include <binder/Parcelable.h>
 #include <gui/DisplayInfo.h>
 #include <gui/WindowInfo.h>
@@ -37,6 +40,28 @@ struct WindowInfosUpdate : public Parcelable {
     int64_t vsyncId;
     int64_t timestamp;
 
+    // The updates sent to a listener are numbered. An update is either a snapshot, in which
+    // windowInfos holds every window, or a delta from the update numbered baseSequence. A delta only
+    // holds the windows which were added or changed in windowInfos, and the ids of every window,
+    // front to back, in windowIds. Both hold every display in displayInfos.
+    int64_t sequence = 0;
+    std::optional<int64_t> baseSequence;
+    std::vector<int32_t> windowIds;
+
+    // Set on the snapshots returned by applyDelta, to the ids of the windows which the delta added
+    // or changed. Windows of the base update which are no longer there were removed. Not parcelled.
+    std::optional<std::vector<int32_t>> changedWindowIds;
+
+    bool isDelta() const { return baseSequence.has_value(); }
+
+    // Returns the delta from the snapshot base to this snapshot, or nullopt if window ids are not
+    // unique, so that no delta can describe the change.
+    std::optional<WindowInfosUpdate> makeDelta(const WindowInfosUpdate& base) const;
+
+    // Returns the snapshot made by applying this delta to the windows of the update it is based on,
+    // or nullopt if they are not the windows the delta was made from.
+    std::optional<WindowInfosUpdate> applyDelta(const std::vector<WindowInfo>& baseWindowInfos) const;
+
     status_t writeToParcel(android::Parcel*) const override;
     status_t readFromParcel(const android::Parcel*) override;
 };
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <binder/Parcel.h>
+
+#include <gui/WindowInfosUpdate.h>
+
+namespace android {
+
+using gui::DisplayInfo;
+using gui::WindowInfo;
+using gui::WindowInfosUpdate;
+
+namespace test {
+
+namespace {
+
+WindowInfo windowInfo(int32_t id, const std::string& name) {
+    WindowInfo info;
+    info.id = id;
+    info.name = name;
+    return info;
+}
+
+WindowInfosUpdate snapshot(std::vector<WindowInfo> windowInfos, int64_t sequence) {
+    DisplayInfo displayInfo;
+    displayInfo.displayId = 42;
+    WindowInfosUpdate update(std::move(windowInfos), {displayInfo}, /*vsyncId=*/sequence,
+                             /*timestamp=*/0);
+    update.sequence = sequence;
+    return update;
+}
+
+std::vector<std::string> names(const std::vector<WindowInfo>& windowInfos) {
+    std::vector<std::string> names;
+    for (const WindowInfo& info : windowInfos) {
+        names.push_back(info.name);
+    }
+    return names;
+}
+
+} // namespace
+
+TEST(WindowInfosUpdate, DeltaHoldsChangedWindows) {
+    WindowInfosUpdate base = snapshot({windowInfo(1, "a"), windowInfo(2, "b")}, 1);
+    WindowInfosUpdate update =
+            snapshot({windowInfo(3, "c"), windowInfo(1, "a"), windowInfo(2, "b2")}, 2);
+
+    std::optional<WindowInfosUpdate> delta = update.makeDelta(base);
+    ASSERT_TRUE(delta);
+    EXPECT_TRUE(delta->isDelta());
+    EXPECT_EQ(2, delta->sequence);
+    EXPECT_EQ(1, *delta->baseSequence);
+    EXPECT_EQ((std::vector<int32_t>{3, 1, 2}), delta->windowIds);
+    EXPECT_EQ((std::vector<std::string>{"c", "b2"}), names(delta->windowInfos));
+    ASSERT_EQ(1u, delta->displayInfos.size());
+    EXPECT_EQ(42, delta->displayInfos[0].displayId);
+}
+
+TEST(WindowInfosUpdate, DeltaHoldsWindowsWithChangedAlpha) {
+    WindowInfo window = windowInfo(1, "a");
+    WindowInfosUpdate base = snapshot({window}, 1);
+    window.alpha = 0.5f;
+    WindowInfosUpdate update = snapshot({window}, 2);
+
+    std::optional<WindowInfosUpdate> delta = update.makeDelta(base);
+    ASSERT_TRUE(delta);
+    ASSERT_EQ(1u, delta->windowInfos.size());
+    EXPECT_EQ(0.5f, delta->windowInfos[0].alpha);
+}
+
+TEST(WindowInfosUpdate, ApplyingDeltaRestoresSnapshot) {
+    WindowInfosUpdate base =
+            snapshot({windowInfo(1, "a"), windowInfo(2, "b"), windowInfo(3, "c")}, 1);
+    WindowInfosUpdate update =
+            snapshot({windowInfo(3, "c"), windowInfo(4, "d"), windowInfo(1, "a2")}, 2);
+
+    std::optional<WindowInfosUpdate> delta = update.makeDelta(base);
+    ASSERT_TRUE(delta);
+    std::optional<WindowInfosUpdate> result = delta->applyDelta(base.windowInfos);
+    ASSERT_TRUE(result);
+    EXPECT_FALSE(result->isDelta());
+    EXPECT_EQ(2, result->sequence);
+    EXPECT_EQ((std::vector<std::string>{"c", "d", "a2"}), names(result->windowInfos));
+    EXPECT_EQ(update.windowInfos, result->windowInfos);
+    ASSERT_TRUE(result->changedWindowIds);
+    EXPECT_EQ((std::vector<int32_t>{4, 1}), *result->changedWindowIds);
+}
+
+TEST(WindowInfosUpdate, ApplyingDeltaToOtherWindowsFails) {
+    WindowInfosUpdate base = snapshot({windowInfo(1, "a"), windowInfo(2, "b")}, 1);
+    WindowInfosUpdate update = snapshot({windowInfo(1, "a"), windowInfo(2, "b2")}, 2);
+
+    std::optional<WindowInfosUpdate> delta = update.makeDelta(base);
+    ASSERT_TRUE(delta);
+    EXPECT_FALSE(delta->applyDelta({windowInfo(2, "b")}));
+}
+
+TEST(WindowInfosUpdate, NoDeltaFromDuplicateWindows) {
+    WindowInfosUpdate base = snapshot({windowInfo(1, "a"), windowInfo(1, "b")}, 1);
+    WindowInfosUpdate update = snapshot({windowInfo(1, "a")}, 2);
+
+    EXPECT_FALSE(update.makeDelta(base));
+    EXPECT_FALSE(base.makeDelta(update));
+}
+
+TEST(WindowInfosUpdate, ParcellingDelta) {
+    WindowInfosUpdate base = snapshot({windowInfo(1, "a"), windowInfo(2, "b")}, 1);
+    WindowInfosUpdate update = snapshot({windowInfo(1, "a"), windowInfo(2, "b2")}, 2);
+    std::optional<WindowInfosUpdate> delta = update.makeDelta(base);
+    ASSERT_TRUE(delta);
+
+    Parcel p;
+    delta->writeToParcel(&p);
+    p.setDataPosition(0);
+
+    WindowInfosUpdate delta2;
+    delta2.readFromParcel(&p);
+    ASSERT_EQ(delta->sequence, delta2.sequence);
+    ASSERT_EQ(delta->baseSequence, delta2.baseSequence);
+    ASSERT_EQ(delta->windowIds, delta2.windowIds);
+    ASSERT_EQ(delta->windowInfos, delta2.windowInfos);
+    ASSERT_EQ(delta->displayInfos, delta2.displayInfos);
+
+    Parcel p2;
+    update.writeToParcel(&p2);
+    p2.setDataPosition(0);
+
+    WindowInfosUpdate update2;
+    update2.readFromParcel(&p2);
+    ASSERT_FALSE(update2.isDelta());
+    ASSERT_EQ(update.windowInfos, update2.windowInfos);
+}
+
+} // namespace test
+} // namespace android
@@ -495,26 +495,42 @@ bool PointerCoords::operator==(const PointerCoords& other) const {
     return true;
 }
 
-void PointerCoords::transform(const ui::Transform& transform) {
-    const vec2 xy = transform.transform(getXYValue());
-    setAxisValue(AMOTION_EVENT_AXIS_X, xy.x);
-    setAxisValue(AMOTION_EVENT_AXIS_Y, xy.y);
+// Transforms the coordinates in place. The rotation of the transform, which is applied to the
+// relative axes, is passed in so that it is only computed once when transforming many samples.
+static void transformCoords(PointerCoords& c, const ui::Transform& transform,
+                            const ui::Transform& rotation) {
+    // X and Y are the lowest axes, so when both are present they are the first two values and
+    // can be updated without looking up where they are stored.
+    static_assert(AMOTION_EVENT_AXIS_X == 0 && AMOTION_EVENT_AXIS_Y == 1);
+    if (BitSet64::hasBit(c.bits, AMOTION_EVENT_AXIS_X) &&
+        BitSet64::hasBit(c.bits, AMOTION_EVENT_AXIS_Y)) {
+        const vec2 xy = transform.transform(c.values[0], c.values[1]);
+        c.values[0] = xy.x;
+        c.values[1] = xy.y;
+    } else {
+        const vec2 xy = transform.transform(c.getXYValue());
+        c.setAxisValue(AMOTION_EVENT_AXIS_X, xy.x);
+        c.setAxisValue(AMOTION_EVENT_AXIS_Y, xy.y);
+    }
 
-    if (BitSet64::hasBit(bits, AMOTION_EVENT_AXIS_RELATIVE_X) ||
-        BitSet64::hasBit(bits, AMOTION_EVENT_AXIS_RELATIVE_Y)) {
-        const ui::Transform rotation(transform.getOrientation());
-        const vec2 relativeXy = rotation.transform(getAxisValue(AMOTION_EVENT_AXIS_RELATIVE_X),
-                                                   getAxisValue(AMOTION_EVENT_AXIS_RELATIVE_Y));
-        setAxisValue(AMOTION_EVENT_AXIS_RELATIVE_X, relativeXy.x);
-        setAxisValue(AMOTION_EVENT_AXIS_RELATIVE_Y, relativeXy.y);
+    if (BitSet64::hasBit(c.bits, AMOTION_EVENT_AXIS_RELATIVE_X) ||
+        BitSet64::hasBit(c.bits, AMOTION_EVENT_AXIS_RELATIVE_Y)) {
+        const vec2 relativeXy = rotation.transform(c.getAxisValue(AMOTION_EVENT_AXIS_RELATIVE_X),
+                                                   c.getAxisValue(AMOTION_EVENT_AXIS_RELATIVE_Y));
+        c.setAxisValue(AMOTION_EVENT_AXIS_RELATIVE_X, relativeXy.x);
+        c.setAxisValue(AMOTION_EVENT_AXIS_RELATIVE_Y, relativeXy.y);
     }
 
-    if (BitSet64::hasBit(bits, AMOTION_EVENT_AXIS_ORIENTATION)) {
-        const float val = getAxisValue(AMOTION_EVENT_AXIS_ORIENTATION);
-        setAxisValue(AMOTION_EVENT_AXIS_ORIENTATION, transformAngle(transform, val));
+    if (BitSet64::hasBit(c.bits, AMOTION_EVENT_AXIS_ORIENTATION)) {
+        const float val = c.getAxisValue(AMOTION_EVENT_AXIS_ORIENTATION);
+        c.setAxisValue(AMOTION_EVENT_AXIS_ORIENTATION, transformAngle(transform, val));
     }
 }
 
+void PointerCoords::transform(const ui::Transform& transform) {
+    transformCoords(*this, transform, ui::Transform(transform.getOrientation()));
+}
+
 // --- PointerProperties ---
 
 void PointerProperties::copyFrom(const PointerProperties& other) {
@@ -723,8 +739,10 @@ void MotionEvent::applyTransform(const std::array<float, 9>& matrix) {
     transform.set(matrix);
 
     // Apply the transformation to all samples.
-    std::for_each(mSamplePointerCoords.begin(), mSamplePointerCoords.end(),
-                  [&transform](PointerCoords& c) { c.transform(transform); });
+    const ui::Transform rotation(transform.getOrientation());
+    for (PointerCoords& c : mSamplePointerCoords) {
+        transformCoords(c, transform, rotation);
+    }
 
     if (mRawXCursorPosition != AMOTION_EVENT_INVALID_CURSOR_POSITION &&
         mRawYCursorPosition != AMOTION_EVENT_INVALID_CURSOR_POSITION) {
@@ -126,6 +126,10 @@ static const size_t SOCKET_BUFFER_SIZE = 32 * 1024;
 // Nanoseconds per milliseconds.
 static const nsecs_t NANOS_PER_MS = 1000000;
 
+// The number of consumed messages that the consumer keeps to receive new messages into. A frame
+// usually batches a handful of samples, so this is enough to not allocate in the steady state.
+static const size_t MAX_RECYCLED_MESSAGES = 16;
+
 // Latency added during resampling.  A few milliseconds doesn't hurt much but
 // reduces the impact of mispredicted touch positions.
 const std::chrono::duration RESAMPLE_LATENCY = 5ms;
@@ -183,6 +187,16 @@ static bool shouldResampleTool(ToolType toolType) {
     return toolType == ToolType::FINGER || toolType == ToolType::UNKNOWN;
 }
 
+static status_t sendErrorToStatus(int error) {
+    if (error == EAGAIN || error == EWOULDBLOCK) {
+        return WOULD_BLOCK;
+    }
+    if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED || error == ECONNRESET) {
+        return DEAD_OBJECT;
+    }
+    return -error;
+}
+
 // --- InputMessage ---
 
 bool InputMessage::isValid(size_t actualSize) const {
@@ -477,13 +491,7 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
         int error = errno;
         ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ error sending message of type %s, %s",
                  name.c_str(), ftl::enum_string(msg->header.type).c_str(), strerror(error));
-        if (error == EAGAIN || error == EWOULDBLOCK) {
-            return WOULD_BLOCK;
-        }
-        if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED || error == ECONNRESET) {
-            return DEAD_OBJECT;
-        }
-        return -error;
+        return sendErrorToStatus(error);
     }
 
     if (size_t(nWrite) != msgLength) {
@@ -499,6 +507,69 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
     return OK;
 }
 
+status_t InputChannel::sendMessages(const InputMessage* msgs, size_t count,
+                                    size_t* outSentCount) {
+    ATRACE_NAME_IF(ATRACE_ENABLED(),
+                   StringPrintf("sendMessages(inputChannel=%s, count=%zu)", name.c_str(), count));
+    *outSentCount = 0;
+#if defined(__linux__)
+    // The socket is a SOCK_SEQPACKET socket, so each message of a sendmmsg call is still
+    // received on its own.
+    std::array<iovec, MAX_MESSAGES_PER_SEND> iovecs;
+    std::array<mmsghdr, MAX_MESSAGES_PER_SEND> headers;
+    while (*outSentCount < count) {
+        const size_t batchSize = std::min(count - *outSentCount, MAX_MESSAGES_PER_SEND);
+        for (size_t i = 0; i < batchSize; i++) {
+            const InputMessage& msg = msgs[*outSentCount + i];
+            iovecs[i].iov_base = const_cast<InputMessage*>(&msg);
+            iovecs[i].iov_len = msg.size();
+            headers[i] = {};
+            headers[i].msg_hdr.msg_iov = &iovecs[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int nSent;
+        do {
+            nSent = ::sendmmsg(getFd(), headers.data(), batchSize, MSG_DONTWAIT | MSG_NOSIGNAL);
+        } while (nSent == -1 && errno == EINTR);
+
+        if (nSent < 0) {
+            int error = errno;
+            ALOGD_IF(DEBUG_CHANNEL_MESSAGES,
+                     "channel '%s' ~ error sending message %zu of %zu, of type %s, %s",
+                     name.c_str(), *outSentCount, count,
+                     ftl::enum_string(msgs[*outSentCount].header.type).c_str(), strerror(error));
+            return sendErrorToStatus(error);
+        }
+
+        for (int i = 0; i < nSent; i++) {
+            if (headers[i].msg_len != iovecs[i].iov_len) {
+                ALOGD_IF(DEBUG_CHANNEL_MESSAGES,
+                         "channel '%s' ~ error sending message type %s, send was incomplete",
+                         name.c_str(),
+                         ftl::enum_string(msgs[*outSentCount].header.type).c_str());
+                return DEAD_OBJECT;
+            }
+            (*outSentCount)++;
+        }
+    }
+
+    ALOGD_IF(DEBUG_CHANNEL_MESSAGES, "channel '%s' ~ sent %zu messages", name.c_str(), count);
+    return OK;
+#else
+    while (*outSentCount < count) {
+        InputMessage cleanMsg;
+        msgs[*outSentCount].getSanitizedCopy(&cleanMsg);
+        status_t status = sendMessage(&cleanMsg);
+        if (status != OK) {
+            return status;
+        }
+        (*outSentCount)++;
+    }
+    return OK;
+#endif
+}
+
 status_t InputChannel::receiveMessage(InputMessage* msg) {
     ssize_t nRead;
     do {
@@ -642,7 +713,7 @@ status_t InputPublisher::publishKeyEvent(uint32_t seq, int32_t eventId, int32_t
     msg.body.key.repeatCount = repeatCount;
     msg.body.key.downTime = downTime;
     msg.body.key.eventTime = eventTime;
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishMotionEvent(
@@ -658,7 +729,9 @@ status_t InputPublisher::publishMotionEvent(
                    StringPrintf("publishMotionEvent(inputChannel=%s, action=%s)",
                                 mChannel->getName().c_str(),
                                 MotionEvent::actionToString(action).c_str()));
-    if (verifyEvents()) {
+    // Staged events are verified once they are sent, since the ones which are not sent are
+    // published again later.
+    if (verifyEvents() && !mBatching) {
         Result<void> result =
                 mInputVerifier.processMovement(deviceId, source, action, pointerCount,
                                                pointerProperties, pointerCoords, flags);
@@ -732,7 +805,7 @@ status_t InputPublisher::publishMotionEvent(
         msg.body.motion.pointers[i].coords = pointerCoords[i];
     }
 
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishFocusEvent(uint32_t seq, int32_t eventId, bool hasFocus) {
@@ -747,7 +820,7 @@ status_t InputPublisher::publishFocusEvent(uint32_t seq, int32_t eventId, bool h
     msg.header.seq = seq;
     msg.body.focus.eventId = eventId;
     msg.body.focus.hasFocus = hasFocus;
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishCaptureEvent(uint32_t seq, int32_t eventId,
@@ -764,7 +837,7 @@ status_t InputPublisher::publishCaptureEvent(uint32_t seq, int32_t eventId,
     msg.header.seq = seq;
     msg.body.capture.eventId = eventId;
     msg.body.capture.pointerCaptureEnabled = pointerCaptureEnabled;
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishDragEvent(uint32_t seq, int32_t eventId, float x, float y,
@@ -783,7 +856,7 @@ status_t InputPublisher::publishDragEvent(uint32_t seq, int32_t eventId, float x
     msg.body.drag.isExiting = isExiting;
     msg.body.drag.x = x;
     msg.body.drag.y = y;
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
 }
 
 status_t InputPublisher::publishTouchModeEvent(uint32_t seq, int32_t eventId, bool isInTouchMode) {
@@ -799,7 +872,51 @@ status_t InputPublisher::publishTouchModeEvent(uint32_t seq, int32_t eventId, bo
     msg.header.seq = seq;
     msg.body.touchMode.eventId = eventId;
     msg.body.touchMode.isInTouchMode = isInTouchMode;
-    return mChannel->sendMessage(&msg);
+    return sendMessage(msg);
+}
+
+void InputPublisher::beginBatch() {
+    mBatching = true;
+}
+
+status_t InputPublisher::endBatch(size_t* outPublishedCount) {
+    mBatching = false;
+    status_t status =
+            mChannel->sendMessages(mBatchedMessages.data(), mBatchedMessages.size(),
+                                   outPublishedCount);
+    if (verifyEvents()) {
+        for (size_t i = 0; i < *outPublishedCount; i++) {
+            const InputMessage& msg = mBatchedMessages[i];
+            if (msg.header.type != InputMessage::Type::MOTION) {
+                continue;
+            }
+            const uint32_t pointerCount = msg.body.motion.pointerCount;
+            PointerProperties pointerProperties[MAX_POINTERS];
+            PointerCoords pointerCoords[MAX_POINTERS];
+            for (uint32_t j = 0; j < pointerCount; j++) {
+                pointerProperties[j] = msg.body.motion.pointers[j].properties;
+                pointerCoords[j] = msg.body.motion.pointers[j].coords;
+            }
+            Result<void> result =
+                    mInputVerifier.processMovement(msg.body.motion.deviceId,
+                                                   msg.body.motion.source, msg.body.motion.action,
+                                                   pointerCount, pointerProperties, pointerCoords,
+                                                   msg.body.motion.flags);
+            if (!result.ok()) {
+                LOG(FATAL) << "Bad stream: " << result.error();
+            }
+        }
+    }
+    mBatchedMessages.clear();
+    return status;
+}
+
+status_t InputPublisher::sendMessage(const InputMessage& msg) {
+    if (!mBatching) {
+        return mChannel->sendMessage(&msg);
+    }
+    msg.getSanitizedCopy(&mBatchedMessages.emplace_back());
+    return OK;
 }
 
 android::base::Result<InputPublisher::ConsumerResponse> InputPublisher::receiveConsumerResponse() {
@@ -845,7 +962,10 @@ InputConsumer::InputConsumer(const std::shared_ptr<InputChannel>& channel)
 
 InputConsumer::InputConsumer(const std::shared_ptr<InputChannel>& channel,
                              bool enableTouchResampling)
-      : mResampleTouch(enableTouchResampling), mChannel(channel), mMsgDeferred(false) {}
+      : mResampleTouch(enableTouchResampling),
+        mChannel(channel),
+        mMsg(std::make_unique<InputMessage>()),
+        mMsgDeferred(false) {}
 
 InputConsumer::~InputConsumer() {
 }
@@ -872,15 +992,15 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
             mMsgDeferred = false;
         } else {
             // Receive a fresh message.
-            status_t result = mChannel->receiveMessage(&mMsg);
+            status_t result = mChannel->receiveMessage(mMsg.get());
             if (result == OK) {
                 const auto [_, inserted] =
-                        mConsumeTimes.emplace(mMsg.header.seq, systemTime(SYSTEM_TIME_MONOTONIC));
+                        mConsumeTimes.emplace(mMsg->header.seq, systemTime(SYSTEM_TIME_MONOTONIC));
                 LOG_ALWAYS_FATAL_IF(!inserted, "Already have a consume time for seq=%" PRIu32,
-                                    mMsg.header.seq);
+                                    mMsg->header.seq);
 
                 // Trace the event processing timeline - event was just read from the socket
-                ATRACE_ASYNC_BEGIN("InputConsumer processing", /*cookie=*/mMsg.header.seq);
+                ATRACE_ASYNC_BEGIN("InputConsumer processing", /*cookie=*/mMsg->header.seq);
             }
             if (result) {
                 // Consume the next batched event unless batches are being held for later.
@@ -897,13 +1017,13 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
             }
         }
 
-        switch (mMsg.header.type) {
+        switch (mMsg->header.type) {
             case InputMessage::Type::KEY: {
                 KeyEvent* keyEvent = factory->createKeyEvent();
                 if (!keyEvent) return NO_MEMORY;
 
-                initializeKeyEvent(keyEvent, &mMsg);
-                *outSeq = mMsg.header.seq;
+                initializeKeyEvent(keyEvent, mMsg.get());
+                *outSeq = mMsg->header.seq;
                 *outEvent = keyEvent;
                 ALOGD_IF(DEBUG_TRANSPORT_CONSUMER,
                          "channel '%s' consumer ~ consumed key event, seq=%u",
@@ -912,24 +1032,26 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
             }
 
             case InputMessage::Type::MOTION: {
-                ssize_t batchIndex = findBatch(mMsg.body.motion.deviceId, mMsg.body.motion.source);
+                ssize_t batchIndex =
+                        findBatch(mMsg->body.motion.deviceId, mMsg->body.motion.source);
                 if (batchIndex >= 0) {
                     Batch& batch = mBatches[batchIndex];
-                    if (canAddSample(batch, &mMsg)) {
-                        batch.samples.push_back(mMsg);
+                    if (canAddSample(batch, mMsg.get())) {
+                        batch.samples.push_back(std::move(mMsg));
+                        mMsg = obtainMessage();
                         ALOGD_IF(DEBUG_TRANSPORT_CONSUMER,
                                  "channel '%s' consumer ~ appended to batch event",
                                  mChannel->getName().c_str());
                         break;
-                    } else if (isPointerEvent(mMsg.body.motion.source) &&
-                               mMsg.body.motion.action == AMOTION_EVENT_ACTION_CANCEL) {
+                    } else if (isPointerEvent(mMsg->body.motion.source) &&
+                               mMsg->body.motion.action == AMOTION_EVENT_ACTION_CANCEL) {
                         // No need to process events that we are going to cancel anyways
                         const size_t count = batch.samples.size();
                         for (size_t i = 0; i < count; i++) {
-                            const InputMessage& msg = batch.samples[i];
+                            const InputMessage& msg = *batch.samples[i];
                             sendFinishedSignal(msg.header.seq, false);
                         }
-                        batch.samples.erase(batch.samples.begin(), batch.samples.begin() + count);
+                        recycleSamples(batch, count);
                         mBatches.erase(mBatches.begin() + batchIndex);
                     } else {
                         // We cannot append to the batch in progress, so we need to consume
@@ -950,11 +1072,11 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
                 }
 
                 // Start a new batch if needed.
-                if (mMsg.body.motion.action == AMOTION_EVENT_ACTION_MOVE ||
-                    mMsg.body.motion.action == AMOTION_EVENT_ACTION_HOVER_MOVE) {
-                    Batch batch;
-                    batch.samples.push_back(mMsg);
-                    mBatches.push_back(batch);
+                if (mMsg->body.motion.action == AMOTION_EVENT_ACTION_MOVE ||
+                    mMsg->body.motion.action == AMOTION_EVENT_ACTION_HOVER_MOVE) {
+                    Batch& batch = mBatches.emplace_back();
+                    batch.samples.push_back(std::move(mMsg));
+                    mMsg = obtainMessage();
                     ALOGD_IF(DEBUG_TRANSPORT_CONSUMER,
                              "channel '%s' consumer ~ started batch event",
                              mChannel->getName().c_str());
@@ -964,9 +1086,9 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
                 MotionEvent* motionEvent = factory->createMotionEvent();
                 if (!motionEvent) return NO_MEMORY;
 
-                updateTouchState(mMsg);
-                initializeMotionEvent(motionEvent, &mMsg);
-                *outSeq = mMsg.header.seq;
+                updateTouchState(*mMsg);
+                initializeMotionEvent(motionEvent, mMsg.get());
+                *outSeq = mMsg->header.seq;
                 *outEvent = motionEvent;
 
                 ALOGD_IF(DEBUG_TRANSPORT_CONSUMER,
@@ -979,7 +1101,7 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
             case InputMessage::Type::TIMELINE: {
                 LOG_ALWAYS_FATAL("Consumed a %s message, which should never be seen by "
                                  "InputConsumer!",
-                                 ftl::enum_string(mMsg.header.type).c_str());
+                                 ftl::enum_string(mMsg->header.type).c_str());
                 break;
             }
 
@@ -987,8 +1109,8 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
                 FocusEvent* focusEvent = factory->createFocusEvent();
                 if (!focusEvent) return NO_MEMORY;
 
-                initializeFocusEvent(focusEvent, &mMsg);
-                *outSeq = mMsg.header.seq;
+                initializeFocusEvent(focusEvent, mMsg.get());
+                *outSeq = mMsg->header.seq;
                 *outEvent = focusEvent;
                 break;
             }
@@ -997,8 +1119,8 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
                 CaptureEvent* captureEvent = factory->createCaptureEvent();
                 if (!captureEvent) return NO_MEMORY;
 
-                initializeCaptureEvent(captureEvent, &mMsg);
-                *outSeq = mMsg.header.seq;
+                initializeCaptureEvent(captureEvent, mMsg.get());
+                *outSeq = mMsg->header.seq;
                 *outEvent = captureEvent;
                 break;
             }
@@ -1007,8 +1129,8 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
                 DragEvent* dragEvent = factory->createDragEvent();
                 if (!dragEvent) return NO_MEMORY;
 
-                initializeDragEvent(dragEvent, &mMsg);
-                *outSeq = mMsg.header.seq;
+                initializeDragEvent(dragEvent, mMsg.get());
+                *outSeq = mMsg->header.seq;
                 *outEvent = dragEvent;
                 break;
             }
@@ -1017,8 +1139,8 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
                 TouchModeEvent* touchModeEvent = factory->createTouchModeEvent();
                 if (!touchModeEvent) return NO_MEMORY;
 
-                initializeTouchModeEvent(touchModeEvent, &mMsg);
-                *outSeq = mMsg.header.seq;
+                initializeTouchModeEvent(touchModeEvent, mMsg.get());
+                *outSeq = mMsg->header.seq;
                 *outEvent = touchModeEvent;
                 break;
             }
@@ -1054,7 +1176,7 @@ status_t InputConsumer::consumeBatch(InputEventFactoryInterface* factory,
             mBatches.erase(mBatches.begin() + i);
             next = nullptr;
         } else {
-            next = &batch.samples[0];
+            next = batch.samples[0].get();
         }
         if (!result && mResampleTouch) {
             resampleTouchState(sampleTime, static_cast<MotionEvent*>(*outEvent), next);
@@ -1072,7 +1194,7 @@ status_t InputConsumer::consumeSamples(InputEventFactoryInterface* factory,
 
     uint32_t chain = 0;
     for (size_t i = 0; i < count; i++) {
-        InputMessage& msg = batch.samples[i];
+        InputMessage& msg = *batch.samples[i];
         updateTouchState(msg);
         if (i) {
             SeqChain seqChain;
@@ -1085,13 +1207,29 @@ status_t InputConsumer::consumeSamples(InputEventFactoryInterface* factory,
         }
         chain = msg.header.seq;
     }
-    batch.samples.erase(batch.samples.begin(), batch.samples.begin() + count);
+    recycleSamples(batch, count);
 
     *outSeq = chain;
     *outEvent = motionEvent;
     return OK;
 }
 
+std::unique_ptr<InputMessage> InputConsumer::obtainMessage() {
+    if (mRecycledMessages.empty()) {
+        return std::make_unique<InputMessage>();
+    }
+    std::unique_ptr<InputMessage> msg = std::move(mRecycledMessages.back());
+    mRecycledMessages.pop_back();
+    return msg;
+}
+
+void InputConsumer::recycleSamples(Batch& batch, size_t count) {
+    for (size_t i = 0; i < count && mRecycledMessages.size() < MAX_RECYCLED_MESSAGES; i++) {
+        mRecycledMessages.push_back(std::move(batch.samples[i]));
+    }
+    batch.samples.erase(batch.samples.begin(), batch.samples.begin() + count);
+}
+
 void InputConsumer::updateTouchState(InputMessage& msg) {
     if (!mResampleTouch || !isPointerEvent(msg.body.motion.source)) {
         return;
@@ -1436,7 +1574,7 @@ int32_t InputConsumer::getPendingBatchSource() const {
     }
 
     const Batch& batch = mBatches[0];
-    const InputMessage& head = batch.samples[0];
+    const InputMessage& head = *batch.samples[0];
     return head.body.motion.source;
 }
 
@@ -1447,7 +1585,7 @@ bool InputConsumer::probablyHasInput() const {
 ssize_t InputConsumer::findBatch(int32_t deviceId, int32_t source) const {
     for (size_t i = 0; i < mBatches.size(); i++) {
         const Batch& batch = mBatches[i];
-        const InputMessage& head = batch.samples[0];
+        const InputMessage& head = *batch.samples[0];
         if (head.body.motion.deviceId == deviceId && head.body.motion.source == source) {
             return i;
         }
@@ -1529,7 +1667,7 @@ void InputConsumer::addSample(MotionEvent* event, const InputMessage* msg) {
 }
 
 bool InputConsumer::canAddSample(const Batch& batch, const InputMessage *msg) {
-    const InputMessage& head = batch.samples[0];
+    const InputMessage& head = *batch.samples[0];
     uint32_t pointerCount = msg->body.motion.pointerCount;
     if (head.body.motion.pointerCount != pointerCount
             || head.body.motion.action != msg->body.motion.action) {
@@ -1547,7 +1685,7 @@ bool InputConsumer::canAddSample(const Batch& batch, const InputMessage *msg) {
 ssize_t InputConsumer::findSampleNoLaterThan(const Batch& batch, nsecs_t time) {
     size_t numSamples = batch.samples.size();
     size_t index = 0;
-    while (index < numSamples && batch.samples[index].body.motion.eventTime <= time) {
+    while (index < numSamples && batch.samples[index]->body.motion.eventTime <= time) {
         index += 1;
     }
     return ssize_t(index) - 1;
@@ -1559,12 +1697,13 @@ std::string InputConsumer::dump() const {
     out = out + "mChannel = " + mChannel->getName() + "\n";
     out = out + "mMsgDeferred: " + toString(mMsgDeferred) + "\n";
     if (mMsgDeferred) {
-        out = out + "mMsg : " + ftl::enum_string(mMsg.header.type) + "\n";
+        out = out + "mMsg : " + ftl::enum_string(mMsg->header.type) + "\n";
     }
     out += "Batches:\n";
     for (const Batch& batch : mBatches) {
         out += "    Batch:\n";
-        for (const InputMessage& msg : batch.samples) {
+        for (const std::unique_ptr<InputMessage>& sample : batch.samples) {
+            const InputMessage& msg = *sample;
             out += android::base::StringPrintf("        Message %" PRIu32 ": %s ", msg.header.seq,
                                                ftl::enum_string(msg.header.type).c_str());
             switch (msg.header.type) {
@@ -18,10 +18,14 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <mutex>
+#include <unordered_map>
 
 #ifdef __linux__
 #include <binder/Parcel.h>
 #endif
+#include <android-base/file.h>
+#include <android-base/thread_annotations.h>
 #include <android/keycodes.h>
 #include <attestation/HmacKeyManager.h>
 #include <input/InputEventLabels.h>
@@ -72,6 +76,18 @@ static const Modifier modifiers[] = {
         { "scrolllock", AMETA_SCROLL_LOCK_ON },
 };
 
+// Key character maps loaded from files, keyed by file path. Every load returns a copy, because a
+// map can be changed after it is loaded by applying an overlay or key remappings, but the copy
+// is much cheaper than parsing the file again for as long as its contents are the same. The
+// contents are kept to compare them, key character map files are only a few kilobytes.
+struct CachedKeyCharacterMap {
+    std::string contents;
+    KeyCharacterMap::Format format;
+    std::shared_ptr<const KeyCharacterMap> map;
+};
+static std::mutex gCacheLock;
+static std::unordered_map<std::string, CachedKeyCharacterMap> gCache GUARDED_BY(gCacheLock);
+
 #if DEBUG_MAPPING
 static String8 toString(const char16_t* chars, size_t numChars) {
     String8 result;
@@ -89,8 +105,23 @@ KeyCharacterMap::KeyCharacterMap(const std::string& filename) : mLoadFileName(fi
 
 base::Result<std::shared_ptr<KeyCharacterMap>> KeyCharacterMap::load(const std::string& filename,
                                                                      Format format) {
+    std::string contents;
+    if (!base::ReadFileToString(filename, &contents)) {
+        const status_t status = -errno;
+        return Errorf("Error {} opening key character map file {}.", status, filename.c_str());
+    }
+    {
+        std::scoped_lock lock(gCacheLock);
+        const auto it = gCache.find(filename);
+        if (it != gCache.end() && it->second.format == format &&
+            it->second.contents == contents) {
+            return std::make_shared<KeyCharacterMap>(*it->second.map);
+        }
+    }
+
     Tokenizer* tokenizer;
-    status_t status = Tokenizer::open(String8(filename.c_str()), &tokenizer);
+    status_t status = Tokenizer::fromContents(String8(filename.c_str()), contents.c_str(),
+                                              &tokenizer);
     if (status) {
         return Errorf("Error {} opening key character map file {}.", status, filename.c_str());
     }
@@ -103,6 +134,10 @@ base::Result<std::shared_ptr<KeyCharacterMap>> KeyCharacterMap::load(const std::
     std::unique_ptr<Tokenizer> t(tokenizer);
     status = map->load(t.get(), format);
     if (status == OK) {
+        std::scoped_lock lock(gCacheLock);
+        gCache.insert_or_assign(filename,
+                                CachedKeyCharacterMap{std::move(contents), format,
+                                                      std::make_shared<KeyCharacterMap>(*map)});
         return map;
     }
     return Errorf("Load KeyCharacterMap failed {}.", status);
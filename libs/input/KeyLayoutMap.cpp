@@ -16,7 +16,9 @@
 
 #define LOG_TAG "KeyLayoutMap"
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
+#include <android-base/thread_annotations.h>
 #include <android/keycodes.h>
 #include <ftl/enum.h>
 #include <input/InputEventLabels.h>
@@ -31,6 +33,7 @@
 #endif
 
 #include <cstdlib>
+#include <mutex>
 #include <string_view>
 #include <unordered_map>
 
@@ -101,9 +104,13 @@ bool kernelConfigsArePresent(const std::set<std::string>& configs) {
         return true;
     }
 
-    std::map<std::string, std::string> kernelConfigs;
-    const status_t result = android::kernelconfigs::LoadKernelConfigs(&kernelConfigs);
-    LOG_ALWAYS_FATAL_IF(result != OK, "Kernel configs could not be fetched");
+    // The kernel configs do not change while the process is running, so only fetch them once.
+    static const std::map<std::string, std::string> kernelConfigs = [] {
+        std::map<std::string, std::string> configs;
+        const status_t result = android::kernelconfigs::LoadKernelConfigs(&configs);
+        LOG_ALWAYS_FATAL_IF(result != OK, "Kernel configs could not be fetched");
+        return configs;
+    }();
 
     for (const std::string& requiredConfig : configs) {
         const auto configIt = kernelConfigs.find(requiredConfig);
@@ -125,6 +132,16 @@ bool kernelConfigsArePresent(const std::set<std::string>& configs) {
 #endif
 }
 
+// Key layout maps loaded from files, keyed by file path. A map is immutable once loaded, so every
+// device that uses the same file can share it for as long as the contents of the file are the same.
+// The contents are kept to compare them, key layout map files are only a few kilobytes.
+struct CachedKeyLayoutMap {
+    std::string contents;
+    std::shared_ptr<KeyLayoutMap> map;
+};
+std::mutex gCacheLock;
+std::unordered_map<std::string, CachedKeyLayoutMap> gCache GUARDED_BY(gCacheLock);
+
 } // namespace
 
 KeyLayoutMap::KeyLayoutMap() = default;
@@ -137,13 +154,24 @@ base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::loadContents(const std
 
 base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::load(const std::string& filename,
                                                                const char* contents) {
-    Tokenizer* tokenizer;
-    status_t status;
-    if (contents == nullptr) {
-        status = Tokenizer::open(String8(filename.c_str()), &tokenizer);
-    } else {
-        status = Tokenizer::fromContents(String8(filename.c_str()), contents, &tokenizer);
+    std::string fileContents;
+    const bool fromFile = contents == nullptr;
+    if (fromFile) {
+        if (!base::ReadFileToString(filename, &fileContents)) {
+            const status_t status = -errno;
+            ALOGE("Error %d opening key layout map file %s.", status, filename.c_str());
+            return Errorf("Error {} opening key layout map file {}.", status, filename.c_str());
+        }
+        std::scoped_lock lock(gCacheLock);
+        const auto it = gCache.find(filename);
+        if (it != gCache.end() && it->second.contents == fileContents) {
+            return it->second.map;
+        }
+        contents = fileContents.c_str();
     }
+
+    Tokenizer* tokenizer;
+    status_t status = Tokenizer::fromContents(String8(filename.c_str()), contents, &tokenizer);
     if (status) {
         ALOGE("Error %d opening key layout map file %s.", status, filename.c_str());
         return Errorf("Error {} opening key layout map file {}.", status, filename.c_str());
@@ -160,6 +188,10 @@ base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::load(const std::string
         return Errorf("Missing kernel config");
     }
     map->mLoadFileName = filename;
+    if (fromFile) {
+        std::scoped_lock lock(gCacheLock);
+        gCache.insert_or_assign(filename, CachedKeyLayoutMap{std::move(fileContents), map});
+    }
     return ret;
 }
 
@@ -23,6 +23,7 @@
 #include <math.h>
 #include <array>
 #include <optional>
+#include <span>
 
 #include <input/PrintTools.h>
 #include <input/VelocityTracker.h>
@@ -71,7 +72,10 @@ static const std::map<int32_t, VelocityTracker::Strategy> DEFAULT_STRATEGY_BY_AX
          {AMOTION_EVENT_AXIS_SCROLL, VelocityTracker::Strategy::IMPULSE}};
 
 // Axes specifying location on a 2D plane (i.e. X and Y).
-static const std::set<int32_t> PLANAR_AXES = {AMOTION_EVENT_AXIS_X, AMOTION_EVENT_AXIS_Y};
+static constexpr std::array<int32_t, 2> PLANAR_AXES = {AMOTION_EVENT_AXIS_X, AMOTION_EVENT_AXIS_Y};
+
+// Axes processed for scroll events.
+static constexpr std::array<int32_t, 1> SCROLL_AXES = {AMOTION_EVENT_AXIS_SCROLL};
 
 // Axes whose motion values are differential values (i.e. deltas).
 static const std::set<int32_t> DIFFERENTIAL_AXES = {AMOTION_EVENT_AXIS_SCROLL};
@@ -119,7 +123,7 @@ static std::string vectorToString(const float* a, uint32_t m) {
     return str;
 }
 
-static std::string vectorToString(const std::vector<float>& v) {
+static std::string vectorToString(std::span<const float> v) {
     return vectorToString(v.data(), v.size());
 }
 
@@ -215,10 +219,16 @@ std::unique_ptr<VelocityTrackerStrategy> VelocityTracker::createStrategy(
     return nullptr;
 }
 
+void VelocityTracker::clearStrategies() {
+    for (std::unique_ptr<VelocityTrackerStrategy>& strategy : mConfiguredStrategies) {
+        strategy.reset();
+    }
+}
+
 void VelocityTracker::clear() {
     mCurrentPointerIdBits.clear();
     mActivePointerId = std::nullopt;
-    mConfiguredStrategies.clear();
+    clearStrategies();
 }
 
 void VelocityTracker::clearPointer(int32_t pointerId) {
@@ -233,8 +243,10 @@ void VelocityTracker::clearPointer(int32_t pointerId) {
         }
     }
 
-    for (const auto& [_, strategy] : mConfiguredStrategies) {
-        strategy->clearPointer(pointerId);
+    for (const std::unique_ptr<VelocityTrackerStrategy>& strategy : mConfiguredStrategies) {
+        if (strategy) {
+            strategy->clearPointer(pointerId);
+        }
     }
 }
 
@@ -244,6 +256,12 @@ void VelocityTracker::addMovement(nsecs_t eventTime, int32_t pointerId, int32_t
         LOG(FATAL) << "Invalid pointer ID " << pointerId << " for axis "
                    << MotionEvent::getLabel(axis);
     }
+    if (!isAxisSupported(axis)) {
+        // Movements on axes without a strategy are dropped, like getVelocity has no value for them.
+        ALOGD_IF(DEBUG_VELOCITY, "VelocityTracker: ignoring unsupported axis %d for pointer %d",
+                 axis, pointerId);
+        return;
+    }
 
     if (mCurrentPointerIdBits.hasBit(pointerId) &&
         std::chrono::nanoseconds(eventTime - mLastEventTime) > ASSUME_POINTER_STOPPED_TIME) {
@@ -252,7 +270,7 @@ void VelocityTracker::addMovement(nsecs_t eventTime, int32_t pointerId, int32_t
 
         // We have not received any movements for too long.  Assume that all pointers
         // have stopped.
-        mConfiguredStrategies.clear();
+        clearStrategies();
     }
     mLastEventTime = eventTime;
 
@@ -262,7 +280,7 @@ void VelocityTracker::addMovement(nsecs_t eventTime, int32_t pointerId, int32_t
         mActivePointerId = pointerId;
     }
 
-    if (mConfiguredStrategies.find(axis) == mConfiguredStrategies.end()) {
+    if (!mConfiguredStrategies[axis]) {
         configureStrategy(axis);
     }
     mConfiguredStrategies[axis]->addMovement(eventTime, pointerId, position);
@@ -277,7 +295,7 @@ void VelocityTracker::addMovement(nsecs_t eventTime, int32_t pointerId, int32_t
 
 void VelocityTracker::addMovement(const MotionEvent& event) {
     // Stores data about which axes to process based on the incoming motion event.
-    std::set<int32_t> axesToProcess;
+    std::span<const int32_t> axesToProcess;
     int32_t actionMasked = event.getActionMasked();
 
     switch (actionMasked) {
@@ -285,19 +303,19 @@ void VelocityTracker::addMovement(const MotionEvent& event) {
         case AMOTION_EVENT_ACTION_HOVER_ENTER:
             // Clear all pointers on down before adding the new movement.
             clear();
-            axesToProcess.insert(PLANAR_AXES.begin(), PLANAR_AXES.end());
+            axesToProcess = PLANAR_AXES;
             break;
         case AMOTION_EVENT_ACTION_POINTER_DOWN: {
             // Start a new movement trace for a pointer that just went down.
             // We do this on down instead of on up because the client may want to query the
             // final velocity for a pointer that just went up.
             clearPointer(event.getPointerId(event.getActionIndex()));
-            axesToProcess.insert(PLANAR_AXES.begin(), PLANAR_AXES.end());
+            axesToProcess = PLANAR_AXES;
             break;
         }
         case AMOTION_EVENT_ACTION_MOVE:
         case AMOTION_EVENT_ACTION_HOVER_MOVE:
-            axesToProcess.insert(PLANAR_AXES.begin(), PLANAR_AXES.end());
+            axesToProcess = PLANAR_AXES;
             break;
         case AMOTION_EVENT_ACTION_POINTER_UP:
             if (event.getFlags() & AMOTION_EVENT_FLAG_CANCELED) {
@@ -315,7 +333,7 @@ void VelocityTracker::addMovement(const MotionEvent& event) {
                 // We have not received any movements for too long.  Assume that all pointers
                 // have stopped.
                 for (int32_t axis : PLANAR_AXES) {
-                    mConfiguredStrategies.erase(axis);
+                    mConfiguredStrategies[axis].reset();
                 }
             }
             // These actions because they do not convey any new information about
@@ -329,7 +347,7 @@ void VelocityTracker::addMovement(const MotionEvent& event) {
             return;
         }
         case AMOTION_EVENT_ACTION_SCROLL:
-            axesToProcess.insert(AMOTION_EVENT_AXIS_SCROLL);
+            axesToProcess = SCROLL_AXES;
             break;
         case AMOTION_EVENT_ACTION_CANCEL: {
             clear();
@@ -358,9 +376,12 @@ void VelocityTracker::addMovement(const MotionEvent& event) {
 }
 
 std::optional<float> VelocityTracker::getVelocity(int32_t axis, int32_t pointerId) const {
-    const auto& it = mConfiguredStrategies.find(axis);
-    if (it != mConfiguredStrategies.end()) {
-        return it->second->getVelocity(pointerId);
+    if (axis < 0 || axis > AMOTION_EVENT_MAXIMUM_VALID_AXIS_VALUE) {
+        return {};
+    }
+    const std::unique_ptr<VelocityTrackerStrategy>& strategy = mConfiguredStrategies[axis];
+    if (strategy) {
+        return strategy->getVelocity(pointerId);
     }
     return {};
 }
@@ -368,7 +389,10 @@ std::optional<float> VelocityTracker::getVelocity(int32_t axis, int32_t pointerI
 VelocityTracker::ComputedVelocity VelocityTracker::getComputedVelocity(int32_t units,
                                                                        float maxVelocity) {
     ComputedVelocity computedVelocity;
-    for (const auto& [axis, _] : mConfiguredStrategies) {
+    for (int32_t axis = 0; axis <= AMOTION_EVENT_MAXIMUM_VALID_AXIS_VALUE; axis++) {
+        if (!mConfiguredStrategies[axis]) {
+            continue;
+        }
         BitSet32 copyIdBits = BitSet32(mCurrentPointerIdBits);
         while (!copyIdBits.isEmpty()) {
             uint32_t id = copyIdBits.clearFirstMarkedBit();
@@ -388,13 +412,26 @@ AccumulatingVelocityTrackerStrategy::AccumulatingVelocityTrackerStrategy(
       : mHorizonNanos(horizonNanos), mMaintainHorizonDuringAdd(maintainHorizonDuringAdd) {}
 
 void AccumulatingVelocityTrackerStrategy::clearPointer(int32_t pointerId) {
-    mMovements.erase(pointerId);
+    if (pointerId >= 0 && pointerId <= MAX_POINTER_ID && mMovements[pointerId]) {
+        mMovements[pointerId]->clear();
+    }
+}
+
+const RingBuffer<AccumulatingVelocityTrackerStrategy::Movement>*
+AccumulatingVelocityTrackerStrategy::findMovements(int32_t pointerId) const {
+    if (pointerId < 0 || pointerId > MAX_POINTER_ID || !mMovements[pointerId]) {
+        return nullptr;
+    }
+    return &*mMovements[pointerId];
 }
 
 void AccumulatingVelocityTrackerStrategy::addMovement(nsecs_t eventTime, int32_t pointerId,
                                                       float position) {
-    auto [ringBufferIt, _] = mMovements.try_emplace(pointerId, HISTORY_SIZE);
-    RingBuffer<Movement>& movements = ringBufferIt->second;
+    std::optional<RingBuffer<Movement>>& pointerMovements = mMovements[pointerId];
+    if (!pointerMovements) {
+        pointerMovements.emplace(HISTORY_SIZE);
+    }
+    RingBuffer<Movement>& movements = *pointerMovements;
     const size_t size = movements.size();
 
     if (size != 0 && movements[size - 1].eventTime == eventTime) {
@@ -479,9 +516,8 @@ LeastSquaresVelocityTrackerStrategy::~LeastSquaresVelocityTrackerStrategy() {}
  * http://en.wikipedia.org/wiki/Numerical_methods_for_linear_least_squares
  * http://en.wikipedia.org/wiki/Gram-Schmidt
  */
-static std::optional<float> solveLeastSquares(const std::vector<float>& x,
-                                              const std::vector<float>& y,
-                                              const std::vector<float>& w, uint32_t n) {
+static std::optional<float> solveLeastSquares(std::span<const float> x, std::span<const float> y,
+                                              std::span<const float> w, uint32_t n) {
     const size_t m = x.size();
 
     ALOGD_IF(DEBUG_STRATEGY, "solveLeastSquares: m=%d, n=%d, x=%s, y=%s, w=%s", int(m), int(n),
@@ -646,12 +682,12 @@ std::optional<float> LeastSquaresVelocityTrackerStrategy::solveUnweightedLeastSq
 }
 
 std::optional<float> LeastSquaresVelocityTrackerStrategy::getVelocity(int32_t pointerId) const {
-    const auto movementIt = mMovements.find(pointerId);
-    if (movementIt == mMovements.end()) {
+    const RingBuffer<Movement>* pointerMovements = findMovements(pointerId);
+    if (pointerMovements == nullptr) {
         return std::nullopt; // no data
     }
 
-    const RingBuffer<Movement>& movements = movementIt->second;
+    const RingBuffer<Movement>& movements = *pointerMovements;
     const size_t size = movements.size();
     if (size == 0) {
         return std::nullopt; // no data
@@ -672,25 +708,28 @@ std::optional<float> LeastSquaresVelocityTrackerStrategy::getVelocity(int32_t po
     }
 
     // Iterate over movement samples in reverse time order and collect samples.
-    std::vector<float> positions;
-    std::vector<float> w;
-    std::vector<float> time;
+    // The ring buffer never holds more than HISTORY_SIZE movements.
+    std::array<float, HISTORY_SIZE> positions;
+    std::array<float, HISTORY_SIZE> w;
+    std::array<float, HISTORY_SIZE> time;
 
     const Movement& newestMovement = movements[size - 1];
-    for (ssize_t i = size - 1; i >= 0; i--) {
-        const Movement& movement = movements[i];
+    for (size_t i = 0; i < size; i++) {
+        const size_t index = size - 1 - i;
+        const Movement& movement = movements[index];
         nsecs_t age = newestMovement.eventTime - movement.eventTime;
-        positions.push_back(movement.position);
-        w.push_back(chooseWeight(pointerId, i));
-        time.push_back(-age * 0.000000001f);
+        positions[i] = movement.position;
+        w[i] = chooseWeight(movements, index);
+        time[i] = -age * 0.000000001f;
     }
 
     // General case for an Nth degree polynomial fit
-    return solveLeastSquares(time, positions, w, degree + 1);
+    return solveLeastSquares({time.data(), size}, {positions.data(), size}, {w.data(), size},
+                             degree + 1);
 }
 
-float LeastSquaresVelocityTrackerStrategy::chooseWeight(int32_t pointerId, uint32_t index) const {
-    const RingBuffer<Movement>& movements = mMovements.at(pointerId);
+float LeastSquaresVelocityTrackerStrategy::chooseWeight(const RingBuffer<Movement>& movements,
+                                                        uint32_t index) const {
     const size_t size = movements.size();
     switch (mWeighting) {
         case Weighting::DELTA: {
@@ -843,12 +882,12 @@ LegacyVelocityTrackerStrategy::~LegacyVelocityTrackerStrategy() {
 }
 
 std::optional<float> LegacyVelocityTrackerStrategy::getVelocity(int32_t pointerId) const {
-    const auto movementIt = mMovements.find(pointerId);
-    if (movementIt == mMovements.end()) {
+    const RingBuffer<Movement>* pointerMovements = findMovements(pointerId);
+    if (pointerMovements == nullptr) {
         return std::nullopt; // no data
     }
 
-    const RingBuffer<Movement>& movements = movementIt->second;
+    const RingBuffer<Movement>& movements = *pointerMovements;
     const size_t size = movements.size();
     if (size == 0) {
         return std::nullopt; // no data
@@ -992,12 +1031,12 @@ static float kineticEnergyToVelocity(float work) {
 }
 
 std::optional<float> ImpulseVelocityTrackerStrategy::getVelocity(int32_t pointerId) const {
-    const auto movementIt = mMovements.find(pointerId);
-    if (movementIt == mMovements.end()) {
+    const RingBuffer<Movement>* pointerMovements = findMovements(pointerId);
+    if (pointerMovements == nullptr) {
         return std::nullopt; // no data
     }
 
-    const RingBuffer<Movement>& movements = movementIt->second;
+    const RingBuffer<Movement>& movements = *pointerMovements;
     const size_t size = movements.size();
     if (size == 0) {
         return std::nullopt; // no data
@@ -196,6 +196,66 @@ TEST_F(InputChannelTest, SendSignal_WhenPeerClosed_ReturnsAnError) {
             << "sendMessage should have returned DEAD_OBJECT";
 }
 
+TEST_F(InputChannelTest, SendMessages_ReceivesEachMessage) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+
+    // More messages than a single system call sends, of different sizes.
+    std::vector<InputMessage> serverMsgs(100);
+    for (size_t i = 0; i < serverMsgs.size(); i++) {
+        InputMessage msg = {};
+        if (i % 2 == 0) {
+            msg.header.type = InputMessage::Type::KEY;
+            msg.body.key.action = AKEY_EVENT_ACTION_DOWN;
+        } else {
+            msg.header.type = InputMessage::Type::FOCUS;
+            msg.body.focus.hasFocus = true;
+        }
+        msg.header.seq = i + 1;
+        msg.getSanitizedCopy(&serverMsgs[i]);
+    }
+
+    // The socket does not hold all of them, so receive them while sending.
+    size_t sentCount = 0;
+    size_t receivedCount = 0;
+    while (receivedCount < serverMsgs.size()) {
+        size_t newlySentCount;
+        result = serverChannel->sendMessages(serverMsgs.data() + sentCount,
+                                             serverMsgs.size() - sentCount, &newlySentCount);
+        sentCount += newlySentCount;
+        ASSERT_TRUE(result == OK || result == WOULD_BLOCK) << statusToString(result);
+        ASSERT_EQ(result == OK, sentCount == serverMsgs.size());
+
+        InputMessage clientMsg;
+        while (clientChannel->receiveMessage(&clientMsg) == OK) {
+            ASSERT_LT(receivedCount, sentCount);
+            EXPECT_EQ(serverMsgs[receivedCount].header.type, clientMsg.header.type);
+            EXPECT_EQ(serverMsgs[receivedCount].header.seq, clientMsg.header.seq);
+            receivedCount++;
+        }
+    }
+    EXPECT_EQ(serverMsgs.size(), sentCount);
+}
+
+TEST_F(InputChannelTest, SendMessages_WhenPeerClosed_ReturnsAnError) {
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    status_t result =
+            InputChannel::openInputChannelPair("channel name", serverChannel, clientChannel);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+
+    serverChannel.reset(); // close server channel
+
+    InputMessage msgs[2] = {};
+    msgs[0].header.type = InputMessage::Type::KEY;
+    msgs[1].header.type = InputMessage::Type::KEY;
+    size_t sentCount;
+    EXPECT_EQ(DEAD_OBJECT, clientChannel->sendMessages(msgs, 2, &sentCount))
+            << "sendMessages should have returned DEAD_OBJECT";
+    EXPECT_EQ(0u, sentCount);
+}
+
 TEST_F(InputChannelTest, SendAndReceive_MotionClassification) {
     std::unique_ptr<InputChannel> serverChannel, clientChannel;
     status_t result = InputChannel::openInputChannelPair("channel name",
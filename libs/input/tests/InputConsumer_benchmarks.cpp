@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <vector>
+
+#include <attestation/HmacKeyManager.h>
+#include <input/Input.h>
+#include <input/InputTransport.h>
+
+namespace android {
+
+namespace {
+
+// Time between two samples of a 240Hz touchscreen.
+constexpr nsecs_t SAMPLE_INTERVAL = 4'166'667;
+
+class TouchStream {
+public:
+    TouchStream(InputPublisher& publisher, size_t pointerCount)
+          : mPublisher(publisher), mProperties(pointerCount), mCoords(pointerCount) {
+        for (size_t i = 0; i < pointerCount; i++) {
+            mProperties[i].clear();
+            mProperties[i].id = i;
+            mProperties[i].toolType = ToolType::FINGER;
+        }
+    }
+
+    // Puts the pointers down, one after the other.
+    status_t publishDown() {
+        for (size_t i = 0; i < mProperties.size(); i++) {
+            const int32_t action = i == 0
+                    ? AMOTION_EVENT_ACTION_DOWN
+                    : AMOTION_EVENT_ACTION_POINTER_DOWN |
+                            (static_cast<int32_t>(i) << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT);
+            if (status_t status = publish(action, i + 1); status != OK) {
+                return status;
+            }
+        }
+        return OK;
+    }
+
+    status_t publishMove() {
+        mEventTime += SAMPLE_INTERVAL;
+        return publish(AMOTION_EVENT_ACTION_MOVE, mProperties.size());
+    }
+
+    nsecs_t getEventTime() const { return mEventTime; }
+
+private:
+    InputPublisher& mPublisher;
+    std::vector<PointerProperties> mProperties;
+    std::vector<PointerCoords> mCoords;
+    uint32_t mSeq = 1;
+    nsecs_t mEventTime = 0;
+
+    status_t publish(int32_t action, size_t pointerCount) {
+        // Every pointer moves along a line, by a few pixels per sample.
+        const float offset = mEventTime / 1'000'000.f;
+        for (size_t i = 0; i < pointerCount; i++) {
+            mCoords[i].clear();
+            mCoords[i].setAxisValue(AMOTION_EVENT_AXIS_X, 100 + i * 50 + offset);
+            mCoords[i].setAxisValue(AMOTION_EVENT_AXIS_Y, 200 + i * 50 + offset * 2);
+            mCoords[i].setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, 0.5);
+            mCoords[i].setAxisValue(AMOTION_EVENT_AXIS_SIZE, 0.1);
+            mCoords[i].setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MAJOR, 10);
+            mCoords[i].setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MINOR, 8);
+        }
+        ui::Transform identity;
+        return mPublisher.publishMotionEvent(mSeq++, InputEvent::nextId(), /*deviceId=*/1,
+                                             AINPUT_SOURCE_TOUCHSCREEN, /*displayId=*/0,
+                                             INVALID_HMAC, action, /*actionButton=*/0, /*flags=*/0,
+                                             /*edgeFlags=*/0, AMETA_NONE, /*buttonState=*/0,
+                                             MotionClassification::NONE, identity,
+                                             /*xPrecision=*/0, /*yPrecision=*/0,
+                                             AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                                             AMOTION_EVENT_INVALID_CURSOR_POSITION, identity,
+                                             /*downTime=*/0, mEventTime, pointerCount,
+                                             mProperties.data(), mCoords.data());
+    }
+};
+
+// Reads the finished signals, so that the channel does not fill up.
+void receiveConsumerResponses(InputPublisher& publisher) {
+    while (publisher.receiveConsumerResponse().ok()) {
+    }
+}
+
+} // namespace
+
+/**
+ * Measures the time that an application spends in consume for every frame, while a 240Hz
+ * touchscreen is touched by the given number of pointers. The samples that arrive during a frame
+ * are consumed as one batch, and resampled for the time of the frame.
+ */
+static void benchmarkConsumeFrame(benchmark::State& state) {
+    const size_t pointerCount = state.range(0);
+    const size_t samplesPerFrame = state.range(1);
+
+    std::unique_ptr<InputChannel> serverChannel, clientChannel;
+    if (InputChannel::openInputChannelPair("benchmark", serverChannel, clientChannel) != OK) {
+        state.SkipWithError("Could not open the input channels");
+        return;
+    }
+    InputPublisher publisher(std::move(serverChannel));
+    InputConsumer consumer(std::move(clientChannel), /*enableTouchResampling=*/true);
+    PreallocatedInputEventFactory factory;
+    uint32_t seq;
+    InputEvent* event;
+
+    TouchStream stream(publisher, pointerCount);
+    if (stream.publishDown() != OK) {
+        state.SkipWithError("Could not publish the down events");
+        return;
+    }
+    while (consumer.consume(&factory, /*consumeBatches=*/true, /*frameTime=*/-1, &seq, &event) ==
+           OK) {
+        consumer.sendFinishedSignal(seq, /*handled=*/true);
+    }
+    receiveConsumerResponses(publisher);
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < samplesPerFrame; i++) {
+            stream.publishMove();
+        }
+        // The frame starts a little after the last sample, so the batch is resampled.
+        const nsecs_t frameTime = stream.getEventTime() + SAMPLE_INTERVAL;
+
+        const auto start = std::chrono::steady_clock::now();
+        if (consumer.consume(&factory, /*consumeBatches=*/true, frameTime, &seq, &event) != OK) {
+            state.SkipWithError("Could not consume the batch");
+            return;
+        }
+        consumer.sendFinishedSignal(seq, /*handled=*/true);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        state.SetIterationTime(elapsed.count());
+
+        receiveConsumerResponses(publisher);
+    }
+    state.SetItemsProcessed(state.iterations() * samplesPerFrame);
+}
+
+BENCHMARK(benchmarkConsumeFrame)
+        ->ArgNames({"pointers", "samples"})
+        ->Args({1, 2})
+        ->Args({1, 4})
+        ->Args({5, 2})
+        ->Args({5, 4})
+        ->UseManualTime();
+
+} // namespace android
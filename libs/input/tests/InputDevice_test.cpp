@@ -224,4 +224,45 @@ TEST(InputDeviceKeyLayoutTest, LoadsWhenRequiredKernelConfigIsPresent) {
     ASSERT_NE(nullptr, map) << "Map should be valid because CONFIG_UHID should always be present";
 }
 
+TEST(InputDeviceKeyLayoutTest, LoadingTheSameFileAgainReturnsTheSameMap) {
+    std::string klPath = base::GetExecutableDirectory() + "/data/hid_fallback_mapping.kl";
+    base::Result<std::shared_ptr<KeyLayoutMap>> first = KeyLayoutMap::load(klPath);
+    ASSERT_TRUE(first.ok()) << "Unable to load KeyLayout at " << klPath;
+    base::Result<std::shared_ptr<KeyLayoutMap>> second = KeyLayoutMap::load(klPath);
+    ASSERT_TRUE(second.ok()) << "Unable to load KeyLayout at " << klPath;
+    // The map is immutable, so it is shared instead of parsing the file again.
+    ASSERT_EQ(*first, *second);
+}
+
+TEST(InputDeviceKeyLayoutTest, LoadingAChangedFileOfTheSameSizeParsesItAgain) {
+    TemporaryFile klFile;
+    ASSERT_TRUE(base::WriteStringToFile("key 30 A\n", klFile.path));
+    base::Result<std::shared_ptr<KeyLayoutMap>> first = KeyLayoutMap::load(klFile.path);
+    ASSERT_TRUE(first.ok()) << "Unable to load KeyLayout at " << klFile.path;
+    ASSERT_EQ(std::vector<int32_t>{30}, (*first)->findScanCodesForKey(AKEYCODE_A));
+
+    ASSERT_TRUE(base::WriteStringToFile("key 30 B\n", klFile.path));
+    base::Result<std::shared_ptr<KeyLayoutMap>> second = KeyLayoutMap::load(klFile.path);
+    ASSERT_TRUE(second.ok()) << "Unable to load KeyLayout at " << klFile.path;
+    ASSERT_NE(*first, *second);
+    ASSERT_EQ(std::vector<int32_t>{}, (*second)->findScanCodesForKey(AKEYCODE_A));
+    ASSERT_EQ(std::vector<int32_t>{30}, (*second)->findScanCodesForKey(AKEYCODE_B));
+}
+
+TEST(InputDeviceKeyCharacterMapTest, LoadingTheSameFileAgainReturnsACopy) {
+    std::string kcmPath = base::GetExecutableDirectory() + "/data/french.kcm";
+    base::Result<std::shared_ptr<KeyCharacterMap>> first =
+            KeyCharacterMap::load(kcmPath, KeyCharacterMap::Format::OVERLAY);
+    ASSERT_TRUE(first.ok()) << "Cannot load KeyCharacterMap at " << kcmPath;
+    base::Result<std::shared_ptr<KeyCharacterMap>> second =
+            KeyCharacterMap::load(kcmPath, KeyCharacterMap::Format::OVERLAY);
+    ASSERT_TRUE(second.ok()) << "Cannot load KeyCharacterMap at " << kcmPath;
+    ASSERT_NE(*first, *second);
+    ASSERT_EQ(**first, **second);
+
+    // Changing one of the maps must not change the other.
+    (*first)->addKeyRemapping(AKEYCODE_A, AKEYCODE_B);
+    ASSERT_NE(**first, **second);
+}
+
 } // namespace android
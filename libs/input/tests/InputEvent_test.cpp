@@ -756,6 +756,27 @@ TEST_F(MotionEventTest, ApplyTransform) {
                 changedEvent.getAxisValue(AMOTION_EVENT_AXIS_RELATIVE_Y, 0), 0.001);
 }
 
+TEST_F(MotionEventTest, ApplyTransform_TransformsHistoricalSamples) {
+    ui::Transform identity;
+    MotionEvent event = createTouchDownEvent(60, 100, 0, 0, identity, identity);
+    // A sample without a Y value, which is not stored because it is 0.
+    PointerCoords coords;
+    coords.clear();
+    coords.setAxisValue(AMOTION_EVENT_AXIS_X, 30);
+    event.addSample(event.getEventTime() + 1, &coords);
+
+    ui::Transform transform(ui::Transform::ROT_90, 800, 400);
+    const std::array<float, 9> rowMajor{transform[0][0], transform[1][0], transform[2][0],
+                                        transform[0][1], transform[1][1], transform[2][1],
+                                        transform[0][2], transform[1][2], transform[2][2]};
+    event.applyTransform(rowMajor);
+
+    ASSERT_EQ(700, event.getHistoricalRawX(0, 0));
+    ASSERT_EQ(60, event.getHistoricalRawY(0, 0));
+    ASSERT_EQ(800, event.getRawX(0));
+    ASSERT_EQ(30, event.getRawY(0));
+}
+
 TEST_F(MotionEventTest, JoystickAndTouchpadAreNotTransformed) {
     constexpr static std::array kNonTransformedSources =
             {std::pair(AINPUT_SOURCE_TOUCHPAD, AMOTION_EVENT_ACTION_DOWN),
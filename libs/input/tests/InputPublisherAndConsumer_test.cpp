@@ -696,4 +696,41 @@ TEST_F(InputPublisherAndConsumerTest, PublishMultipleEvents_EndToEnd) {
     ASSERT_NO_FATAL_FAILURE(publishAndConsumeTouchModeEvent());
 }
 
+TEST_F(InputPublisherAndConsumerTest, PublishBatch_SendsEventsWhenBatchEnds) {
+    mPublisher->beginBatch();
+    ASSERT_EQ(OK, mPublisher->publishFocusEvent(/*seq=*/1, InputEvent::nextId(), true));
+    ASSERT_EQ(OK, mPublisher->publishTouchModeEvent(/*seq=*/2, InputEvent::nextId(), true));
+    ASSERT_EQ(BAD_VALUE,
+              mPublisher->publishKeyEvent(/*seq=*/0, InputEvent::nextId(), 0, 0, 0, INVALID_HMAC,
+                                          AKEY_EVENT_ACTION_DOWN, 0, 0, 0, 0, 0, 0, 0))
+            << "publisher should check the events it stages";
+    ASSERT_EQ(OK, mPublisher->publishDragEvent(/*seq=*/3, InputEvent::nextId(), 10, 20, false));
+
+    uint32_t consumeSeq;
+    InputEvent* event;
+    ASSERT_EQ(WOULD_BLOCK,
+              mConsumer->consume(&mEventFactory, /*consumeBatches=*/true, -1, &consumeSeq, &event))
+            << "events should not be sent before the batch ends";
+
+    size_t publishedCount;
+    ASSERT_EQ(OK, mPublisher->endBatch(&publishedCount));
+    ASSERT_EQ(3u, publishedCount);
+
+    const std::array<std::pair<uint32_t, InputEventType>, 3> expectedEvents = {{
+            {1, InputEventType::FOCUS},
+            {2, InputEventType::TOUCH_MODE},
+            {3, InputEventType::DRAG},
+    }};
+    for (const auto& [seq, type] : expectedEvents) {
+        ASSERT_EQ(OK,
+                  mConsumer->consume(&mEventFactory, /*consumeBatches=*/true, -1, &consumeSeq,
+                                     &event));
+        EXPECT_EQ(seq, consumeSeq);
+        EXPECT_EQ(type, event->getType());
+    }
+
+    // Events published after the batch are sent right away.
+    ASSERT_NO_FATAL_FAILURE(publishAndConsumeFocusEvent());
+}
+
 } // namespace android
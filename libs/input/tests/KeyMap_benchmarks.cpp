@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <android-base/file.h>
+#include <input/KeyCharacterMap.h>
+#include <input/KeyLayoutMap.h>
+
+namespace android {
+
+namespace {
+
+std::string getTestDataPath(const std::string& name) {
+    return base::GetExecutableDirectory() + "/data/" + name;
+}
+
+} // namespace
+
+// Parses the key layout map every time, which is what opening a keyboard used to cost.
+static void benchmarkParseKeyLayoutMap(benchmark::State& state) {
+    const std::string path = getTestDataPath("hid_fallback_mapping.kl");
+    std::string contents;
+    if (!base::ReadFileToString(path, &contents)) {
+        state.SkipWithError("Could not read the key layout map");
+        return;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(KeyLayoutMap::loadContents(path, contents.c_str()));
+    }
+}
+
+// Loads the key layout map from its file, which is what opening a keyboard costs now.
+static void benchmarkLoadKeyLayoutMap(benchmark::State& state) {
+    const std::string path = getTestDataPath("hid_fallback_mapping.kl");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(KeyLayoutMap::load(path));
+    }
+}
+
+static void benchmarkParseKeyCharacterMap(benchmark::State& state) {
+    const std::string path = getTestDataPath("english_us.kcm");
+    std::string contents;
+    if (!base::ReadFileToString(path, &contents)) {
+        state.SkipWithError("Could not read the key character map");
+        return;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+                KeyCharacterMap::loadContents(path, contents.c_str(),
+                                              KeyCharacterMap::Format::OVERLAY));
+    }
+}
+
+static void benchmarkLoadKeyCharacterMap(benchmark::State& state) {
+    const std::string path = getTestDataPath("english_us.kcm");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(KeyCharacterMap::load(path, KeyCharacterMap::Format::OVERLAY));
+    }
+}
+
+BENCHMARK(benchmarkParseKeyLayoutMap);
+BENCHMARK(benchmarkLoadKeyLayoutMap);
+BENCHMARK(benchmarkParseKeyCharacterMap);
+BENCHMARK(benchmarkLoadKeyCharacterMap);
+
+} // namespace android
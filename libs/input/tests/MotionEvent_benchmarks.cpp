@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <vector>
+
+#include <attestation/HmacKeyManager.h>
+#include <input/Input.h>
+#include <ui/Transform.h>
+
+namespace android {
+
+namespace {
+
+constexpr size_t POINTER_COUNT = 2;
+
+// Axes that a touchscreen typically reports for every pointer.
+std::array<PointerCoords, POINTER_COUNT> generateTouchCoords(float offset) {
+    std::array<PointerCoords, POINTER_COUNT> coords;
+    for (size_t i = 0; i < POINTER_COUNT; i++) {
+        coords[i].clear();
+        coords[i].setAxisValue(AMOTION_EVENT_AXIS_X, 100 + offset + i * 50);
+        coords[i].setAxisValue(AMOTION_EVENT_AXIS_Y, 200 + offset + i * 50);
+        coords[i].setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, 0.5);
+        coords[i].setAxisValue(AMOTION_EVENT_AXIS_SIZE, 0.1);
+        coords[i].setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MAJOR, 10);
+        coords[i].setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MINOR, 8);
+        coords[i].setAxisValue(AMOTION_EVENT_AXIS_ORIENTATION, 0.3);
+    }
+    return coords;
+}
+
+MotionEvent generateMotionEvent(size_t historySize) {
+    std::array<PointerProperties, POINTER_COUNT> properties;
+    for (size_t i = 0; i < POINTER_COUNT; i++) {
+        properties[i].clear();
+        properties[i].id = i;
+        properties[i].toolType = ToolType::FINGER;
+    }
+
+    ui::Transform identity;
+    MotionEvent event;
+    event.initialize(InputEvent::nextId(), /*deviceId=*/1, AINPUT_SOURCE_TOUCHSCREEN,
+                     /*displayId=*/0, INVALID_HMAC, AMOTION_EVENT_ACTION_MOVE,
+                     /*actionButton=*/0, /*flags=*/0, /*edgeFlags=*/0, AMETA_NONE,
+                     /*buttonState=*/0, MotionClassification::NONE, identity, /*xPrecision=*/0,
+                     /*yPrecision=*/0, AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                     AMOTION_EVENT_INVALID_CURSOR_POSITION, identity, /*downTime=*/0,
+                     /*eventTime=*/0, POINTER_COUNT, properties.data(),
+                     generateTouchCoords(0).data());
+    for (size_t i = 1; i <= historySize; i++) {
+        event.addSample(i, generateTouchCoords(i).data());
+    }
+    return event;
+}
+
+std::array<float, 9> rotate90WithOffset() {
+    ui::Transform transform(ui::Transform::ROT_90, 1080, 2400);
+    transform.set(transform.tx() + 20, transform.ty() + 40);
+    return {transform[0][0], transform[1][0], transform[2][0],
+            transform[0][1], transform[1][1], transform[2][1],
+            transform[0][2], transform[1][2], transform[2][2]};
+}
+
+} // namespace
+
+static void benchmarkTransform(benchmark::State& state) {
+    MotionEvent event = generateMotionEvent(state.range(0));
+    const std::array<float, 9> matrix = rotate90WithOffset();
+    for (auto _ : state) {
+        event.transform(matrix);
+        benchmark::DoNotOptimize(event.getHistoricalAxisValue(AMOTION_EVENT_AXIS_X, 0, 0));
+    }
+}
+
+static void benchmarkApplyTransform(benchmark::State& state) {
+    MotionEvent event = generateMotionEvent(state.range(0));
+    const std::array<float, 9> matrix = rotate90WithOffset();
+    for (auto _ : state) {
+        event.applyTransform(matrix);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * (state.range(0) + 1) * POINTER_COUNT);
+}
+
+static void benchmarkAddSample(benchmark::State& state) {
+    const size_t historySize = state.range(0);
+    std::vector<std::array<PointerCoords, POINTER_COUNT>> samples;
+    for (size_t i = 1; i <= historySize; i++) {
+        samples.push_back(generateTouchCoords(i));
+    }
+    for (auto _ : state) {
+        MotionEvent event = generateMotionEvent(/*historySize=*/0);
+        for (size_t i = 0; i < historySize; i++) {
+            event.addSample(i + 1, samples[i].data());
+        }
+        benchmark::DoNotOptimize(event.getHistorySize());
+    }
+    state.SetItemsProcessed(state.iterations() * historySize);
+}
+
+BENCHMARK(benchmarkTransform)->Arg(0)->Arg(32);
+BENCHMARK(benchmarkApplyTransform)->Arg(0)->Arg(32);
+BENCHMARK(benchmarkAddSample)->Arg(8)->Arg(32);
+
+} // namespace android
+
+BENCHMARK_MAIN();
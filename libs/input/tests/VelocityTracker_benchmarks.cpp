@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <input/VelocityTracker.h>
+
+namespace android {
+
+namespace {
+
+// Time between two samples of a 120Hz touchscreen.
+constexpr nsecs_t SAMPLE_INTERVAL = 8'333'333;
+
+// A gesture of 20 samples for every pointer, which fills the history of the strategies.
+constexpr size_t SAMPLE_COUNT = 20;
+
+} // namespace
+
+static void benchmarkAddMovementAndGetVelocity(benchmark::State& state,
+                                               VelocityTracker::Strategy strategy) {
+    const int32_t pointerCount = state.range(0);
+    for (auto _ : state) {
+        VelocityTracker tracker(strategy);
+        for (size_t sample = 0; sample < SAMPLE_COUNT; sample++) {
+            const nsecs_t eventTime = sample * SAMPLE_INTERVAL;
+            for (int32_t pointerId = 0; pointerId < pointerCount; pointerId++) {
+                tracker.addMovement(eventTime, pointerId, AMOTION_EVENT_AXIS_X,
+                                    100 + pointerId * 50 + sample * sample);
+                tracker.addMovement(eventTime, pointerId, AMOTION_EVENT_AXIS_Y,
+                                    200 + pointerId * 50 + sample * 3);
+            }
+        }
+        for (int32_t pointerId = 0; pointerId < pointerCount; pointerId++) {
+            benchmark::DoNotOptimize(tracker.getVelocity(AMOTION_EVENT_AXIS_X, pointerId));
+            benchmark::DoNotOptimize(tracker.getVelocity(AMOTION_EVENT_AXIS_Y, pointerId));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * pointerCount);
+}
+
+BENCHMARK_CAPTURE(benchmarkAddMovementAndGetVelocity, lsq2, VelocityTracker::Strategy::LSQ2)
+        ->Arg(1)
+        ->Arg(2)
+        ->Arg(5)
+        ->Arg(10);
+BENCHMARK_CAPTURE(benchmarkAddMovementAndGetVelocity, lsq3, VelocityTracker::Strategy::LSQ3)
+        ->Arg(1)
+        ->Arg(2)
+        ->Arg(5)
+        ->Arg(10);
+BENCHMARK_CAPTURE(benchmarkAddMovementAndGetVelocity, impulse, VelocityTracker::Strategy::IMPULSE)
+        ->Arg(1)
+        ->Arg(2)
+        ->Arg(5)
+        ->Arg(10);
+
+} // namespace android
@@ -303,6 +303,34 @@ TEST(SimpleVelocityTrackerTest, TestSupportedAxis) {
     }
 }
 
+TEST(SimpleVelocityTrackerTest, IgnoresUnsupportedAxes) {
+    VelocityTracker vt;
+    for (int32_t axis : {-1, static_cast<int32_t>(AMOTION_EVENT_AXIS_PRESSURE),
+                         AMOTION_EVENT_MAXIMUM_VALID_AXIS_VALUE + 1}) {
+        vt.addMovement(/*eventTime=*/0, DEFAULT_POINTER_ID, axis, /*position=*/10);
+        vt.addMovement(/*eventTime=*/10'000'000, DEFAULT_POINTER_ID, axis, /*position=*/20);
+        EXPECT_FALSE(vt.getVelocity(axis, DEFAULT_POINTER_ID).has_value()) << axis;
+    }
+    EXPECT_EQ(-1, vt.getActivePointerId());
+}
+
+TEST(SimpleVelocityTrackerTest, SkipsUnsupportedAxisWithOverrideStrategy) {
+    VelocityTracker vt(VelocityTracker::Strategy::LSQ2);
+    for (int i = 0; i < 4; i++) {
+        const nsecs_t eventTime = i * 10'000'000;
+        vt.addMovement(eventTime, DEFAULT_POINTER_ID, AMOTION_EVENT_AXIS_PRESSURE, i * 0.1f);
+        vt.addMovement(eventTime, DEFAULT_POINTER_ID, AMOTION_EVENT_AXIS_X, i * 10.0f);
+    }
+
+    // The skipped axis does not get in the way of the supported one.
+    EXPECT_FALSE(vt.getVelocity(AMOTION_EVENT_AXIS_PRESSURE, DEFAULT_POINTER_ID).has_value());
+    const std::optional<float> velocity =
+            vt.getVelocity(AMOTION_EVENT_AXIS_X, DEFAULT_POINTER_ID);
+    ASSERT_TRUE(velocity.has_value());
+    EXPECT_NEAR(1000.0f, *velocity, 1.0f);
+    EXPECT_EQ(DEFAULT_POINTER_ID, vt.getActivePointerId());
+}
+
 /*
  * ================== VelocityTracker tests generated manually =====================================
  */
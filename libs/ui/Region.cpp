@@ -19,6 +19,8 @@
 #include <inttypes.h>
 #include <limits.h>
 
+#include <algorithm>
+
 #include <android-base/stringprintf.h>
 
 #include <utils/Log.h>
@@ -466,18 +468,17 @@ const Region Region::operation(const Region& rhs, int dx, int dy, uint32_t op) c
 // ----------------------------------------------------------------------------
 
 // This is our region rasterizer, which merges rects and spans together
-// to obtain an optimal region.
+// to obtain an optimal region. The current span is built in place at the end
+// of the storage, right after the previous span that it may be merged into.
 class Region::rasterizer : public region_operator<Rect>::region_rasterizer
 {
     Rect bounds;
     FatVector<Rect>& storage;
-    Rect* head;
-    Rect* tail;
-    FatVector<Rect> span;
-    Rect* cur;
+    size_t head;
+    size_t tail;
 public:
     explicit rasterizer(Region& reg)
-        : bounds(INT_MAX, 0, INT_MIN, 0), storage(reg.mStorage), head(), tail(), cur() {
+        : bounds(INT_MAX, 0, INT_MIN, 0), storage(reg.mStorage), head(0), tail(0) {
         storage.clear();
     }
 
@@ -496,7 +497,7 @@ private:
 
 Region::rasterizer::~rasterizer()
 {
-    if (span.size()) {
+    if (storage.size() > tail) {
         flushSpan();
     }
     if (storage.size()) {
@@ -516,51 +517,46 @@ void Region::rasterizer::operator()(const Rect& rect)
 {
     //ALOGD(">>> %3d, %3d, %3d, %3d",
     //        rect.left, rect.top, rect.right, rect.bottom);
-    if (span.size()) {
-        if (cur->top != rect.top) {
+    if (storage.size() > tail) {
+        Rect& cur = storage.back();
+        if (cur.top != rect.top) {
             flushSpan();
-        } else if (cur->right == rect.left) {
-            cur->right = rect.right;
+        } else if (cur.right == rect.left) {
+            cur.right = rect.right;
             return;
         }
     }
-    span.push_back(rect);
-    cur = span.data() + (span.size() - 1);
+    storage.push_back(rect);
 }
 
 void Region::rasterizer::flushSpan()
 {
+    // The previous span is [head, tail) and the current one [tail, end).
+    const size_t count = storage.size() - tail;
+    Rect* const prev = storage.data() + head;
+    Rect const* const span = storage.data() + tail;
     bool merge = false;
-    if (tail-head == ssize_t(span.size())) {
-        Rect const* p = span.data();
-        Rect const* q = head;
-        if (p->top == q->bottom) {
-            merge = true;
-            while (q != tail) {
-                if ((p->left != q->left) || (p->right != q->right)) {
-                    merge = false;
-                    break;
-                }
-                p++;
-                q++;
-            }
+    if (tail - head == count && span->top == prev->bottom) {
+        // Compare all the rects without branching, so that the loop is
+        // vectorized for the long spans of banded regions.
+        bool same = true;
+        for (size_t i = 0; i < count; i++) {
+            same &= (span[i].left == prev[i].left) & (span[i].right == prev[i].right);
         }
+        merge = same;
     }
     if (merge) {
-        const int bottom = span.front().bottom;
-        Rect* r = head;
-        while (r != tail) {
-            r->bottom = bottom;
-            r++;
+        const int bottom = span->bottom;
+        for (size_t i = 0; i < count; i++) {
+            prev[i].bottom = bottom;
         }
+        storage.erase(storage.begin() + static_cast<ssize_t>(tail), storage.end());
     } else {
-        bounds.left = min(span.front().left, bounds.left);
-        bounds.right = max(span.back().right, bounds.right);
-        storage.insert(storage.end(), span.begin(), span.end());
-        tail = storage.data() + storage.size();
-        head = tail - span.size();
+        bounds.left = min(span->left, bounds.left);
+        bounds.right = max(storage.back().right, bounds.right);
+        head = tail;
+        tail = storage.size();
     }
-    span.clear();
 }
 
 bool Region::validate(const Region& reg, const char* name, bool silent)
@@ -784,15 +780,184 @@ void Region::boolean_operation(uint32_t op, Region& dst,
 void Region::boolean_operation(uint32_t op, Region& dst,
         const Region& lhs, const Region& rhs)
 {
+    if (trivial_boolean_operation(op, dst, lhs, rhs)) {
+#if defined(VALIDATE_REGIONS)
+        validate(dst, "trivial_boolean_operation: dst");
+#endif
+        return;
+    }
     boolean_operation(op, dst, lhs, rhs, 0, 0);
 }
 
 void Region::boolean_operation(uint32_t op, Region& dst,
         const Region& lhs, const Rect& rhs)
 {
+    if (trivial_boolean_operation(op, dst, lhs, rhs)) {
+#if defined(VALIDATE_REGIONS)
+        validate(dst, "trivial_boolean_operation: dst");
+#endif
+        return;
+    }
     boolean_operation(op, dst, lhs, rhs, 0, 0);
 }
 
+// The results below are the same as the ones of the sweep: an optimal region is
+// the only one with its coverage, and the rasterizer produces it from any rects
+// sorted by span.
+
+bool Region::trivial_boolean_operation(uint32_t op, Region& dst,
+        const Region& lhs, const Region& rhs)
+{
+    if (rhs.isRect()) {
+        return trivial_boolean_operation(op, dst, lhs, rhs.getBounds());
+    }
+    if (lhs.isRect() && (op == op_and || op == op_or)) {
+        return trivial_boolean_operation(op, dst, rhs, lhs.getBounds());
+    }
+    if (lhs.isEmpty() || rhs.isEmpty()) {
+        return false;
+    }
+
+    const Rect lhsBounds = lhs.getBounds();
+    const Rect rhsBounds = rhs.getBounds();
+    const bool above = rhsBounds.bottom <= lhsBounds.top;
+    const bool below = rhsBounds.top >= lhsBounds.bottom;
+    if (!above && !below &&
+            rhsBounds.left < lhsBounds.right && lhsBounds.left < rhsBounds.right) {
+        return false;
+    }
+
+    // The bounds do not overlap.
+    switch (op) {
+        case op_and:
+            dst.clear();
+            return true;
+        case op_nand:
+            dst = lhs;
+            return true;
+        case op_or:
+            if (above || below) {
+                rasterizer r(dst);
+                for (const Rect& rect : above ? rhs : lhs) {
+                    r(rect);
+                }
+                for (const Rect& rect : above ? lhs : rhs) {
+                    r(rect);
+                }
+                return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+bool Region::trivial_boolean_operation(uint32_t op, Region& dst,
+        const Region& lhs, const Rect& rhs)
+{
+    if (lhs.isEmpty() || rhs.isEmpty()) {
+        return false;
+    }
+
+    const Rect bounds = lhs.getBounds();
+    const bool overlaps = rhs.left < bounds.right && bounds.left < rhs.right &&
+            rhs.top < bounds.bottom && bounds.top < rhs.bottom;
+    const bool covers = rhs.left <= bounds.left && rhs.top <= bounds.top &&
+            rhs.right >= bounds.right && rhs.bottom >= bounds.bottom;
+
+    switch (op) {
+        case op_and: {
+            if (!overlaps) {
+                dst.clear();
+                return true;
+            }
+            if (covers) {
+                dst = lhs;
+                return true;
+            }
+            if (lhs.isRect()) {
+                Rect result;
+                bounds.intersect(rhs, &result);
+                dst.set(result);
+                return true;
+            }
+            return false;
+        }
+        case op_nand: {
+            if (!overlaps) {
+                dst = lhs;
+                return true;
+            }
+            if (covers) {
+                dst.clear();
+                return true;
+            }
+            if (lhs.isRect()) {
+                // What is left of the rect is at most a span above rhs, one on
+                // each side of it, and one below it.
+                const int top = std::max(bounds.top, rhs.top);
+                const int bottom = std::min(bounds.bottom, rhs.bottom);
+                rasterizer r(dst);
+                if (bounds.top < rhs.top) {
+                    r(Rect(bounds.left, bounds.top, bounds.right, rhs.top));
+                }
+                if (bounds.left < rhs.left) {
+                    r(Rect(bounds.left, top, rhs.left, bottom));
+                }
+                if (rhs.right < bounds.right) {
+                    r(Rect(rhs.right, top, bounds.right, bottom));
+                }
+                if (rhs.bottom < bounds.bottom) {
+                    r(Rect(bounds.left, rhs.bottom, bounds.right, bounds.bottom));
+                }
+                return true;
+            }
+            return false;
+        }
+        case op_or: {
+            if (covers) {
+                dst.set(rhs);
+                return true;
+            }
+            if (lhs.isRect()) {
+                if (bounds.left <= rhs.left && bounds.top <= rhs.top &&
+                        bounds.right >= rhs.right && bounds.bottom >= rhs.bottom) {
+                    dst = lhs;
+                    return true;
+                }
+                // Rects in the same columns or in the same rows, which overlap
+                // or touch, are merged into a single rect.
+                if ((bounds.left == rhs.left && bounds.right == rhs.right &&
+                            bounds.top <= rhs.bottom && rhs.top <= bounds.bottom) ||
+                        (bounds.top == rhs.top && bounds.bottom == rhs.bottom &&
+                            bounds.left <= rhs.right && rhs.left <= bounds.right)) {
+                    dst.set(Rect(std::min(bounds.left, rhs.left), std::min(bounds.top, rhs.top),
+                            std::max(bounds.right, rhs.right),
+                            std::max(bounds.bottom, rhs.bottom)));
+                    return true;
+                }
+            }
+            // A rect that is entirely above or below the region is a span of its own.
+            if (rhs.bottom <= bounds.top || rhs.top >= bounds.bottom) {
+                rasterizer r(dst);
+                if (rhs.bottom <= bounds.top) {
+                    r(rhs);
+                }
+                for (const Rect& rect : lhs) {
+                    r(rect);
+                }
+                if (rhs.top >= bounds.bottom) {
+                    r(rhs);
+                }
+                return true;
+            }
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+
 void Region::translate(Region& reg, int dx, int dy)
 {
     if ((dx || dy) && !reg.isEmpty()) {
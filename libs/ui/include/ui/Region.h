@@ -171,6 +171,14 @@ private:
     static void boolean_operation(uint32_t op, Region& dst,
             const Region& lhs, const Rect& rhs);
 
+    // Computes the operations whose result is an operand, a rect, or the
+    // operands' rects in order, without sweeping the regions. Returns false if
+    // the result needs the sweep.
+    static bool trivial_boolean_operation(uint32_t op, Region& dst,
+            const Region& lhs, const Region& rhs);
+    static bool trivial_boolean_operation(uint32_t op, Region& dst,
+            const Region& lhs, const Rect& rhs);
+
     static void translate(Region& reg, int dx, int dy);
     static void translate(Region& dst, const Region& reg, int dx, int dy);
 
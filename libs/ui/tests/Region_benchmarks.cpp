@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <ui/Rect.h>
+#include <ui/Region.h>
+
+namespace android {
+
+namespace {
+
+constexpr int kDisplayWidth = 1080;
+constexpr int kDisplayHeight = 2400;
+
+// A window of the given index, spread over the display so that windows partially overlap.
+Rect windowRect(int index) {
+    const int left = (index * 97) % (kDisplayWidth / 2);
+    const int top = (index * 181) % (kDisplayHeight / 2);
+    return Rect(left, top, left + 300 + (index % 4) * 100, top + 200 + (index % 5) * 150);
+}
+
+// A region made of the given number of overlapping windows.
+Region windowsRegion(int count) {
+    Region region;
+    for (int i = 0; i < count; i++) {
+        region.orSelf(windowRect(i));
+    }
+    return region;
+}
+
+} // namespace
+
+static void benchmarkIntersectRects(benchmark::State& state) {
+    const Region region(Rect(0, 0, kDisplayWidth, kDisplayHeight / 2));
+    const Rect rect(100, 100, kDisplayWidth - 100, kDisplayHeight - 100);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(region.intersect(rect));
+    }
+}
+
+static void benchmarkSubtractRects(benchmark::State& state) {
+    const Region region(Rect(0, 0, kDisplayWidth, kDisplayHeight));
+    const Rect rect(100, 100, kDisplayWidth - 100, kDisplayHeight - 100);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(region.subtract(rect));
+    }
+}
+
+static void benchmarkMergeAdjacentRects(benchmark::State& state) {
+    const Region region(Rect(0, 0, kDisplayWidth, kDisplayHeight / 2));
+    const Rect rect(0, kDisplayHeight / 2, kDisplayWidth, kDisplayHeight);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(region.merge(rect));
+    }
+}
+
+static void benchmarkMergeRect(benchmark::State& state) {
+    const Region region = windowsRegion(static_cast<int>(state.range(0)));
+    const Rect rect = windowRect(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(region.merge(rect));
+    }
+}
+
+static void benchmarkSubtractRegion(benchmark::State& state) {
+    const Region lhs(Rect(0, 0, kDisplayWidth, kDisplayHeight));
+    const Region rhs = windowsRegion(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lhs.subtract(rhs));
+    }
+}
+
+static void benchmarkIntersectRegions(benchmark::State& state) {
+    const Region lhs = windowsRegion(static_cast<int>(state.range(0)));
+    const Region rhs = windowsRegion(static_cast<int>(state.range(0))).translate(50, 50);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lhs.intersect(rhs));
+    }
+}
+
+// The region operations that the composition engine does to compute the visible and covered
+// regions of a stack of windows, from front to back.
+static void benchmarkComputeVisibleRegions(benchmark::State& state) {
+    const int layerCount = static_cast<int>(state.range(0));
+    for (auto _ : state) {
+        Region aboveOpaqueLayers;
+        Region aboveCoveredLayers;
+        Region dirtyRegion;
+        for (int i = layerCount - 1; i >= 0; i--) {
+            Region visibleRegion(windowRect(i));
+            const Region coveredRegion = aboveCoveredLayers.intersect(visibleRegion);
+            aboveCoveredLayers.orSelf(visibleRegion);
+            visibleRegion.subtractSelf(aboveOpaqueLayers);
+            dirtyRegion.orSelf(visibleRegion);
+            if (i % 3 == 0) {
+                aboveOpaqueLayers.orSelf(windowRect(i));
+            }
+            benchmark::DoNotOptimize(coveredRegion);
+        }
+        benchmark::DoNotOptimize(dirtyRegion);
+    }
+    state.SetItemsProcessed(state.iterations() * layerCount);
+}
+
+BENCHMARK(benchmarkIntersectRects);
+BENCHMARK(benchmarkSubtractRects);
+BENCHMARK(benchmarkMergeAdjacentRects);
+// Two windows make a region of three rects, which still fits in the inline storage of a Region
+// along with its bounds. The regions of more windows allocate.
+BENCHMARK(benchmarkMergeRect)->Arg(2)->Arg(8)->Arg(32);
+BENCHMARK(benchmarkSubtractRegion)->Arg(2)->Arg(8)->Arg(32);
+BENCHMARK(benchmarkIntersectRegions)->Arg(2)->Arg(8)->Arg(32);
+BENCHMARK(benchmarkComputeVisibleRegions)->Arg(10)->Arg(50);
+
+} // namespace android
+
+BENCHMARK_MAIN();
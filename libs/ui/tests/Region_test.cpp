@@ -17,6 +17,10 @@
 #define LOG_TAG "RegionTest"
 
 #include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
 #include <ui/Region.h>
 #include <ui/Rect.h>
 #include <gtest/gtest.h>
@@ -179,5 +183,184 @@ TEST_F(RegionTest, RegionHash) {
     EXPECT_NE(std::hash<Region>{}(region1), std::hash<Region>{}(region2));
 }
 
+// The pixels of a region, kept independently of Region so that the results of its operations
+// can be checked against a plain per-pixel reference.
+class PixelSet {
+public:
+    explicit PixelSet(int size) : mSize(size), mPixels(size * size, false) {}
+
+    bool contains(int x, int y) const { return mPixels[y * mSize + x]; }
+    void set(int x, int y, bool value) { mPixels[y * mSize + x] = value; }
+
+    // Applies fn(contains(x, y)) to every pixel of the rect.
+    template <typename Fn>
+    void apply(const Rect& rect, Fn fn) {
+        for (int y = 0; y < mSize; y++) {
+            for (int x = 0; x < mSize; x++) {
+                const bool inRect =
+                        x >= rect.left && x < rect.right && y >= rect.top && y < rect.bottom;
+                set(x, y, fn(contains(x, y), inRect));
+            }
+        }
+    }
+
+    // Combines every pixel with the same pixel of other.
+    template <typename Fn>
+    PixelSet combine(const PixelSet& other, Fn fn) const {
+        PixelSet result(mSize);
+        for (size_t i = 0; i < mPixels.size(); i++) {
+            result.mPixels[i] = fn(mPixels[i], other.mPixels[i]);
+        }
+        return result;
+    }
+
+    Rect bounds() const {
+        Rect bounds(mSize, mSize, 0, 0);
+        for (int y = 0; y < mSize; y++) {
+            for (int x = 0; x < mSize; x++) {
+                if (contains(x, y)) {
+                    bounds.left = std::min(bounds.left, x);
+                    bounds.top = std::min(bounds.top, y);
+                    bounds.right = std::max(bounds.right, x + 1);
+                    bounds.bottom = std::max(bounds.bottom, y + 1);
+                }
+            }
+        }
+        return bounds.isEmpty() ? Rect::EMPTY_RECT : bounds;
+    }
+
+    bool operator==(const PixelSet& other) const { return mPixels == other.mPixels; }
+
+private:
+    int mSize;
+    std::vector<bool> mPixels;
+};
+
+// Builds a random region out of the boolean operations, like the regions of the layers, and
+// applies the same operations to pixels.
+static Region randomRegion(int max, PixelSet& pixels) {
+    Region region;
+    const long count = random() % 6;
+    for (long i = 0; i < count; i++) {
+        const int left = static_cast<int>(random() % max);
+        const int top = static_cast<int>(random() % max);
+        const Rect rect(left, top, left + 1 + static_cast<int>(random() % max),
+                        top + 1 + static_cast<int>(random() % max));
+        switch (random() % 4) {
+            case 0:
+                region.subtractSelf(rect);
+                pixels.apply(rect, [](bool in, bool inRect) { return in && !inRect; });
+                break;
+            case 1:
+                region.andSelf(rect);
+                pixels.apply(rect, [](bool in, bool inRect) { return in && inRect; });
+                break;
+            default:
+                region.orSelf(rect);
+                pixels.apply(rect, [](bool in, bool inRect) { return in || inRect; });
+                break;
+        }
+    }
+    return region;
+}
+
+static void expectRegionHasPixels(const PixelSet& expected, const Region& actual, int size,
+                                  const char* op) {
+    // Every pixel is covered by at most one non-empty rect, and none is out of the grid. An
+    // empty region is stored as a single empty rect.
+    PixelSet pixels(size);
+    for (const Rect& rect : actual) {
+        if (actual.isEmpty()) break;
+        ASSERT_FALSE(rect.isEmpty()) << op;
+        ASSERT_TRUE(rect.left >= 0 && rect.top >= 0 && rect.right <= size && rect.bottom <= size)
+                << op;
+        for (int y = rect.top; y < rect.bottom; y++) {
+            for (int x = rect.left; x < rect.right; x++) {
+                ASSERT_FALSE(pixels.contains(x, y)) << op << " covers " << x << "," << y;
+                pixels.set(x, y, true);
+            }
+        }
+    }
+    EXPECT_TRUE(expected == pixels) << op;
+
+    const Rect bounds = expected.bounds();
+    EXPECT_EQ(bounds.isEmpty(), actual.isEmpty()) << op;
+    if (!bounds.isEmpty()) {
+        EXPECT_EQ(bounds, actual.getBounds()) << op;
+    }
+}
+
+// The operations without an offset take shortcuts for rects and for regions that do not
+// overlap. The results are checked against the same operations done pixel by pixel.
+TEST_F(RegionTest, Random_OperationsMatchPixels) {
+    srandom(12345);
+
+    const auto merge = [](bool lhs, bool rhs) { return lhs || rhs; };
+    const auto intersect = [](bool lhs, bool rhs) { return lhs && rhs; };
+    const auto subtract = [](bool lhs, bool rhs) { return lhs && !rhs; };
+    const auto exclusiveOr = [](bool lhs, bool rhs) { return lhs != rhs; };
+
+    for (int iter = 0; iter < ITER_MAX * 10; iter++) {
+        const int max = iter % 2 ? X_MAX : X_MAX * 4;
+        const int size = max * 2;
+        PixelSet lhsPixels(size);
+        PixelSet rhsPixels(size);
+        const Region lhs = randomRegion(max, lhsPixels);
+        Region rhs = randomRegion(max, rhsPixels);
+        if (random() % 2) {
+            rhs.makeBoundsSelf();
+            const Rect bounds = rhsPixels.bounds();
+            rhsPixels.apply(bounds, [](bool, bool inRect) { return inRect; });
+        }
+
+        expectRegionHasPixels(lhsPixels.combine(rhsPixels, merge), lhs.merge(rhs), size, "merge");
+        expectRegionHasPixels(lhsPixels.combine(rhsPixels, intersect), lhs.intersect(rhs), size,
+                              "intersect");
+        expectRegionHasPixels(lhsPixels.combine(rhsPixels, subtract), lhs.subtract(rhs), size,
+                              "subtract");
+        expectRegionHasPixels(rhsPixels.combine(lhsPixels, subtract), rhs.subtract(lhs), size,
+                              "subtract");
+        expectRegionHasPixels(lhsPixels.combine(rhsPixels, exclusiveOr), lhs.mergeExclusive(rhs),
+                              size, "xor");
+
+        PixelSet rectPixels(size);
+        const Rect rect = rhs.getBounds();
+        if (!rect.isEmpty()) {
+            rectPixels.apply(rect, [](bool, bool inRect) { return inRect; });
+        }
+        expectRegionHasPixels(lhsPixels.combine(rectPixels, merge), lhs.merge(rect), size,
+                              "merge rect");
+        expectRegionHasPixels(lhsPixels.combine(rectPixels, intersect), lhs.intersect(rect), size,
+                              "intersect rect");
+        expectRegionHasPixels(lhsPixels.combine(rectPixels, subtract), lhs.subtract(rect), size,
+                              "subtract rect");
+    }
+}
+
+TEST_F(RegionTest, OrSelf_MergesAdjacentRects) {
+    Region region(Rect(0, 0, 10, 10));
+    region.orSelf(Rect(0, 10, 10, 20));
+    EXPECT_TRUE(region.isRect());
+    EXPECT_EQ(Rect(0, 0, 10, 20), region.getBounds());
+
+    region.orSelf(Rect(10, 0, 20, 20));
+    EXPECT_TRUE(region.isRect());
+    EXPECT_EQ(Rect(0, 0, 20, 20), region.getBounds());
+}
+
+TEST_F(RegionTest, SubtractSelf_SplitsRectIntoSpans) {
+    Region region(Rect(0, 0, 30, 30));
+    region.subtractSelf(Rect(10, 10, 20, 20));
+
+    size_t count;
+    const Rect* rects = region.getArray(&count);
+    ASSERT_EQ(4u, count);
+    EXPECT_EQ(Rect(0, 0, 30, 10), rects[0]);
+    EXPECT_EQ(Rect(0, 10, 10, 20), rects[1]);
+    EXPECT_EQ(Rect(20, 10, 30, 20), rects[2]);
+    EXPECT_EQ(Rect(0, 20, 30, 30), rects[3]);
+    EXPECT_EQ(Rect(0, 0, 30, 30), region.getBounds());
+}
+
 }; // namespace android
 
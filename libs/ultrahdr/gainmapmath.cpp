@@ -772,4 +772,257 @@ uint64_t colorToRgbaF16(Color e_gamma) {
        | (((uint64_t) floatToHalf(1.0f)) << 48);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Row kernels
+
+// The per pixel functions are defined in this file, so passing them as template arguments lets
+// the compiler inline them into the loops below instead of calling through a pointer per pixel.
+template <ColorTransformFn fn>
+static void transformRow(ColorRow& row, size_t width) {
+  float* __restrict r = row.r;
+  float* __restrict g = row.g;
+  float* __restrict b = row.b;
+  for (size_t x = 0; x < width; ++x) {
+    Color e = fn({{{ r[x], g[x], b[x] }}});
+    r[x] = e.r;
+    g[x] = e.g;
+    b[x] = e.b;
+  }
+}
+
+template <ColorCalculationFn fn>
+static void calculateRow(const ColorRow& row, size_t width, float* __restrict out) {
+  const float* __restrict r = row.r;
+  const float* __restrict g = row.g;
+  const float* __restrict b = row.b;
+  for (size_t x = 0; x < width; ++x) {
+    out[x] = fn({{{ r[x], g[x], b[x] }}});
+  }
+}
+
+void srgbYuvToRgbRow(ColorRow& row, size_t width) { transformRow<srgbYuvToRgb>(row, width); }
+void p3YuvToRgbRow(ColorRow& row, size_t width) { transformRow<p3YuvToRgb>(row, width); }
+void bt2100YuvToRgbRow(ColorRow& row, size_t width) { transformRow<bt2100YuvToRgb>(row, width); }
+void srgbInvOetfRow(ColorRow& row, size_t width) { transformRow<srgbInvOetf>(row, width); }
+void srgbInvOetfLUTRow(ColorRow& row, size_t width) { transformRow<srgbInvOetfLUT>(row, width); }
+void hlgOetfRow(ColorRow& row, size_t width) { transformRow<hlgOetf>(row, width); }
+void hlgOetfLUTRow(ColorRow& row, size_t width) { transformRow<hlgOetfLUT>(row, width); }
+void hlgInvOetfRow(ColorRow& row, size_t width) { transformRow<hlgInvOetf>(row, width); }
+void hlgInvOetfLUTRow(ColorRow& row, size_t width) { transformRow<hlgInvOetfLUT>(row, width); }
+void pqOetfRow(ColorRow& row, size_t width) { transformRow<pqOetf>(row, width); }
+void pqOetfLUTRow(ColorRow& row, size_t width) { transformRow<pqOetfLUT>(row, width); }
+void pqInvOetfRow(ColorRow& row, size_t width) { transformRow<pqInvOetf>(row, width); }
+void pqInvOetfLUTRow(ColorRow& row, size_t width) { transformRow<pqInvOetfLUT>(row, width); }
+void bt709ToP3Row(ColorRow& row, size_t width) { transformRow<bt709ToP3>(row, width); }
+void bt709ToBt2100Row(ColorRow& row, size_t width) { transformRow<bt709ToBt2100>(row, width); }
+void p3ToBt709Row(ColorRow& row, size_t width) { transformRow<p3ToBt709>(row, width); }
+void p3ToBt2100Row(ColorRow& row, size_t width) { transformRow<p3ToBt2100>(row, width); }
+void bt2100ToBt709Row(ColorRow& row, size_t width) { transformRow<bt2100ToBt709>(row, width); }
+void bt2100ToP3Row(ColorRow& row, size_t width) { transformRow<bt2100ToP3>(row, width); }
+
+ColorTransformRowFn getHdrConversionRowFn(ultrahdr_color_gamut sdr_gamut,
+                                          ultrahdr_color_gamut hdr_gamut) {
+  switch (sdr_gamut) {
+    case ULTRAHDR_COLORGAMUT_BT709:
+      switch (hdr_gamut) {
+        case ULTRAHDR_COLORGAMUT_BT709:
+          return identityConversionRow;
+        case ULTRAHDR_COLORGAMUT_P3:
+          return p3ToBt709Row;
+        case ULTRAHDR_COLORGAMUT_BT2100:
+          return bt2100ToBt709Row;
+        case ULTRAHDR_COLORGAMUT_UNSPECIFIED:
+          return nullptr;
+      }
+      break;
+    case ULTRAHDR_COLORGAMUT_P3:
+      switch (hdr_gamut) {
+        case ULTRAHDR_COLORGAMUT_BT709:
+          return bt709ToP3Row;
+        case ULTRAHDR_COLORGAMUT_P3:
+          return identityConversionRow;
+        case ULTRAHDR_COLORGAMUT_BT2100:
+          return bt2100ToP3Row;
+        case ULTRAHDR_COLORGAMUT_UNSPECIFIED:
+          return nullptr;
+      }
+      break;
+    case ULTRAHDR_COLORGAMUT_BT2100:
+      switch (hdr_gamut) {
+        case ULTRAHDR_COLORGAMUT_BT709:
+          return bt709ToBt2100Row;
+        case ULTRAHDR_COLORGAMUT_P3:
+          return p3ToBt2100Row;
+        case ULTRAHDR_COLORGAMUT_BT2100:
+          return identityConversionRow;
+        case ULTRAHDR_COLORGAMUT_UNSPECIFIED:
+          return nullptr;
+      }
+      break;
+    case ULTRAHDR_COLORGAMUT_UNSPECIFIED:
+      return nullptr;
+  }
+  return nullptr;
+}
+
+void srgbLuminanceRow(const ColorRow& row, size_t width, float* out) {
+  calculateRow<srgbLuminance>(row, width, out);
+}
+
+void p3LuminanceRow(const ColorRow& row, size_t width, float* out) {
+  calculateRow<p3Luminance>(row, width, out);
+}
+
+void bt2100LuminanceRow(const ColorRow& row, size_t width, float* out) {
+  calculateRow<bt2100Luminance>(row, width, out);
+}
+
+void divideRow(ColorRow& row, size_t width, float divisor) {
+  float* __restrict r = row.r;
+  float* __restrict g = row.g;
+  float* __restrict b = row.b;
+  for (size_t x = 0; x < width; ++x) {
+    r[x] /= divisor;
+    g[x] /= divisor;
+    b[x] /= divisor;
+  }
+}
+
+void encodeGainRow(const float* __restrict y_sdr, const float* __restrict y_hdr, size_t width,
+                   ultrahdr_metadata_ptr metadata, float log2MinContentBoost,
+                   float log2MaxContentBoost, uint8_t* __restrict out) {
+  for (size_t x = 0; x < width; ++x) {
+    out[x] = encodeGain(y_sdr[x], y_hdr[x], metadata, log2MinContentBoost, log2MaxContentBoost);
+  }
+}
+
+void applyGainRow(ColorRow& row, const float* __restrict gain, size_t width,
+                  ultrahdr_metadata_ptr metadata, float displayBoost) {
+  float* __restrict r = row.r;
+  float* __restrict g = row.g;
+  float* __restrict b = row.b;
+  for (size_t x = 0; x < width; ++x) {
+    Color e = applyGain({{{ r[x], g[x], b[x] }}}, gain[x], metadata, displayBoost);
+    r[x] = e.r;
+    g[x] = e.g;
+    b[x] = e.b;
+  }
+}
+
+void applyGainLUTRow(ColorRow& row, const float* __restrict gain, size_t width,
+                     GainLUT& gainLUT) {
+  float* __restrict r = row.r;
+  float* __restrict g = row.g;
+  float* __restrict b = row.b;
+  for (size_t x = 0; x < width; ++x) {
+    Color e = applyGainLUT({{{ r[x], g[x], b[x] }}}, gain[x], gainLUT);
+    r[x] = e.r;
+    g[x] = e.g;
+    b[x] = e.b;
+  }
+}
+
+void getYuv420PixelRow(jr_uncompressed_ptr image, size_t y, size_t width, ColorRow& out) {
+  float* __restrict r = out.r;
+  float* __restrict g = out.g;
+  float* __restrict b = out.b;
+  for (size_t x = 0; x < width; ++x) {
+    Color e = getYuv420Pixel(image, x, y);
+    r[x] = e.y;
+    g[x] = e.u;
+    b[x] = e.v;
+  }
+}
+
+// The sampling kernels sum each block in the same order as samplePixels(), and convert each
+// pixel with the same arithmetic as getYuv420Pixel() and getP010Pixel(), so the results match
+// exactly. Row addresses are computed once per block row instead of once per pixel.
+void sampleYuv420Row(jr_uncompressed_ptr image, size_t map_scale_factor, size_t y, size_t width,
+                     ColorRow& out) {
+  const uint8_t* luma_data = reinterpret_cast<uint8_t*>(image->data);
+  const uint8_t* chroma_data = reinterpret_cast<uint8_t*>(image->chroma_data);
+  const size_t luma_stride = image->luma_stride;
+  const size_t chroma_stride = image->chroma_stride;
+  const size_t offset_cr = chroma_stride * (image->height / 2);
+  const float count = static_cast<float>(map_scale_factor * map_scale_factor);
+  float* __restrict r = out.r;
+  float* __restrict g = out.g;
+  float* __restrict b = out.b;
+  for (size_t x = 0; x < width; ++x) {
+    Color e = {{{ 0.0f, 0.0f, 0.0f }}};
+    for (size_t dy = 0; dy < map_scale_factor; ++dy) {
+      const size_t pixel_y = y * map_scale_factor + dy;
+      const uint8_t* luma_row = luma_data + pixel_y * luma_stride;
+      const uint8_t* u_row = chroma_data + (pixel_y / 2) * chroma_stride;
+      const uint8_t* v_row = u_row + offset_cr;
+      for (size_t dx = 0; dx < map_scale_factor; ++dx) {
+        const size_t pixel_x = x * map_scale_factor + dx;
+        e += {{{ static_cast<float>(luma_row[pixel_x]) / 255.0f,
+                 (static_cast<float>(u_row[pixel_x / 2]) - 128.0f) / 255.0f,
+                 (static_cast<float>(v_row[pixel_x / 2]) - 128.0f) / 255.0f }}};
+      }
+    }
+    r[x] = e.r / count;
+    g[x] = e.g / count;
+    b[x] = e.b / count;
+  }
+}
+
+void sampleP010Row(jr_uncompressed_ptr image, size_t map_scale_factor, size_t y, size_t width,
+                   ColorRow& out) {
+  const uint16_t* luma_data = reinterpret_cast<uint16_t*>(image->data);
+  const uint16_t* chroma_data = reinterpret_cast<uint16_t*>(image->chroma_data);
+  const size_t luma_stride = image->luma_stride == 0 ? image->width : image->luma_stride;
+  const size_t chroma_stride = image->chroma_stride;
+  const float count = static_cast<float>(map_scale_factor * map_scale_factor);
+  float* __restrict r = out.r;
+  float* __restrict g = out.g;
+  float* __restrict b = out.b;
+  for (size_t x = 0; x < width; ++x) {
+    Color e = {{{ 0.0f, 0.0f, 0.0f }}};
+    for (size_t dy = 0; dy < map_scale_factor; ++dy) {
+      const size_t pixel_y = y * map_scale_factor + dy;
+      const uint16_t* luma_row = luma_data + pixel_y * luma_stride;
+      const uint16_t* chroma_row = chroma_data + (pixel_y >> 1) * chroma_stride;
+      for (size_t dx = 0; dx < map_scale_factor; ++dx) {
+        const size_t pixel_x = x * map_scale_factor + dx;
+        const uint16_t y_uint = luma_row[pixel_x] >> 6;
+        const uint16_t u_uint = chroma_row[pixel_x & ~0x1] >> 6;
+        const uint16_t v_uint = chroma_row[(pixel_x & ~0x1) + 1] >> 6;
+        e += {{{ (static_cast<float>(y_uint) - 64.0f) / 876.0f,
+                 (static_cast<float>(u_uint) - 64.0f) / 896.0f - 0.5f,
+                 (static_cast<float>(v_uint) - 64.0f) / 896.0f - 0.5f }}};
+      }
+    }
+    r[x] = e.r / count;
+    g[x] = e.g / count;
+    b[x] = e.b / count;
+  }
+}
+
+void sampleMapRow(jr_uncompressed_ptr map, size_t map_scale_factor, size_t y, size_t width,
+                  ShepardsIDW& weightTables, float* __restrict out) {
+  for (size_t x = 0; x < width; ++x) {
+    out[x] = sampleMap(map, map_scale_factor, x, y, weightTables);
+  }
+}
+
+void colorToRgba1010102Row(const ColorRow& row, size_t width, uint32_t* __restrict out) {
+  const float* __restrict r = row.r;
+  const float* __restrict g = row.g;
+  const float* __restrict b = row.b;
+  for (size_t x = 0; x < width; ++x) {
+    out[x] = colorToRgba1010102({{{ r[x], g[x], b[x] }}});
+  }
+}
+
+void colorToRgbaF16Row(const ColorRow& row, size_t width, uint64_t* __restrict out) {
+  const float* __restrict r = row.r;
+  const float* __restrict g = row.g;
+  const float* __restrict b = row.b;
+  for (size_t x = 0; x < width; ++x) {
+    out[x] = colorToRgbaF16({{{ r[x], g[x], b[x] }}});
+  }
+}
+
 } // namespace android::ultrahdr
@@ -19,6 +19,7 @@
 
 #include <cmath>
 #include <stdint.h>
+#include <vector>
 
 #include <ultrahdr/jpegr.h>
 
@@ -500,6 +501,111 @@ uint32_t colorToRgba1010102(Color e_gamma);
  */
 uint64_t colorToRgbaF16(Color e_gamma);
 
+////////////////////////////////////////////////////////////////////////////////
+// Row kernels
+//
+// Planar versions of the per pixel helpers above, used to generate and apply the gain map one row
+// at a time. Each kernel runs one stage over a whole row as a scalar loop over separate channel
+// arrays, calling the per pixel function for each pixel. Per row setup, such as picking the
+// conversion function or computing row addresses, is done once before the loop rather than for
+// every pixel. Every kernel produces exactly the values of the per pixel function it is named
+// after, which remains the reference.
+
+/*
+ * One row of colors, stored as a plane per channel. The planes hold r, g and b, or y, u and v.
+ */
+struct ColorRow {
+  explicit ColorRow(size_t width)
+        : mData(3 * width), r(mData.data()), g(r + width), b(g + width) {}
+
+  std::vector<float> mData;
+  float* r;
+  float* g;
+  float* b;
+};
+
+typedef void (*ColorTransformRowFn)(ColorRow& row, size_t width);
+typedef void (*ColorCalculationRowFn)(const ColorRow& row, size_t width, float* out);
+
+/*
+ * Row versions of the color transforms above; each transforms the row in place.
+ */
+void srgbYuvToRgbRow(ColorRow& row, size_t width);
+void p3YuvToRgbRow(ColorRow& row, size_t width);
+void bt2100YuvToRgbRow(ColorRow& row, size_t width);
+void srgbInvOetfRow(ColorRow& row, size_t width);
+void srgbInvOetfLUTRow(ColorRow& row, size_t width);
+void hlgOetfRow(ColorRow& row, size_t width);
+void hlgOetfLUTRow(ColorRow& row, size_t width);
+void hlgInvOetfRow(ColorRow& row, size_t width);
+void hlgInvOetfLUTRow(ColorRow& row, size_t width);
+void pqOetfRow(ColorRow& row, size_t width);
+void pqOetfLUTRow(ColorRow& row, size_t width);
+void pqInvOetfRow(ColorRow& row, size_t width);
+void pqInvOetfLUTRow(ColorRow& row, size_t width);
+void bt709ToP3Row(ColorRow& row, size_t width);
+void bt709ToBt2100Row(ColorRow& row, size_t width);
+void p3ToBt709Row(ColorRow& row, size_t width);
+void p3ToBt2100Row(ColorRow& row, size_t width);
+void bt2100ToBt709Row(ColorRow& row, size_t width);
+void bt2100ToP3Row(ColorRow& row, size_t width);
+inline void identityConversionRow(ColorRow&, size_t) {}
+
+/*
+ * Row version of getHdrConversionFn().
+ */
+ColorTransformRowFn getHdrConversionRowFn(ultrahdr_color_gamut sdr_gamut,
+                                          ultrahdr_color_gamut hdr_gamut);
+
+/*
+ * Row versions of the luminance calculations above, writing one value per pixel to out.
+ */
+void srgbLuminanceRow(const ColorRow& row, size_t width, float* out);
+void p3LuminanceRow(const ColorRow& row, size_t width, float* out);
+void bt2100LuminanceRow(const ColorRow& row, size_t width, float* out);
+
+/*
+ * Divides every pixel of the row by divisor. Unlike scaling by the reciprocal, the result is the
+ * same as the Color operator/ for every pixel.
+ */
+void divideRow(ColorRow& row, size_t width, float divisor);
+
+/*
+ * Row version of encodeGain(), writing one gain value per pixel to out.
+ */
+void encodeGainRow(const float* y_sdr, const float* y_hdr, size_t width,
+                   ultrahdr_metadata_ptr metadata, float log2MinContentBoost,
+                   float log2MaxContentBoost, uint8_t* out);
+
+/*
+ * Row versions of applyGain() and applyGainLUT(), applying gain[x] to pixel x.
+ */
+void applyGainRow(ColorRow& row, const float* gain, size_t width, ultrahdr_metadata_ptr metadata,
+                  float displayBoost);
+void applyGainLUTRow(ColorRow& row, const float* gain, size_t width, GainLUT& gainLUT);
+
+/*
+ * Row versions of getYuv420Pixel(), sampleYuv420() and sampleP010(), for pixels [0, width) of
+ * row y.
+ */
+void getYuv420PixelRow(jr_uncompressed_ptr image, size_t y, size_t width, ColorRow& out);
+void sampleYuv420Row(jr_uncompressed_ptr image, size_t map_scale_factor, size_t y, size_t width,
+                     ColorRow& out);
+void sampleP010Row(jr_uncompressed_ptr image, size_t map_scale_factor, size_t y, size_t width,
+                   ColorRow& out);
+
+/*
+ * Row version of sampleMap() with weight tables, writing one gain value per pixel to out.
+ */
+void sampleMapRow(jr_uncompressed_ptr map, size_t map_scale_factor, size_t y, size_t width,
+                  ShepardsIDW& weightTables, float* out);
+
+/*
+ * Row versions of colorToRgba1010102() and colorToRgbaF16().
+ */
+void colorToRgba1010102Row(const ColorRow& row, size_t width, uint32_t* out);
+void colorToRgbaF16Row(const ColorRow& row, size_t width, uint64_t* out);
+
 } // namespace android::ultrahdr
 
 #endif // ANDROID_ULTRAHDR_RECOVERYMAPMATH_H
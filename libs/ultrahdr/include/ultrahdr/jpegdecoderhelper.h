@@ -24,6 +24,7 @@ extern "C" {
 #include <jpeglib.h>
 }
 #include <utils/Errors.h>
+#include <memory>
 #include <vector>
 
 // constraint on max width and max height is only due to device alloc constraints
@@ -111,9 +112,43 @@ public:
     bool getCompressedImageParameters(const void* image, int length, size_t* pWidth,
                                       size_t* pHeight, std::vector<uint8_t>* iccData,
                                       std::vector<uint8_t>* exifData);
+    /*
+     * Starts decompressing a 4:2:0 JPEG image to raw image (YUV420planer or RGBA) format one band
+     * of getBandHeight() rows at a time, so that the whole image is never held in memory. After
+     * this returns true the image dimensions and the XMP, EXIF and ICC data are available, and
+     * decompressNextBand() must be called to decompress the image.
+     * Returns false if the image can not be decompressed.
+     */
+    bool startBandDecompression(const void* image, int length, bool decodeToRGBA = false);
+    /*
+     * Decompresses the next band of the image passed to startBandDecompression() into the buffer
+     * returned by getBandPtr(). Returns the number of image rows in the band, 0 once every row
+     * has been decompressed, or -1 if decompressing fails.
+     */
+    int decompressNextBand();
+    /*
+     * Returns the buffer holding the last band decompressed by decompressNextBand(). For YUV420
+     * it holds getBandHeight() rows of Y followed by half as many rows of U and then of V, with
+     * strides of getBandStride() and getBandStride() / 2. For RGBA rows are packed with a stride
+     * of getDecompressedImageWidth() pixels.
+     */
+    void* getBandPtr();
+    /*
+     * Returns the luma stride of a YUV420 band in pixels. This method must be called only after
+     * calling startBandDecompression().
+     */
+    size_t getBandStride();
+    /*
+     * Returns the number of rows in a full band.
+     */
+    static size_t getBandHeight() { return kCompressBatchSize; }
 
 private:
+    struct BandState;
+
     bool decode(const void* image, int length, bool decodeToRGBA);
+    // Copies the first XMP, EXIF and ICC packages of the image.
+    void saveMetadata(jpeg_decompress_struct* cinfo);
     // Returns false if errors occur.
     bool decompress(jpeg_decompress_struct* cinfo, const uint8_t* dest, bool isSingleChannel);
     bool decompressYUV(jpeg_decompress_struct* cinfo, const uint8_t* dest);
@@ -137,6 +172,9 @@ private:
 
     // Position of EXIF package, default value is -1 which means no EXIF package appears.
     ssize_t mExifPos = -1;
+
+    // libjpeg state of the image being decompressed by decompressNextBand(), if any.
+    std::unique_ptr<BandState> mBandState;
 };
 } /* namespace android::ultrahdr  */
 
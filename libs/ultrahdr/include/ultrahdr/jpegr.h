@@ -114,6 +114,30 @@ struct jpegr_exif_struct {
     int length;
 };
 
+/*
+ * Receives the decoded image from JpegR::decodeJPEGRStreaming() in bands of consecutive rows,
+ * from top to bottom. An implementation can copy the rows to a locked ANativeWindow buffer, a
+ * tile cache or an encoder without the decoder ever holding the full output image.
+ */
+class JpegROutputSink {
+public:
+    virtual ~JpegROutputSink() = default;
+    /*
+     * Called once, before any rows, with the resolution of the output image.
+     * @return NO_ERROR to continue decoding, any other value stops decoding and is returned by
+     *         the decoder.
+     */
+    virtual status_t onImageSize(size_t width, size_t height) = 0;
+    /*
+     * Called with rows [row_start, row_start + row_count) of the output image. Pixels are in the
+     * color format selected by the output_format passed to the decoder and rows are packed with a
+     * stride of width pixels. data is only valid for the duration of the call.
+     * @return NO_ERROR to continue decoding, any other value stops decoding and is returned by
+     *         the decoder.
+     */
+    virtual status_t onRows(size_t row_start, size_t row_count, const void* data) = 0;
+};
+
 typedef struct jpegr_uncompressed_struct* jr_uncompressed_ptr;
 typedef struct jpegr_compressed_struct* jr_compressed_ptr;
 typedef struct jpegr_exif_struct* jr_exif_ptr;
@@ -281,6 +305,32 @@ public:
                          jr_uncompressed_ptr gainmap_image_ptr = nullptr,
                          ultrahdr_metadata_ptr metadata = nullptr);
 
+    /*
+     * Streaming Decode API
+     * Decompress JPEGR image, handing the output to sink one band of rows at a time.
+     *
+     * The primary image is decoded one MCU row (16 rows) at a time, and each band is combined with
+     * the matching rows of the gain map and handed to the sink before the next one is decoded.
+     * Only the gain map, which is a sixteenth of the size of the primary image, is decoded in
+     * full, so memory use does not grow with the size of the primary image the way it does for
+     * decodeJPEGR(), and the first rows reach the sink long before the whole image is decoded.
+     * The output is identical to that of decodeJPEGR() with the same arguments.
+     *
+     * @param jpegr_image_ptr compressed JPEGR image.
+     * @param sink receiver of the decoded rows.
+     * @param max_display_boost (optional) the maximum available boost supported by a display,
+     *                          the value must be greater than or equal to 1.0.
+     * @param exif see decodeJPEGR().
+     * @param output_format see decodeJPEGR().
+     * @param metadata see decodeJPEGR().
+     * @return NO_ERROR if decoding succeeds, error code if error occurs, including errors
+     *         returned by sink.
+     */
+    status_t decodeJPEGRStreaming(jr_compressed_ptr jpegr_image_ptr, JpegROutputSink* sink,
+                                  float max_display_boost = FLT_MAX, jr_exif_ptr exif = nullptr,
+                                  ultrahdr_output_format output_format = ULTRAHDR_OUTPUT_HDR_LINEAR,
+                                  ultrahdr_metadata_ptr metadata = nullptr);
+
     /*
      * Gets Info from JPEGR file without decoding it.
      *
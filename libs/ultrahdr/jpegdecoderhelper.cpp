@@ -20,6 +20,7 @@
 
 #include <errno.h>
 #include <setjmp.h>
+#include <algorithm>
 #include <string>
 
 using namespace std;
@@ -97,6 +98,23 @@ static void jpegrerror_exit(j_common_ptr cinfo) {
     longjmp(err->setjmp_buffer, 1);
 }
 
+// libjpeg keeps pointers to the error and source managers, so they live next to the decompress
+// struct for as long as it is in use.
+struct JpegDecoderHelper::BandState {
+    BandState(const uint8_t* ptr, int len) : mgr(ptr, len) {}
+    ~BandState() {
+        if (created) {
+            jpeg_destroy_decompress(&cinfo);
+        }
+    }
+
+    jpeg_decompress_struct cinfo;
+    jpegrerror_mgr myerr;
+    jpegr_source_mgr mgr;
+    bool created = false;
+    size_t stride = 0;
+};
+
 JpegDecoderHelper::JpegDecoderHelper() {}
 
 JpegDecoderHelper::~JpegDecoderHelper() {}
@@ -203,30 +221,7 @@ bool JpegDecoderHelper::extractEXIF(const void* image, int length) {
     return true;
 }
 
-bool JpegDecoderHelper::decode(const void* image, int length, bool decodeToRGBA) {
-    bool status = true;
-    jpeg_decompress_struct cinfo;
-    jpegrerror_mgr myerr;
-    cinfo.err = jpeg_std_error(&myerr.pub);
-    myerr.pub.error_exit = jpegrerror_exit;
-    if (setjmp(myerr.setjmp_buffer)) {
-        jpeg_destroy_decompress(&cinfo);
-        return false;
-    }
-
-    jpeg_create_decompress(&cinfo);
-
-    jpeg_save_markers(&cinfo, kAPP0Marker, 0xFFFF);
-    jpeg_save_markers(&cinfo, kAPP1Marker, 0xFFFF);
-    jpeg_save_markers(&cinfo, kAPP2Marker, 0xFFFF);
-
-    jpegr_source_mgr mgr(static_cast<const uint8_t*>(image), length);
-    cinfo.src = &mgr;
-    if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
-        jpeg_destroy_decompress(&cinfo);
-        return false;
-    }
-
+void JpegDecoderHelper::saveMetadata(jpeg_decompress_struct* cinfo) {
     // Save XMP data, EXIF data, and ICC data.
     // Here we only handle the first XMP / EXIF / ICC package.
     // We assume that all packages are starting with two bytes marker (eg FF E1 for EXIF package),
@@ -236,7 +231,7 @@ bool JpegDecoderHelper::decode(const void* image, int length, bool decodeToRGBA)
     bool xmpAppears = false;
     bool iccAppears = false;
     size_t pos = 2;  // position after SOI
-    for (jpeg_marker_struct* marker = cinfo.marker_list;
+    for (jpeg_marker_struct* marker = cinfo->marker_list;
          marker && !(exifAppears && xmpAppears && iccAppears);
          marker = marker->next) {
          pos += 4;
@@ -266,6 +261,33 @@ bool JpegDecoderHelper::decode(const void* image, int length, bool decodeToRGBA)
             iccAppears = true;
         }
     }
+}
+
+bool JpegDecoderHelper::decode(const void* image, int length, bool decodeToRGBA) {
+    bool status = true;
+    jpeg_decompress_struct cinfo;
+    jpegrerror_mgr myerr;
+    cinfo.err = jpeg_std_error(&myerr.pub);
+    myerr.pub.error_exit = jpegrerror_exit;
+    if (setjmp(myerr.setjmp_buffer)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_create_decompress(&cinfo);
+
+    jpeg_save_markers(&cinfo, kAPP0Marker, 0xFFFF);
+    jpeg_save_markers(&cinfo, kAPP1Marker, 0xFFFF);
+    jpeg_save_markers(&cinfo, kAPP2Marker, 0xFFFF);
+
+    jpegr_source_mgr mgr(static_cast<const uint8_t*>(image), length);
+    cinfo.src = &mgr;
+    if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    saveMetadata(&cinfo);
 
     mWidth = cinfo.image_width;
     mHeight = cinfo.image_height;
@@ -540,4 +562,132 @@ bool JpegDecoderHelper::decompressSingleChannel(jpeg_decompress_struct* cinfo,
     return true;
 }
 
+bool JpegDecoderHelper::startBandDecompression(const void* image, int length, bool decodeToRGBA) {
+    if (image == nullptr || length <= 0) {
+        ALOGE("Image size can not be handled: %d", length);
+        return false;
+    }
+    mResultBuffer.clear();
+    mXMPBuffer.clear();
+    mBandState = std::make_unique<BandState>(static_cast<const uint8_t*>(image), length);
+    jpeg_decompress_struct* cinfo = &mBandState->cinfo;
+    cinfo->err = jpeg_std_error(&mBandState->myerr.pub);
+    mBandState->myerr.pub.error_exit = jpegrerror_exit;
+    if (setjmp(mBandState->myerr.setjmp_buffer)) {
+        mBandState.reset();
+        return false;
+    }
+
+    jpeg_create_decompress(cinfo);
+    mBandState->created = true;
+
+    jpeg_save_markers(cinfo, kAPP0Marker, 0xFFFF);
+    jpeg_save_markers(cinfo, kAPP1Marker, 0xFFFF);
+    jpeg_save_markers(cinfo, kAPP2Marker, 0xFFFF);
+
+    cinfo->src = &mBandState->mgr;
+    if (jpeg_read_header(cinfo, TRUE) != JPEG_HEADER_OK) {
+        mBandState.reset();
+        return false;
+    }
+
+    saveMetadata(cinfo);
+
+    mWidth = cinfo->image_width;
+    mHeight = cinfo->image_height;
+    if (mWidth > kMaxWidth || mHeight > kMaxHeight) {
+        mBandState.reset();
+        return false;
+    }
+
+    // Only the primary image is decompressed in bands, and it is expected to be yuv420 sampling
+    if (cinfo->jpeg_color_space != JCS_YCbCr || cinfo->comp_info[0].h_samp_factor != 2 ||
+        cinfo->comp_info[0].v_samp_factor != 2 || cinfo->comp_info[1].h_samp_factor != 1 ||
+        cinfo->comp_info[1].v_samp_factor != 1 || cinfo->comp_info[2].h_samp_factor != 1 ||
+        cinfo->comp_info[2].v_samp_factor != 1) {
+        ALOGE("%s: band decompression only supports 4:2:0 subsampling", __func__);
+        mBandState.reset();
+        return false;
+    }
+
+    if (decodeToRGBA) {
+        mBandState->stride = cinfo->image_width;
+        mResultBuffer.resize(cinfo->image_width * kCompressBatchSize * 4);
+        cinfo->out_color_space = JCS_EXT_RGBA;
+    } else {
+        // libjpeg writes whole MCUs, so with an aligned stride the band is decompressed in place
+        // without the intermediate buffer decompressYUV() needs.
+        mBandState->stride = ALIGNM(cinfo->image_width, kCompressBatchSize);
+        mResultBuffer.resize(mBandState->stride * kCompressBatchSize * 3 / 2, 0);
+        cinfo->out_color_space = cinfo->jpeg_color_space;
+        cinfo->raw_data_out = TRUE;
+    }
+
+    cinfo->dct_method = JDCT_ISLOW;
+    jpeg_start_decompress(cinfo);
+    return true;
+}
+
+int JpegDecoderHelper::decompressNextBand() {
+    if (mBandState == nullptr) {
+        return -1;
+    }
+    jpeg_decompress_struct* cinfo = &mBandState->cinfo;
+    if (setjmp(mBandState->myerr.setjmp_buffer)) {
+        mBandState.reset();
+        return -1;
+    }
+
+    const size_t firstRow = cinfo->output_scanline;
+    if (firstRow >= cinfo->image_height) {
+        jpeg_finish_decompress(cinfo);
+        mBandState.reset();
+        return 0;
+    }
+    const int rows = std::min(static_cast<size_t>(kCompressBatchSize),
+                              cinfo->image_height - firstRow);
+
+    if (cinfo->out_color_space == JCS_EXT_RGBA) {
+        JSAMPLE* out = mResultBuffer.data();
+        for (int i = 0; i < rows; ++i) {
+            if (1 != jpeg_read_scanlines(cinfo, &out, 1)) {
+                mBandState.reset();
+                return -1;
+            }
+            out += cinfo->image_width * 4;
+        }
+        return rows;
+    }
+
+    JSAMPROW y[kCompressBatchSize];
+    JSAMPROW cb[kCompressBatchSize / 2];
+    JSAMPROW cr[kCompressBatchSize / 2];
+    JSAMPARRAY planes[3]{y, cb, cr};
+    const size_t stride = mBandState->stride;
+    uint8_t* y_plane = mResultBuffer.data();
+    uint8_t* u_plane = y_plane + stride * kCompressBatchSize;
+    uint8_t* v_plane = u_plane + (stride / 2) * (kCompressBatchSize / 2);
+    for (int i = 0; i < kCompressBatchSize; ++i) {
+        y[i] = y_plane + i * stride;
+    }
+    for (int i = 0; i < kCompressBatchSize / 2; ++i) {
+        cb[i] = u_plane + i * (stride / 2);
+        cr[i] = v_plane + i * (stride / 2);
+    }
+    if (jpeg_read_raw_data(cinfo, planes, kCompressBatchSize) != kCompressBatchSize) {
+        ALOGE("Number of processed lines does not equal input lines.");
+        mBandState.reset();
+        return -1;
+    }
+    return rows;
+}
+
+void* JpegDecoderHelper::getBandPtr() {
+    return mResultBuffer.data();
+}
+
+size_t JpegDecoderHelper::getBandStride() {
+    return mBandState == nullptr ? 0 : mBandState->stride;
+}
+
 } // namespace android::ultrahdr
@@ -14,9 +14,12 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <condition_variable>
 #include <deque>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <thread>
@@ -750,58 +753,104 @@ const int kJobSzInRows = 16;
 static_assert(kJobSzInRows > 0 && kJobSzInRows % kMapDimensionScaleFactor == 0,
               "align job size to kMapDimensionScaleFactor");
 
-class JobQueue {
+// Runs row jobs for generateGainMap() and applyGainMap(). The threads are started on first use
+// and shared by every JpegR instance for the rest of the process, so no threads are created per
+// image. Several images may be processed at once: their jobs are taken in submission order, and
+// each submitting thread works on its own jobs until they are all claimed.
+class WorkerPool {
 public:
-  bool dequeueJob(size_t& rowStart, size_t& rowEnd);
-  void enqueueJob(size_t rowStart, size_t rowEnd);
-  void markQueueForEnd();
-  void reset();
+  typedef std::function<void(size_t rowStart, size_t rowEnd)> Job;
+
+  static WorkerPool& getInstance();
+
+  // Calls job for consecutive ranges of at most rowStep rows covering [0, rowCount), on the pool
+  // threads and the calling thread, and returns once every range is done.
+  void run(size_t rowCount, size_t rowStep, const Job& job);
 
 private:
-  bool mQueuedAllJobs = false;
-  std::deque<std::tuple<size_t, size_t>> mJobs;
+  struct Batch {
+    const Job* job;
+    size_t rowCount;
+    size_t rowStep;
+    std::atomic<size_t> nextRow = 0;
+    size_t rowsDone = 0;  // guarded by mMutex
+  };
+
+  explicit WorkerPool(int threads);
+  void threadMain();
+  void runJobs(Batch& batch);
+
   std::mutex mMutex;
-  std::condition_variable mCv;
+  std::condition_variable mWorkCv;
+  std::condition_variable mDoneCv;
+  std::deque<std::shared_ptr<Batch>> mBatches;
 };
 
-bool JobQueue::dequeueJob(size_t& rowStart, size_t& rowEnd) {
+WorkerPool& WorkerPool::getInstance() {
+  // Never destroyed, so that exiting doesn't wait on the threads.
+  static WorkerPool* pool = new WorkerPool(std::clamp(GetCPUCoreCount(), 1, 4) - 1);
+  return *pool;
+}
+
+WorkerPool::WorkerPool(int threads) {
+  for (int th = 0; th < threads; th++) {
+    std::thread(&WorkerPool::threadMain, this).detach();
+  }
+}
+
+void WorkerPool::threadMain() {
   std::unique_lock<std::mutex> lock{mMutex};
   while (true) {
-    if (mJobs.empty()) {
-      if (mQueuedAllJobs) {
-        return false;
-      } else {
-        mCv.wait_for(lock, std::chrono::milliseconds(100));
-      }
-    } else {
-      auto it = mJobs.begin();
-      rowStart = std::get<0>(*it);
-      rowEnd = std::get<1>(*it);
-      mJobs.erase(it);
-      return true;
+    mWorkCv.wait(lock, [this] { return !mBatches.empty(); });
+    std::shared_ptr<Batch> batch = mBatches.front();
+    if (batch->nextRow.load(std::memory_order_relaxed) >= batch->rowCount) {
+      // Every range is claimed, the remaining ones are finished by whoever claimed them
+      mBatches.pop_front();
+      continue;
     }
+    lock.unlock();
+    runJobs(*batch);
+    lock.lock();
   }
-  return false;
 }
 
-void JobQueue::enqueueJob(size_t rowStart, size_t rowEnd) {
-  std::unique_lock<std::mutex> lock{mMutex};
-  mJobs.push_back(std::make_tuple(rowStart, rowEnd));
-  lock.unlock();
-  mCv.notify_one();
+void WorkerPool::runJobs(Batch& batch) {
+  size_t rowStart;
+  while ((rowStart = batch.nextRow.fetch_add(batch.rowStep, std::memory_order_relaxed)) <
+         batch.rowCount) {
+    size_t rowEnd = std::min(rowStart + batch.rowStep, batch.rowCount);
+    (*batch.job)(rowStart, rowEnd);
+
+    std::lock_guard<std::mutex> lock{mMutex};
+    batch.rowsDone += rowEnd - rowStart;
+    if (batch.rowsDone == batch.rowCount) {
+      mDoneCv.notify_all();
+    }
+  }
 }
 
-void JobQueue::markQueueForEnd() {
-  std::unique_lock<std::mutex> lock{mMutex};
-  mQueuedAllJobs = true;
-  lock.unlock();
-  mCv.notify_all();
-}
+void WorkerPool::run(size_t rowCount, size_t rowStep, const Job& job) {
+  if (rowCount == 0) {
+    return;
+  }
+  auto batch = std::make_shared<Batch>();
+  batch->job = &job;
+  batch->rowCount = rowCount;
+  batch->rowStep = rowStep;
+  {
+    std::lock_guard<std::mutex> lock{mMutex};
+    mBatches.push_back(batch);
+  }
+  mWorkCv.notify_all();
+
+  runJobs(*batch);
 
-void JobQueue::reset() {
   std::unique_lock<std::mutex> lock{mMutex};
-  mJobs.clear();
-  mQueuedAllJobs = false;
+  mDoneCv.wait(lock, [&batch] { return batch->rowsDone == batch->rowCount; });
+  auto it = std::find(mBatches.begin(), mBatches.end(), batch);
+  if (it != mBatches.end()) {
+    mBatches.erase(it);
+  }
 }
 
 status_t JpegR::generateGainMap(jr_uncompressed_ptr yuv420_image_ptr,
@@ -838,28 +887,28 @@ status_t JpegR::generateGainMap(jr_uncompressed_ptr yuv420_image_ptr,
   std::unique_ptr<uint8_t[]> map_data;
   map_data.reset(reinterpret_cast<uint8_t*>(dest->data));
 
-  ColorTransformFn hdrInvOetf = nullptr;
+  ColorTransformRowFn hdrInvOetf = nullptr;
   float hdr_white_nits;
   switch (hdr_tf) {
     case ULTRAHDR_TF_LINEAR:
-      hdrInvOetf = identityConversion;
+      hdrInvOetf = identityConversionRow;
       // Note: this will produce clipping if the input exceeds kHlgMaxNits.
       // TODO: TF LINEAR will be deprecated.
       hdr_white_nits = kHlgMaxNits;
       break;
     case ULTRAHDR_TF_HLG:
 #if USE_HLG_INVOETF_LUT
-      hdrInvOetf = hlgInvOetfLUT;
+      hdrInvOetf = hlgInvOetfLUTRow;
 #else
-      hdrInvOetf = hlgInvOetf;
+      hdrInvOetf = hlgInvOetfRow;
 #endif
       hdr_white_nits = kHlgMaxNits;
       break;
     case ULTRAHDR_TF_PQ:
 #if USE_PQ_INVOETF_LUT
-      hdrInvOetf = pqInvOetfLUT;
+      hdrInvOetf = pqInvOetfLUTRow;
 #else
-      hdrInvOetf = pqInvOetf;
+      hdrInvOetf = pqInvOetfRow;
 #endif
       hdr_white_nits = kPqMaxNits;
       break;
@@ -879,114 +928,92 @@ status_t JpegR::generateGainMap(jr_uncompressed_ptr yuv420_image_ptr,
   float log2MinBoost = log2(metadata->minContentBoost);
   float log2MaxBoost = log2(metadata->maxContentBoost);
 
-  ColorTransformFn hdrGamutConversionFn =
-          getHdrConversionFn(yuv420_image_ptr->colorGamut, p010_image_ptr->colorGamut);
+  ColorTransformRowFn hdrGamutConversionFn =
+          getHdrConversionRowFn(yuv420_image_ptr->colorGamut, p010_image_ptr->colorGamut);
 
-  ColorCalculationFn luminanceFn = nullptr;
-  ColorTransformFn sdrYuvToRgbFn = nullptr;
+  ColorCalculationRowFn luminanceFn = nullptr;
+  ColorTransformRowFn sdrYuvToRgbFn = nullptr;
   switch (yuv420_image_ptr->colorGamut) {
     case ULTRAHDR_COLORGAMUT_BT709:
-      luminanceFn = srgbLuminance;
-      sdrYuvToRgbFn = srgbYuvToRgb;
+      luminanceFn = srgbLuminanceRow;
+      sdrYuvToRgbFn = srgbYuvToRgbRow;
       break;
     case ULTRAHDR_COLORGAMUT_P3:
-      luminanceFn = p3Luminance;
-      sdrYuvToRgbFn = p3YuvToRgb;
+      luminanceFn = p3LuminanceRow;
+      sdrYuvToRgbFn = p3YuvToRgbRow;
       break;
     case ULTRAHDR_COLORGAMUT_BT2100:
-      luminanceFn = bt2100Luminance;
-      sdrYuvToRgbFn = bt2100YuvToRgb;
+      luminanceFn = bt2100LuminanceRow;
+      sdrYuvToRgbFn = bt2100YuvToRgbRow;
       break;
     case ULTRAHDR_COLORGAMUT_UNSPECIFIED:
       // Should be impossible to hit after input validation.
       return ERROR_JPEGR_INVALID_COLORGAMUT;
   }
   if (sdr_is_601) {
-    sdrYuvToRgbFn = p3YuvToRgb;
+    sdrYuvToRgbFn = p3YuvToRgbRow;
   }
 
-  ColorTransformFn hdrYuvToRgbFn = nullptr;
+  ColorTransformRowFn hdrYuvToRgbFn = nullptr;
   switch (p010_image_ptr->colorGamut) {
     case ULTRAHDR_COLORGAMUT_BT709:
-      hdrYuvToRgbFn = srgbYuvToRgb;
+      hdrYuvToRgbFn = srgbYuvToRgbRow;
       break;
     case ULTRAHDR_COLORGAMUT_P3:
-      hdrYuvToRgbFn = p3YuvToRgb;
+      hdrYuvToRgbFn = p3YuvToRgbRow;
       break;
     case ULTRAHDR_COLORGAMUT_BT2100:
-      hdrYuvToRgbFn = bt2100YuvToRgb;
+      hdrYuvToRgbFn = bt2100YuvToRgbRow;
       break;
     case ULTRAHDR_COLORGAMUT_UNSPECIFIED:
       // Should be impossible to hit after input validation.
       return ERROR_JPEGR_INVALID_COLORGAMUT;
   }
 
-  std::mutex mutex;
-  const int threads = std::clamp(GetCPUCoreCount(), 1, 4);
-  size_t rowStep = threads == 1 ? image_height : kJobSzInRows;
-  JobQueue jobQueue;
-
-  std::function<void()> generateMap = [yuv420_image_ptr, p010_image_ptr, metadata, dest, hdrInvOetf,
-                                       hdrGamutConversionFn, luminanceFn, sdrYuvToRgbFn,
-                                       hdrYuvToRgbFn, hdr_white_nits, log2MinBoost, log2MaxBoost,
-                                       &jobQueue]() -> void {
-    size_t rowStart, rowEnd;
-    while (jobQueue.dequeueJob(rowStart, rowEnd)) {
-      for (size_t y = rowStart; y < rowEnd; ++y) {
-        for (size_t x = 0; x < dest->width; ++x) {
-          Color sdr_yuv_gamma = sampleYuv420(yuv420_image_ptr, kMapDimensionScaleFactor, x, y);
-          Color sdr_rgb_gamma = sdrYuvToRgbFn(sdr_yuv_gamma);
-          // We are assuming the SDR input is always sRGB transfer.
+  WorkerPool::Job generateMap = [yuv420_image_ptr, p010_image_ptr, metadata, dest, hdrInvOetf,
+                                 hdrGamutConversionFn, luminanceFn, sdrYuvToRgbFn, hdrYuvToRgbFn,
+                                 hdr_white_nits, log2MinBoost,
+                                 log2MaxBoost](size_t rowStart, size_t rowEnd) -> void {
+    size_t width = dest->width;
+    ColorRow sdr_rgb(width);
+    ColorRow hdr_rgb(width);
+    std::vector<float> sdr_y_nits(width);
+    std::vector<float> hdr_y_nits(width);
+    for (size_t y = rowStart; y < rowEnd; ++y) {
+      sampleYuv420Row(yuv420_image_ptr, kMapDimensionScaleFactor, y, width, sdr_rgb);
+      sdrYuvToRgbFn(sdr_rgb, width);
+      // We are assuming the SDR input is always sRGB transfer.
 #if USE_SRGB_INVOETF_LUT
-          Color sdr_rgb = srgbInvOetfLUT(sdr_rgb_gamma);
+      srgbInvOetfLUTRow(sdr_rgb, width);
 #else
-          Color sdr_rgb = srgbInvOetf(sdr_rgb_gamma);
+      srgbInvOetfRow(sdr_rgb, width);
 #endif
-          float sdr_y_nits = luminanceFn(sdr_rgb) * kSdrWhiteNits;
+      luminanceFn(sdr_rgb, width, sdr_y_nits.data());
 
-          Color hdr_yuv_gamma = sampleP010(p010_image_ptr, kMapDimensionScaleFactor, x, y);
-          Color hdr_rgb_gamma = hdrYuvToRgbFn(hdr_yuv_gamma);
-          Color hdr_rgb = hdrInvOetf(hdr_rgb_gamma);
-          hdr_rgb = hdrGamutConversionFn(hdr_rgb);
-          float hdr_y_nits = luminanceFn(hdr_rgb) * hdr_white_nits;
+      sampleP010Row(p010_image_ptr, kMapDimensionScaleFactor, y, width, hdr_rgb);
+      hdrYuvToRgbFn(hdr_rgb, width);
+      hdrInvOetf(hdr_rgb, width);
+      hdrGamutConversionFn(hdr_rgb, width);
+      luminanceFn(hdr_rgb, width, hdr_y_nits.data());
 
-          size_t pixel_idx = x + y * dest->width;
-          reinterpret_cast<uint8_t*>(dest->data)[pixel_idx] =
-                  encodeGain(sdr_y_nits, hdr_y_nits, metadata, log2MinBoost, log2MaxBoost);
-        }
+      for (size_t x = 0; x < width; ++x) {
+        sdr_y_nits[x] *= kSdrWhiteNits;
+        hdr_y_nits[x] *= hdr_white_nits;
       }
+      encodeGainRow(sdr_y_nits.data(), hdr_y_nits.data(), width, metadata, log2MinBoost,
+                    log2MaxBoost, reinterpret_cast<uint8_t*>(dest->data) + y * width);
     }
   };
 
   // generate map
-  std::vector<std::thread> workers;
-  for (int th = 0; th < threads - 1; th++) {
-    workers.push_back(std::thread(generateMap));
-  }
-
-  rowStep = (threads == 1 ? image_height : kJobSzInRows) / kMapDimensionScaleFactor;
-  for (size_t rowStart = 0; rowStart < map_height;) {
-    size_t rowEnd = std::min(rowStart + rowStep, map_height);
-    jobQueue.enqueueJob(rowStart, rowEnd);
-    rowStart = rowEnd;
-  }
-  jobQueue.markQueueForEnd();
-  generateMap();
-  std::for_each(workers.begin(), workers.end(), [](std::thread& t) { t.join(); });
+  WorkerPool::getInstance().run(map_height, kJobSzInRows / kMapDimensionScaleFactor, generateMap);
 
   map_data.release();
   return NO_ERROR;
 }
 
-status_t JpegR::applyGainMap(jr_uncompressed_ptr yuv420_image_ptr,
-                             jr_uncompressed_ptr gainmap_image_ptr, ultrahdr_metadata_ptr metadata,
-                             ultrahdr_output_format output_format, float max_display_boost,
-                             jr_uncompressed_ptr dest) {
-  if (yuv420_image_ptr == nullptr || gainmap_image_ptr == nullptr || metadata == nullptr ||
-      dest == nullptr || yuv420_image_ptr->data == nullptr ||
-      yuv420_image_ptr->chroma_data == nullptr || gainmap_image_ptr->data == nullptr) {
-    return ERROR_JPEGR_INVALID_NULL_PTR;
-  }
+// Returns NO_ERROR if the gain map can be applied with the given metadata.
+static status_t checkGainMapMetadata(ultrahdr_metadata_ptr metadata) {
   if (metadata->version.compare(kJpegrVersion)) {
     ALOGE("Unsupported metadata version: %s", metadata->version.c_str());
     return ERROR_JPEGR_UNSUPPORTED_METADATA;
@@ -1005,6 +1032,87 @@ status_t JpegR::applyGainMap(jr_uncompressed_ptr yuv420_image_ptr,
           metadata->hdrCapacityMax);
     return ERROR_JPEGR_UNSUPPORTED_METADATA;
   }
+  return NO_ERROR;
+}
+
+// Recovers row_count rows of the HDR image, starting at row image_row of the full image. The SDR
+// rows are read from yuv420_image_ptr starting at yuv_row, which is image_row when the whole
+// image is decoded and the row within the band when decoding in bands. The output is written to
+// dest with a stride of the image width.
+static void applyGainMapRows(jr_uncompressed_ptr yuv420_image_ptr, size_t yuv_row,
+                             jr_uncompressed_ptr gainmap_image_ptr, size_t image_row,
+                             size_t row_count, ultrahdr_metadata_ptr metadata,
+                             ultrahdr_output_format output_format, ShepardsIDW& idwTable,
+                             GainLUT& gainLUT, float display_boost, void* dest) {
+  size_t width = yuv420_image_ptr->width;
+  ColorRow rgb(width);
+  std::vector<float> gain(width);
+  for (size_t i = 0; i < row_count; ++i) {
+    getYuv420PixelRow(yuv420_image_ptr, yuv_row + i, width, rgb);
+    // Assuming the sdr image is a decoded JPEG, we should always use Rec.601 YUV coefficients
+    p3YuvToRgbRow(rgb, width);
+    // We are assuming the SDR base image is always sRGB transfer.
+#if USE_SRGB_INVOETF_LUT
+    srgbInvOetfLUTRow(rgb, width);
+#else
+    srgbInvOetfRow(rgb, width);
+#endif
+    // TODO: determine map scaling factor based on actual map dims
+    sampleMapRow(gainmap_image_ptr, kMapDimensionScaleFactor, image_row + i, width, idwTable,
+                 gain.data());
+
+#if USE_APPLY_GAIN_LUT
+    applyGainLUTRow(rgb, gain.data(), width, gainLUT);
+#else
+    applyGainRow(rgb, gain.data(), width, metadata, display_boost);
+#endif
+    divideRow(rgb, width, display_boost);
+    size_t pixel_idx = i * width;
+
+    switch (output_format) {
+      case ULTRAHDR_OUTPUT_HDR_LINEAR: {
+        colorToRgbaF16Row(rgb, width, reinterpret_cast<uint64_t*>(dest) + pixel_idx);
+        break;
+      }
+      case ULTRAHDR_OUTPUT_HDR_HLG: {
+#if USE_HLG_OETF_LUT
+        hlgOetfLUTRow(rgb, width);
+#else
+        hlgOetfRow(rgb, width);
+#endif
+        colorToRgba1010102Row(rgb, width, reinterpret_cast<uint32_t*>(dest) + pixel_idx);
+        break;
+      }
+      case ULTRAHDR_OUTPUT_HDR_PQ: {
+#if USE_PQ_OETF_LUT
+        pqOetfLUTRow(rgb, width);
+#else
+        pqOetfRow(rgb, width);
+#endif
+        colorToRgba1010102Row(rgb, width, reinterpret_cast<uint32_t*>(dest) + pixel_idx);
+        break;
+      }
+      default: {
+      }
+        // Should be impossible to hit after input validation.
+    }
+  }
+}
+
+static size_t bytesPerPixel(ultrahdr_output_format output_format) {
+  return output_format == ULTRAHDR_OUTPUT_HDR_LINEAR ? 8 : 4;
+}
+
+status_t JpegR::applyGainMap(jr_uncompressed_ptr yuv420_image_ptr,
+                             jr_uncompressed_ptr gainmap_image_ptr, ultrahdr_metadata_ptr metadata,
+                             ultrahdr_output_format output_format, float max_display_boost,
+                             jr_uncompressed_ptr dest) {
+  if (yuv420_image_ptr == nullptr || gainmap_image_ptr == nullptr || metadata == nullptr ||
+      dest == nullptr || yuv420_image_ptr->data == nullptr ||
+      yuv420_image_ptr->chroma_data == nullptr || gainmap_image_ptr->data == nullptr) {
+    return ERROR_JPEGR_INVALID_NULL_PTR;
+  }
+  JPEGR_CHECK(checkGainMapMetadata(metadata));
 
   // TODO: remove once map scaling factor is computed based on actual map dims
   size_t image_width = yuv420_image_ptr->width;
@@ -1024,97 +1132,162 @@ status_t JpegR::applyGainMap(jr_uncompressed_ptr yuv420_image_ptr,
   float display_boost = std::min(max_display_boost, metadata->maxContentBoost);
   GainLUT gainLUT(metadata, display_boost);
 
-  JobQueue jobQueue;
-  std::function<void()> applyRecMap = [yuv420_image_ptr, gainmap_image_ptr, metadata, dest,
-                                       &jobQueue, &idwTable, output_format, &gainLUT,
-                                       display_boost]() -> void {
-    size_t width = yuv420_image_ptr->width;
-    size_t height = yuv420_image_ptr->height;
-
-    size_t rowStart, rowEnd;
-    while (jobQueue.dequeueJob(rowStart, rowEnd)) {
-      for (size_t y = rowStart; y < rowEnd; ++y) {
-        for (size_t x = 0; x < width; ++x) {
-          Color yuv_gamma_sdr = getYuv420Pixel(yuv420_image_ptr, x, y);
-          // Assuming the sdr image is a decoded JPEG, we should always use Rec.601 YUV coefficients
-          Color rgb_gamma_sdr = p3YuvToRgb(yuv_gamma_sdr);
-          // We are assuming the SDR base image is always sRGB transfer.
-#if USE_SRGB_INVOETF_LUT
-          Color rgb_sdr = srgbInvOetfLUT(rgb_gamma_sdr);
-#else
-          Color rgb_sdr = srgbInvOetf(rgb_gamma_sdr);
-#endif
-          float gain;
-          // TODO: determine map scaling factor based on actual map dims
-          size_t map_scale_factor = kMapDimensionScaleFactor;
-          // TODO: If map_scale_factor is guaranteed to be an integer, then remove the following.
-          // Currently map_scale_factor is of type size_t, but it could be changed to a float
-          // later.
-          if (map_scale_factor != floorf(map_scale_factor)) {
-            gain = sampleMap(gainmap_image_ptr, map_scale_factor, x, y);
-          } else {
-            gain = sampleMap(gainmap_image_ptr, map_scale_factor, x, y, idwTable);
-          }
+  const size_t row_size = dest->width * bytesPerPixel(output_format);
+  WorkerPool::Job applyRecMap = [yuv420_image_ptr, gainmap_image_ptr, metadata, dest, &idwTable,
+                                 output_format, &gainLUT, display_boost,
+                                 row_size](size_t rowStart, size_t rowEnd) -> void {
+    applyGainMapRows(yuv420_image_ptr, rowStart, gainmap_image_ptr, rowStart, rowEnd - rowStart,
+                     metadata, output_format, idwTable, gainLUT, display_boost,
+                     reinterpret_cast<uint8_t*>(dest->data) + rowStart * row_size);
+  };
 
-#if USE_APPLY_GAIN_LUT
-          Color rgb_hdr = applyGainLUT(rgb_sdr, gain, gainLUT);
-#else
-          Color rgb_hdr = applyGain(rgb_sdr, gain, metadata, display_boost);
-#endif
-          rgb_hdr = rgb_hdr / display_boost;
-          size_t pixel_idx = x + y * width;
-
-          switch (output_format) {
-            case ULTRAHDR_OUTPUT_HDR_LINEAR: {
-              uint64_t rgba_f16 = colorToRgbaF16(rgb_hdr);
-              reinterpret_cast<uint64_t*>(dest->data)[pixel_idx] = rgba_f16;
-              break;
-            }
-            case ULTRAHDR_OUTPUT_HDR_HLG: {
-#if USE_HLG_OETF_LUT
-              ColorTransformFn hdrOetf = hlgOetfLUT;
-#else
-              ColorTransformFn hdrOetf = hlgOetf;
-#endif
-              Color rgb_gamma_hdr = hdrOetf(rgb_hdr);
-              uint32_t rgba_1010102 = colorToRgba1010102(rgb_gamma_hdr);
-              reinterpret_cast<uint32_t*>(dest->data)[pixel_idx] = rgba_1010102;
-              break;
-            }
-            case ULTRAHDR_OUTPUT_HDR_PQ: {
-#if USE_PQ_OETF_LUT
-              ColorTransformFn hdrOetf = pqOetfLUT;
-#else
-              ColorTransformFn hdrOetf = pqOetf;
-#endif
-              Color rgb_gamma_hdr = hdrOetf(rgb_hdr);
-              uint32_t rgba_1010102 = colorToRgba1010102(rgb_gamma_hdr);
-              reinterpret_cast<uint32_t*>(dest->data)[pixel_idx] = rgba_1010102;
-              break;
-            }
-            default: {
-            }
-              // Should be impossible to hit after input validation.
-          }
-        }
-      }
+  WorkerPool::getInstance().run(yuv420_image_ptr->height, kJobSzInRows, applyRecMap);
+  return NO_ERROR;
+}
+
+/* Streaming Decode API */
+status_t JpegR::decodeJPEGRStreaming(jr_compressed_ptr jpegr_image_ptr, JpegROutputSink* sink,
+                                     float max_display_boost, jr_exif_ptr exif,
+                                     ultrahdr_output_format output_format,
+                                     ultrahdr_metadata_ptr metadata) {
+  if (jpegr_image_ptr == nullptr || jpegr_image_ptr->data == nullptr) {
+    ALOGE("received nullptr for compressed jpegr image");
+    return ERROR_JPEGR_INVALID_NULL_PTR;
+  }
+  if (sink == nullptr) {
+    ALOGE("received nullptr for output sink");
+    return ERROR_JPEGR_INVALID_NULL_PTR;
+  }
+  if (max_display_boost < 1.0f) {
+    ALOGE("received bad value for max_display_boost %f", max_display_boost);
+    return ERROR_JPEGR_INVALID_INPUT_TYPE;
+  }
+  if (exif != nullptr && exif->data == nullptr) {
+    ALOGE("received nullptr address for exif data");
+    return ERROR_JPEGR_INVALID_INPUT_TYPE;
+  }
+  if (output_format <= ULTRAHDR_OUTPUT_UNSPECIFIED || output_format > ULTRAHDR_OUTPUT_MAX) {
+    ALOGE("received bad value for output format %d", output_format);
+    return ERROR_JPEGR_INVALID_INPUT_TYPE;
+  }
+
+  jpegr_compressed_struct primary_jpeg_image, gainmap_jpeg_image;
+  status_t status =
+          extractPrimaryImageAndGainMap(jpegr_image_ptr, &primary_jpeg_image, &gainmap_jpeg_image);
+  if (status != NO_ERROR) {
+    if (output_format != ULTRAHDR_OUTPUT_SDR || status != ERROR_JPEGR_GAIN_MAP_IMAGE_NOT_FOUND) {
+      ALOGE("received invalid compressed jpegr image");
+      return status;
+    }
+  }
+
+  const bool sdr = output_format == ULTRAHDR_OUTPUT_SDR;
+  JpegDecoderHelper jpeg_dec_obj_yuv420;
+  if (!jpeg_dec_obj_yuv420.startBandDecompression(primary_jpeg_image.data,
+                                                  primary_jpeg_image.length, sdr)) {
+    return ERROR_JPEGR_DECODE_ERROR;
+  }
+
+  if (exif != nullptr) {
+    if (exif->length < jpeg_dec_obj_yuv420.getEXIFSize()) {
+      return ERROR_JPEGR_BUFFER_TOO_SMALL;
+    }
+    memcpy(exif->data, jpeg_dec_obj_yuv420.getEXIFPtr(), jpeg_dec_obj_yuv420.getEXIFSize());
+    exif->length = jpeg_dec_obj_yuv420.getEXIFSize();
+  }
+
+  const size_t width = jpeg_dec_obj_yuv420.getDecompressedImageWidth();
+  const size_t height = jpeg_dec_obj_yuv420.getDecompressedImageHeight();
+
+  // The gain map is small enough to be decoded up front, and each band of the primary image
+  // needs the map rows above and below it for interpolation.
+  JpegDecoderHelper jpeg_dec_obj_gm;
+  jpegr_uncompressed_struct gainmap_image;
+  ultrahdr_metadata_struct uhdr_metadata;
+  if (!sdr) {
+    if (!jpeg_dec_obj_gm.decompressImage(gainmap_jpeg_image.data, gainmap_jpeg_image.length)) {
+      return ERROR_JPEGR_DECODE_ERROR;
+    }
+    if ((jpeg_dec_obj_gm.getDecompressedImageWidth() *
+         jpeg_dec_obj_gm.getDecompressedImageHeight()) >
+        jpeg_dec_obj_gm.getDecompressedImageSize()) {
+      return ERROR_JPEGR_CALCULATION_ERROR;
+    }
+    gainmap_image.data = jpeg_dec_obj_gm.getDecompressedImagePtr();
+    gainmap_image.width = jpeg_dec_obj_gm.getDecompressedImageWidth();
+    gainmap_image.height = jpeg_dec_obj_gm.getDecompressedImageHeight();
+
+    if (!getMetadataFromXMP(static_cast<uint8_t*>(jpeg_dec_obj_gm.getXMPPtr()),
+                            jpeg_dec_obj_gm.getXMPSize(), &uhdr_metadata)) {
+      return ERROR_JPEGR_INVALID_METADATA;
     }
+    if (metadata != nullptr) {
+      *metadata = uhdr_metadata;
+    }
+    JPEGR_CHECK(checkGainMapMetadata(&uhdr_metadata));
+
+    // TODO: remove once map scaling factor is computed based on actual map dims
+    size_t map_width = width / kMapDimensionScaleFactor;
+    size_t map_height = height / kMapDimensionScaleFactor;
+    if (map_width != gainmap_image.width || map_height != gainmap_image.height) {
+      ALOGE("gain map dimensions and primary image dimensions are not to scale, computed gain "
+            "map resolution is %dx%d, received gain map resolution is %dx%d",
+            (int)map_width, (int)map_height, gainmap_image.width, gainmap_image.height);
+      return ERROR_JPEGR_INVALID_INPUT_TYPE;
+    }
+  }
+
+  JPEGR_CHECK(sink->onImageSize(width, height));
+
+  const size_t band_height = JpegDecoderHelper::getBandHeight();
+  if (sdr) {
+    size_t row = 0;
+    int rows;
+    while ((rows = jpeg_dec_obj_yuv420.decompressNextBand()) > 0) {
+      JPEGR_CHECK(sink->onRows(row, rows, jpeg_dec_obj_yuv420.getBandPtr()));
+      row += rows;
+    }
+    if (rows < 0) {
+      return ERROR_JPEGR_DECODE_ERROR;
+    }
+    return NO_ERROR;
+  }
+
+  // Describes the band buffer of the primary image decoder. The V plane directly follows
+  // band_height / 2 rows of U, which is where getYuv420Pixel() expects it for this height.
+  jpegr_uncompressed_struct band_image;
+  band_image.data = jpeg_dec_obj_yuv420.getBandPtr();
+  band_image.width = width;
+  band_image.height = band_height;
+  band_image.luma_stride = jpeg_dec_obj_yuv420.getBandStride();
+  band_image.chroma_data =
+          reinterpret_cast<uint8_t*>(band_image.data) + band_image.luma_stride * band_height;
+  band_image.chroma_stride = band_image.luma_stride / 2;
+
+  ShepardsIDW idwTable(kMapDimensionScaleFactor);
+  float display_boost = std::min(max_display_boost, uhdr_metadata.maxContentBoost);
+  GainLUT gainLUT(&uhdr_metadata, display_boost);
+
+  const size_t row_size = width * bytesPerPixel(output_format);
+  std::unique_ptr<uint8_t[]> band_out = std::make_unique<uint8_t[]>(row_size * band_height);
+  size_t row = 0;
+  WorkerPool::Job applyRecMap = [&band_image, &gainmap_image, &uhdr_metadata, &idwTable,
+                                 output_format, &gainLUT, display_boost, row_size, &band_out,
+                                 &row](size_t rowStart, size_t rowEnd) -> void {
+    applyGainMapRows(&band_image, rowStart, &gainmap_image, row + rowStart, rowEnd - rowStart,
+                     &uhdr_metadata, output_format, idwTable, gainLUT, display_boost,
+                     band_out.get() + rowStart * row_size);
   };
 
-  const int threads = std::clamp(GetCPUCoreCount(), 1, 4);
-  std::vector<std::thread> workers;
-  for (int th = 0; th < threads - 1; th++) {
-    workers.push_back(std::thread(applyRecMap));
+  int rows;
+  while ((rows = jpeg_dec_obj_yuv420.decompressNextBand()) > 0) {
+    WorkerPool::getInstance().run(rows, kMapDimensionScaleFactor, applyRecMap);
+    JPEGR_CHECK(sink->onRows(row, rows, band_out.get()));
+    row += rows;
   }
-  const int rowStep = threads == 1 ? yuv420_image_ptr->height : kJobSzInRows;
-  for (int rowStart = 0; rowStart < yuv420_image_ptr->height;) {
-    int rowEnd = std::min(rowStart + rowStep, yuv420_image_ptr->height);
-    jobQueue.enqueueJob(rowStart, rowEnd);
-    rowStart = rowEnd;
+  if (rows < 0) {
+    return ERROR_JPEGR_DECODE_ERROR;
   }
-  jobQueue.markQueueForEnd();
-  applyRecMap();
-  std::for_each(workers.begin(), workers.end(), [](std::thread& t) { t.join(); });
   return NO_ERROR;
 }
 
@@ -0,0 +1,347 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+#include <ultrahdr/gainmapmath.h>
+
+namespace android::ultrahdr {
+
+// Each benchmark runs one stage of gain map generation or application over a row of a 12MP
+// image, once with the per pixel functions and once with the row kernel. Throughput is reported
+// in megapixels per second.
+static const size_t kWidth = 4000;
+static const size_t kHeight = 16;
+
+static void setThroughput(benchmark::State& state, size_t pixels) {
+  state.counters["MP/s"] = benchmark::Counter(static_cast<double>(pixels) / 1e6,
+                                              benchmark::Counter::kIsIterationInvariantRate);
+}
+
+class Images {
+public:
+  Images() : mYuv420(kWidth * kHeight * 3 / 2), mP010(kWidth * kHeight * 3 / 2),
+             mMap(kWidth / kMapDimensionScaleFactor * kHeight / kMapDimensionScaleFactor) {
+    std::mt19937 rng(42);
+    for (auto& value : mYuv420) value = static_cast<uint8_t>(rng());
+    for (auto& value : mP010) value = static_cast<uint16_t>((64 + rng() % 876) << 6);
+    for (auto& value : mMap) value = static_cast<uint8_t>(rng());
+  }
+
+  jpegr_uncompressed_struct yuv420() {
+    return { mYuv420.data(), kWidth, kHeight, ULTRAHDR_COLORGAMUT_BT709,
+             mYuv420.data() + kWidth * kHeight, kWidth, kWidth / 2 };
+  }
+
+  jpegr_uncompressed_struct p010() {
+    return { mP010.data(), kWidth, kHeight, ULTRAHDR_COLORGAMUT_BT2100,
+             mP010.data() + kWidth * kHeight, kWidth, kWidth };
+  }
+
+  jpegr_uncompressed_struct map() {
+    return { mMap.data(), kWidth / kMapDimensionScaleFactor, kHeight / kMapDimensionScaleFactor,
+             ULTRAHDR_COLORGAMUT_UNSPECIFIED };
+  }
+
+private:
+  std::vector<uint8_t> mYuv420;
+  std::vector<uint16_t> mP010;
+  std::vector<uint8_t> mMap;
+};
+
+static Images& images() {
+  static Images images;
+  return images;
+}
+
+// A row of colors in [0, 1], for the stages that start from decoded pixels.
+static ColorRow randomRow() {
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  ColorRow row(kWidth);
+  for (size_t x = 0; x < kWidth; ++x) {
+    row.r[x] = dist(rng);
+    row.g[x] = dist(rng);
+    row.b[x] = dist(rng);
+  }
+  return row;
+}
+
+static void BM_SampleYuv420(benchmark::State& state) {
+  jpegr_uncompressed_struct image = images().yuv420();
+  const size_t width = kWidth / kMapDimensionScaleFactor;
+  std::vector<Color> out(width);
+  for (auto _ : state) {
+    for (size_t x = 0; x < width; ++x) {
+      out[x] = sampleYuv420(&image, kMapDimensionScaleFactor, x, 0);
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  setThroughput(state, width * kMapDimensionScaleFactor * kMapDimensionScaleFactor);
+}
+
+static void BM_SampleYuv420Row(benchmark::State& state) {
+  jpegr_uncompressed_struct image = images().yuv420();
+  const size_t width = kWidth / kMapDimensionScaleFactor;
+  ColorRow row(width);
+  for (auto _ : state) {
+    sampleYuv420Row(&image, kMapDimensionScaleFactor, 0, width, row);
+    benchmark::DoNotOptimize(row.r);
+  }
+  setThroughput(state, width * kMapDimensionScaleFactor * kMapDimensionScaleFactor);
+}
+
+static void BM_SampleP010(benchmark::State& state) {
+  jpegr_uncompressed_struct image = images().p010();
+  const size_t width = kWidth / kMapDimensionScaleFactor;
+  std::vector<Color> out(width);
+  for (auto _ : state) {
+    for (size_t x = 0; x < width; ++x) {
+      out[x] = sampleP010(&image, kMapDimensionScaleFactor, x, 0);
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  setThroughput(state, width * kMapDimensionScaleFactor * kMapDimensionScaleFactor);
+}
+
+static void BM_SampleP010Row(benchmark::State& state) {
+  jpegr_uncompressed_struct image = images().p010();
+  const size_t width = kWidth / kMapDimensionScaleFactor;
+  ColorRow row(width);
+  for (auto _ : state) {
+    sampleP010Row(&image, kMapDimensionScaleFactor, 0, width, row);
+    benchmark::DoNotOptimize(row.r);
+  }
+  setThroughput(state, width * kMapDimensionScaleFactor * kMapDimensionScaleFactor);
+}
+
+static void BM_Transform(benchmark::State& state, ColorTransformFn fn) {
+  ColorRow row = randomRow();
+  std::vector<Color> colors(kWidth);
+  for (auto _ : state) {
+    for (size_t x = 0; x < kWidth; ++x) {
+      colors[x] = fn({{{ row.r[x], row.g[x], row.b[x] }}});
+    }
+    benchmark::DoNotOptimize(colors.data());
+  }
+  setThroughput(state, kWidth);
+}
+
+static void BM_TransformRow(benchmark::State& state, ColorTransformRowFn fn) {
+  const ColorRow input = randomRow();
+  ColorRow row(kWidth);
+  for (auto _ : state) {
+    // Start from the same input every time, so values don't drift out of range.
+    std::copy(input.mData.begin(), input.mData.end(), row.mData.begin());
+    fn(row, kWidth);
+    benchmark::DoNotOptimize(row.r);
+  }
+  setThroughput(state, kWidth);
+}
+
+static void BM_Luminance(benchmark::State& state) {
+  ColorRow row = randomRow();
+  std::vector<float> out(kWidth);
+  for (auto _ : state) {
+    for (size_t x = 0; x < kWidth; ++x) {
+      out[x] = bt2100Luminance({{{ row.r[x], row.g[x], row.b[x] }}});
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  setThroughput(state, kWidth);
+}
+
+static void BM_LuminanceRow(benchmark::State& state) {
+  ColorRow row = randomRow();
+  std::vector<float> out(kWidth);
+  for (auto _ : state) {
+    bt2100LuminanceRow(row, kWidth, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  setThroughput(state, kWidth);
+}
+
+static ultrahdr_metadata_struct metadata() {
+  ultrahdr_metadata_struct metadata;
+  metadata.maxContentBoost = kHlgMaxNits / kSdrWhiteNits;
+  metadata.minContentBoost = 1.0f;
+  return metadata;
+}
+
+static void BM_EncodeGain(benchmark::State& state) {
+  ultrahdr_metadata_struct md = metadata();
+  ColorRow row = randomRow();
+  std::vector<uint8_t> out(kWidth);
+  const float log2Min = log2(md.minContentBoost);
+  const float log2Max = log2(md.maxContentBoost);
+  for (auto _ : state) {
+    for (size_t x = 0; x < kWidth; ++x) {
+      out[x] = encodeGain(row.r[x] * kSdrWhiteNits, row.g[x] * kHlgMaxNits, &md, log2Min,
+                          log2Max);
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  setThroughput(state, kWidth);
+}
+
+static void BM_EncodeGainRow(benchmark::State& state) {
+  ultrahdr_metadata_struct md = metadata();
+  ColorRow row = randomRow();
+  for (size_t x = 0; x < kWidth; ++x) {
+    row.r[x] *= kSdrWhiteNits;
+    row.g[x] *= kHlgMaxNits;
+  }
+  std::vector<uint8_t> out(kWidth);
+  const float log2Min = log2(md.minContentBoost);
+  const float log2Max = log2(md.maxContentBoost);
+  for (auto _ : state) {
+    encodeGainRow(row.r, row.g, kWidth, &md, log2Min, log2Max, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  setThroughput(state, kWidth);
+}
+
+static void BM_SampleMap(benchmark::State& state) {
+  jpegr_uncompressed_struct map = images().map();
+  ShepardsIDW idwTable(kMapDimensionScaleFactor);
+  std::vector<float> out(kWidth);
+  for (auto _ : state) {
+    for (size_t x = 0; x < kWidth; ++x) {
+      out[x] = sampleMap(&map, kMapDimensionScaleFactor, x, 1, idwTable);
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  setThroughput(state, kWidth);
+}
+
+static void BM_SampleMapRow(benchmark::State& state) {
+  jpegr_uncompressed_struct map = images().map();
+  ShepardsIDW idwTable(kMapDimensionScaleFactor);
+  std::vector<float> out(kWidth);
+  for (auto _ : state) {
+    sampleMapRow(&map, kMapDimensionScaleFactor, 1, kWidth, idwTable, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  setThroughput(state, kWidth);
+}
+
+static void BM_ApplyGainLUT(benchmark::State& state) {
+  ultrahdr_metadata_struct md = metadata();
+  GainLUT gainLUT(&md, md.maxContentBoost);
+  ColorRow row = randomRow();
+  std::vector<Color> out(kWidth);
+  for (auto _ : state) {
+    for (size_t x = 0; x < kWidth; ++x) {
+      out[x] = applyGainLUT({{{ row.r[x], row.g[x], row.b[x] }}}, row.g[x], gainLUT);
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  setThroughput(state, kWidth);
+}
+
+static void BM_ApplyGainLUTRow(benchmark::State& state) {
+  ultrahdr_metadata_struct md = metadata();
+  GainLUT gainLUT(&md, md.maxContentBoost);
+  const ColorRow input = randomRow();
+  ColorRow row(kWidth);
+  for (auto _ : state) {
+    std::copy(input.mData.begin(), input.mData.end(), row.mData.begin());
+    applyGainLUTRow(row, input.g, kWidth, gainLUT);
+    benchmark::DoNotOptimize(row.r);
+  }
+  setThroughput(state, kWidth);
+}
+
+static void BM_ColorToRgbaF16(benchmark::State& state) {
+  ColorRow row = randomRow();
+  std::vector<uint64_t> out(kWidth);
+  for (auto _ : state) {
+    for (size_t x = 0; x < kWidth; ++x) {
+      out[x] = colorToRgbaF16({{{ row.r[x], row.g[x], row.b[x] }}});
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  setThroughput(state, kWidth);
+}
+
+static void BM_ColorToRgbaF16Row(benchmark::State& state) {
+  ColorRow row = randomRow();
+  std::vector<uint64_t> out(kWidth);
+  for (auto _ : state) {
+    colorToRgbaF16Row(row, kWidth, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  setThroughput(state, kWidth);
+}
+
+static void BM_ColorToRgba1010102(benchmark::State& state) {
+  ColorRow row = randomRow();
+  std::vector<uint32_t> out(kWidth);
+  for (auto _ : state) {
+    for (size_t x = 0; x < kWidth; ++x) {
+      out[x] = colorToRgba1010102({{{ row.r[x], row.g[x], row.b[x] }}});
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  setThroughput(state, kWidth);
+}
+
+static void BM_ColorToRgba1010102Row(benchmark::State& state) {
+  ColorRow row = randomRow();
+  std::vector<uint32_t> out(kWidth);
+  for (auto _ : state) {
+    colorToRgba1010102Row(row, kWidth, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  setThroughput(state, kWidth);
+}
+
+// Gain map generation
+BENCHMARK(BM_SampleYuv420);
+BENCHMARK(BM_SampleYuv420Row);
+BENCHMARK(BM_SampleP010);
+BENCHMARK(BM_SampleP010Row);
+BENCHMARK_CAPTURE(BM_Transform, bt2100YuvToRgb, bt2100YuvToRgb);
+BENCHMARK_CAPTURE(BM_TransformRow, bt2100YuvToRgb, bt2100YuvToRgbRow);
+BENCHMARK_CAPTURE(BM_Transform, srgbInvOetfLUT, srgbInvOetfLUT);
+BENCHMARK_CAPTURE(BM_TransformRow, srgbInvOetfLUT, srgbInvOetfLUTRow);
+BENCHMARK_CAPTURE(BM_Transform, pqInvOetfLUT, pqInvOetfLUT);
+BENCHMARK_CAPTURE(BM_TransformRow, pqInvOetfLUT, pqInvOetfLUTRow);
+BENCHMARK_CAPTURE(BM_Transform, bt2100ToBt709, bt2100ToBt709);
+BENCHMARK_CAPTURE(BM_TransformRow, bt2100ToBt709, bt2100ToBt709Row);
+BENCHMARK(BM_Luminance);
+BENCHMARK(BM_LuminanceRow);
+BENCHMARK(BM_EncodeGain);
+BENCHMARK(BM_EncodeGainRow);
+
+// Gain map application
+BENCHMARK_CAPTURE(BM_Transform, p3YuvToRgb, p3YuvToRgb);
+BENCHMARK_CAPTURE(BM_TransformRow, p3YuvToRgb, p3YuvToRgbRow);
+BENCHMARK(BM_SampleMap);
+BENCHMARK(BM_SampleMapRow);
+BENCHMARK(BM_ApplyGainLUT);
+BENCHMARK(BM_ApplyGainLUTRow);
+BENCHMARK_CAPTURE(BM_Transform, pqOetfLUT, pqOetfLUT);
+BENCHMARK_CAPTURE(BM_TransformRow, pqOetfLUT, pqOetfLUTRow);
+BENCHMARK(BM_ColorToRgbaF16);
+BENCHMARK(BM_ColorToRgbaF16Row);
+BENCHMARK(BM_ColorToRgba1010102);
+BENCHMARK(BM_ColorToRgba1010102Row);
+
+} // namespace android::ultrahdr
+
+BENCHMARK_MAIN();
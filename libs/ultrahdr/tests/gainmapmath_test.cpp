@@ -1159,6 +1159,171 @@ TEST_F(GainMapMathTest, SampleMap) {
   }
 }
 
+TEST_F(GainMapMathTest, SampleRows) {
+  jpegr_uncompressed_struct yuv420_image = Yuv420Image();
+  jpegr_uncompressed_struct p010_image = P010Image();
+
+  static const size_t kMapScaleFactor = 2;
+  static const size_t kWidth = 4 / kMapScaleFactor;
+  ColorRow row(kWidth);
+  for (size_t y = 0; y < 4 / kMapScaleFactor; ++y) {
+    sampleYuv420Row(&yuv420_image, kMapScaleFactor, y, kWidth, row);
+    for (size_t x = 0; x < kWidth; ++x) {
+      Color e = {{{ row.r[x], row.g[x], row.b[x] }}};
+      EXPECT_YUV_EQ(e, sampleYuv420(&yuv420_image, kMapScaleFactor, x, y));
+    }
+
+    sampleP010Row(&p010_image, kMapScaleFactor, y, kWidth, row);
+    for (size_t x = 0; x < kWidth; ++x) {
+      Color e = {{{ row.r[x], row.g[x], row.b[x] }}};
+      EXPECT_YUV_EQ(e, sampleP010(&p010_image, kMapScaleFactor, x, y));
+    }
+  }
+
+  ColorRow pixels(4);
+  for (size_t y = 0; y < 4; ++y) {
+    getYuv420PixelRow(&yuv420_image, y, 4, pixels);
+    for (size_t x = 0; x < 4; ++x) {
+      Color e = {{{ pixels.r[x], pixels.g[x], pixels.b[x] }}};
+      EXPECT_YUV_EQ(e, getYuv420Pixel(&yuv420_image, x, y));
+    }
+  }
+
+  jpegr_uncompressed_struct map_image = MapImage();
+  ShepardsIDW idwTable(kMapScaleFactor);
+  float gains[4 * kMapScaleFactor];
+  for (size_t y = 0; y < 4 * kMapScaleFactor; ++y) {
+    sampleMapRow(&map_image, kMapScaleFactor, y, 4 * kMapScaleFactor, idwTable, gains);
+    for (size_t x = 0; x < 4 * kMapScaleFactor; ++x) {
+      EXPECT_FLOAT_EQ(gains[x], sampleMap(&map_image, kMapScaleFactor, x, y, idwTable));
+    }
+  }
+}
+
+TEST_F(GainMapMathTest, TransformRows) {
+  const Color colors[] = {
+    RgbBlack(), RgbWhite(), RgbRed(), RgbGreen(), RgbBlue(),
+    {{{ 0.1f, 0.2f, 0.3f }}}, {{{ 0.9f, 0.5f, 0.01f }}}, {{{ 0.5f, 0.0001f, 0.75f }}},
+  };
+  const size_t width = sizeof(colors) / sizeof(colors[0]);
+
+  const std::pair<ColorTransformRowFn, ColorTransformFn> transforms[] = {
+    { srgbYuvToRgbRow, srgbYuvToRgb },
+    { p3YuvToRgbRow, p3YuvToRgb },
+    { bt2100YuvToRgbRow, bt2100YuvToRgb },
+    { srgbInvOetfRow, srgbInvOetf },
+    { srgbInvOetfLUTRow, srgbInvOetfLUT },
+    { hlgOetfRow, hlgOetf },
+    { hlgOetfLUTRow, hlgOetfLUT },
+    { hlgInvOetfRow, hlgInvOetf },
+    { hlgInvOetfLUTRow, hlgInvOetfLUT },
+    { pqOetfRow, pqOetf },
+    { pqOetfLUTRow, pqOetfLUT },
+    { pqInvOetfRow, pqInvOetf },
+    { pqInvOetfLUTRow, pqInvOetfLUT },
+    { bt709ToP3Row, bt709ToP3 },
+    { bt709ToBt2100Row, bt709ToBt2100 },
+    { p3ToBt709Row, p3ToBt709 },
+    { p3ToBt2100Row, p3ToBt2100 },
+    { bt2100ToBt709Row, bt2100ToBt709 },
+    { bt2100ToP3Row, bt2100ToP3 },
+    { identityConversionRow, identityConversion },
+  };
+
+  ColorRow row(width);
+  for (const auto& [rowFn, fn] : transforms) {
+    for (size_t x = 0; x < width; ++x) {
+      row.r[x] = colors[x].r;
+      row.g[x] = colors[x].g;
+      row.b[x] = colors[x].b;
+    }
+    rowFn(row, width);
+    for (size_t x = 0; x < width; ++x) {
+      Color e = {{{ row.r[x], row.g[x], row.b[x] }}};
+      EXPECT_RGB_EQ(e, fn(colors[x]));
+    }
+  }
+}
+
+TEST_F(GainMapMathTest, GainRows) {
+  const Color colors[] = {
+    RgbBlack(), RgbWhite(), RgbRed(), RgbGreen(), RgbBlue(), {{{ 0.1f, 0.2f, 0.3f }}},
+  };
+  const size_t width = sizeof(colors) / sizeof(colors[0]);
+  ColorRow row(width);
+  auto fillRow = [&]() {
+    for (size_t x = 0; x < width; ++x) {
+      row.r[x] = colors[x].r;
+      row.g[x] = colors[x].g;
+      row.b[x] = colors[x].b;
+    }
+  };
+
+  float luminance[width];
+  fillRow();
+  srgbLuminanceRow(row, width, luminance);
+  for (size_t x = 0; x < width; ++x) {
+    EXPECT_FLOAT_EQ(luminance[x], srgbLuminance(colors[x]));
+  }
+  p3LuminanceRow(row, width, luminance);
+  for (size_t x = 0; x < width; ++x) {
+    EXPECT_FLOAT_EQ(luminance[x], p3Luminance(colors[x]));
+  }
+  bt2100LuminanceRow(row, width, luminance);
+  for (size_t x = 0; x < width; ++x) {
+    EXPECT_FLOAT_EQ(luminance[x], bt2100Luminance(colors[x]));
+  }
+
+  ultrahdr_metadata_struct metadata = {
+    .maxContentBoost = 4.0f,
+    .minContentBoost = 1.0f / 4.0f,
+  };
+  const float y_sdr[width] = { 0.0f, 1.0f, 10.0f, 100.0f, 50.0f, 25.0f };
+  const float y_hdr[width] = { 0.0f, 4.0f, 5.0f, 100.0f, 1000.0f, 30.0f };
+  uint8_t encoded[width];
+  encodeGainRow(y_sdr, y_hdr, width, &metadata, log2(metadata.minContentBoost),
+                log2(metadata.maxContentBoost), encoded);
+  for (size_t x = 0; x < width; ++x) {
+    EXPECT_EQ(encoded[x], encodeGain(y_sdr[x], y_hdr[x], &metadata));
+  }
+
+  const float gains[width] = { 0.0f, 0.25f, 0.5f, 0.75f, 1.0f, 0.6f };
+  GainLUT gainLUT(&metadata, 2.0f);
+  fillRow();
+  applyGainLUTRow(row, gains, width, gainLUT);
+  for (size_t x = 0; x < width; ++x) {
+    Color e = {{{ row.r[x], row.g[x], row.b[x] }}};
+    EXPECT_RGB_EQ(e, applyGainLUT(colors[x], gains[x], gainLUT));
+  }
+  fillRow();
+  applyGainRow(row, gains, width, &metadata, 2.0f);
+  for (size_t x = 0; x < width; ++x) {
+    Color e = {{{ row.r[x], row.g[x], row.b[x] }}};
+    EXPECT_RGB_EQ(e, applyGain(colors[x], gains[x], &metadata, 2.0f));
+  }
+
+  fillRow();
+  divideRow(row, width, 2.0f);
+  uint32_t rgba1010102[width];
+  uint64_t rgbaF16[width];
+  colorToRgba1010102Row(row, width, rgba1010102);
+  colorToRgbaF16Row(row, width, rgbaF16);
+  for (size_t x = 0; x < width; ++x) {
+    EXPECT_EQ(rgba1010102[x], colorToRgba1010102(colors[x] / 2.0f));
+    EXPECT_EQ(rgbaF16[x], colorToRgbaF16(colors[x] / 2.0f));
+  }
+
+  // Dividing must match the per-pixel division exactly, which scaling by the reciprocal does not.
+  fillRow();
+  divideRow(row, width, 3.0f);
+  for (size_t x = 0; x < width; ++x) {
+    Color e = colors[x] / 3.0f;
+    EXPECT_EQ(row.r[x], e.r);
+    EXPECT_EQ(row.g[x], e.g);
+    EXPECT_EQ(row.b[x], e.b);
+  }
+}
+
 TEST_F(GainMapMathTest, ColorToRgba1010102) {
   EXPECT_EQ(colorToRgba1010102(RgbBlack()), 0x3 << 30);
   EXPECT_EQ(colorToRgba1010102(RgbWhite()), 0xFFFFFFFF);
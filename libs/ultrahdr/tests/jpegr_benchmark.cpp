@@ -0,0 +1,204 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <ultrahdr/jpegr.h>
+
+namespace android::ultrahdr {
+
+// Decodes a 12MP JPEGR image to linear RGBA_F16, once into a full size buffer with decodeJPEGR()
+// and once band by band with decodeJPEGRStreaming(). Each benchmark reports the time until the
+// first output row is available and how much the peak resident set size grew while decoding.
+static const size_t kWidth = 4000;
+static const size_t kHeight = 3000;
+static const size_t kBytesPerPixel = 8;
+
+// Returns a field of /proc/self/status in kB, or 0 if it can not be read.
+static size_t readStatusKb(const char* field) {
+  FILE* file = fopen("/proc/self/status", "r");
+  if (file == nullptr) {
+    return 0;
+  }
+  char line[256];
+  size_t value = 0;
+  const size_t length = strlen(field);
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    if (strncmp(line, field, length) == 0 && line[length] == ':') {
+      value = strtoul(line + length + 1, nullptr, 10);
+      break;
+    }
+  }
+  fclose(file);
+  return value;
+}
+
+// Resets VmHWM to the current resident set size, so that it only covers what happens next.
+static void resetPeakRss() {
+  FILE* file = fopen("/proc/self/clear_refs", "w");
+  if (file != nullptr) {
+    fputs("5", file);
+    fclose(file);
+  }
+}
+
+class PeakRssCounter {
+public:
+  void start() {
+    resetPeakRss();
+    mStartKb = readStatusKb("VmRSS");
+  }
+
+  void stop() {
+    size_t peakKb = readStatusKb("VmHWM");
+    mGrowthKb += peakKb > mStartKb ? peakKb - mStartKb : 0;
+  }
+
+  void report(benchmark::State& state) {
+    state.counters["peak_rss_MB"] =
+            benchmark::Counter(static_cast<double>(mGrowthKb) / 1024.0,
+                               benchmark::Counter::kAvgIterations);
+  }
+
+private:
+  size_t mStartKb = 0;
+  size_t mGrowthKb = 0;
+};
+
+// A smooth HDR gradient encoded once with Encode API-0.
+class JpegRImage {
+public:
+  JpegRImage() : mP010(kWidth * kHeight * 3 / 2), mCompressed(kWidth * kHeight * 3) {
+    for (size_t y = 0; y < kHeight; ++y) {
+      for (size_t x = 0; x < kWidth; ++x) {
+        size_t value = 64 + (x + y) * 876 / (kWidth + kHeight);
+        mP010[y * kWidth + x] = static_cast<uint16_t>(value << 6);
+      }
+    }
+    for (size_t i = kWidth * kHeight; i < mP010.size(); ++i) {
+      mP010[i] = 512 << 6;
+    }
+    jpegr_uncompressed_struct p010 = { mP010.data(), kWidth, kHeight,
+                                       ULTRAHDR_COLORGAMUT_BT2100 };
+    mImage = { mCompressed.data(), 0, static_cast<int>(mCompressed.size()),
+               ULTRAHDR_COLORGAMUT_UNSPECIFIED };
+    JpegR jpegr;
+    mValid = jpegr.encodeJPEGR(&p010, ULTRAHDR_TF_HLG, &mImage, 95, nullptr) == NO_ERROR;
+    // Only the compressed image is needed from here on.
+    std::vector<uint16_t>().swap(mP010);
+  }
+
+  jr_compressed_ptr get() { return mValid ? &mImage : nullptr; }
+
+private:
+  std::vector<uint16_t> mP010;
+  std::vector<uint8_t> mCompressed;
+  jpegr_compressed_struct mImage;
+  bool mValid;
+};
+
+static JpegRImage& image() {
+  static JpegRImage image;
+  return image;
+}
+
+// Consumes rows the way a display or encoder would, without keeping them.
+class FirstRowSink : public JpegROutputSink {
+public:
+  explicit FirstRowSink(std::chrono::steady_clock::time_point start) : mStart(start) {}
+
+  status_t onImageSize(size_t width, size_t /* height */) override {
+    mWidth = width;
+    return NO_ERROR;
+  }
+
+  status_t onRows(size_t row_start, size_t row_count, const void* data) override {
+    if (row_start == 0) {
+      mFirstRow = std::chrono::steady_clock::now() - mStart;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    benchmark::DoNotOptimize(bytes[row_count * mWidth * kBytesPerPixel - 1]);
+    return NO_ERROR;
+  }
+
+  std::chrono::duration<double, std::milli> mFirstRow{};
+
+private:
+  const std::chrono::steady_clock::time_point mStart;
+  size_t mWidth = 0;
+};
+
+static void BM_decodeJPEGR(benchmark::State& state) {
+  jr_compressed_ptr compressed = image().get();
+  if (compressed == nullptr) {
+    state.SkipWithError("failed to encode JPEGR image");
+    return;
+  }
+  JpegR jpegr;
+  PeakRssCounter rss;
+  double firstRowMs = 0;
+  for (auto _ : state) {
+    rss.start();
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<uint8_t[]> data = std::make_unique<uint8_t[]>(kWidth * kHeight *
+                                                                  kBytesPerPixel);
+    jpegr_uncompressed_struct dest{};
+    dest.data = data.get();
+    if (jpegr.decodeJPEGR(compressed, &dest) != NO_ERROR) {
+      state.SkipWithError("decodeJPEGR failed");
+      return;
+    }
+    firstRowMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                            start).count();
+    rss.stop();
+  }
+  state.counters["first_row_ms"] =
+          benchmark::Counter(firstRowMs, benchmark::Counter::kAvgIterations);
+  rss.report(state);
+}
+
+static void BM_decodeJPEGRStreaming(benchmark::State& state) {
+  jr_compressed_ptr compressed = image().get();
+  if (compressed == nullptr) {
+    state.SkipWithError("failed to encode JPEGR image");
+    return;
+  }
+  JpegR jpegr;
+  PeakRssCounter rss;
+  double firstRowMs = 0;
+  for (auto _ : state) {
+    rss.start();
+    FirstRowSink sink(std::chrono::steady_clock::now());
+    if (jpegr.decodeJPEGRStreaming(compressed, &sink) != NO_ERROR) {
+      state.SkipWithError("decodeJPEGRStreaming failed");
+      return;
+    }
+    firstRowMs += sink.mFirstRow.count();
+    rss.stop();
+  }
+  state.counters["first_row_ms"] =
+          benchmark::Counter(firstRowMs, benchmark::Counter::kAvgIterations);
+  rss.report(state);
+}
+
+BENCHMARK(BM_decodeJPEGR)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_decodeJPEGRStreaming)->Unit(benchmark::kMillisecond);
+
+} // namespace android::ultrahdr
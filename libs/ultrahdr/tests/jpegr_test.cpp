@@ -294,6 +294,38 @@ static bool readFile(const char* fileName, void*& result, int maxLength, int& le
   return false;
 }
 
+/**
+ * Output sink that collects the rows of a streaming decode into one buffer, checking that bands
+ * arrive in order.
+ */
+class BufferOutputSink : public JpegROutputSink {
+public:
+  explicit BufferOutputSink(size_t bytesPerPixel) : mBytesPerPixel(bytesPerPixel) {}
+
+  status_t onImageSize(size_t width, size_t height) override {
+    mWidth = width;
+    mData.resize(width * height * mBytesPerPixel);
+    return OK;
+  }
+
+  status_t onRows(size_t rowStart, size_t rowCount, const void* data) override {
+    if (rowStart != mNextRow) {
+      return UNKNOWN_ERROR;
+    }
+    memcpy(mData.data() + rowStart * mWidth * mBytesPerPixel, data,
+           rowCount * mWidth * mBytesPerPixel);
+    mNextRow += rowCount;
+    return mRowLimit != 0 && mNextRow >= mRowLimit ? INVALID_OPERATION : OK;
+  }
+
+  const size_t mBytesPerPixel;
+  size_t mWidth = 0;
+  size_t mNextRow = 0;
+  // if not 0, decoding is stopped once this many rows were received
+  size_t mRowLimit = 0;
+  std::vector<uint8_t> mData;
+};
+
 void decodeJpegRImg(jr_compressed_ptr img, [[maybe_unused]] const char* outFileName) {
   std::vector<uint8_t> iccData(0);
   std::vector<uint8_t> exifData(0);
@@ -314,6 +346,13 @@ void decodeJpegRImg(jr_compressed_ptr img, [[maybe_unused]] const char* outFileN
     std::cerr << "unable to write output file" << std::endl;
   }
 #endif
+
+  // streaming decode must produce the same image
+  BufferOutputSink sink(8);
+  ASSERT_EQ(OK, jpegHdr.decodeJPEGRStreaming(img, &sink));
+  ASSERT_EQ(kImageWidth, sink.mWidth);
+  ASSERT_EQ(kImageHeight, sink.mNextRow);
+  ASSERT_EQ(0, memcmp(sink.mData.data(), destImage.data, outSize));
 }
 
 // ============================================================================
@@ -1342,6 +1381,65 @@ TEST(JpegRTest, DecodeAPIWithInvalidArgs) {
           << "fail, API allows invalid output format";
 }
 
+/* Test Streaming Decode API invalid arguments */
+TEST(JpegRTest, StreamingDecodeAPIWithInvalidArgs) {
+  JpegR uHdrLib;
+
+  UhdrCompressedStructWrapper jpgImg(16, 16);
+  BufferOutputSink sink(8);
+
+  // test jpegr image
+  ASSERT_NE(uHdrLib.decodeJPEGRStreaming(nullptr, &sink), OK)
+          << "fail, API allows nullptr for jpegr img";
+  ASSERT_NE(uHdrLib.decodeJPEGRStreaming(jpgImg.getImageHandle(), &sink), OK)
+          << "fail, API allows nullptr for jpegr img";
+  ASSERT_TRUE(jpgImg.allocateMemory());
+
+  // test sink
+  ASSERT_NE(uHdrLib.decodeJPEGRStreaming(jpgImg.getImageHandle(), nullptr), OK)
+          << "fail, API allows nullptr for sink";
+
+  // test max display boost
+  ASSERT_NE(uHdrLib.decodeJPEGRStreaming(jpgImg.getImageHandle(), &sink, 0.5), OK)
+          << "fail, API allows invalid max display boost";
+
+  // test output format
+  ASSERT_NE(uHdrLib.decodeJPEGRStreaming(jpgImg.getImageHandle(), &sink, FLT_MAX, nullptr,
+                                         static_cast<ultrahdr_output_format>(-1)),
+            OK)
+          << "fail, API allows invalid output format";
+  ASSERT_NE(uHdrLib.decodeJPEGRStreaming(jpgImg.getImageHandle(), &sink, FLT_MAX, nullptr,
+                                         static_cast<ultrahdr_output_format>(
+                                                 ULTRAHDR_OUTPUT_MAX + 1)),
+            OK)
+          << "fail, API allows invalid output format";
+  ASSERT_EQ(0, sink.mNextRow) << "fail, rows emitted for invalid arguments";
+}
+
+/* Test that an error returned by the sink stops a streaming decode */
+TEST(JpegRTest, StreamingDecodeStopsOnSinkError) {
+  UhdrUnCompressedStructWrapper rawImgP010(kImageWidth, kImageHeight, YCbCr_p010);
+  ASSERT_TRUE(rawImgP010.setImageColorGamut(ultrahdr_color_gamut::ULTRAHDR_COLORGAMUT_BT2100));
+  ASSERT_TRUE(rawImgP010.allocateMemory());
+  ASSERT_TRUE(rawImgP010.loadRawResource(kYCbCrP010FileName));
+  UhdrCompressedStructWrapper jpgImg(kImageWidth, kImageHeight);
+  ASSERT_TRUE(jpgImg.allocateMemory());
+  JpegR uHdrLib;
+  ASSERT_EQ(uHdrLib.encodeJPEGR(rawImgP010.getImageHandle(),
+                                ultrahdr_transfer_function::ULTRAHDR_TF_HLG,
+                                jpgImg.getImageHandle(), kQuality, nullptr),
+            OK);
+
+  for (auto outputFormat : {ULTRAHDR_OUTPUT_SDR, ULTRAHDR_OUTPUT_HDR_LINEAR}) {
+    BufferOutputSink sink(outputFormat == ULTRAHDR_OUTPUT_HDR_LINEAR ? 8 : 4);
+    sink.mRowLimit = kImageHeight / 2;
+    ASSERT_EQ(INVALID_OPERATION,
+              uHdrLib.decodeJPEGRStreaming(jpgImg.getImageHandle(), &sink, FLT_MAX, nullptr,
+                                           outputFormat));
+    ASSERT_LT(sink.mNextRow, static_cast<size_t>(kImageHeight));
+  }
+}
+
 TEST(JpegRTest, writeXmpThenRead) {
   ultrahdr_metadata_struct metadata_expected;
   metadata_expected.version = "1.0";
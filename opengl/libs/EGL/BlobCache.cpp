@@ -26,6 +26,7 @@
 #include <utils/Trace.h>
 
 #include <chrono>
+#include <string_view>
 
 namespace android {
 
@@ -38,11 +39,16 @@ static const uint32_t blobCacheVersion = 3;
 // BlobCache::Header::mDeviceVersion value
 static const uint32_t blobCacheDeviceVersion = 1;
 
-BlobCache::BlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize)
+// Number of least recently used entries considered for each eviction when the
+// policy is BlobCache::Policy::kLru.
+static const size_t kLruEvictionWindow = 8;
+
+BlobCache::BlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize, Policy policy)
       : mMaxTotalSize(maxTotalSize),
         mMaxKeySize(maxKeySize),
         mMaxValueSize(maxValueSize),
-        mTotalSize(0) {
+        mTotalSize(0),
+        mPolicy(policy) {
     int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
 #ifdef _WIN32
     srand(now);
@@ -81,6 +87,10 @@ BlobCache::InsertResult BlobCache::set(const void* key, size_t keySize, const vo
         return InsertResult::kInvalidValueSize;
     }
 
+    if (mPolicy == Policy::kLru) {
+        return setLru(key, keySize, value, valueSize);
+    }
+
     std::shared_ptr<Blob> cacheKey(new Blob(key, keySize, false));
     CacheEntry cacheEntry(cacheKey, nullptr);
 
@@ -144,6 +154,9 @@ size_t BlobCache::get(const void* key, size_t keySize, void* value, size_t value
               mMaxKeySize);
         return 0;
     }
+    if (mPolicy == Policy::kLru) {
+        return getLru(key, keySize, value, valueSize);
+    }
     std::shared_ptr<Blob> cacheKey(new Blob(key, keySize, false));
     CacheEntry cacheEntry(cacheKey, nullptr);
     auto index = std::lower_bound(mCacheEntries.begin(), mCacheEntries.end(), cacheEntry);
@@ -166,6 +179,125 @@ size_t BlobCache::get(const void* key, size_t keySize, void* value, size_t value
     return valueBlobSize;
 }
 
+BlobCache::InsertResult BlobCache::setLru(const void* key, size_t keySize, const void* value,
+                                          size_t valueSize) {
+    bool didClean = false;
+    auto found = mLruIndex.find(KeyView{key, keySize});
+    if (found == mLruIndex.end()) {
+        // Create a new cache entry. The combined size was already checked
+        // against mMaxTotalSize, so evicting everything else always makes room.
+        while (mMaxTotalSize < mTotalSize + keySize + valueSize) {
+            evictLru(nullptr);
+            didClean = true;
+        }
+        std::shared_ptr<Blob> keyBlob(new Blob(key, keySize, true));
+        std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, true));
+        mLruEntries.emplace_front(keyBlob, valueBlob);
+        mLruIndex.emplace(KeyView{keyBlob->getData(), keySize}, mLruEntries.begin());
+        mTotalSize += keySize + valueSize;
+        ALOGV("set: created new cache entry with %zu byte key and %zu byte value", keySize,
+              valueSize);
+    } else {
+        // Update the existing cache entry.
+        LruEntry& entry = *found->second;
+        const size_t oldValueSize = entry.mEntry.getValue()->getSize();
+        while (mMaxTotalSize < mTotalSize + valueSize - oldValueSize) {
+            if (!evictLru(&entry)) {
+                ALOGV("set: not caching new value because the total cache "
+                      "size limit would be exceeded: %zu (limit: %zu)",
+                      keySize + valueSize, mMaxTotalSize);
+                return InsertResult::kNotEnoughSpace;
+            }
+            didClean = true;
+        }
+        entry.mEntry.setValue(std::shared_ptr<Blob>(new Blob(value, valueSize, true)));
+        entry.mHitCount = 0;
+        mLruEntries.splice(mLruEntries.begin(), mLruEntries, found->second);
+        mTotalSize = mTotalSize + valueSize - oldValueSize;
+        ALOGV("set: updated existing cache entry with %zu byte key and %zu byte "
+              "value",
+              keySize, valueSize);
+    }
+    return didClean ? InsertResult::kDidClean : InsertResult::kInserted;
+}
+
+size_t BlobCache::getLru(const void* key, size_t keySize, void* value, size_t valueSize) {
+    auto found = mLruIndex.find(KeyView{key, keySize});
+    if (found == mLruIndex.end()) {
+        ALOGV("get: no cache entry found for key of size %zu", keySize);
+        return 0;
+    }
+
+    LruEntry& entry = *found->second;
+    if (entry.mHitCount < UINT32_MAX) {
+        entry.mHitCount++;
+    }
+    mLruEntries.splice(mLruEntries.begin(), mLruEntries, found->second);
+
+    // The key was found. Return the value if the caller's buffer is large
+    // enough.
+    std::shared_ptr<Blob> valueBlob(entry.mEntry.getValue());
+    size_t valueBlobSize = valueBlob->getSize();
+    if (valueBlobSize <= valueSize) {
+        ALOGV("get: copying %zu bytes to caller's buffer", valueBlobSize);
+        memcpy(value, valueBlob->getData(), valueBlobSize);
+    } else {
+        ALOGV("get: caller's buffer is too small for value: %zu (needs %zu)", valueSize,
+              valueBlobSize);
+    }
+    return valueBlobSize;
+}
+
+bool BlobCache::evictLru(const LruEntry* keep) {
+    // Weigh each candidate by hits per byte. Comparing (hitsA + 1) * sizeB with
+    // (hitsB + 1) * sizeA avoids floating point, and ties go to the older entry.
+    auto victim = mLruEntries.end();
+    uint64_t victimHits = 0;
+    uint64_t victimSize = 0;
+    size_t considered = 0;
+    for (auto it = mLruEntries.end();
+         it != mLruEntries.begin() && considered < kLruEvictionWindow;) {
+        --it;
+        if (&*it == keep) {
+            continue;
+        }
+        considered++;
+        const uint64_t hits = uint64_t(it->mHitCount) + 1;
+        const uint64_t size = it->mEntry.getKey()->getSize() + it->mEntry.getValue()->getSize();
+        if (victim == mLruEntries.end() || hits * victimSize < victimHits * size) {
+            victim = it;
+            victimHits = hits;
+            victimSize = size;
+        }
+    }
+    if (victim == mLruEntries.end()) {
+        return false;
+    }
+
+    const std::shared_ptr<Blob> keyBlob = victim->mEntry.getKey();
+    ALOGV("evictLru: evicting %" PRIu64 " byte entry with %" PRIu32 " hits", victimSize,
+          victim->mHitCount);
+    mLruIndex.erase(KeyView{keyBlob->getData(), keyBlob->getSize()});
+    mLruEntries.erase(victim);
+    mTotalSize -= victimSize;
+    return true;
+}
+
+template <typename F>
+void BlobCache::forEachEntry(F f) const {
+    if (mPolicy == Policy::kLru) {
+        // Least recently used first, so that unflatten inserts the most
+        // recently used entry last and it ends up at the front again.
+        for (auto it = mLruEntries.crbegin(); it != mLruEntries.crend(); ++it) {
+            f(it->mEntry.getKey(), it->mEntry.getValue());
+        }
+        return;
+    }
+    for (const CacheEntry& e : mCacheEntries) {
+        f(e.getKey(), e.getValue());
+    }
+}
+
 static inline size_t align4(size_t size) {
     return (size + 3) & ~3;
 }
@@ -173,11 +305,10 @@ static inline size_t align4(size_t size) {
 size_t BlobCache::getFlattenedSize() const {
     auto buildId = base::GetProperty("ro.build.id", "");
     size_t size = align4(sizeof(Header) + buildId.size());
-    for (const CacheEntry& e : mCacheEntries) {
-        std::shared_ptr<Blob> const& keyBlob = e.getKey();
-        std::shared_ptr<Blob> const& valueBlob = e.getValue();
+    forEachEntry([&size](const std::shared_ptr<Blob>& keyBlob,
+                         const std::shared_ptr<Blob>& valueBlob) {
         size += align4(sizeof(EntryHeader) + keyBlob->getSize() + valueBlob->getSize());
-    }
+    });
     return size;
 }
 
@@ -191,7 +322,7 @@ int BlobCache::flatten(void* buffer, size_t size) const {
     header->mMagicNumber = blobCacheMagic;
     header->mBlobCacheVersion = blobCacheVersion;
     header->mDeviceVersion = blobCacheDeviceVersion;
-    header->mNumEntries = mCacheEntries.size();
+    header->mNumEntries = mPolicy == Policy::kLru ? mLruEntries.size() : mCacheEntries.size();
     auto buildId = base::GetProperty("ro.build.id", "");
     header->mBuildIdLength = buildId.size();
     memcpy(header->mBuildId, buildId.c_str(), header->mBuildIdLength);
@@ -199,9 +330,11 @@ int BlobCache::flatten(void* buffer, size_t size) const {
     // Write cache entries
     uint8_t* byteBuffer = reinterpret_cast<uint8_t*>(buffer);
     off_t byteOffset = align4(sizeof(Header) + header->mBuildIdLength);
-    for (const CacheEntry& e : mCacheEntries) {
-        std::shared_ptr<Blob> const& keyBlob = e.getKey();
-        std::shared_ptr<Blob> const& valueBlob = e.getValue();
+    bool overflowed = false;
+    forEachEntry([&](const std::shared_ptr<Blob>& keyBlob, const std::shared_ptr<Blob>& valueBlob) {
+        if (overflowed) {
+            return;
+        }
         size_t keySize = keyBlob->getSize();
         size_t valueSize = valueBlob->getSize();
 
@@ -209,7 +342,8 @@ int BlobCache::flatten(void* buffer, size_t size) const {
         size_t totalSize = align4(entrySize);
         if (byteOffset + totalSize > size) {
             ALOGE("flatten: not enough room for cache entries");
-            return -EINVAL;
+            overflowed = true;
+            return;
         }
 
         EntryHeader* eheader = reinterpret_cast<EntryHeader*>(&byteBuffer[byteOffset]);
@@ -226,6 +360,9 @@ int BlobCache::flatten(void* buffer, size_t size) const {
         }
 
         byteOffset += totalSize;
+    });
+    if (overflowed) {
+        return -EINVAL;
     }
 
     return 0;
@@ -372,4 +509,13 @@ void BlobCache::CacheEntry::setValue(const std::shared_ptr<Blob>& value) {
     mValue = value;
 }
 
+bool BlobCache::KeyView::operator==(const KeyView& rhs) const {
+    return mSize == rhs.mSize && memcmp(mData, rhs.mData, mSize) == 0;
+}
+
+size_t BlobCache::KeyViewHash::operator()(const KeyView& key) const {
+    return std::hash<std::string_view>{}(
+            std::string_view(static_cast<const char*>(key.mData), key.mSize));
+}
+
 } // namespace android
@@ -19,7 +19,9 @@
 
 #include <stddef.h>
 
+#include <list>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace android {
@@ -33,11 +35,27 @@ namespace android {
 // that generated it.
 class BlobCache {
 public:
+    // How entries are chosen for eviction when the cache is full.
+    enum class Policy {
+        // Entries are kept sorted by key. When an insertion would exceed
+        // maxTotalSize, randomly chosen entries are evicted until the cache is
+        // at most half full.
+        kRandom,
+        // Entries are indexed by a hash of their key and kept in least recently
+        // used order. When an insertion would exceed maxTotalSize, only as many
+        // entries as needed are evicted, each chosen from the least recently
+        // used few as the one with the fewest hits per byte. flatten writes
+        // entries from least to most recently used so that unflatten restores
+        // the same order.
+        kLru,
+    };
+
     // Create an empty blob cache. The blob cache will cache key/value pairs
     // with key and value sizes less than or equal to maxKeySize and
     // maxValueSize, respectively. The total combined size of ALL cache entries
     // (key sizes plus value sizes) will not exceed maxTotalSize.
-    BlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize);
+    BlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize,
+              Policy policy = Policy::kRandom);
 
     // Return value from set(), below.
     enum class InsertResult {
@@ -119,6 +137,8 @@ public:
     // it in an empty state.
     void clear() {
         mCacheEntries.clear();
+        mLruIndex.clear();
+        mLruEntries.clear();
         mTotalSize = 0;
     }
 
@@ -146,6 +166,23 @@ private:
     // to have some effect, and false otherwise.
     bool isCleanable() const;
 
+    // setLru and getLru implement set and get for Policy::kLru, once the
+    // arguments have been validated.
+    InsertResult setLru(const void* key, size_t keySize, const void* value, size_t valueSize);
+    size_t getLru(const void* key, size_t keySize, void* value, size_t valueSize);
+
+    // evictLru evicts a single entry other than 'keep' and returns false if
+    // there was no such entry. Only the kLruEvictionWindow least recently used
+    // entries are considered, and of those the one with the fewest hits per
+    // byte is evicted.
+    class LruEntry;
+    bool evictLru(const LruEntry* keep);
+
+    // forEachEntry calls f with the key and value of each entry, in the order
+    // the entries are serialized by flatten.
+    template <typename F>
+    void forEachEntry(F f) const;
+
     // A Blob is an immutable sized unstructured data blob.
     class Blob {
     public:
@@ -196,6 +233,30 @@ private:
         std::shared_ptr<Blob> mValue;
     };
 
+    // An LruEntry is a cache entry along with the number of times it has been
+    // read since it was inserted.
+    class LruEntry {
+    public:
+        LruEntry(const std::shared_ptr<Blob>& key, const std::shared_ptr<Blob>& value)
+              : mEntry(key, value), mHitCount(0) {}
+
+        CacheEntry mEntry;
+        uint32_t mHitCount;
+    };
+
+    // A KeyView refers to key data owned either by a cache entry or, during a
+    // lookup, by the caller.
+    struct KeyView {
+        const void* mData;
+        size_t mSize;
+
+        bool operator==(const KeyView& rhs) const;
+    };
+
+    struct KeyViewHash {
+        size_t operator()(const KeyView& key) const;
+    };
+
     // A Header is the header for the entire BlobCache serialization format. No
     // need to make this portable, so we simply write the struct out.
     struct Header {
@@ -260,9 +321,19 @@ private:
     // nrand48 to generate random numbers when needed.
     unsigned short mRandState[3];
 
-    // mCacheEntries stores all the cache entries that are resident in memory.
-    // Cache entries are added to it by the 'set' method.
+    // mPolicy is the eviction policy specified in the constructor.
+    const Policy mPolicy;
+
+    // mCacheEntries stores all the cache entries that are resident in memory
+    // when mPolicy is kRandom. Cache entries are added to it by the 'set'
+    // method.
     std::vector<CacheEntry> mCacheEntries;
+
+    // mLruEntries stores all the cache entries when mPolicy is kLru, most
+    // recently used first, and mLruIndex maps their keys to them. The keys in
+    // mLruIndex point at the key data owned by the corresponding entry.
+    std::list<LruEntry> mLruEntries;
+    std::unordered_map<KeyView, std::list<LruEntry>::iterator, KeyViewHash> mLruIndex;
 };
 
 } // namespace android
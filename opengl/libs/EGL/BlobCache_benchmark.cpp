@@ -0,0 +1,120 @@
+/*
+ ** Copyright 2024, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#include "BlobCache.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace android {
+
+// Same limits as the monolithic cache in egl_cache.cpp.
+static const size_t kMaxKeySize = 12 * 1024;
+static const size_t kMaxValueSize = 64 * 1024;
+static const size_t kMaxTotalSize = 2 * 1024 * 1024;
+
+// A synthetic shader cache workload. A few hundred pipelines are used with a
+// Zipf-like popularity, so a small hot set is looked up far more often than
+// the long tail, and their combined size is several times the cache size.
+// Every miss is followed by a set, as the driver would after compiling.
+class Trace {
+public:
+    Trace(size_t numShaders, size_t numLookups) {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<size_t> keySize(16, 256);
+        std::uniform_int_distribution<size_t> valueSize(1024, kMaxValueSize);
+        for (size_t i = 0; i < numShaders; i++) {
+            std::vector<uint8_t> key(keySize(rng));
+            for (size_t b = 0; b < key.size(); b++) {
+                key[b] = uint8_t(rng());
+            }
+            mKeys.push_back(std::move(key));
+            mValueSizes.push_back(valueSize(rng));
+        }
+
+        std::vector<double> weights;
+        for (size_t i = 0; i < numShaders; i++) {
+            weights.push_back(1.0 / std::pow(double(i + 1), 1.1));
+        }
+        std::discrete_distribution<size_t> popularity(weights.begin(), weights.end());
+        for (size_t i = 0; i < numLookups; i++) {
+            mLookups.push_back(popularity(rng));
+        }
+    }
+
+    const std::vector<uint8_t>& key(size_t shader) const { return mKeys[shader]; }
+    size_t valueSize(size_t shader) const { return mValueSizes[shader]; }
+    const std::vector<size_t>& lookups() const { return mLookups; }
+
+private:
+    std::vector<std::vector<uint8_t>> mKeys;
+    std::vector<size_t> mValueSizes;
+    std::vector<size_t> mLookups;
+};
+
+static void BM_trace(benchmark::State& state, BlobCache::Policy policy) {
+    static const Trace trace(512, 20000);
+    std::vector<uint8_t> value(kMaxValueSize, 0xab);
+    size_t hits = 0;
+    size_t lookups = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        BlobCache cache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, policy);
+        state.ResumeTiming();
+        for (size_t shader : trace.lookups()) {
+            const auto& key = trace.key(shader);
+            lookups++;
+            if (cache.get(key.data(), key.size(), value.data(), value.size()) != 0) {
+                hits++;
+            } else {
+                cache.set(key.data(), key.size(), value.data(), trace.valueSize(shader));
+            }
+        }
+    }
+    state.counters["hit_rate"] = double(hits) / double(lookups);
+    state.counters["time_per_lookup"] =
+            benchmark::Counter(double(lookups), benchmark::Counter::kIsRate |
+                                       benchmark::Counter::kInvert);
+}
+
+static void BM_get(benchmark::State& state, BlobCache::Policy policy) {
+    // Lookups in a full cache of small entries, as after loading a saved cache.
+    BlobCache cache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, policy);
+    const size_t numEntries = size_t(state.range(0));
+    std::vector<uint64_t> keys;
+    for (uint64_t i = 0; i < numEntries; i++) {
+        keys.push_back(i * 0x9e3779b97f4a7c15ull);
+        cache.set(&keys.back(), sizeof(uint64_t), "value", 5);
+    }
+    char buf[5];
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+                cache.get(&keys[i++ % numEntries], sizeof(uint64_t), buf, sizeof(buf)));
+    }
+}
+
+BENCHMARK_CAPTURE(BM_trace, random, BlobCache::Policy::kRandom)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_trace, lru, BlobCache::Policy::kLru)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_get, random, BlobCache::Policy::kRandom)->Range(64, 16384);
+BENCHMARK_CAPTURE(BM_get, lru, BlobCache::Policy::kLru)->Range(64, 16384);
+
+} // namespace android
+
+BENCHMARK_MAIN();
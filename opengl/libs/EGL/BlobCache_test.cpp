@@ -21,6 +21,7 @@
 #include <stdio.h>
 
 #include <memory>
+#include <vector>
 
 namespace android {
 
@@ -302,6 +303,132 @@ TEST_F(BlobCacheTest, InvalidValueSize) {
     ASSERT_EQ(BlobCache::InsertResult::kInvalidValueSize, mBC->set("abcd", 4, "", 0));
 }
 
+class BlobCacheLruTest : public BlobCacheTest {
+protected:
+    virtual void SetUp() {
+        mBC.reset(new BlobCache(MAX_KEY_SIZE, MAX_VALUE_SIZE, MAX_TOTAL_SIZE,
+                                BlobCache::Policy::kLru));
+    }
+
+    int countCached(int numKeys) {
+        int numCached = 0;
+        for (int i = 0; i < numKeys; i++) {
+            uint8_t k = i;
+            if (mBC->get(&k, 1, nullptr, 0) != 0) {
+                numCached++;
+            }
+        }
+        return numCached;
+    }
+};
+
+TEST_F(BlobCacheLruTest, CacheSingleValueSucceeds) {
+    unsigned char buf[4] = {0xee, 0xee, 0xee, 0xee};
+    ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set("abcd", 4, "efgh", 4));
+    ASSERT_EQ(size_t(4), mBC->get("abcd", 4, buf, 4));
+    ASSERT_EQ('e', buf[0]);
+    ASSERT_EQ('f', buf[1]);
+    ASSERT_EQ('g', buf[2]);
+    ASSERT_EQ('h', buf[3]);
+}
+
+TEST_F(BlobCacheLruTest, MultipleSetsCacheLatestValue) {
+    unsigned char buf[4] = {0xee, 0xee, 0xee, 0xee};
+    ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set("abcd", 4, "efgh", 4));
+    ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set("abcd", 4, "ijkl", 4));
+    ASSERT_EQ(size_t(4), mBC->get("abcd", 4, buf, 4));
+    ASSERT_EQ('i', buf[0]);
+    ASSERT_EQ('j', buf[1]);
+    ASSERT_EQ('k', buf[2]);
+    ASSERT_EQ('l', buf[3]);
+}
+
+TEST_F(BlobCacheLruTest, CacheSizeDoesntExceedTotalLimit) {
+    for (int i = 0; i < 256; i++) {
+        uint8_t k = i;
+        mBC->set(&k, 1, "x", 1);
+    }
+    ASSERT_GE(MAX_TOTAL_SIZE / 2, countCached(256));
+}
+
+TEST_F(BlobCacheLruTest, ExceedingTotalLimitEvictsOnlyOneEntry) {
+    // Fill up the entire cache with 1 char key/value pairs.
+    const int maxEntries = MAX_TOTAL_SIZE / 2;
+    for (int i = 0; i < maxEntries; i++) {
+        uint8_t k = i;
+        ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set(&k, 1, "x", 1));
+    }
+    // Read the oldest entry so it is no longer the least recently used.
+    {
+        uint8_t k = 0;
+        ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+    }
+    // Insert one more entry, causing a cache overflow.
+    {
+        uint8_t k = maxEntries;
+        ASSERT_EQ(BlobCache::InsertResult::kDidClean, mBC->set(&k, 1, "x", 1));
+    }
+    // Only the least recently used entry was evicted.
+    uint8_t k = 1;
+    ASSERT_EQ(size_t(0), mBC->get(&k, 1, nullptr, 0));
+    ASSERT_EQ(maxEntries, countCached(maxEntries + 1));
+}
+
+TEST_F(BlobCacheLruTest, EvictsLargeColdEntryBeforeSmallHotOnes) {
+    // A large entry that is never read, then small entries that are.
+    ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set("a", 1, "aaaaa", 5));
+    ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set("b", 1, "b", 1));
+    ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set("c", 1, "c", 1));
+    ASSERT_EQ(size_t(1), mBC->get("b", 1, nullptr, 0));
+    ASSERT_EQ(size_t(1), mBC->get("c", 1, nullptr, 0));
+    ASSERT_EQ(size_t(5), mBC->get("a", 1, nullptr, 0));
+
+    // "a" is the most recently used, but has the fewest hits per byte.
+    ASSERT_EQ(BlobCache::InsertResult::kDidClean, mBC->set("d", 1, "ddd", 3));
+    ASSERT_EQ(size_t(0), mBC->get("a", 1, nullptr, 0));
+    ASSERT_EQ(size_t(1), mBC->get("b", 1, nullptr, 0));
+    ASSERT_EQ(size_t(1), mBC->get("c", 1, nullptr, 0));
+    ASSERT_EQ(size_t(3), mBC->get("d", 1, nullptr, 0));
+}
+
+TEST_F(BlobCacheLruTest, UpdateEvictsOtherEntriesToFit) {
+    ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set("x", 1, "y", 1));
+    ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set("abcd", 4, "e", 1));
+    ASSERT_EQ(BlobCache::InsertResult::kDidClean, mBC->set("abcd", 4, "efghijkl", 8));
+    ASSERT_EQ(size_t(0), mBC->get("x", 1, nullptr, 0));
+    ASSERT_EQ(size_t(8), mBC->get("abcd", 4, nullptr, 0));
+}
+
+TEST_F(BlobCacheLruTest, FlattenPreservesRecencyOrder) {
+    std::unique_ptr<BlobCache> other(
+            new BlobCache(MAX_KEY_SIZE, MAX_VALUE_SIZE, MAX_TOTAL_SIZE, BlobCache::Policy::kLru));
+    const int maxEntries = MAX_TOTAL_SIZE / 2;
+    for (int i = 0; i < maxEntries; i++) {
+        uint8_t k = i;
+        ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set(&k, 1, "x", 1));
+    }
+    // Touch every entry but the last, in reverse, so the last inserted entry is
+    // now the least recently used.
+    for (int i = maxEntries - 2; i >= 0; i--) {
+        uint8_t k = i;
+        ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+    }
+
+    size_t size = mBC->getFlattenedSize();
+    std::vector<uint8_t> flat(size);
+    ASSERT_EQ(OK, mBC->flatten(flat.data(), size));
+    ASSERT_EQ(OK, other->unflatten(flat.data(), size));
+
+    uint8_t k = maxEntries;
+    ASSERT_EQ(BlobCache::InsertResult::kDidClean, other->set(&k, 1, "x", 1));
+    k = maxEntries - 1;
+    ASSERT_EQ(size_t(0), other->get(&k, 1, nullptr, 0));
+    for (int i = 0; i < maxEntries - 1; i++) {
+        k = i;
+        ASSERT_EQ(size_t(1), other->get(&k, 1, nullptr, 0));
+    }
+}
+
 class BlobCacheFlattenTest : public BlobCacheTest {
 protected:
     virtual void SetUp() {
@@ -51,8 +51,8 @@ uint32_t crc32c(const uint8_t* buf, size_t len) {
 }
 
 FileBlobCache::FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize,
-        const std::string& filename)
-        : BlobCache(maxKeySize, maxValueSize, maxTotalSize)
+        const std::string& filename, Policy policy)
+        : BlobCache(maxKeySize, maxValueSize, maxTotalSize, policy)
         , mFilename(filename) {
     ATRACE_CALL();
 
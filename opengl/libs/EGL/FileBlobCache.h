@@ -29,7 +29,7 @@ public:
     // FileBlobCache attempts to load the saved cache contents from disk into
     // BlobCache.
     FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize,
-            const std::string& filename);
+            const std::string& filename, Policy policy = Policy::kRandom);
 
     // writeToFile attempts to save the current contents of BlobCache to
     // disk.
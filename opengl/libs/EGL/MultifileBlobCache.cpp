@@ -35,6 +35,7 @@
 #include <chrono>
 #include <limits>
 #include <locale>
+#include <vector>
 
 #include <utils/JenkinsHash.h>
 
@@ -63,7 +64,8 @@ void freeHotCacheEntry(android::MultifileHotCache& entry) {
 namespace android {
 
 MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize,
-                                       size_t maxTotalEntries, const std::string& baseDir)
+                                       size_t maxTotalEntries, const std::string& baseDir,
+                                       bool keepEntriesMapped)
       : mInitialized(false),
         mCacheVersion(0),
         mMaxKeySize(maxKeySize),
@@ -74,6 +76,9 @@ MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, s
         mTotalCacheEntries(0),
         mHotCacheLimit(0),
         mHotCacheSize(0),
+        mKeepEntriesMapped(keepEntriesMapped),
+        mMappedSize(0),
+        mMappedSizeLimit(maxTotalSize / 4),
         mWorkerThreadIdle(true) {
     if (baseDir.empty()) {
         ALOGV("INIT: no baseDir provided in MultifileBlobCache constructor, returning early.");
@@ -244,8 +249,9 @@ MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, s
                 // Track the total size
                 increaseTotalCacheSize(fileSize);
 
-                // Preload the entry for fast retrieval
-                if ((mHotCacheSize + fileSize) < mHotCacheLimit) {
+                // Preload the entry for fast retrieval. Kept mappings are only made once an entry
+                // is used.
+                if (!mKeepEntriesMapped && (mHotCacheSize + fileSize) < mHotCacheLimit) {
                     ALOGV("INIT: Populating hot cache with fd = %i, cacheEntry = %p for "
                           "entryHash %u",
                           fd, mappedEntry, entryHash);
@@ -348,6 +354,13 @@ void MultifileBlobCache::set(const void* key, EGLsizeiANDROID keySize, const voi
     // Update the overall cache size
     increaseTotalCacheSize(fileSize);
 
+    // A kept mapping of the previous value would otherwise be replaced without being unmapped.
+    // Kept mappings are never used by pending writes, so this does not wait for them.
+    if (auto hotCacheIter = mHotCache.find(entryHash);
+        hotCacheIter != mHotCache.end() && isKeptMapped(hotCacheIter->second)) {
+        removeFromHotCache(entryHash);
+    }
+
     // Keep the entry in hot cache for quick retrieval
     ALOGV("SET: Adding %u to hot cache.", entryHash);
 
@@ -410,6 +423,11 @@ EGLsizeiANDROID MultifileBlobCache::get(const void* key, EGLsizeiANDROID keySize
     // We have the file and have enough room to write it out, return the entry
     ALOGV("GET: Cache HIT - cache contains entry: %u", entryHash);
 
+    // Kept mappings are trimmed by their last access
+    if (mKeepEntriesMapped) {
+        mEntryStats[entryHash].accessTime = time(0);
+    }
+
     // Look up the size of the file
     size_t fileSize = entryStats.fileSize;
     if (keySize > fileSize) {
@@ -425,9 +443,9 @@ EGLsizeiANDROID MultifileBlobCache::get(const void* key, EGLsizeiANDROID keySize
     uint8_t* cacheEntry = 0;
 
     // Check hot cache
-    if (mHotCache.find(entryHash) != mHotCache.end()) {
+    if (auto hotCacheIter = mHotCache.find(entryHash); hotCacheIter != mHotCache.end()) {
         ALOGV("GET: HotCache HIT for entry %u", entryHash);
-        cacheEntry = mHotCache[entryHash].entryBuffer;
+        cacheEntry = hotCacheIter->second.entryBuffer;
     } else {
         ALOGV("GET: HotCache MISS for entry: %u", entryHash);
 
@@ -654,6 +672,17 @@ bool MultifileBlobCache::addToHotCache(uint32_t newEntryHash, int newFd, uint8_t
                                        size_t newEntrySize) {
     ALOGV("HOTCACHE(ADD): Adding %u to hot cache", newEntryHash);
 
+    // Mappings that are kept have their own limit
+    if (mKeepEntriesMapped && newFd != -1) {
+        if (mMappedSize + newEntrySize > mMappedSizeLimit) {
+            trimMappedEntries(newEntrySize);
+        }
+        mHotCache[newEntryHash] = {newFd, newEntryBuffer, newEntrySize};
+        mMappedSize += newEntrySize;
+        ALOGV("HOTCACHE(ADD): New mapped size: %zu", mMappedSize);
+        return true;
+    }
+
     // Clear space if we need to
     if ((mHotCacheSize + newEntrySize) > mHotCacheLimit) {
         ALOGV("HOTCACHE(ADD): mHotCacheSize (%zu) + newEntrySize (%zu) is to big for "
@@ -672,6 +701,12 @@ bool MultifileBlobCache::addToHotCache(uint32_t newEntryHash, int newFd, uint8_t
 
             // Move our iterator before deleting the entry
             hotCacheIter++;
+
+            // Removing a kept mapping would not free any space
+            if (isKeptMapped(oldEntry)) {
+                continue;
+            }
+
             if (!removeFromHotCache(oldEntryHash)) {
                 ALOGE("HOTCACHE(ADD): Unable to remove entry %u", oldEntryHash);
                 return false;
@@ -698,16 +733,24 @@ bool MultifileBlobCache::removeFromHotCache(uint32_t entryHash) {
     if (mHotCache.find(entryHash) != mHotCache.end()) {
         ALOGV("HOTCACHE(REMOVE): Removing %u from hot cache", entryHash);
 
-        // Wait for all the files to complete writing so our hot cache is accurate
-        ALOGV("HOTCACHE(REMOVE): Waiting for work to complete for %u", entryHash);
-        waitForWorkComplete();
+        MultifileHotCache entry = mHotCache[entryHash];
+
+        // Wait for all the files to complete writing so our hot cache is accurate. Kept mappings
+        // were read from files that are already written, so there is nothing to wait for.
+        if (!isKeptMapped(entry)) {
+            ALOGV("HOTCACHE(REMOVE): Waiting for work to complete for %u", entryHash);
+            waitForWorkComplete();
+        }
 
         ALOGV("HOTCACHE(REMOVE): Closing hot cache entry for %u", entryHash);
-        MultifileHotCache entry = mHotCache[entryHash];
         freeHotCacheEntry(entry);
 
         // Delete the entry from our tracking
-        mHotCacheSize -= entry.entrySize;
+        if (isKeptMapped(entry)) {
+            mMappedSize -= entry.entrySize;
+        } else {
+            mHotCacheSize -= entry.entrySize;
+        }
         mHotCache.erase(entryHash);
 
         return true;
@@ -716,6 +759,34 @@ bool MultifileBlobCache::removeFromHotCache(uint32_t entryHash) {
     return false;
 }
 
+bool MultifileBlobCache::isKeptMapped(const MultifileHotCache& entry) const {
+    return mKeepEntriesMapped && entry.entryFd != -1;
+}
+
+void MultifileBlobCache::trimMappedEntries(size_t newEntrySize) {
+    ALOGV("HOTCACHE(TRIM): mMappedSize (%zu) + newEntrySize (%zu) is too big for "
+          "mMappedSizeLimit (%zu)",
+          mMappedSize, newEntrySize, mMappedSizeLimit);
+
+    // Collect the kept mappings, heap copies are bounded by the hot cache limit
+    std::vector<std::pair<time_t, uint32_t>> mappedEntries;
+    for (const auto& [entryHash, entry] : mHotCache) {
+        if (isKeptMapped(entry)) {
+            mappedEntries.emplace_back(getEntryStats(entryHash).accessTime, entryHash);
+        }
+    }
+
+    // Unmap the least recently used entries until at least half the limit is free
+    std::sort(mappedEntries.begin(), mappedEntries.end());
+    for (const auto& [accessTime, entryHash] : mappedEntries) {
+        removeFromHotCache(entryHash);
+        if (mMappedSize + newEntrySize <= mMappedSizeLimit / 2) {
+            ALOGV("HOTCACHE(TRIM): Unmapped enough for %zu", mMappedSize);
+            break;
+        }
+    }
+}
+
 bool MultifileBlobCache::applyLRU(size_t cacheSizeLimit, size_t cacheEntryLimit) {
     // Walk through our map of sorted last access times and remove files until under the limit
     for (auto cacheEntryIter = mEntryStats.begin(); cacheEntryIter != mEntryStats.end();) {
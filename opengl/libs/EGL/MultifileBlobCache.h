@@ -102,8 +102,14 @@ private:
 
 class MultifileBlobCache {
 public:
+    // If keepEntriesMapped is set, entries that get() reads from disk stay mapped read-only, and
+    // later lookups copy straight out of the mapping. Those mappings are backed by the page cache,
+    // so they do not count against the hot cache limit, which then only bounds the heap copies
+    // made by set() before their writes complete. They are bounded by a quarter of the total cache
+    // size instead.
     MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize,
-                       size_t maxTotalEntries, const std::string& baseDir);
+                       size_t maxTotalEntries, const std::string& baseDir,
+                       bool keepEntriesMapped = false);
     ~MultifileBlobCache();
 
     void set(const void* key, EGLsizeiANDROID keySize, const void* value,
@@ -115,6 +121,9 @@ public:
 
     size_t getTotalSize() const { return mTotalCacheSize; }
     size_t getTotalEntries() const { return mTotalCacheEntries; }
+    size_t getHotCacheSize() const { return mHotCacheSize; }
+    size_t getMappedSize() const { return mMappedSize; }
+    size_t getMappedSizeLimit() const { return mMappedSizeLimit; }
 
     const std::string& getCurrentBuildId() const { return mBuildId; }
     void setCurrentBuildId(const std::string& buildId) { mBuildId = buildId; }
@@ -140,6 +149,8 @@ private:
 
     bool addToHotCache(uint32_t entryHash, int fd, uint8_t* entryBufer, size_t entrySize);
     bool removeFromHotCache(uint32_t entryHash);
+    bool isKeptMapped(const MultifileHotCache& entry) const;
+    void trimMappedEntries(size_t newEntrySize);
 
     bool clearCache();
     void trimCache();
@@ -165,6 +176,11 @@ private:
     size_t mHotCacheEntryLimit;
     size_t mHotCacheSize;
 
+    // Whether mapped entries stay in mHotCache, their combined size, and its limit
+    bool mKeepEntriesMapped;
+    size_t mMappedSize;
+    size_t mMappedSizeLimit;
+
     // Below are the components used for deferred writes
 
     // Track whether we have pending writes for an entry
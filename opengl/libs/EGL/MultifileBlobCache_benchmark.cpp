@@ -0,0 +1,111 @@
+/*
+ ** Copyright 2024, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#include "MultifileBlobCache.h"
+
+#include <android-base/file.h>
+#include <benchmark/benchmark.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <memory>
+#include <vector>
+
+namespace android {
+
+// Same limits as the multifile cache in egl_cache.cpp.
+static const size_t kMaxKeySize = 1024;
+static const size_t kMaxValueSize = 2 * 1024 * 1024;
+static const size_t kMaxTotalSize = 32 * 1024 * 1024;
+static const size_t kMaxTotalEntries = 4096;
+
+// Resident set size of the process, from /proc/self/statm.
+static size_t getResidentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t totalPages = 0;
+    size_t residentPages = 0;
+    statm >> totalPages >> residentPages;
+    return residentPages * size_t(sysconf(_SC_PAGESIZE));
+}
+
+// A cache directory written once and shared by every run, so that each run measures loading a
+// cache saved by a previous process, as after an app restart.
+class SavedCache {
+public:
+    SavedCache(size_t numEntries, size_t valueSize) {
+        std::vector<uint8_t> value(valueSize, 0xab);
+        MultifileBlobCache cache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, kMaxTotalEntries,
+                                 path());
+        for (uint32_t i = 0; i < numEntries; i++) {
+            cache.set(&i, sizeof(i), value.data(), value.size());
+        }
+        cache.finish();
+    }
+
+    const char* path() const { return mTempFile.path; }
+
+private:
+    TemporaryFile mTempFile;
+};
+
+// Loads the saved cache and looks up every entry once. Without keepEntriesMapped only a single
+// maximum sized entry stays in the hot cache, so most lookups open and map their file again.
+static void BM_loadAndGetAll(benchmark::State& state, bool keepEntriesMapped) {
+    const size_t numEntries = size_t(state.range(0));
+    const size_t valueSize = 16 * 1024;
+    static const SavedCache savedCache(1024, valueSize);
+    std::vector<uint8_t> value(valueSize);
+    size_t residentGrowth = 0;
+    for (auto _ : state) {
+        const size_t residentBefore = getResidentBytes();
+        auto cache = std::make_unique<MultifileBlobCache>(kMaxKeySize, kMaxValueSize,
+                                                          kMaxTotalSize, kMaxTotalEntries,
+                                                          savedCache.path(), keepEntriesMapped);
+        for (uint32_t i = 0; i < numEntries; i++) {
+            benchmark::DoNotOptimize(cache->get(&i, sizeof(i), value.data(), value.size()));
+        }
+        residentGrowth = getResidentBytes() - residentBefore;
+        state.PauseTiming();
+        cache->finish();
+        cache.reset();
+        state.ResumeTiming();
+    }
+    state.counters["resident_growth_kb"] = double(residentGrowth) / 1024;
+}
+
+// Repeated lookups of a working set that is larger than the hot cache limit.
+static void BM_getWorkingSet(benchmark::State& state, bool keepEntriesMapped) {
+    const size_t numEntries = size_t(state.range(0));
+    const size_t valueSize = 16 * 1024;
+    static const SavedCache savedCache(1024, valueSize);
+    MultifileBlobCache cache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, kMaxTotalEntries,
+                             savedCache.path(), keepEntriesMapped);
+    std::vector<uint8_t> value(valueSize);
+    uint32_t i = 0;
+    for (auto _ : state) {
+        const uint32_t key = i++ % numEntries;
+        benchmark::DoNotOptimize(cache.get(&key, sizeof(key), value.data(), value.size()));
+    }
+    state.counters["mapped_kb"] = double(cache.getMappedSize()) / 1024;
+    cache.finish();
+}
+
+BENCHMARK_CAPTURE(BM_loadAndGetAll, copy, false)->Range(64, 1024)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_loadAndGetAll, mapped, true)->Range(64, 1024)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_getWorkingSet, copy, false)->Range(64, 1024);
+BENCHMARK_CAPTURE(BM_getWorkingSet, mapped, true)->Range(64, 1024);
+
+} // namespace android
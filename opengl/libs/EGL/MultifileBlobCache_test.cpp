@@ -24,6 +24,7 @@
 
 #include <fstream>
 #include <memory>
+#include <vector>
 
 using namespace std::literals;
 
@@ -307,6 +308,53 @@ TEST_F(MultifileBlobCacheTest, EnsureFileDescriptorsClosed) {
     ASSERT_LT(getFileDescriptorCount(), kMaxTotalEntries / 2);
 }
 
+TEST_F(MultifileBlobCacheTest, KeepEntriesMappedMapsEntriesLazilyWithinLimit) {
+    // Use enough data that the entries don't all fit in the mapped size limit
+    constexpr int kEntryCount = 16;
+    std::vector<uint8_t> value(1024);
+    for (int i = 0; i < kEntryCount; i++) {
+        value[0] = static_cast<uint8_t>(i);
+        mMBC->set(&i, sizeof(i), value.data(), value.size());
+    }
+
+    // Close the cache so everything writes out
+    mMBC->finish();
+    mMBC.reset();
+
+    // Open it again, keeping the entries mapped
+    mMBC.reset(new MultifileBlobCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, kMaxTotalEntries,
+                                      &mTempFile->path[0], /*keepEntriesMapped=*/true));
+
+    // Nothing is mapped until it is used
+    ASSERT_EQ(size_t(0), mMBC->getMappedSize());
+    ASSERT_EQ(size_t(0), mMBC->getHotCacheSize());
+    ASSERT_LT(mMBC->getMappedSizeLimit(), mMBC->getTotalSize());
+
+    // Every entry can be read, and the mappings stay within their limit
+    std::vector<uint8_t> result(value.size());
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < kEntryCount; i++) {
+            ASSERT_EQ(value.size(), mMBC->get(&i, sizeof(i), result.data(), result.size()));
+            ASSERT_EQ(static_cast<uint8_t>(i), result[0]);
+            ASSERT_GT(mMBC->getMappedSize(), size_t(0));
+            ASSERT_LE(mMBC->getMappedSize(), mMBC->getMappedSizeLimit());
+            ASSERT_EQ(size_t(0), mMBC->getHotCacheSize());
+        }
+    }
+
+    // Mappings don't hold on to their fds
+    ASSERT_LT(getFileDescriptorCount(), kMaxTotalEntries / 2);
+
+    // Replacing an entry releases its mapping
+    int key = kEntryCount - 1;
+    const size_t mappedSize = mMBC->getMappedSize();
+    value[0] = 0xff;
+    mMBC->set(&key, sizeof(key), value.data(), value.size());
+    ASSERT_LT(mMBC->getMappedSize(), mappedSize);
+    ASSERT_EQ(value.size(), mMBC->get(&key, sizeof(key), result.data(), result.size()));
+    ASSERT_EQ(0xff, result[0]);
+}
+
 std::vector<std::string> MultifileBlobCacheTest::getCacheEntries() {
     std::string cachePath = &mTempFile->path[0];
     std::string multifileDirName = cachePath + ".multifile";
@@ -268,17 +268,23 @@ void egl_cache_t::updateMode() {
 
 BlobCache* egl_cache_t::getBlobCacheLocked() {
     if (mBlobCache == nullptr) {
+        const BlobCache::Policy policy = base::GetBoolProperty("ro.egl.blobcache.lru", false)
+                ? BlobCache::Policy::kLru
+                : BlobCache::Policy::kRandom;
         mBlobCache.reset(new FileBlobCache(kMaxMonolithicKeySize, kMaxMonolithicValueSize,
-                                           mCacheByteLimit, mFilename));
+                                           mCacheByteLimit, mFilename, policy));
     }
     return mBlobCache.get();
 }
 
 MultifileBlobCache* egl_cache_t::getMultifileBlobCacheLocked() {
     if (mMultifileBlobCache == nullptr) {
+        const bool keepEntriesMapped =
+                base::GetBoolProperty("ro.egl.blobcache.multifile_mmap", false);
         mMultifileBlobCache.reset(new MultifileBlobCache(kMaxMultifileKeySize,
                                                          kMaxMultifileValueSize, mCacheByteLimit,
-                                                         kMaxMultifileTotalEntries, mFilename));
+                                                         kMaxMultifileTotalEntries, mFilename,
+                                                         keepEntriesMapped));
     }
     return mMultifileBlobCache.get();
 }
@@ -16,10 +16,15 @@
 
 #include <benchmark/benchmark.h>
 
+#include <algorithm>
+#include <thread>
+
 #include <android/os/IInputConstants.h>
 #include <binder/Binder.h>
 #include <gui/constants.h>
 #include "../dispatcher/InputDispatcher.h"
+#include "../dispatcher/trace/InputTracingPerfettoBackend.h"
+#include "../dispatcher/trace/ThreadedBackend.h"
 #include "../tests/FakeApplicationHandle.h"
 #include "../tests/FakeInputDispatcherPolicy.h"
 #include "../tests/FakeWindowHandle.h"
@@ -39,6 +44,7 @@ constexpr DeviceId DEVICE_ID = 1;
 
 // An arbitrary display id
 constexpr int32_t DISPLAY_ID = ADISPLAY_ID_DEFAULT;
+constexpr int32_t SECOND_DISPLAY_ID = DISPLAY_ID + 1;
 
 static constexpr std::chrono::duration INJECT_EVENT_TIMEOUT = 5s;
 
@@ -74,6 +80,12 @@ static MotionEvent generateMotionEvent() {
     return event;
 }
 
+// The backend that the dispatcher uses when input tracing is enabled on the device.
+static std::unique_ptr<trace::InputTracingBackendInterface> createTracingBackend() {
+    return std::make_unique<trace::impl::ThreadedBackend<trace::impl::PerfettoBackend>>(
+            trace::impl::PerfettoBackend());
+}
+
 static NotifyMotionArgs generateMotionArgs() {
     PointerProperties pointerProperties[1];
     PointerCoords pointerCoords[1];
@@ -101,10 +113,8 @@ static NotifyMotionArgs generateMotionArgs() {
     return args;
 }
 
-static void benchmarkNotifyMotion(benchmark::State& state) {
-    // Create dispatcher
-    FakeInputDispatcherPolicy fakePolicy;
-    InputDispatcher dispatcher(fakePolicy);
+// Sends taps to a window through the given dispatcher.
+static void dispatchTaps(benchmark::State& state, InputDispatcher& dispatcher) {
     dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
     dispatcher.start();
 
@@ -136,6 +146,23 @@ static void benchmarkNotifyMotion(benchmark::State& state) {
     dispatcher.stop();
 }
 
+static void benchmarkNotifyMotion(benchmark::State& state) {
+    // Create dispatcher
+    FakeInputDispatcherPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy);
+    dispatchTaps(state, dispatcher);
+}
+
+/**
+ * Same as benchmarkNotifyMotion, with input tracing enabled, so that the overhead of tracing on
+ * the dispatch latency can be compared.
+ */
+static void benchmarkNotifyMotionWithTracing(benchmark::State& state) {
+    FakeInputDispatcherPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy, createTracingBackend());
+    dispatchTaps(state, dispatcher);
+}
+
 static void benchmarkInjectMotion(benchmark::State& state) {
     // Create dispatcher
     FakeInputDispatcherPolicy fakePolicy;
@@ -170,6 +197,149 @@ static void benchmarkInjectMotion(benchmark::State& state) {
     dispatcher.stop();
 }
 
+/**
+ * Measures the dispatch of a backlog of taps to a window which only reads them once they were all
+ * sent, as when the application is busy. The events which do not fit into the channel wait in
+ * the outbound queue of the connection, and are sent together once the application catches up.
+ */
+static void benchmarkDispatchBacklog(benchmark::State& state) {
+    const int64_t tapCount = state.range(0);
+
+    // Create dispatcher
+    FakeInputDispatcherPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy);
+    dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher.start();
+
+    // Create a window that will receive motion events
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    sp<FakeWindowHandle> window =
+            sp<FakeWindowHandle>::make(application, dispatcher, "Fake Window", DISPLAY_ID);
+
+    dispatcher.onWindowInfosChanged({{*window->getInfo()}, {}, 0, 0});
+
+    NotifyMotionArgs motionArgs = generateMotionArgs();
+
+    for (auto _ : state) {
+        // Taps rather than moves, so that the window does not batch them.
+        for (int64_t i = 0; i < tapCount; i++) {
+            motionArgs.action = AMOTION_EVENT_ACTION_DOWN;
+            motionArgs.downTime = now();
+            motionArgs.eventTime = motionArgs.downTime;
+            dispatcher.notifyMotion(motionArgs);
+
+            motionArgs.action = AMOTION_EVENT_ACTION_UP;
+            motionArgs.eventTime = now();
+            dispatcher.notifyMotion(motionArgs);
+        }
+
+        for (int64_t i = 0; i < 2 * tapCount; i++) {
+            window->consumeMotion();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * 2 * tapCount);
+
+    dispatcher.stop();
+}
+
+// How long the dispatcher waits for the events of a slow window before it sends a key anyway.
+static constexpr std::chrono::duration KEY_WAITING_FOR_SLOW_WINDOW_TIMEOUT = 5ms;
+
+class SlowWindowPolicy : public FakeInputDispatcherPolicy {
+public:
+    std::chrono::nanoseconds getKeyWaitingForEventsTimeout() override {
+        return KEY_WAITING_FOR_SLOW_WINDOW_TIMEOUT;
+    }
+};
+
+static nsecs_t getPercentile(std::vector<nsecs_t>& values, double percentile) {
+    if (values.empty()) {
+        return 0;
+    }
+    const size_t index =
+            std::min(values.size() - 1, static_cast<size_t>(values.size() * percentile));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+/**
+ * Measures the latency of a touch on one display, while keystrokes wait for a slow window on
+ * another display. The slow window is focused and never reads its events, so the dispatcher waits
+ * for it before it sends each key. The argument selects whether per-display dispatch is enabled,
+ * which lets the touch go ahead of the keys.
+ */
+static void benchmarkTouchLatencyWithSlowDisplay(benchmark::State& state) {
+    // Create dispatcher
+    SlowWindowPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy);
+    dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher.setPerDisplayDispatchEnabled(state.range(0));
+    dispatcher.start();
+
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    sp<FakeWindowHandle> window =
+            sp<FakeWindowHandle>::make(application, dispatcher, "Fake Window", DISPLAY_ID);
+    std::shared_ptr<FakeApplicationHandle> slowApplication =
+            std::make_shared<FakeApplicationHandle>();
+    sp<FakeWindowHandle> slowWindow = sp<FakeWindowHandle>::make(slowApplication, dispatcher,
+                                                                 "Slow Window", SECOND_DISPLAY_ID);
+    // Keep the slow window from becoming unresponsive, so that the dispatcher keeps waiting for it.
+    slowWindow->setDispatchingTimeout(std::chrono::hours(1));
+    slowWindow->setFocusable(true);
+
+    dispatcher.onWindowInfosChanged({{*window->getInfo(), *slowWindow->getInfo()}, {}, 0, 0});
+    dispatcher.setFocusedApplication(SECOND_DISPLAY_ID, slowApplication);
+    gui::FocusRequest request;
+    request.token = slowWindow->getToken();
+    request.windowName = slowWindow->getName();
+    request.timestamp = now();
+    request.displayId = SECOND_DISPLAY_ID;
+    dispatcher.setFocusedWindow(request);
+
+    // Start a gesture on the window, which every iteration continues.
+    NotifyMotionArgs motionArgs = generateMotionArgs();
+    dispatcher.notifyMotion(motionArgs);
+    window->consumeMotion();
+
+    // Touch the slow window from another device, which it never reads.
+    NotifyMotionArgs slowMotionArgs = generateMotionArgs();
+    slowMotionArgs.deviceId = DEVICE_ID + 1;
+    slowMotionArgs.displayId = SECOND_DISPLAY_ID;
+    dispatcher.notifyMotion(slowMotionArgs);
+
+    const nsecs_t keyDownTime = now();
+    NotifyKeyArgs keyArgs(IInputConstants::INVALID_INPUT_EVENT_ID, keyDownTime, keyDownTime,
+                          DEVICE_ID + 2, AINPUT_SOURCE_KEYBOARD, SECOND_DISPLAY_ID,
+                          POLICY_FLAG_PASS_TO_USER | POLICY_FLAG_DISABLE_KEY_REPEAT,
+                          AKEY_EVENT_ACTION_DOWN, /* flags */ 0, AKEYCODE_A, /* scanCode */ 0,
+                          AMETA_NONE, keyDownTime);
+
+    std::vector<nsecs_t> latencies;
+    motionArgs.action = AMOTION_EVENT_ACTION_MOVE;
+    for (auto _ : state) {
+        keyArgs.action = AKEY_EVENT_ACTION_DOWN;
+        keyArgs.downTime = now();
+        keyArgs.eventTime = keyArgs.downTime;
+        dispatcher.notifyKey(keyArgs);
+        keyArgs.action = AKEY_EVENT_ACTION_UP;
+        keyArgs.eventTime = now();
+        dispatcher.notifyKey(keyArgs);
+
+        motionArgs.eventTime = now();
+        dispatcher.notifyMotion(motionArgs);
+        window->consumeMotion();
+        const nsecs_t latency = now() - motionArgs.eventTime;
+        latencies.push_back(latency);
+        state.SetIterationTime(latency / 1E9);
+
+        // Let the keys reach the slow window before the next keystroke.
+        std::this_thread::sleep_for(3 * KEY_WAITING_FOR_SLOW_WINDOW_TIMEOUT);
+    }
+    state.counters["p99_latency_ns"] = getPercentile(latencies, 0.99);
+
+    dispatcher.stop();
+}
+
 static void benchmarkOnWindowInfosChanged(benchmark::State& state) {
     // Create dispatcher
     FakeInputDispatcherPolicy fakePolicy;
@@ -196,11 +366,151 @@ static void benchmarkOnWindowInfosChanged(benchmark::State& state) {
     dispatcher.stop();
 }
 
+/**
+ * Measures the dispatch of a touch on a display with the given number of windows. The touched
+ * window covers the display, behind a grid of small windows which do not contain the touch, so
+ * that the hit test has to pass over all of them.
+ */
+static void benchmarkHitTest(benchmark::State& state) {
+    const int32_t windowCount = static_cast<int32_t>(state.range(0));
+
+    // Create dispatcher
+    FakeInputDispatcherPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy);
+    dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher.start();
+
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    sp<FakeWindowHandle> window =
+            sp<FakeWindowHandle>::make(application, dispatcher, "Fake Window", DISPLAY_ID);
+    window->setFrame(Rect(0, 0, 1080, 2400));
+
+    // The other windows have no input channel, so that there is no need to create hundreds of
+    // them. They are laid out in 40x40 tiles below the touch at (100, 100).
+    std::vector<gui::WindowInfo> windowInfos;
+    for (int32_t i = 0; i < windowCount - 1; i++) {
+        gui::WindowInfo info = *window->getInfo();
+        info.token = nullptr;
+        info.id = window->getInfo()->id + 1 + i;
+        info.name = "Tile " + std::to_string(i);
+        info.setInputConfig(WindowInfo::InputConfig::NO_INPUT_CHANNEL, true);
+        const int32_t left = (i % 27) * 40;
+        const int32_t top = 200 + (i / 27) * 40;
+        info.frame = Rect(left, top, left + 40, top + 40);
+        info.touchableRegion = Region(info.frame);
+        windowInfos.push_back(info);
+    }
+    windowInfos.push_back(*window->getInfo());
+
+    gui::DisplayInfo displayInfo;
+    displayInfo.displayId = DISPLAY_ID;
+    dispatcher.onWindowInfosChanged(
+            {windowInfos, {displayInfo}, /*vsyncId=*/0, /*timestamp=*/0});
+
+    NotifyMotionArgs motionArgs = generateMotionArgs();
+
+    for (auto _ : state) {
+        // Send ACTION_DOWN
+        motionArgs.action = AMOTION_EVENT_ACTION_DOWN;
+        motionArgs.downTime = now();
+        motionArgs.eventTime = motionArgs.downTime;
+        dispatcher.notifyMotion(motionArgs);
+
+        // Send ACTION_UP
+        motionArgs.action = AMOTION_EVENT_ACTION_UP;
+        motionArgs.eventTime = now();
+        dispatcher.notifyMotion(motionArgs);
+
+        window->consumeMotion();
+        window->consumeMotion();
+    }
+
+    dispatcher.stop();
+}
+
+/**
+ * Measures window updates which move one window, on a device with four displays showing the given
+ * number of windows each. With the second argument set, the updates take the path of a delta from
+ * SurfaceFlinger: the delta is made from the previous update and applied back to it, and the
+ * dispatcher only sets the windows of the display which changed.
+ */
+static void benchmarkOnWindowInfosChangedByOneWindow(benchmark::State& state) {
+    const int32_t windowCount = static_cast<int32_t>(state.range(0));
+    const bool sendDeltas = state.range(1) != 0;
+    constexpr int32_t DISPLAY_COUNT = 4;
+
+    // Create dispatcher
+    FakeInputDispatcherPolicy fakePolicy;
+    InputDispatcher dispatcher(fakePolicy);
+    dispatcher.setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher.start();
+
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    sp<FakeWindowHandle> window =
+            sp<FakeWindowHandle>::make(application, dispatcher, "Fake Window", DISPLAY_ID);
+
+    // As in benchmarkHitTest, the windows have no input channel.
+    gui::WindowInfosUpdate update;
+    for (int32_t display = 0; display < DISPLAY_COUNT; display++) {
+        gui::DisplayInfo displayInfo;
+        displayInfo.displayId = DISPLAY_ID + display;
+        update.displayInfos.push_back(displayInfo);
+        for (int32_t i = 0; i < windowCount; i++) {
+            gui::WindowInfo info = *window->getInfo();
+            info.token = nullptr;
+            info.id = window->getInfo()->id + 1 + display * windowCount + i;
+            info.displayId = DISPLAY_ID + display;
+            info.name = "Window " + std::to_string(info.id);
+            info.setInputConfig(WindowInfo::InputConfig::NO_INPUT_CHANNEL, true);
+            info.frame = Rect(0, i * 10, 1080, i * 10 + 100);
+            info.touchableRegion = Region(info.frame);
+            update.windowInfos.push_back(info);
+        }
+    }
+    update.vsyncId = 0;
+    update.timestamp = 0;
+    dispatcher.onWindowInfosChanged(update);
+
+    for (auto _ : state) {
+        gui::WindowInfosUpdate next = update;
+        next.sequence = update.sequence + 1;
+        next.vsyncId = update.vsyncId + 1;
+        gui::WindowInfo& moved = next.windowInfos[0];
+        moved.frame.offsetBy(0, next.vsyncId % 2 == 0 ? -1 : 1);
+        moved.touchableRegion = Region(moved.frame);
+
+        if (sendDeltas) {
+            std::optional<gui::WindowInfosUpdate> delta = next.makeDelta(update);
+            std::optional<gui::WindowInfosUpdate> snapshot =
+                    delta->applyDelta(update.windowInfos);
+            dispatcher.onWindowInfosChanged(*snapshot);
+        } else {
+            dispatcher.onWindowInfosChanged(next);
+        }
+        update = std::move(next);
+    }
+
+    dispatcher.stop();
+}
+
 } // namespace
 
 BENCHMARK(benchmarkNotifyMotion);
+BENCHMARK(benchmarkNotifyMotionWithTracing);
 BENCHMARK(benchmarkInjectMotion);
+BENCHMARK(benchmarkDispatchBacklog)->Arg(16)->Arg(64);
+BENCHMARK(benchmarkTouchLatencyWithSlowDisplay)
+        ->Arg(false)
+        ->Arg(true)
+        ->UseManualTime()
+        ->Iterations(200);
 BENCHMARK(benchmarkOnWindowInfosChanged);
+BENCHMARK(benchmarkOnWindowInfosChangedByOneWindow)
+        ->Args({10, false})
+        ->Args({10, true})
+        ->Args({100, false})
+        ->Args({100, true});
+BENCHMARK(benchmarkHitTest)->Arg(10)->Arg(100)->Arg(500);
 
 } // namespace android::inputdispatcher
 
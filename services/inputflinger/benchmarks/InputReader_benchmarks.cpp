@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <linux/input-event-codes.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <InputReader.h>
+#include "../tests/FakeEventHub.h"
+#include "../tests/FakeInputReaderPolicy.h"
+
+namespace android {
+
+namespace {
+
+// An arbitrary device id.
+constexpr int32_t EVENTHUB_ID = 1;
+
+static nsecs_t now() {
+    return systemTime(SYSTEM_TIME_MONOTONIC);
+}
+
+// Exposes loopOnce so that the benchmark can drive the reader without its thread.
+class BenchmarkInputReader : public InputReader {
+public:
+    using InputReader::InputReader;
+    using InputReader::loopOnce;
+};
+
+// Records how long each key took to get from the event hub to the listener.
+class KeyLatencyListener : public InputListenerInterface {
+public:
+    void notifyInputDevicesChanged(const NotifyInputDevicesChangedArgs&) override {}
+    void notifyConfigurationChanged(const NotifyConfigurationChangedArgs&) override {}
+    void notifyKey(const NotifyKeyArgs& args) override {
+        mLatencies.push_back(now() - args.readTime);
+    }
+    void notifyMotion(const NotifyMotionArgs&) override {}
+    void notifySwitch(const NotifySwitchArgs&) override {}
+    void notifySensor(const NotifySensorArgs&) override {}
+    void notifyVibratorState(const NotifyVibratorStateArgs&) override {}
+    void notifyDeviceReset(const NotifyDeviceResetArgs&) override {}
+    void notifyPointerCaptureChanged(const NotifyPointerCaptureChangedArgs&) override {}
+
+    nsecs_t getPercentileLatency(double percentile) {
+        if (mLatencies.empty()) {
+            return 0;
+        }
+        const size_t index = std::min(mLatencies.size() - 1,
+                                      static_cast<size_t>(mLatencies.size() * percentile));
+        std::nth_element(mLatencies.begin(), mLatencies.begin() + index, mLatencies.end());
+        return mLatencies[index];
+    }
+
+private:
+    std::vector<nsecs_t> mLatencies;
+};
+
+} // namespace
+
+static void benchmarkReadKeyEvents(benchmark::State& state) {
+    std::shared_ptr<FakeEventHub> eventHub = std::make_shared<FakeEventHub>();
+    sp<FakeInputReaderPolicy> policy = sp<FakeInputReaderPolicy>::make();
+    KeyLatencyListener listener;
+    BenchmarkInputReader reader(eventHub, policy, listener);
+
+    eventHub->addDevice(EVENTHUB_ID, "keyboard", InputDeviceClass::KEYBOARD);
+    eventHub->addKey(EVENTHUB_ID, KEY_A, /*usageCode=*/0, AKEYCODE_A, /*flags=*/0);
+    eventHub->finishDeviceScan();
+    reader.loopOnce();
+
+    for (auto _ : state) {
+        const nsecs_t readTime = now();
+        eventHub->enqueueEvent(readTime, readTime, EVENTHUB_ID, EV_KEY, KEY_A, 1);
+        eventHub->enqueueEvent(readTime, readTime, EVENTHUB_ID, EV_SYN, SYN_REPORT, 0);
+        eventHub->enqueueEvent(readTime, readTime, EVENTHUB_ID, EV_KEY, KEY_A, 0);
+        eventHub->enqueueEvent(readTime, readTime, EVENTHUB_ID, EV_SYN, SYN_REPORT, 0);
+        reader.loopOnce();
+    }
+
+    state.SetItemsProcessed(state.iterations() * 4);
+    state.counters["p99_latency_ns"] = listener.getPercentileLatency(0.99);
+}
+
+BENCHMARK(benchmarkReadKeyEvents);
+
+} // namespace android
@@ -65,7 +65,8 @@ EventEntry::EventEntry(int32_t id, Type type, nsecs_t eventTime, uint32_t policy
         eventTime(eventTime),
         policyFlags(policyFlags),
         injectionState(nullptr),
-        dispatchInProgress(false) {}
+        dispatchInProgress(false),
+        userActivityPoked(false) {}
 
 // --- ConfigurationChangedEntry ---
 
@@ -52,6 +52,7 @@ struct EventEntry {
     std::shared_ptr<InjectionState> injectionState;
 
     mutable bool dispatchInProgress; // initially false, set to true while dispatching
+    mutable bool userActivityPoked;  // initially false, set to true once poked when dequeued
 
     /**
      * Injected keys are events from an external (probably untrusted) application
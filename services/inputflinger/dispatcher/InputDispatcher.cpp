@@ -545,34 +545,6 @@ bool isUserActivityEvent(const EventEntry& eventEntry) {
     }
 }
 
-// Returns true if the given window can accept pointer events at the given display location.
-bool windowAcceptsTouchAt(const WindowInfo& windowInfo, int32_t displayId, float x, float y,
-                          bool isStylus, const ui::Transform& displayTransform) {
-    const auto inputConfig = windowInfo.inputConfig;
-    if (windowInfo.displayId != displayId ||
-        inputConfig.test(WindowInfo::InputConfig::NOT_VISIBLE)) {
-        return false;
-    }
-    const bool windowCanInterceptTouch = isStylus && windowInfo.interceptsStylus();
-    if (inputConfig.test(WindowInfo::InputConfig::NOT_TOUCHABLE) && !windowCanInterceptTouch) {
-        return false;
-    }
-
-    // Window Manager works in the logical display coordinate space. When it specifies bounds for a
-    // window as (l, t, r, b), the range of x in [l, r) and y in [t, b) are considered to be inside
-    // the window. Points on the right and bottom edges should not be inside the window, so we need
-    // to be careful about performing a hit test when the display is rotated, since the "right" and
-    // "bottom" of the window will be different in the display (un-rotated) space compared to in the
-    // logical display in which WM determined the bounds. Perform the hit test in the logical
-    // display space to ensure these edges are considered correctly in all orientations.
-    const auto touchableRegion = displayTransform.transform(windowInfo.touchableRegion);
-    const auto p = displayTransform.transform(x, y);
-    if (!touchableRegion.contains(std::floor(p.x), std::floor(p.y))) {
-        return false;
-    }
-    return true;
-}
-
 bool isPointerFromStylus(const MotionEntry& entry, int32_t pointerIndex) {
     return isFromSource(entry.source, AINPUT_SOURCE_STYLUS) &&
             isStylusToolType(entry.pointerProperties[pointerIndex].toolType);
@@ -804,6 +776,15 @@ Result<void> validateWindowInfosUpdate(const gui::WindowInfosUpdate& update) {
     return {};
 }
 
+// Whether a display has the windows with these ids, in the same order.
+bool hasWindowIds(const std::vector<sp<WindowInfoHandle>>& handles,
+                  const std::vector<const WindowInfo*>& infos) {
+    return std::equal(handles.begin(), handles.end(), infos.begin(), infos.end(),
+                      [](const sp<WindowInfoHandle>& handle, const WindowInfo* info) {
+                          return handle->getId() == info->id;
+                      });
+}
+
 int32_t getUserActivityEventType(const EventEntry& eventEntry) {
     switch (eventEntry.type) {
         case EventEntry::Type::KEY: {
@@ -855,6 +836,7 @@ InputDispatcher::InputDispatcher(InputDispatcherPolicyInterface& policy,
         mMonitorDispatchingTimeout(DEFAULT_INPUT_DISPATCHING_TIMEOUT),
         mDispatchEnabled(false),
         mDispatchFrozen(false),
+        mPerDisplayDispatchEnabled(false),
         mInputFilterEnabled(false),
         mMaximumObscuringOpacityForTouch(1.0f),
         mFocusedDisplayId(ADISPLAY_ID_DEFAULT),
@@ -951,25 +933,24 @@ void InputDispatcher::dispatchOnce() {
  * 1. The currently focused application must be the same one we are waiting for.
  * 2. Ensure we still don't have a focused window.
  */
-void InputDispatcher::processNoFocusedWindowAnrLocked() {
+void InputDispatcher::processNoFocusedWindowAnrLocked(
+        int32_t displayId, const std::shared_ptr<InputApplicationHandle>& application) {
     // Check if the application that we are waiting for is still focused.
     std::shared_ptr<InputApplicationHandle> focusedApplication =
-            getValueByKey(mFocusedApplicationHandlesByDisplay, mAwaitedApplicationDisplayId);
+            getValueByKey(mFocusedApplicationHandlesByDisplay, displayId);
     if (focusedApplication == nullptr ||
-        focusedApplication->getApplicationToken() !=
-                mAwaitedFocusedApplication->getApplicationToken()) {
+        focusedApplication->getApplicationToken() != application->getApplicationToken()) {
         // Unexpected because we should have reset the ANR timer when focused application changed
         ALOGE("Waited for a focused window, but focused application has already changed to %s",
               focusedApplication->getName().c_str());
         return; // The focused application has changed.
     }
 
-    const sp<WindowInfoHandle>& focusedWindowHandle =
-            getFocusedWindowHandleLocked(mAwaitedApplicationDisplayId);
+    const sp<WindowInfoHandle>& focusedWindowHandle = getFocusedWindowHandleLocked(displayId);
     if (focusedWindowHandle != nullptr) {
         return; // We now have a focused window. No need for ANR.
     }
-    onAnrLocked(mAwaitedFocusedApplication);
+    onAnrLocked(application);
 }
 
 /**
@@ -981,16 +962,17 @@ nsecs_t InputDispatcher::processAnrsLocked() {
     const nsecs_t currentTime = now();
     nsecs_t nextAnrCheck = LLONG_MAX;
     // Check if we are waiting for a focused window to appear. Raise ANR if waited too long
-    if (mNoFocusedWindowTimeoutTime.has_value() && mAwaitedFocusedApplication != nullptr) {
-        if (currentTime >= *mNoFocusedWindowTimeoutTime) {
-            processNoFocusedWindowAnrLocked();
-            mAwaitedFocusedApplication.reset();
-            mNoFocusedWindowTimeoutTime = std::nullopt;
+    for (const auto& [displayId, awaited] : mAwaitedFocusedApplications) {
+        if (currentTime >= awaited.timeoutTime) {
+            // Copy the application, since erasing the entry destroys it.
+            const int32_t awaitedDisplayId = displayId;
+            const std::shared_ptr<InputApplicationHandle> application = awaited.application;
+            processNoFocusedWindowAnrLocked(awaitedDisplayId, application);
+            mAwaitedFocusedApplications.erase(awaitedDisplayId);
             return LLONG_MIN;
-        } else {
-            // Keep waiting. We will drop the event when mNoFocusedWindowTimeoutTime comes.
-            nextAnrCheck = *mNoFocusedWindowTimeoutTime;
         }
+        // Keep waiting. We will drop the event when the timeout comes.
+        nextAnrCheck = std::min(nextAnrCheck, awaited.timeoutTime);
     }
 
     // Check if any connection ANRs are due
@@ -1066,8 +1048,11 @@ void InputDispatcher::dispatchOnceInnerLocked(nsecs_t& nextWakeupTime) {
             traceInboundQueueLengthLocked();
         }
 
-        // Poke user activity for this event.
-        if (mPendingEvent->policyFlags & POLICY_FLAG_PASS_TO_USER) {
+        // Poke user activity for this event, unless it was already poked when it was dispatched
+        // ahead of a blocked event and then put back in the inbound queue.
+        if ((mPendingEvent->policyFlags & POLICY_FLAG_PASS_TO_USER) &&
+            !mPendingEvent->userActivityPoked) {
+            mPendingEvent->userActivityPoked = true;
             pokeUserActivityLocked(*mPendingEvent);
         }
     }
@@ -1075,6 +1060,12 @@ void InputDispatcher::dispatchOnceInnerLocked(nsecs_t& nextWakeupTime) {
     // Now we have an event to dispatch.
     // All events are eventually dequeued and processed this way, even if we intend to drop them.
     ALOG_ASSERT(mPendingEvent != nullptr);
+    if (!dispatchPendingEventLocked(currentTime, nextWakeupTime) && mPerDisplayDispatchEnabled) {
+        dispatchEventsBehindBlockedEventLocked(currentTime, nextWakeupTime);
+    }
+}
+
+bool InputDispatcher::dispatchPendingEventLocked(nsecs_t currentTime, nsecs_t& nextWakeupTime) {
     bool done = false;
     DropReason dropReason = DropReason::NOT_DROPPED;
     if (!(mPendingEvent->policyFlags & POLICY_FLAG_PASS_TO_USER)) {
@@ -1208,6 +1199,76 @@ void InputDispatcher::dispatchOnceInnerLocked(nsecs_t& nextWakeupTime) {
         releasePendingEventLocked();
         nextWakeupTime = LLONG_MIN; // force next poll to wake up immediately
     }
+    return done;
+}
+
+void InputDispatcher::dispatchEventsBehindBlockedEventLocked(nsecs_t currentTime,
+                                                              nsecs_t& nextWakeupTime) {
+    // The events of a display, and the events of a device, are always dispatched in order. Only
+    // the key and motion events that were sent to a specific display can be dispatched ahead of
+    // the events before them. Any other event, such as a focus change, or a key that goes to
+    // whichever display has focus, may affect all the displays, so it waits for everything
+    // before it.
+    struct Scope {
+        int32_t displayId;
+        DeviceId deviceId;
+    };
+    const auto getScope = [](const EventEntry& entry) -> std::optional<Scope> {
+        if (entry.type == EventEntry::Type::KEY) {
+            const auto& keyEntry = static_cast<const KeyEntry&>(entry);
+            if (keyEntry.displayId != ADISPLAY_ID_NONE) {
+                return Scope{keyEntry.displayId, keyEntry.deviceId};
+            }
+        } else if (entry.type == EventEntry::Type::MOTION) {
+            const auto& motionEntry = static_cast<const MotionEntry&>(entry);
+            if (motionEntry.displayId != ADISPLAY_ID_NONE) {
+                return Scope{motionEntry.displayId, motionEntry.deviceId};
+            }
+        }
+        return std::nullopt;
+    };
+
+    const std::optional<Scope> blockedScope = getScope(*mPendingEvent);
+    if (!blockedScope || mNextUnblockedEvent != nullptr) {
+        // Everything waits for the pending event, or the inbound queue is being pruned anyway.
+        return;
+    }
+    std::unordered_set<int32_t> blockedDisplays{blockedScope->displayId};
+    std::unordered_set<DeviceId> blockedDevices{blockedScope->deviceId};
+
+    // Dispatching may append to the inbound queue, so the queue is walked by index.
+    std::shared_ptr<const EventEntry> blockedEvent = std::move(mPendingEvent);
+    for (size_t i = 0; i < mInboundQueue.size();) {
+        const std::optional<Scope> scope = getScope(*mInboundQueue[i]);
+        if (!scope) {
+            break;
+        }
+        if (blockedDisplays.count(scope->displayId) || blockedDevices.count(scope->deviceId)) {
+            blockedDisplays.insert(scope->displayId);
+            blockedDevices.insert(scope->deviceId);
+            i++;
+            continue;
+        }
+
+        mPendingEvent = mInboundQueue[i];
+        mInboundQueue.erase(mInboundQueue.begin() + i);
+        traceInboundQueueLengthLocked();
+        if ((mPendingEvent->policyFlags & POLICY_FLAG_PASS_TO_USER) &&
+            !mPendingEvent->userActivityPoked) {
+            mPendingEvent->userActivityPoked = true;
+            pokeUserActivityLocked(*mPendingEvent);
+        }
+        if (!dispatchPendingEventLocked(currentTime, nextWakeupTime)) {
+            // This event has to wait as well. Put it back, and hold back what comes after it.
+            mInboundQueue.insert(mInboundQueue.begin() + i, std::move(mPendingEvent));
+            mPendingEvent = nullptr;
+            traceInboundQueueLengthLocked();
+            blockedDisplays.insert(scope->displayId);
+            blockedDevices.insert(scope->deviceId);
+            i++;
+        }
+    }
+    mPendingEvent = std::move(blockedEvent);
 }
 
 bool InputDispatcher::isStaleEvent(nsecs_t currentTime, const EventEntry& entry) {
@@ -1226,7 +1287,14 @@ bool InputDispatcher::shouldPruneInboundQueueLocked(const MotionEntry& motionEnt
     // decides to touch a window in a different application.
     // If the application takes too long to catch up then we drop all events preceding
     // the touch into the other window.
-    if (isPointerDownEvent && mAwaitedFocusedApplication != nullptr) {
+    // With per-display dispatch, only the queue of the touched display can be waiting on it.
+    // Otherwise, only one display waits at a time, and a touch on any display ends the wait.
+    const auto awaitedIt = mPerDisplayDispatchEnabled
+            ? mAwaitedFocusedApplications.find(motionEntry.displayId)
+            : mAwaitedFocusedApplications.begin();
+    if (isPointerDownEvent && awaitedIt != mAwaitedFocusedApplications.end()) {
+        const std::shared_ptr<InputApplicationHandle>& awaitedFocusedApplication =
+                awaitedIt->second.application;
         const int32_t displayId = motionEntry.displayId;
         const auto [x, y] = resolveTouchedPosition(motionEntry);
         const bool isStylus = isPointerFromStylus(motionEntry, /*pointerIndex=*/0);
@@ -1235,11 +1303,11 @@ bool InputDispatcher::shouldPruneInboundQueueLocked(const MotionEntry& motionEnt
                 findTouchedWindowAtLocked(displayId, x, y, isStylus);
         if (touchedWindowHandle != nullptr &&
             touchedWindowHandle->getApplicationToken() !=
-                    mAwaitedFocusedApplication->getApplicationToken()) {
+                    awaitedFocusedApplication->getApplicationToken()) {
             // User touched a different application than the one we are waiting on.
             ALOGI("Pruning input queue because user touched a different application while waiting "
                   "for %s",
-                  mAwaitedFocusedApplication->getName().c_str());
+                  awaitedFocusedApplication->getName().c_str());
             return true;
         }
 
@@ -1254,7 +1322,7 @@ bool InputDispatcher::shouldPruneInboundQueueLocked(const MotionEntry& motionEnt
                 // event, so that the spy window can get a chance to receive the stream.
                 ALOGW("Pruning the input queue because %s is unresponsive, but we have a "
                       "responsive spy window that may handle the event.",
-                      mAwaitedFocusedApplication->getName().c_str());
+                      awaitedFocusedApplication->getName().c_str());
                 return true;
             }
         }
@@ -1310,17 +1378,25 @@ bool InputDispatcher::enqueueInboundEventLocked(std::unique_ptr<EventEntry> newE
 
             const bool isPointerDownEvent = motionEntry.action == AMOTION_EVENT_ACTION_DOWN &&
                     isFromSource(motionEntry.source, AINPUT_SOURCE_CLASS_POINTER);
-            if (isPointerDownEvent && mKeyIsWaitingForEventsTimeout) {
+            if (isPointerDownEvent && !mKeyIsWaitingForEventsTimeouts.empty()) {
                 // Prevent waiting too long for unprocessed events: if we have a pending key event,
                 // and some other events have not yet been processed, the dispatcher will wait for
                 // these events to be processed before dispatching the key event. This is because
                 // the unprocessed events may cause the focus to change (for example, by launching a
                 // new window or tapping a different window). To prevent waiting too long, we force
                 // the key to be sent to the currently focused window when a new tap comes in.
-                ALOGD("Received a new pointer down event, stop waiting for events to process and "
-                      "just send the pending key event to the currently focused window.");
-                mKeyIsWaitingForEventsTimeout = now();
-                needWake = true;
+                // With per-display dispatch, a tap only ends the waits that include its display.
+                const nsecs_t currentTime = now();
+                for (auto& [scope, timeout] : mKeyIsWaitingForEventsTimeouts) {
+                    if (!mPerDisplayDispatchEnabled || scope == ADISPLAY_ID_NONE ||
+                        scope == motionEntry.displayId) {
+                        ALOGD("Received a new pointer down event, stop waiting for events to "
+                              "process and just send the pending key event to the currently "
+                              "focused window.");
+                        timeout = currentTime;
+                        needWake = true;
+                    }
+                }
             }
             break;
         }
@@ -1355,20 +1431,21 @@ void InputDispatcher::addRecentEventLocked(std::shared_ptr<const EventEntry> ent
 sp<WindowInfoHandle> InputDispatcher::findTouchedWindowAtLocked(int32_t displayId, float x, float y,
                                                                 bool isStylus,
                                                                 bool ignoreDragWindow) const {
-    // Traverse windows from front to back to find touched window.
-    const auto& windowHandles = getWindowHandlesLocked(displayId);
-    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
-        if (ignoreDragWindow && haveSameToken(windowHandle, mDragState->dragWindow)) {
-            continue;
-        }
-
-        const WindowInfo& info = *windowHandle->getInfo();
-        if (!info.isSpy() &&
-            windowAcceptsTouchAt(info, displayId, x, y, isStylus, getTransformLocked(displayId))) {
-            return windowHandle;
-        }
-    }
-    return nullptr;
+    // Traverse windows at the location from front to back to find touched window.
+    const sp<WindowInfoHandle> dragWindow = ignoreDragWindow ? mDragState->dragWindow : nullptr;
+    sp<WindowInfoHandle> touchedWindow;
+    getTouchableWindowIndexLocked(displayId)
+            .forEachWindowAt(x, y, isStylus, [&](const sp<WindowInfoHandle>& windowHandle) {
+                if (ignoreDragWindow && haveSameToken(windowHandle, dragWindow)) {
+                    return true;
+                }
+                if (windowHandle->getInfo()->isSpy()) {
+                    return true;
+                }
+                touchedWindow = windowHandle;
+                return false;
+            });
+    return touchedWindow;
 }
 
 std::vector<InputTarget> InputDispatcher::findOutsideTargetsLocked(
@@ -1400,21 +1477,18 @@ std::vector<InputTarget> InputDispatcher::findOutsideTargetsLocked(
 
 std::vector<sp<WindowInfoHandle>> InputDispatcher::findTouchedSpyWindowsAtLocked(
         int32_t displayId, float x, float y, bool isStylus) const {
-    // Traverse windows from front to back and gather the touched spy windows.
+    // Traverse windows at the location from front to back and gather the touched spy windows.
     std::vector<sp<WindowInfoHandle>> spyWindows;
-    const auto& windowHandles = getWindowHandlesLocked(displayId);
-    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
-        const WindowInfo& info = *windowHandle->getInfo();
-
-        if (!windowAcceptsTouchAt(info, displayId, x, y, isStylus, getTransformLocked(displayId))) {
-            continue;
-        }
-        if (!info.isSpy()) {
-            // The first touched non-spy window was found, so return the spy windows touched so far.
-            return spyWindows;
-        }
-        spyWindows.push_back(windowHandle);
-    }
+    getTouchableWindowIndexLocked(displayId)
+            .forEachWindowAt(x, y, isStylus, [&](const sp<WindowInfoHandle>& windowHandle) {
+                if (!windowHandle->getInfo()->isSpy()) {
+                    // The first touched non-spy window was found, so return the spy windows
+                    // touched so far.
+                    return false;
+                }
+                spyWindows.push_back(windowHandle);
+                return true;
+            });
     return spyWindows;
 }
 
@@ -2124,8 +2198,22 @@ void InputDispatcher::resetNoFocusedWindowTimeoutLocked() {
     }
 
     // Reset input target wait timeout.
-    mNoFocusedWindowTimeoutTime = std::nullopt;
-    mAwaitedFocusedApplication.reset();
+    mAwaitedFocusedApplications.clear();
+}
+
+void InputDispatcher::resetNoFocusedWindowTimeoutLocked(int32_t displayId) {
+    // Without per-display dispatch, only one display waits at a time, and finding any focused
+    // window ends the wait.
+    if (!mPerDisplayDispatchEnabled) {
+        resetNoFocusedWindowTimeoutLocked();
+        return;
+    }
+
+    if (DEBUG_FOCUS) {
+        ALOGD("Resetting ANR timeouts for display %" PRId32 ".", displayId);
+    }
+
+    mAwaitedFocusedApplications.erase(displayId);
 }
 
 /**
@@ -2160,18 +2248,28 @@ int32_t InputDispatcher::getTargetDisplayId(const EventEntry& entry) {
     return displayId == ADISPLAY_ID_NONE ? mFocusedDisplayId : displayId;
 }
 
-bool InputDispatcher::shouldWaitToSendKeyLocked(nsecs_t currentTime,
+int32_t InputDispatcher::getKeyWaitingScopeLocked(const KeyEntry& entry) const {
+    // With per-display dispatch, only the events on the display of the key can move its focus.
+    return mPerDisplayDispatchEnabled ? entry.displayId : ADISPLAY_ID_NONE;
+}
+
+bool InputDispatcher::shouldWaitToSendKeyLocked(nsecs_t currentTime, const KeyEntry& entry,
                                                 const char* focusedWindowName) {
-    if (mAnrTracker.empty()) {
+    const int32_t scope = getKeyWaitingScopeLocked(entry);
+    const bool hasUnprocessedEvents = scope != ADISPLAY_ID_NONE
+            ? hasUnprocessedEventsOnDisplayLocked(scope)
+            : !mAnrTracker.empty();
+    if (!hasUnprocessedEvents) {
         // already processed all events that we waited for
-        mKeyIsWaitingForEventsTimeout = std::nullopt;
+        mKeyIsWaitingForEventsTimeouts.erase(scope);
         return false;
     }
 
-    if (!mKeyIsWaitingForEventsTimeout.has_value()) {
+    const auto [it, inserted] = mKeyIsWaitingForEventsTimeouts.try_emplace(scope, 0);
+    if (inserted) {
         // Start the timer
         // Wait to send key because there are unprocessed events that may cause focus to change
-        mKeyIsWaitingForEventsTimeout = currentTime +
+        it->second = currentTime +
                 std::chrono::duration_cast<std::chrono::nanoseconds>(
                         mPolicy.getKeyWaitingForEventsTimeout())
                         .count();
@@ -2179,7 +2277,7 @@ bool InputDispatcher::shouldWaitToSendKeyLocked(nsecs_t currentTime,
     }
 
     // We still have pending events, and already started the timer
-    if (currentTime < *mKeyIsWaitingForEventsTimeout) {
+    if (currentTime < it->second) {
         return true; // Still waiting
     }
 
@@ -2187,7 +2285,30 @@ bool InputDispatcher::shouldWaitToSendKeyLocked(nsecs_t currentTime,
     // Just send the key to the focused window
     ALOGW("Dispatching key to %s even though there are other unprocessed events",
           focusedWindowName);
-    mKeyIsWaitingForEventsTimeout = std::nullopt;
+    mKeyIsWaitingForEventsTimeouts.erase(it);
+    return false;
+}
+
+bool InputDispatcher::hasUnprocessedEventsOnDisplayLocked(int32_t displayId) const {
+    // Like mAnrTracker, do not count the connections that are already unresponsive.
+    const auto hasUnprocessedEvents = [](const Connection& connection) {
+        return connection.responsive && !connection.waitQueue.empty();
+    };
+    for (const sp<WindowInfoHandle>& windowHandle : getWindowHandlesLocked(displayId)) {
+        const std::shared_ptr<Connection> connection =
+                getConnectionLocked(windowHandle->getToken());
+        if (connection != nullptr && hasUnprocessedEvents(*connection)) {
+            return true;
+        }
+    }
+    const auto monitorsIt = mGlobalMonitorsByDisplay.find(displayId);
+    if (monitorsIt != mGlobalMonitorsByDisplay.end()) {
+        for (const Monitor& monitor : monitorsIt->second) {
+            if (hasUnprocessedEvents(*monitor.connection)) {
+                return true;
+            }
+        }
+    }
     return false;
 }
 
@@ -2221,20 +2342,22 @@ sp<WindowInfoHandle> InputDispatcher::findFocusedWindowTargetLocked(
     // if the "no focused window ANR" is moved to the policy. Input doesn't know whether
     // an app is expected to have a focused window.
     if (focusedWindowHandle == nullptr && focusedApplicationHandle != nullptr) {
-        if (!mNoFocusedWindowTimeoutTime.has_value()) {
+        const auto awaitedIt = mAwaitedFocusedApplications.find(displayId);
+        if (awaitedIt == mAwaitedFocusedApplications.end()) {
             // We just discovered that there's no focused window. Start the ANR timer
             std::chrono::nanoseconds timeout = focusedApplicationHandle->getDispatchingTimeout(
                     DEFAULT_INPUT_DISPATCHING_TIMEOUT);
-            mNoFocusedWindowTimeoutTime = currentTime + timeout.count();
-            mAwaitedFocusedApplication = focusedApplicationHandle;
-            mAwaitedApplicationDisplayId = displayId;
+            const nsecs_t timeoutTime = currentTime + timeout.count();
+            mAwaitedFocusedApplications.emplace(displayId,
+                                                AwaitedFocusedApplication{focusedApplicationHandle,
+                                                                          timeoutTime});
             ALOGW("Waiting because no window has focus but %s may eventually add a "
                   "window when it finishes starting up. Will wait for %" PRId64 "ms",
-                  mAwaitedFocusedApplication->getName().c_str(), millis(timeout));
-            nextWakeupTime = std::min(nextWakeupTime, *mNoFocusedWindowTimeoutTime);
+                  focusedApplicationHandle->getName().c_str(), millis(timeout));
+            nextWakeupTime = std::min(nextWakeupTime, timeoutTime);
             outInjectionResult = InputEventInjectionResult::PENDING;
             return nullptr;
-        } else if (currentTime > *mNoFocusedWindowTimeoutTime) {
+        } else if (currentTime > awaitedIt->second.timeoutTime) {
             // Already raised ANR. Drop the event
             ALOGE("Dropping %s event because there is no focused window",
                   ftl::enum_string(entry.type).c_str());
@@ -2247,7 +2370,7 @@ sp<WindowInfoHandle> InputDispatcher::findFocusedWindowTargetLocked(
     }
 
     // we have a valid, non-null focused window
-    resetNoFocusedWindowTimeoutLocked();
+    resetNoFocusedWindowTimeoutLocked(displayId);
 
     // Verify targeted injection.
     if (const auto err = verifyTargetedInjection(focusedWindowHandle, entry); err) {
@@ -2275,8 +2398,12 @@ sp<WindowInfoHandle> InputDispatcher::findFocusedWindowTargetLocked(
     // To obtain this behavior, we must serialize key events with respect to all
     // prior input events.
     if (entry.type == EventEntry::Type::KEY) {
-        if (shouldWaitToSendKeyLocked(currentTime, focusedWindowHandle->getName().c_str())) {
-            nextWakeupTime = std::min(nextWakeupTime, *mKeyIsWaitingForEventsTimeout);
+        const auto& keyEntry = static_cast<const KeyEntry&>(entry);
+        if (shouldWaitToSendKeyLocked(currentTime, keyEntry,
+                                      focusedWindowHandle->getName().c_str())) {
+            nextWakeupTime =
+                    std::min(nextWakeupTime,
+                             mKeyIsWaitingForEventsTimeouts[getKeyWaitingScopeLocked(keyEntry)]);
             outInjectionResult = InputEventInjectionResult::PENDING;
             return nullptr;
         }
@@ -3701,136 +3828,172 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
         ALOGD("channel '%s' ~ startDispatchCycle", connection->getInputChannelName().c_str());
     }
 
-    while (connection->status == Connection::Status::NORMAL && !connection->outboundQueue.empty()) {
-        std::unique_ptr<DispatchEntry>& dispatchEntry = connection->outboundQueue.front();
-        dispatchEntry->deliveryTime = currentTime;
-        const std::chrono::nanoseconds timeout = getDispatchingTimeoutLocked(connection);
-        dispatchEntry->timeoutTime = currentTime + timeout.count();
+    if (connection->status != Connection::Status::NORMAL || connection->outboundQueue.empty()) {
+        return;
+    }
 
-        // Publish the event.
-        status_t status;
-        const EventEntry& eventEntry = *(dispatchEntry->eventEntry);
-        switch (eventEntry.type) {
-            case EventEntry::Type::KEY: {
-                const KeyEntry& keyEntry = static_cast<const KeyEntry&>(eventEntry);
-                std::array<uint8_t, 32> hmac = getSignature(keyEntry, *dispatchEntry);
-                if (DEBUG_OUTBOUND_EVENT_DETAILS) {
-                    LOG(INFO) << "Publishing " << *dispatchEntry << " to "
-                              << connection->getInputChannelName();
+    // Stage the outbound events, and send them to the channel together. A batch is no larger than
+    // what the channel sends in one system call, so that a consumer that is behind does not make
+    // every cycle sign and copy its whole backlog again.
+    const std::chrono::nanoseconds timeout = getDispatchingTimeoutLocked(connection);
+    status_t cycleStatus = OK;
+    while (cycleStatus == OK && !connection->outboundQueue.empty()) {
+        const size_t batchSize =
+                std::min(connection->outboundQueue.size(), InputChannel::MAX_MESSAGES_PER_SEND);
+        status_t stagingStatus = OK;
+        connection->inputPublisher.beginBatch();
+        for (size_t i = 0; i < batchSize; i++) {
+            std::unique_ptr<DispatchEntry>& dispatchEntry = connection->outboundQueue[i];
+            dispatchEntry->deliveryTime = currentTime;
+            dispatchEntry->timeoutTime = currentTime + timeout.count();
+
+            // Publish the event.
+            status_t status;
+            const EventEntry& eventEntry = *(dispatchEntry->eventEntry);
+            switch (eventEntry.type) {
+                case EventEntry::Type::KEY: {
+                    const KeyEntry& keyEntry = static_cast<const KeyEntry&>(eventEntry);
+                    std::array<uint8_t, 32> hmac = getSignature(keyEntry, *dispatchEntry);
+                    if (DEBUG_OUTBOUND_EVENT_DETAILS) {
+                        LOG(INFO) << "Publishing " << *dispatchEntry << " to "
+                                  << connection->getInputChannelName();
+                    }
+
+                    // Publish the key event.
+                    status = connection->inputPublisher
+                                     .publishKeyEvent(dispatchEntry->seq, keyEntry.id,
+                                                      keyEntry.deviceId, keyEntry.source,
+                                                      keyEntry.displayId, std::move(hmac),
+                                                      keyEntry.action,
+                                                      dispatchEntry->resolvedFlags,
+                                                      keyEntry.keyCode, keyEntry.scanCode,
+                                                      keyEntry.metaState, keyEntry.repeatCount,
+                                                      keyEntry.downTime, keyEntry.eventTime);
+                    break;
                 }
 
-                // Publish the key event.
-                status = connection->inputPublisher
-                                 .publishKeyEvent(dispatchEntry->seq, keyEntry.id,
-                                                  keyEntry.deviceId, keyEntry.source,
-                                                  keyEntry.displayId, std::move(hmac),
-                                                  keyEntry.action, dispatchEntry->resolvedFlags,
-                                                  keyEntry.keyCode, keyEntry.scanCode,
-                                                  keyEntry.metaState, keyEntry.repeatCount,
-                                                  keyEntry.downTime, keyEntry.eventTime);
-                if (mTracer) {
-                    mTracer->traceEventDispatch(*dispatchEntry, keyEntry.traceTracker.get());
+                case EventEntry::Type::MOTION: {
+                    if (DEBUG_OUTBOUND_EVENT_DETAILS) {
+                        LOG(INFO) << "Publishing " << *dispatchEntry << " to "
+                                  << connection->getInputChannelName();
+                    }
+                    status = publishMotionEvent(*connection, *dispatchEntry);
+                    break;
                 }
-                break;
-            }
 
-            case EventEntry::Type::MOTION: {
-                if (DEBUG_OUTBOUND_EVENT_DETAILS) {
-                    LOG(INFO) << "Publishing " << *dispatchEntry << " to "
-                              << connection->getInputChannelName();
+                case EventEntry::Type::FOCUS: {
+                    const FocusEntry& focusEntry = static_cast<const FocusEntry&>(eventEntry);
+                    status = connection->inputPublisher.publishFocusEvent(dispatchEntry->seq,
+                                                                          focusEntry.id,
+                                                                          focusEntry.hasFocus);
+                    break;
                 }
-                const MotionEntry& motionEntry = static_cast<const MotionEntry&>(eventEntry);
-                status = publishMotionEvent(*connection, *dispatchEntry);
-                if (mTracer) {
-                    mTracer->traceEventDispatch(*dispatchEntry, motionEntry.traceTracker.get());
+
+                case EventEntry::Type::TOUCH_MODE_CHANGED: {
+                    const TouchModeEntry& touchModeEntry =
+                            static_cast<const TouchModeEntry&>(eventEntry);
+                    status = connection->inputPublisher
+                                     .publishTouchModeEvent(dispatchEntry->seq, touchModeEntry.id,
+                                                            touchModeEntry.inTouchMode);
+
+                    break;
                 }
-                break;
-            }
 
-            case EventEntry::Type::FOCUS: {
-                const FocusEntry& focusEntry = static_cast<const FocusEntry&>(eventEntry);
-                status = connection->inputPublisher.publishFocusEvent(dispatchEntry->seq,
-                                                                      focusEntry.id,
-                                                                      focusEntry.hasFocus);
-                break;
-            }
+                case EventEntry::Type::POINTER_CAPTURE_CHANGED: {
+                    const auto& captureEntry =
+                            static_cast<const PointerCaptureChangedEntry&>(eventEntry);
+                    status = connection->inputPublisher
+                                     .publishCaptureEvent(dispatchEntry->seq, captureEntry.id,
+                                                          captureEntry.pointerCaptureRequest
+                                                                  .enable);
+                    break;
+                }
 
-            case EventEntry::Type::TOUCH_MODE_CHANGED: {
-                const TouchModeEntry& touchModeEntry =
-                        static_cast<const TouchModeEntry&>(eventEntry);
-                status = connection->inputPublisher
-                                 .publishTouchModeEvent(dispatchEntry->seq, touchModeEntry.id,
-                                                        touchModeEntry.inTouchMode);
+                case EventEntry::Type::DRAG: {
+                    const DragEntry& dragEntry = static_cast<const DragEntry&>(eventEntry);
+                    status = connection->inputPublisher.publishDragEvent(dispatchEntry->seq,
+                                                                         dragEntry.id, dragEntry.x,
+                                                                         dragEntry.y,
+                                                                         dragEntry.isExiting);
+                    break;
+                }
 
-                break;
+                case EventEntry::Type::CONFIGURATION_CHANGED:
+                case EventEntry::Type::DEVICE_RESET:
+                case EventEntry::Type::SENSOR: {
+                    LOG_ALWAYS_FATAL("Should never start dispatch cycles for %s events",
+                                     ftl::enum_string(eventEntry.type).c_str());
+                    return;
+                }
             }
 
-            case EventEntry::Type::POINTER_CAPTURE_CHANGED: {
-                const auto& captureEntry =
-                        static_cast<const PointerCaptureChangedEntry&>(eventEntry);
-                status = connection->inputPublisher
-                                 .publishCaptureEvent(dispatchEntry->seq, captureEntry.id,
-                                                      captureEntry.pointerCaptureRequest.enable);
+            if (status) {
+                // The events staged before this one can still be sent.
+                stagingStatus = status;
                 break;
             }
+        }
 
-            case EventEntry::Type::DRAG: {
-                const DragEntry& dragEntry = static_cast<const DragEntry&>(eventEntry);
-                status = connection->inputPublisher.publishDragEvent(dispatchEntry->seq,
-                                                                     dragEntry.id, dragEntry.x,
-                                                                     dragEntry.y,
-                                                                     dragEntry.isExiting);
-                break;
+        size_t publishedCount;
+        cycleStatus = connection->inputPublisher.endBatch(&publishedCount);
+        if (cycleStatus == OK) {
+            cycleStatus = stagingStatus;
+        }
+
+        for (size_t i = 0; i < publishedCount; i++) {
+            std::unique_ptr<DispatchEntry>& dispatchEntry = connection->outboundQueue.front();
+            if (mTracer) {
+                const EventEntry& eventEntry = *(dispatchEntry->eventEntry);
+                if (eventEntry.type == EventEntry::Type::KEY) {
+                    mTracer->traceEventDispatch(*dispatchEntry,
+                                                static_cast<const KeyEntry&>(eventEntry)
+                                                        .traceTracker.get());
+                } else if (eventEntry.type == EventEntry::Type::MOTION) {
+                    mTracer->traceEventDispatch(*dispatchEntry,
+                                                static_cast<const MotionEntry&>(eventEntry)
+                                                        .traceTracker.get());
+                }
             }
 
-            case EventEntry::Type::CONFIGURATION_CHANGED:
-            case EventEntry::Type::DEVICE_RESET:
-            case EventEntry::Type::SENSOR: {
-                LOG_ALWAYS_FATAL("Should never start dispatch cycles for %s events",
-                                 ftl::enum_string(eventEntry.type).c_str());
-                return;
+            // Re-enqueue the event on the wait queue.
+            const nsecs_t timeoutTime = dispatchEntry->timeoutTime;
+            connection->waitQueue.emplace_back(std::move(dispatchEntry));
+            connection->outboundQueue.erase(connection->outboundQueue.begin());
+            traceOutboundQueueLength(*connection);
+            if (connection->responsive) {
+                mAnrTracker.insert(timeoutTime, connection->getToken());
             }
+            traceWaitQueueLength(*connection);
         }
+    }
 
-        // Check the result.
-        if (status) {
-            if (status == WOULD_BLOCK) {
-                if (connection->waitQueue.empty()) {
-                    ALOGE("channel '%s' ~ Could not publish event because the pipe is full. "
-                          "This is unexpected because the wait queue is empty, so the pipe "
-                          "should be empty and we shouldn't have any problems writing an "
-                          "event to it, status=%s(%d)",
-                          connection->getInputChannelName().c_str(), statusToString(status).c_str(),
-                          status);
-                    abortBrokenDispatchCycleLocked(currentTime, connection, /*notify=*/true);
-                } else {
-                    // Pipe is full and we are waiting for the app to finish process some events
-                    // before sending more events to it.
-                    if (DEBUG_DISPATCH_CYCLE) {
-                        ALOGD("channel '%s' ~ Could not publish event because the pipe is full, "
-                              "waiting for the application to catch up",
-                              connection->getInputChannelName().c_str());
-                    }
-                }
-            } else {
-                ALOGE("channel '%s' ~ Could not publish event due to an unexpected error, "
-                      "status=%s(%d)",
-                      connection->getInputChannelName().c_str(), statusToString(status).c_str(),
-                      status);
+    // Check the result.
+    if (cycleStatus) {
+        if (cycleStatus == WOULD_BLOCK) {
+            if (connection->waitQueue.empty()) {
+                ALOGE("channel '%s' ~ Could not publish event because the pipe is full. "
+                      "This is unexpected because the wait queue is empty, so the pipe "
+                      "should be empty and we shouldn't have any problems writing an "
+                      "event to it, status=%s(%d)",
+                      connection->getInputChannelName().c_str(),
+                      statusToString(cycleStatus).c_str(), cycleStatus);
                 abortBrokenDispatchCycleLocked(currentTime, connection, /*notify=*/true);
+            } else {
+                // Pipe is full and we are waiting for the app to finish process some events
+                // before sending more events to it.
+                if (DEBUG_DISPATCH_CYCLE) {
+                    ALOGD("channel '%s' ~ Could not publish event because the pipe is full, "
+                          "waiting for the application to catch up",
+                          connection->getInputChannelName().c_str());
+                }
             }
-            return;
-        }
-
-        // Re-enqueue the event on the wait queue.
-        const nsecs_t timeoutTime = dispatchEntry->timeoutTime;
-        connection->waitQueue.emplace_back(std::move(dispatchEntry));
-        connection->outboundQueue.erase(connection->outboundQueue.begin());
-        traceOutboundQueueLength(*connection);
-        if (connection->responsive) {
-            mAnrTracker.insert(timeoutTime, connection->getToken());
+        } else {
+            ALOGE("channel '%s' ~ Could not publish event due to an unexpected error, "
+                  "status=%s(%d)",
+                  connection->getInputChannelName().c_str(), statusToString(cycleStatus).c_str(),
+                  cycleStatus);
+            abortBrokenDispatchCycleLocked(currentTime, connection, /*notify=*/true);
         }
-        traceWaitQueueLength(*connection);
     }
 }
 
@@ -5114,6 +5277,13 @@ ui::Transform InputDispatcher::getTransformLocked(int32_t displayId) const {
                                                 : kIdentityTransform;
 }
 
+const TouchableWindowIndex& InputDispatcher::getTouchableWindowIndexLocked(
+        int32_t displayId) const {
+    static const TouchableWindowIndex EMPTY_TOUCHABLE_WINDOW_INDEX;
+    auto it = mTouchableWindowIndexByDisplay.find(displayId);
+    return it != mTouchableWindowIndexByDisplay.end() ? it->second : EMPTY_TOUCHABLE_WINDOW_INDEX;
+}
+
 bool InputDispatcher::canWindowReceiveMotionLocked(const sp<WindowInfoHandle>& window,
                                                    const MotionEntry& motionEntry) const {
     const WindowInfo& info = *window->getInfo();
@@ -5181,6 +5351,7 @@ void InputDispatcher::updateWindowHandlesForDisplayLocked(
     if (windowInfoHandles.empty()) {
         // Remove all handles on a display if there are no windows left.
         mWindowHandlesByDisplay.erase(displayId);
+        mTouchableWindowIndexByDisplay.erase(displayId);
         return;
     }
 
@@ -5226,6 +5397,8 @@ void InputDispatcher::updateWindowHandlesForDisplayLocked(
 
     // Insert or replace
     mWindowHandlesByDisplay[displayId] = newHandles;
+    mTouchableWindowIndexByDisplay[displayId] =
+            TouchableWindowIndex(newHandles, getTransformLocked(displayId));
 }
 
 /**
@@ -5371,7 +5544,7 @@ void InputDispatcher::setFocusedApplicationLocked(
 
     // No matter what the old focused application was, stop waiting on it because it is
     // no longer focused.
-    resetNoFocusedWindowTimeoutLocked();
+    resetNoFocusedWindowTimeoutLocked(displayId);
 }
 
 void InputDispatcher::setMinTimeBetweenUserActivityPokes(std::chrono::milliseconds interval) {
@@ -5759,6 +5932,8 @@ std::string InputDispatcher::dumpPointerCaptureStateLocked() const {
 void InputDispatcher::dumpDispatchStateLocked(std::string& dump) const {
     dump += StringPrintf(INDENT "DispatchEnabled: %s\n", toString(mDispatchEnabled));
     dump += StringPrintf(INDENT "DispatchFrozen: %s\n", toString(mDispatchFrozen));
+    dump += StringPrintf(INDENT "PerDisplayDispatchEnabled: %s\n",
+                         toString(mPerDisplayDispatchEnabled));
     dump += StringPrintf(INDENT "InputFilterEnabled: %s\n", toString(mInputFilterEnabled));
     dump += StringPrintf(INDENT "FocusedDisplayId: %" PRId32 "\n", mFocusedDisplayId);
 
@@ -6777,7 +6952,7 @@ void InputDispatcher::onFocusChangedLocked(const FocusResolver::FocusChanges& ch
         enqueueFocusEventLocked(changes.oldFocus, /*hasFocus=*/false, changes.reason);
     }
     if (changes.newFocus) {
-        resetNoFocusedWindowTimeoutLocked();
+        resetNoFocusedWindowTimeoutLocked(changes.displayId);
         enqueueFocusEventLocked(changes.newFocus, /*hasFocus=*/true, changes.reason);
     }
 
@@ -6866,10 +7041,22 @@ void InputDispatcher::onWindowInfosChanged(const gui::WindowInfosUpdate& update)
     };
     // The listener sends the windows as a flattened array. Separate the windows by display for
     // more convenient parsing.
-    std::unordered_map<int32_t, std::vector<sp<WindowInfoHandle>>> handlesPerDisplay;
+    std::unordered_map<int32_t, std::vector<const WindowInfo*>> infosPerDisplay;
     for (const auto& info : update.windowInfos) {
-        handlesPerDisplay.emplace(info.displayId, std::vector<sp<WindowInfoHandle>>());
-        handlesPerDisplay[info.displayId].push_back(sp<WindowInfoHandle>::make(info));
+        infosPerDisplay[info.displayId].push_back(&info);
+    }
+
+    // When the update was made from a delta, only the displays with added, changed or removed
+    // windows need their windows to be set again.
+    std::unordered_set<int32_t> displaysWithChangedWindows;
+    if (update.changedWindowIds) {
+        const std::unordered_set<int32_t> changedWindowIds(update.changedWindowIds->begin(),
+                                                           update.changedWindowIds->end());
+        for (const auto& info : update.windowInfos) {
+            if (changedWindowIds.count(info.id) > 0) {
+                displaysWithChangedWindows.insert(info.displayId);
+            }
+        }
     }
 
     { // acquire lock
@@ -6878,15 +7065,33 @@ void InputDispatcher::onWindowInfosChanged(const gui::WindowInfosUpdate& update)
         // Ensure that we have an entry created for all existing displays so that if a displayId has
         // no windows, we can tell that the windows were removed from the display.
         for (const auto& [displayId, _] : mWindowHandlesByDisplay) {
-            handlesPerDisplay[displayId];
+            infosPerDisplay[displayId];
         }
 
-        mDisplayInfos.clear();
+        std::unordered_map<int32_t /*displayId*/, gui::DisplayInfo> oldDisplayInfos;
+        std::swap(oldDisplayInfos, mDisplayInfos);
         for (const auto& displayInfo : update.displayInfos) {
             mDisplayInfos.emplace(displayInfo.displayId, displayInfo);
         }
 
-        for (const auto& [displayId, handles] : handlesPerDisplay) {
+        for (const auto& [displayId, infos] : infosPerDisplay) {
+            if (update.changedWindowIds && displaysWithChangedWindows.count(displayId) == 0 &&
+                hasWindowIds(getWindowHandlesLocked(displayId), infos)) {
+                // The windows are the same, but their hit test index depends on the display.
+                const auto oldIt = oldDisplayInfos.find(displayId);
+                const auto newIt = mDisplayInfos.find(displayId);
+                const bool hadDisplayInfo = oldIt != oldDisplayInfos.end();
+                const bool hasDisplayInfo = newIt != mDisplayInfos.end();
+                if (hadDisplayInfo == hasDisplayInfo &&
+                    (!hasDisplayInfo || oldIt->second == newIt->second)) {
+                    continue;
+                }
+            }
+            std::vector<sp<WindowInfoHandle>> handles;
+            handles.reserve(infos.size());
+            for (const WindowInfo* info : infos) {
+                handles.push_back(sp<WindowInfoHandle>::make(*info));
+            }
             setInputWindowsLocked(handles, displayId);
         }
 
@@ -7054,6 +7259,16 @@ void InputDispatcher::setKeyRepeatConfiguration(std::chrono::nanoseconds timeout
     mConfig.keyRepeatDelay = delay.count();
 }
 
+void InputDispatcher::setPerDisplayDispatchEnabled(bool enabled) {
+    { // acquire lock
+        std::scoped_lock _l(mLock);
+        mPerDisplayDispatchEnabled = enabled;
+    } // release lock
+
+    // Wake the dispatcher, in case the pending event holds back events that can now go ahead.
+    mLooper->wake();
+}
+
 bool InputDispatcher::isPointerInWindow(const sp<android::IBinder>& token, int32_t displayId,
                                         DeviceId deviceId, int32_t pointerId) {
     std::scoped_lock _l(mLock);
@@ -31,6 +31,7 @@
 #include "LatencyTracker.h"
 #include "Monitor.h"
 #include "TouchState.h"
+#include "TouchableWindowIndex.h"
 #include "TouchedWindow.h"
 #include "trace/InputTracerInterface.h"
 #include "trace/InputTracingBackendInterface.h"
@@ -51,6 +52,7 @@
 #include <bitset>
 #include <condition_variable>
 #include <deque>
+#include <map>
 #include <optional>
 #include <unordered_map>
 #include <unordered_set>
@@ -155,6 +157,8 @@ public:
     void setKeyRepeatConfiguration(std::chrono::nanoseconds timeout,
                                    std::chrono::nanoseconds delay) override;
 
+    void setPerDisplayDispatchEnabled(bool enabled) override;
+
     bool isPointerInWindow(const sp<IBinder>& token, int32_t displayId, DeviceId deviceId,
                            int32_t pointerId) override;
 
@@ -224,6 +228,12 @@ private:
     void dispatchOnce();
 
     void dispatchOnceInnerLocked(nsecs_t& nextWakeupTime) REQUIRES(mLock);
+    // Dispatches mPendingEvent, and releases it if it is done. Returns false if it has to wait.
+    bool dispatchPendingEventLocked(nsecs_t currentTime, nsecs_t& nextWakeupTime) REQUIRES(mLock);
+    // With per-display dispatch, dispatches the inbound events that are not held back by the
+    // pending event, which has to wait.
+    void dispatchEventsBehindBlockedEventLocked(nsecs_t currentTime, nsecs_t& nextWakeupTime)
+            REQUIRES(mLock);
 
     // Enqueues an inbound event.  Returns true if mLooper->wake() should be called.
     bool enqueueInboundEventLocked(std::unique_ptr<EventEntry> entry) REQUIRES(mLock);
@@ -334,6 +344,7 @@ private:
     // Dispatch state.
     bool mDispatchEnabled GUARDED_BY(mLock);
     bool mDispatchFrozen GUARDED_BY(mLock);
+    bool mPerDisplayDispatchEnabled GUARDED_BY(mLock);
     bool mInputFilterEnabled GUARDED_BY(mLock);
     float mMaximumObscuringOpacityForTouch GUARDED_BY(mLock);
 
@@ -356,6 +367,10 @@ private:
             mWindowHandlesByDisplay GUARDED_BY(mLock);
     std::unordered_map<int32_t /*displayId*/, android::gui::DisplayInfo> mDisplayInfos
             GUARDED_BY(mLock);
+    // Built from mWindowHandlesByDisplay and mDisplayInfos whenever the windows of a display are
+    // set, for the hit tests of touches.
+    std::unordered_map<int32_t /*displayId*/, TouchableWindowIndex> mTouchableWindowIndexByDisplay
+            GUARDED_BY(mLock);
     void setInputWindowsLocked(
             const std::vector<sp<android::gui::WindowInfoHandle>>& inputWindowHandles,
             int32_t displayId) REQUIRES(mLock);
@@ -363,6 +378,9 @@ private:
     const std::vector<sp<android::gui::WindowInfoHandle>>& getWindowHandlesLocked(
             int32_t displayId) const REQUIRES(mLock);
     ui::Transform getTransformLocked(int32_t displayId) const REQUIRES(mLock);
+    // Get the hit test index of a display, return an empty index if not found.
+    const TouchableWindowIndex& getTouchableWindowIndexLocked(int32_t displayId) const
+            REQUIRES(mLock);
 
     sp<android::gui::WindowInfoHandle> getWindowHandleLocked(
             const sp<IBinder>& windowHandleToken, std::optional<int32_t> displayId = {}) const
@@ -460,13 +478,24 @@ private:
     void logOutboundMotionDetails(const char* prefix, const MotionEntry& entry);
 
     /**
-     * This field is set if there is no focused window, and we have an event that requires
-     * a focused window to be dispatched (for example, a KeyEvent).
-     * When this happens, we will wait until *mNoFocusedWindowTimeoutTime before
-     * dropping the event and raising an ANR for that application.
+     * The focused application of a display at the time when no focused window was present, and
+     * the time to stop waiting for it.
+     */
+    struct AwaitedFocusedApplication {
+        std::shared_ptr<InputApplicationHandle> application;
+        nsecs_t timeoutTime;
+    };
+    /**
+     * An entry is added for a display if there is no focused window, and we have an event that
+     * requires a focused window to be dispatched (for example, a KeyEvent).
+     * When this happens, we will wait until the timeoutTime before dropping the event and raising
+     * an ANR for that application.
      * This is useful if an application is slow to add a focused window.
+     * Every display waits separately, so that the events that per-display dispatch lets through
+     * do not restart or cancel the wait of a blocked display.
      */
-    std::optional<nsecs_t> mNoFocusedWindowTimeoutTime GUARDED_BY(mLock);
+    std::map<int32_t /*displayId*/, AwaitedFocusedApplication> mAwaitedFocusedApplications
+            GUARDED_BY(mLock);
 
     bool isStaleEvent(nsecs_t currentTime, const EventEntry& entry);
 
@@ -476,22 +505,19 @@ private:
      * Time to stop waiting for the events to be processed while trying to dispatch a key.
      * When this time expires, we just send the pending key event to the currently focused window,
      * without waiting on other events to be processed first.
+     * With per-display dispatch, a key sent to a specific display only waits for the events of that
+     * display, so it has its own timeout. Every other key uses the ADISPLAY_ID_NONE entry.
      */
-    std::optional<nsecs_t> mKeyIsWaitingForEventsTimeout GUARDED_BY(mLock);
-    bool shouldWaitToSendKeyLocked(nsecs_t currentTime, const char* focusedWindowName)
+    std::map<int32_t /*displayId*/, nsecs_t> mKeyIsWaitingForEventsTimeouts GUARDED_BY(mLock);
+    int32_t getKeyWaitingScopeLocked(const KeyEntry& entry) const REQUIRES(mLock);
+    bool shouldWaitToSendKeyLocked(nsecs_t currentTime, const KeyEntry& entry,
+                                   const char* focusedWindowName) REQUIRES(mLock);
+    bool hasUnprocessedEventsOnDisplayLocked(int32_t displayId) const REQUIRES(mLock);
+
+    void processNoFocusedWindowAnrLocked(int32_t displayId,
+                                         const std::shared_ptr<InputApplicationHandle>& application)
             REQUIRES(mLock);
 
-    /**
-     * The focused application at the time when no focused window was present.
-     * Used to raise an ANR when we have no focused window.
-     */
-    std::shared_ptr<InputApplicationHandle> mAwaitedFocusedApplication GUARDED_BY(mLock);
-    /**
-     * The displayId that the focused application is associated with.
-     */
-    int32_t mAwaitedApplicationDisplayId GUARDED_BY(mLock);
-    void processNoFocusedWindowAnrLocked() REQUIRES(mLock);
-
     /**
      * Tell policy about a window or a monitor that just became unresponsive. Starts ANR.
      */
@@ -522,6 +548,8 @@ private:
     // focused application does not have a focused window (no ANR will be raised if notification
     // shade is pulled down while we are counting down the timeout).
     void resetNoFocusedWindowTimeoutLocked() REQUIRES(mLock);
+    // Only resets the wait of the given display with per-display dispatch, every wait otherwise.
+    void resetNoFocusedWindowTimeoutLocked(int32_t displayId) REQUIRES(mLock);
 
     int32_t getTargetDisplayId(const EventEntry& entry);
     sp<android::gui::WindowInfoHandle> findFocusedWindowTargetLocked(
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TouchableWindowIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+using android::gui::WindowInfo;
+using android::gui::WindowInfoHandle;
+
+namespace android::inputdispatcher {
+
+namespace {
+
+// The grid has about as many cells as there are windows, up to this many rows and columns.
+constexpr int32_t MAX_GRID_SIZE = 16;
+
+bool canEverAcceptTouch(const WindowInfo& info) {
+    if (info.inputConfig.test(WindowInfo::InputConfig::NOT_VISIBLE)) {
+        return false;
+    }
+    return !info.inputConfig.test(WindowInfo::InputConfig::NOT_TOUCHABLE) ||
+            info.interceptsStylus();
+}
+
+// Cells overlapped by a window, including the last row and column.
+struct CellRange {
+    int32_t left;
+    int32_t top;
+    int32_t right;
+    int32_t bottom;
+};
+
+int64_t divideRoundingUp(int64_t dividend, int64_t divisor) {
+    return (dividend + divisor - 1) / divisor;
+}
+
+// Regions may span the whole int32_t range, so offsets from the grid origin are computed in 64
+// bits. The cell is clamped to the grid in case rounding put an edge one cell too far.
+int32_t cellFor(int32_t coordinate, int32_t origin, int64_t cellSize, int32_t cellCount) {
+    const int64_t cell = (int64_t(coordinate) - origin) / cellSize;
+    return static_cast<int32_t>(std::clamp<int64_t>(cell, 0, cellCount - 1));
+}
+
+} // namespace
+
+TouchableWindowIndex::TouchableWindowIndex(
+        const std::vector<sp<WindowInfoHandle>>& windowHandles,
+        const ui::Transform& displayTransform)
+      : mDisplayTransform(displayTransform) {
+    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
+        const WindowInfo& info = *windowHandle->getInfo();
+        if (!canEverAcceptTouch(info)) {
+            continue;
+        }
+        // Window Manager works in the logical display coordinate space. When it specifies bounds
+        // for a window as (l, t, r, b), the range of x in [l, r) and y in [t, b) are considered to
+        // be inside the window. Points on the right and bottom edges should not be inside the
+        // window, which only holds in the logical display space when the display is rotated, so
+        // perform hit tests in that space.
+        Region touchableRegion = displayTransform.transform(info.touchableRegion);
+        if (touchableRegion.isEmpty()) {
+            continue;
+        }
+        const Rect bounds = touchableRegion.getBounds();
+        if (mEntries.empty()) {
+            mBounds = bounds;
+        } else {
+            mBounds.left = std::min(mBounds.left, bounds.left);
+            mBounds.top = std::min(mBounds.top, bounds.top);
+            mBounds.right = std::max(mBounds.right, bounds.right);
+            mBounds.bottom = std::max(mBounds.bottom, bounds.bottom);
+        }
+        mEntries.push_back({windowHandle, std::move(touchableRegion)});
+    }
+    if (mEntries.empty()) {
+        return;
+    }
+
+    const int32_t gridSize =
+            std::clamp(static_cast<int32_t>(std::ceil(std::sqrt(mEntries.size()))), 1,
+                       MAX_GRID_SIZE);
+    const int64_t width = int64_t(mBounds.right) - mBounds.left;
+    const int64_t height = int64_t(mBounds.bottom) - mBounds.top;
+    mCellWidth = divideRoundingUp(width, gridSize);
+    mCellHeight = divideRoundingUp(height, gridSize);
+    mColumns = static_cast<int32_t>(divideRoundingUp(width, mCellWidth));
+    mRows = static_cast<int32_t>(divideRoundingUp(height, mCellHeight));
+
+    // Each window is listed in every cell its bounds overlap. Count them first, so that the lists
+    // can be laid out one after another.
+    std::vector<CellRange> cellRanges;
+    cellRanges.reserve(mEntries.size());
+    std::vector<uint32_t> counts(size_t(mColumns) * mRows + 1, 0);
+    for (const Entry& entry : mEntries) {
+        const Rect bounds = entry.touchableRegion.getBounds();
+        const CellRange range{
+                .left = cellFor(bounds.left, mBounds.left, mCellWidth, mColumns),
+                .top = cellFor(bounds.top, mBounds.top, mCellHeight, mRows),
+                .right = cellFor(bounds.right - 1, mBounds.left, mCellWidth, mColumns),
+                .bottom = cellFor(bounds.bottom - 1, mBounds.top, mCellHeight, mRows),
+        };
+        for (int32_t row = range.top; row <= range.bottom; row++) {
+            for (int32_t column = range.left; column <= range.right; column++) {
+                counts[row * mColumns + column]++;
+            }
+        }
+        cellRanges.push_back(range);
+    }
+
+    mCellStart.resize(counts.size());
+    uint32_t start = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        mCellStart[i] = start;
+        start += counts[i];
+    }
+    mCellEntries.resize(start);
+
+    // Filling the cells in window order keeps every list ordered front to back.
+    std::vector<uint32_t> next(mCellStart.begin(), mCellStart.end() - 1);
+    for (uint32_t index = 0; index < mEntries.size(); index++) {
+        const CellRange& range = cellRanges[index];
+        for (int32_t row = range.top; row <= range.bottom; row++) {
+            for (int32_t column = range.left; column <= range.right; column++) {
+                mCellEntries[next[row * mColumns + column]++] = index;
+            }
+        }
+    }
+}
+
+int32_t TouchableWindowIndex::cellAt(int32_t x, int32_t y) const {
+    if (mEntries.empty() || x < mBounds.left || x >= mBounds.right || y < mBounds.top ||
+        y >= mBounds.bottom) {
+        return -1;
+    }
+    const int32_t column = cellFor(x, mBounds.left, mCellWidth, mColumns);
+    const int32_t row = cellFor(y, mBounds.top, mCellHeight, mRows);
+    return row * mColumns + column;
+}
+
+void TouchableWindowIndex::forEachWindowAt(
+        float x, float y, bool isStylus,
+        const std::function<bool(const sp<WindowInfoHandle>&)>& visitor) const {
+    const vec2 p = mDisplayTransform.transform(x, y);
+    const float fx = std::floor(p.x);
+    const float fy = std::floor(p.y);
+    // No touchable region reaches outside of the int32_t range.
+    if (!(fx >= float(INT32_MIN) && fx < -float(INT32_MIN) && fy >= float(INT32_MIN) &&
+          fy < -float(INT32_MIN))) {
+        return;
+    }
+    const int32_t px = static_cast<int32_t>(fx);
+    const int32_t py = static_cast<int32_t>(fy);
+    const int32_t cell = cellAt(px, py);
+    if (cell < 0) {
+        return;
+    }
+
+    for (uint32_t i = mCellStart[cell]; i < mCellStart[cell + 1]; i++) {
+        const Entry& entry = mEntries[mCellEntries[i]];
+        const WindowInfo& info = *entry.windowHandle->getInfo();
+        if (info.inputConfig.test(WindowInfo::InputConfig::NOT_TOUCHABLE) &&
+            !(isStylus && info.interceptsStylus())) {
+            continue;
+        }
+        if (!entry.touchableRegion.contains(px, py)) {
+            continue;
+        }
+        if (!visitor(entry.windowHandle)) {
+            return;
+        }
+    }
+}
+
+} // namespace android::inputdispatcher
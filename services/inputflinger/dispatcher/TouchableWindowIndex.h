@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
+#include <gui/WindowInfo.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+#include <ui/Transform.h>
+
+namespace android::inputdispatcher {
+
+// Finds the windows of a display that can be touched at a location, without checking every
+// window on the display.
+//
+// When the index is built, the touchable regions of the windows are transformed into the logical
+// display space, and the area they cover is divided into a grid. Each cell of the grid lists the
+// windows whose touchable region overlaps it, in the same front to back order as the window list.
+// A lookup transforms the location once and only checks the windows of its cell.
+//
+// The index must be rebuilt when the windows or the display transform change.
+class TouchableWindowIndex {
+public:
+    TouchableWindowIndex() = default;
+    TouchableWindowIndex(const std::vector<sp<gui::WindowInfoHandle>>& windowHandles,
+                         const ui::Transform& displayTransform);
+
+    // Calls visitor with each window that accepts a touch at (x, y), given in display space, from
+    // front to back, until visitor returns false.
+    void forEachWindowAt(float x, float y, bool isStylus,
+                         const std::function<bool(const sp<gui::WindowInfoHandle>&)>& visitor) const;
+
+private:
+    struct Entry {
+        sp<gui::WindowInfoHandle> windowHandle;
+        // Touchable region in logical display space.
+        Region touchableRegion;
+    };
+
+    // Returns the cell holding the point, or -1 if it is outside of every window.
+    int32_t cellAt(int32_t x, int32_t y) const;
+
+    ui::Transform mDisplayTransform;
+    std::vector<Entry> mEntries;
+
+    // Area covered by the touchable regions, and the size of the cells it is divided into.
+    Rect mBounds;
+    int32_t mColumns = 0;
+    int32_t mRows = 0;
+    int64_t mCellWidth = 1;
+    int64_t mCellHeight = 1;
+
+    // Indices into mEntries of the windows overlapping cell i are
+    // mCellEntries[mCellStart[i]] to mCellEntries[mCellStart[i + 1] - 1].
+    std::vector<uint32_t> mCellStart;
+    std::vector<uint32_t> mCellEntries;
+};
+
+} // namespace android::inputdispatcher
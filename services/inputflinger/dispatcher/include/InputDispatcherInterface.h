@@ -231,6 +231,14 @@ public:
     virtual void setKeyRepeatConfiguration(std::chrono::nanoseconds timeout,
                                            std::chrono::nanoseconds delay) = 0;
 
+    /*
+     * Enables or disables per-display dispatch. By default, an event that has to wait before it can
+     * be dispatched holds back all the events behind it. With per-display dispatch, it only holds
+     * back the events for the same display or from the same device, and a key only waits for the
+     * events that were sent to its own display to be processed.
+     */
+    virtual void setPerDisplayDispatchEnabled(bool enabled) = 0;
+
     /*
      * Determine if a pointer from a device is being dispatched to the given window.
      */
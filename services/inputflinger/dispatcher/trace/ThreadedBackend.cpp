@@ -38,70 +38,91 @@ struct Visitor : V... {
 
 template <typename Backend>
 ThreadedBackend<Backend>::ThreadedBackend(Backend&& innerBackend)
-      : mTracerThread(
-                "InputTracer", [this]() { threadLoop(); },
-                [this]() { mThreadWakeCondition.notify_all(); }),
-        mBackend(std::move(innerBackend)) {}
+      : mQueue(QUEUE_CAPACITY),
+        mBackend(std::move(innerBackend)),
+        mTracerThread(
+                "InputTracer", [this]() { threadLoop(); }, [this]() { wakeTracerThread(); }) {}
 
 template <typename Backend>
 ThreadedBackend<Backend>::~ThreadedBackend() {
-    {
-        std::scoped_lock lock(mLock);
-        mThreadExit = true;
-    }
-    mThreadWakeCondition.notify_all();
+    mThreadExit = true;
+    wakeTracerThread();
 }
 
 template <typename Backend>
 void ThreadedBackend<Backend>::traceMotionEvent(const TracedMotionEvent& event) {
-    std::scoped_lock lock(mLock);
-    mQueue.emplace_back(event);
-    mThreadWakeCondition.notify_all();
+    enqueue(event);
 }
 
 template <typename Backend>
 void ThreadedBackend<Backend>::traceKeyEvent(const TracedKeyEvent& event) {
-    std::scoped_lock lock(mLock);
-    mQueue.emplace_back(event);
-    mThreadWakeCondition.notify_all();
+    enqueue(event);
 }
 
 template <typename Backend>
 void ThreadedBackend<Backend>::traceWindowDispatch(const WindowDispatchArgs& dispatchArgs) {
-    std::scoped_lock lock(mLock);
-    mQueue.emplace_back(dispatchArgs);
-    mThreadWakeCondition.notify_all();
+    enqueue(dispatchArgs);
 }
 
 template <typename Backend>
-void ThreadedBackend<Backend>::threadLoop() {
-    std::vector<TraceEntry> entries;
-
+template <typename Entry>
+void ThreadedBackend<Backend>::enqueue(const Entry& entry) {
     { // acquire lock
-        std::unique_lock lock(mLock);
-        base::ScopedLockAssertion assumeLocked(mLock);
-
-        // Wait until we need to process more events or exit.
-        mThreadWakeCondition.wait(lock,
-                                  [&]() REQUIRES(mLock) { return mThreadExit || !mQueue.empty(); });
-        if (mThreadExit) {
+        std::scoped_lock lock(mProducerLock);
+        const size_t head = mQueueHead.load(std::memory_order_relaxed);
+        if (head - mQueueTail.load(std::memory_order_acquire) >= QUEUE_CAPACITY) {
+            // The tracing thread is behind. Drop the entry rather than wait for it.
+            mDroppedEntryCount.fetch_add(1, std::memory_order_relaxed);
             return;
         }
-
-        mQueue.swap(entries);
+        // When the slot last held the same kind of entry, this reuses its allocations.
+        mQueue[head % QUEUE_CAPACITY] = entry;
+        mQueueHead.store(head + 1, std::memory_order_release);
     } // release lock
+    wakeTracerThread();
+}
+
+template <typename Backend>
+void ThreadedBackend<Backend>::wakeTracerThread() {
+    mWakeSignal.fetch_add(1, std::memory_order_release);
+    mWakeSignal.notify_one();
+}
 
-    // Trace the events into the backend without holding the lock to reduce the amount of
-    // work performed in the critical section.
-    for (const auto& entry : entries) {
+template <typename Backend>
+void ThreadedBackend<Backend>::threadLoop() {
+    // Read the signal before checking for work, so that anything published after the check
+    // changes the signal and ends the wait below.
+    const uint32_t signal = mWakeSignal.load(std::memory_order_acquire);
+    if (mThreadExit) {
+        return;
+    }
+
+    const size_t head = mQueueHead.load(std::memory_order_acquire);
+    size_t tail = mQueueTail.load(std::memory_order_relaxed);
+    if (tail == head) {
+        // Wait until we need to process more events or exit.
+        mWakeSignal.wait(signal, std::memory_order_acquire);
+        return;
+    }
+
+    // Trace the events into the backend directly from their slots. Each slot is handed back to
+    // the traced threads as soon as it has been traced.
+    for (; tail != head; tail++) {
         std::visit(Visitor{[&](const TracedMotionEvent& e) { mBackend.traceMotionEvent(e); },
                            [&](const TracedKeyEvent& e) { mBackend.traceKeyEvent(e); },
                            [&](const WindowDispatchArgs& args) {
                                mBackend.traceWindowDispatch(args);
                            }},
-                   entry);
+                   mQueue[tail % QUEUE_CAPACITY]);
+        mQueueTail.store(tail + 1, std::memory_order_release);
+    }
+
+    const size_t droppedEntryCount = mDroppedEntryCount.load(std::memory_order_relaxed);
+    if (droppedEntryCount != mReportedDroppedEntryCount) {
+        LOG(WARNING) << "Dropped " << droppedEntryCount - mReportedDroppedEntryCount
+                     << " trace entries because the tracing thread could not keep up";
+        mReportedDroppedEntryCount = droppedEntryCount;
     }
-    entries.clear();
 }
 
 // Explicit template instantiation for the PerfettoBackend.
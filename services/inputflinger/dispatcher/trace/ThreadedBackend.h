@@ -19,7 +19,7 @@
 #include "InputThread.h"
 #include "InputTracingPerfettoBackend.h"
 
-#include <android-base/thread_annotations.h>
+#include <atomic>
 #include <mutex>
 #include <variant>
 #include <vector>
@@ -31,6 +31,10 @@ namespace android::inputdispatcher::trace::impl {
  * from a single new thread that it creates. The new tracing thread is started when the
  * ThreadedBackend is created, and is stopped when it is destroyed. The ThreadedBackend is
  * thread-safe.
+ *
+ * Traced entries are handed to the tracing thread through a bounded ring of preallocated slots.
+ * The tracing thread never holds a lock that the traced threads need, so tracing an event does not
+ * wait for the backend. When the ring is full, new entries are dropped and counted.
  */
 template <typename Backend>
 class ThreadedBackend : public InputTracingBackendInterface {
@@ -42,17 +46,36 @@ public:
     void traceMotionEvent(const TracedMotionEvent&) override;
     void traceWindowDispatch(const WindowDispatchArgs&) override;
 
+    // The number of entries that can wait for the tracing thread before new ones are dropped.
+    static constexpr size_t QUEUE_CAPACITY = 512;
+
 private:
-    std::mutex mLock;
-    InputThread mTracerThread;
-    bool mThreadExit GUARDED_BY(mLock){false};
-    std::condition_variable mThreadWakeCondition;
-    Backend mBackend;
+    using WindowDispatchArgs = InputTracingBackendInterface::WindowDispatchArgs;
     using TraceEntry = std::variant<TracedKeyEvent, TracedMotionEvent, WindowDispatchArgs>;
-    std::vector<TraceEntry> mQueue GUARDED_BY(mLock);
 
-    using WindowDispatchArgs = InputTracingBackendInterface::WindowDispatchArgs;
+    // Serializes the threads that trace entries. The tracing thread never acquires it.
+    std::mutex mProducerLock;
+    // The slots are reused, so an entry is copied into the memory of the entry that used the slot
+    // before it, instead of being allocated.
+    std::vector<TraceEntry> mQueue;
+    // Entries [mQueueTail, mQueueHead) are waiting for the tracing thread. Both only increase, and
+    // the slot of an entry is its index modulo QUEUE_CAPACITY. mQueueHead is only written by the
+    // traced threads, and mQueueTail by the tracing thread.
+    std::atomic<size_t> mQueueHead{0};
+    std::atomic<size_t> mQueueTail{0};
+    std::atomic<size_t> mDroppedEntryCount{0};
+    size_t mReportedDroppedEntryCount{0};
+    std::atomic<bool> mThreadExit{false};
+    // Incremented to wake up the tracing thread, which waits for it to change.
+    std::atomic<uint32_t> mWakeSignal{0};
+    Backend mBackend;
+    // Declared last, so that the thread is started after and stopped before everything it uses
+    // is destroyed.
+    InputThread mTracerThread;
 
+    template <typename Entry>
+    void enqueue(const Entry& entry);
+    void wakeTracerThread();
     void threadLoop();
 };
 
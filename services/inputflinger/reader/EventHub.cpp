@@ -1845,11 +1845,18 @@ std::optional<int32_t> EventHub::getBatteryStatus(int32_t deviceId, int32_t batt
 }
 
 std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
+    std::vector<RawEvent> events(EVENT_BUFFER_SIZE);
+    events.resize(getEvents(timeoutMillis, events.data(), events.size()));
+    return events;
+}
+
+size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSize) {
+    LOG_ALWAYS_FATAL_IF(bufferSize == 0, "getEvents needs room for at least one event");
     std::scoped_lock _l(mLock);
 
     std::array<input_event, EVENT_BUFFER_SIZE> readBuffer;
 
-    std::vector<RawEvent> events;
+    size_t count = 0;
     bool awoken = false;
     for (;;) {
         nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
@@ -1866,22 +1873,19 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
         }
 
         // Report any devices that had last been added/removed.
-        for (auto it = mClosingDevices.begin(); it != mClosingDevices.end();) {
+        for (auto it = mClosingDevices.begin(); it != mClosingDevices.end() && count < bufferSize;) {
             std::unique_ptr<Device> device = std::move(*it);
             ALOGV("Reporting device closed: id=%d, name=%s\n", device->id, device->path.c_str());
             const int32_t deviceId = (device->id == mBuiltInKeyboardId)
                     ? ReservedInputDeviceId::BUILT_IN_KEYBOARD_ID
                     : device->id;
-            events.push_back({
+            buffer[count++] = {
                     .when = now,
                     .deviceId = deviceId,
                     .type = DEVICE_REMOVED,
-            });
+            };
             it = mClosingDevices.erase(it);
             mNeedToSendFinishedDeviceScan = true;
-            if (events.size() == EVENT_BUFFER_SIZE) {
-                break;
-            }
         }
 
         if (mNeedToScanDevices) {
@@ -1890,16 +1894,16 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
             mNeedToSendFinishedDeviceScan = true;
         }
 
-        while (!mOpeningDevices.empty()) {
+        while (!mOpeningDevices.empty() && count < bufferSize) {
             std::unique_ptr<Device> device = std::move(*mOpeningDevices.rbegin());
             mOpeningDevices.pop_back();
             ALOGV("Reporting device opened: id=%d, name=%s\n", device->id, device->path.c_str());
             const int32_t deviceId = device->id == mBuiltInKeyboardId ? 0 : device->id;
-            events.push_back({
+            buffer[count++] = {
                     .when = now,
                     .deviceId = deviceId,
                     .type = DEVICE_ADDED,
-            });
+            };
 
             // Try to find a matching video device by comparing device names
             for (auto it = mUnattachedVideoDevices.begin(); it != mUnattachedVideoDevices.end();
@@ -1917,25 +1921,19 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
                 ALOGW("Device id %d exists, replaced.", device->id);
             }
             mNeedToSendFinishedDeviceScan = true;
-            if (events.size() == EVENT_BUFFER_SIZE) {
-                break;
-            }
         }
 
-        if (mNeedToSendFinishedDeviceScan) {
+        if (mNeedToSendFinishedDeviceScan && count < bufferSize) {
             mNeedToSendFinishedDeviceScan = false;
-            events.push_back({
+            buffer[count++] = {
                     .when = now,
                     .type = FINISHED_DEVICE_SCAN,
-            });
-            if (events.size() == EVENT_BUFFER_SIZE) {
-                break;
-            }
+            };
         }
 
         // Grab the next input event.
         bool deviceChanged = false;
-        while (mPendingEventIndex < mPendingEventCount) {
+        while (mPendingEventIndex < mPendingEventCount && count < bufferSize) {
             const struct epoll_event& eventItem = mPendingEventItems[mPendingEventIndex++];
             if (eventItem.data.fd == mINotifyFd) {
                 if (eventItem.events & EPOLLIN) {
@@ -1991,9 +1989,11 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
             }
             // This must be an input event
             if (eventItem.events & EPOLLIN) {
+                // Read as many events as the caller has room for, all at once.
+                const size_t readCapacity = std::min(readBuffer.size(), bufferSize - count);
                 int32_t readSize =
                         read(device->fd, readBuffer.data(),
-                             sizeof(decltype(readBuffer)::value_type) * readBuffer.size());
+                             sizeof(decltype(readBuffer)::value_type) * readCapacity);
                 if (readSize == 0 || (readSize < 0 && errno == ENODEV)) {
                     // Device was removed before INotify noticed.
                     ALOGW("could not get event, removed? (fd: %d size: %" PRId32
@@ -2009,21 +2009,23 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
                     ALOGE("could not get event (wrong size: %d)", readSize);
                 } else {
                     const int32_t deviceId = device->id == mBuiltInKeyboardId ? 0 : device->id;
+                    // The events were all read by the same call.
+                    const nsecs_t readTime = systemTime(SYSTEM_TIME_MONOTONIC);
 
-                    const size_t count = size_t(readSize) / sizeof(struct input_event);
-                    for (size_t i = 0; i < count; i++) {
+                    const size_t readCount = size_t(readSize) / sizeof(struct input_event);
+                    for (size_t i = 0; i < readCount; i++) {
                         struct input_event& iev = readBuffer[i];
                         device->trackInputEvent(iev);
-                        events.push_back({
+                        buffer[count++] = {
                                 .when = processEventTimestamp(iev),
-                                .readTime = systemTime(SYSTEM_TIME_MONOTONIC),
+                                .readTime = readTime,
                                 .deviceId = deviceId,
                                 .type = iev.type,
                                 .code = iev.code,
                                 .value = iev.value,
-                        });
+                        };
                     }
-                    if (events.size() >= EVENT_BUFFER_SIZE) {
+                    if (count == bufferSize) {
                         // The result buffer is full.  Reset the pending event index
                         // so we will try to read the device again on the next iteration.
                         mPendingEventIndex -= 1;
@@ -2059,7 +2061,7 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
         }
 
         // Return now if we have collected any events or if we were explicitly awoken.
-        if (!events.empty() || awoken) {
+        if (count > 0 || awoken) {
             break;
         }
 
@@ -2105,7 +2107,7 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
     }
 
     // All done, return the number of events we read.
-    return events;
+    return count;
 }
 
 std::vector<TouchVideoFrame> EventHub::getVideoFrames(int32_t deviceId) {
@@ -133,14 +133,15 @@ void InputReader::loopOnce() {
         }
     } // release lock
 
-    std::vector<RawEvent> events = mEventHub->getEvents(timeoutMillis);
+    const size_t count = mEventHub->getEvents(timeoutMillis, mEventBuffer.data(),
+                                              mEventBuffer.size());
 
     { // acquire lock
         std::scoped_lock _l(mLock);
         mReaderIsAliveCondition.notify_all();
 
-        if (!events.empty()) {
-            mPendingArgs += processEventsLocked(events.data(), events.size());
+        if (count > 0) {
+            mPendingArgs += processEventsLocked(mEventBuffer.data(), count);
         }
 
         if (mNextTimeout != LLONG_MAX) {
@@ -308,6 +308,14 @@ public:
      * Returns the number of events obtained, or 0 if the timeout expired.
      */
     virtual std::vector<RawEvent> getEvents(int timeoutMillis) = 0;
+    /*
+     * Same as getEvents, but writes the events into a buffer owned by the caller, which has room
+     * for bufferSize events, so that nothing is allocated. bufferSize must not be 0. The events
+     * which do not fit into the buffer are returned by the next call.
+     *
+     * Returns the number of events obtained, or 0 if the timeout expired.
+     */
+    virtual size_t getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSize) = 0;
     virtual std::vector<TouchVideoFrame> getVideoFrames(int32_t deviceId) = 0;
     virtual base::Result<std::pair<InputDeviceSensorType, int32_t>> mapSensor(
             int32_t deviceId, int32_t absCode) const = 0;
@@ -563,6 +571,7 @@ public:
                                uint8_t* outFlags) const override final;
 
     std::vector<RawEvent> getEvents(int timeoutMillis) override final;
+    size_t getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSize) override final;
     std::vector<TouchVideoFrame> getVideoFrames(int32_t deviceId) override final;
 
     bool hasScanCode(int32_t deviceId, int32_t scanCode) const override final;
@@ -21,6 +21,7 @@
 #include <utils/Condition.h>
 #include <utils/Mutex.h>
 
+#include <array>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -178,6 +179,11 @@ private:
     std::shared_ptr<EventHubInterface> mEventHub;
     sp<InputReaderPolicyInterface> mPolicy;
 
+    // The raw events read from the EventHub by the last loop. Only used by the reader thread, and
+    // reused so that reading events does not allocate.
+    static constexpr size_t EVENT_BUFFER_SIZE = 256;
+    std::array<RawEvent, EVENT_BUFFER_SIZE> mEventBuffer;
+
     // The next stage that should receive the events generated inside InputReader.
     InputListenerInterface& mNextListener;
     // As various events are generated inside InputReader, they are stored inside this list. The
@@ -22,6 +22,7 @@
 #include <inttypes.h>
 #include <linux/uinput.h>
 #include <log/log.h>
+#include <array>
 #include <chrono>
 
 #define TAG "EventHub_test"
@@ -218,6 +219,29 @@ TEST_F(EventHubTest, InputEvent_TimestampIsMonotonic) {
     }
 }
 
+/**
+ * Ensure that events that don't fit into the caller's buffer are returned by the next call,
+ * in order.
+ */
+TEST_F(EventHubTest, GetEvents_WithSmallBuffer_ReturnsRemainingEventsOnNextCall) {
+    ASSERT_NO_FATAL_FAILURE(mKeyboard->pressAndReleaseHomeKey());
+
+    std::array<RawEvent, 1> buffer;
+    std::vector<RawEvent> events;
+    while (events.size() < 4) {
+        const size_t count = mEventHub->getEvents(std::chrono::milliseconds(2s).count(),
+                                                  buffer.data(), buffer.size());
+        ASSERT_EQ(1U, count) << "Received " << events.size() << " events before timing out";
+        events.push_back(buffer[0]);
+    }
+    EXPECT_EQ(EV_KEY, events[0].type);
+    EXPECT_EQ(1, events[0].value);
+    EXPECT_EQ(EV_SYN, events[1].type);
+    EXPECT_EQ(EV_KEY, events[2].type);
+    EXPECT_EQ(0, events[2].value);
+    EXPECT_EQ(EV_SYN, events[3].type);
+}
+
 // --- BitArrayTest ---
 class BitArrayTest : public testing::Test {
 protected:
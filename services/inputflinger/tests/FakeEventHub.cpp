@@ -16,6 +16,8 @@
 
 #include "FakeEventHub.h"
 
+#include <algorithm>
+
 #include <android-base/thread_annotations.h>
 #include <gtest/gtest.h>
 #include <linux/input-event-codes.h>
@@ -369,6 +371,17 @@ std::vector<RawEvent> FakeEventHub::getEvents(int) {
     return buffer;
 }
 
+size_t FakeEventHub::getEvents(int, RawEvent* buffer, size_t bufferSize) {
+    std::scoped_lock lock(mLock);
+
+    const size_t count = std::min(bufferSize, mEvents.size());
+    std::copy(mEvents.begin(), mEvents.begin() + count, buffer);
+    mEvents.erase(mEvents.begin(), mEvents.begin() + count);
+
+    mEventsCondition.notify_all();
+    return count;
+}
+
 std::vector<TouchVideoFrame> FakeEventHub::getVideoFrames(int32_t deviceId) {
     auto it = mVideoFrames.find(deviceId);
     if (it != mVideoFrames.end()) {
@@ -182,6 +182,7 @@ private:
             int32_t deviceId, int32_t absCode) const override;
     void setExcludedDevices(const std::vector<std::string>& devices) override;
     std::vector<RawEvent> getEvents(int) override;
+    size_t getEvents(int, RawEvent* buffer, size_t bufferSize) override;
     std::vector<TouchVideoFrame> getVideoFrames(int32_t deviceId) override;
     int32_t getScanCodeState(int32_t deviceId, int32_t scanCode) const override;
     std::optional<RawLayoutInfo> getRawLayoutInfo(int32_t deviceId) const override;
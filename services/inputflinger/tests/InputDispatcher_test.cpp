@@ -400,6 +400,11 @@ public:
         }
     }
 
+    void clearUserActivityPokes() {
+        std::scoped_lock lock(mLock);
+        mUserActivityPokeEvents = {};
+    }
+
     void assertNotifyDeviceInteractionWasCalled(int32_t deviceId, std::set<gui::Uid> uids) {
         ASSERT_EQ(std::make_pair(deviceId, uids), mNotifiedInteractions.popWithTimeout(100ms));
     }
@@ -1843,6 +1848,44 @@ TEST_F(InputDispatcherTest, SetInputWindowTwice_SingleWindowTouch) {
     window->consumeMotionDown(ADISPLAY_ID_DEFAULT);
 }
 
+/**
+ * An update made from a delta only sets the windows of the displays which changed. The windows of
+ * the other displays keep working, and windows removed by the delta are gone.
+ */
+TEST_F(InputDispatcherTest, SetInputWindowsFromDelta_UpdatesChangedDisplays) {
+    std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
+    sp<FakeWindowHandle> window = sp<FakeWindowHandle>::make(application, mDispatcher,
+                                                             "Fake Window", ADISPLAY_ID_DEFAULT);
+    window->setFrame(Rect(0, 0, 100, 100));
+    sp<FakeWindowHandle> secondWindow = sp<FakeWindowHandle>::make(application, mDispatcher,
+                                                                   "Second Window",
+                                                                   SECOND_DISPLAY_ID);
+    secondWindow->setFrame(Rect(0, 0, 100, 100));
+    mDispatcher->onWindowInfosChanged({{*window->getInfo(), *secondWindow->getInfo()}, {}, 0, 0});
+
+    window->setFrame(Rect(100, 0, 200, 100));
+    gui::WindowInfosUpdate update{{*window->getInfo(), *secondWindow->getInfo()}, {}, 1, 0};
+    update.changedWindowIds = {window->getInfo()->id};
+    mDispatcher->onWindowInfosChanged(update);
+
+    ASSERT_EQ(InputEventInjectionResult::SUCCEEDED,
+              injectMotionDown(*mDispatcher, AINPUT_SOURCE_TOUCHSCREEN, ADISPLAY_ID_DEFAULT,
+                               {150, 50}));
+    window->consumeMotionDown(ADISPLAY_ID_DEFAULT);
+    ASSERT_EQ(InputEventInjectionResult::SUCCEEDED,
+              injectMotionDown(*mDispatcher, AINPUT_SOURCE_TOUCHSCREEN, SECOND_DISPLAY_ID,
+                               {50, 50}));
+    secondWindow->consumeMotionDown(SECOND_DISPLAY_ID);
+
+    // Remove the window of the second display.
+    update = {{*window->getInfo()}, {}, 2, 0};
+    update.changedWindowIds = std::vector<int32_t>{};
+    mDispatcher->onWindowInfosChanged(update);
+
+    secondWindow->consumeMotionCancel(SECOND_DISPLAY_ID);
+    window->assertNoEvents();
+}
+
 // The foreground window should receive the first touch down event.
 TEST_F(InputDispatcherTest, SetInputWindow_MultiWindowsTouch) {
     std::shared_ptr<FakeApplicationHandle> application = std::make_shared<FakeApplicationHandle>();
@@ -7872,6 +7915,220 @@ TEST_F(InputDispatcherFocusOnTwoDisplaysTest, WhenDropMotionEvent_OnlyCancelCorr
     windowInSecondary->assertNoEvents();
 }
 
+/**
+ * A key waits for the paused focused window of the primary display. By default, the touch on the
+ * second display that comes after it waits as well.
+ */
+TEST_F(InputDispatcherFocusOnTwoDisplaysTest, WaitingKey_HoldsBackTouchOnOtherDisplay) {
+    windowInPrimary->setPaused(true);
+    mDispatcher->onWindowInfosChanged(
+            {{*windowInPrimary->getInfo(), *windowInSecondary->getInfo()}, {}, 0, 0});
+
+    mDispatcher->notifyKey(generateKeyArgs(AKEY_EVENT_ACTION_DOWN, ADISPLAY_ID_DEFAULT));
+    mDispatcher->notifyMotion(MotionArgsBuilder(ACTION_DOWN, AINPUT_SOURCE_TOUCHSCREEN)
+                                      .deviceId(SECOND_DEVICE_ID)
+                                      .pointer(PointerBuilder(/*id=*/0, ToolType::FINGER)
+                                                       .x(100)
+                                                       .y(200))
+                                      .displayId(SECOND_DISPLAY_ID)
+                                      .build());
+    windowInSecondary->assertNoEvents();
+
+    windowInPrimary->setPaused(false);
+    mDispatcher->onWindowInfosChanged(
+            {{*windowInPrimary->getInfo(), *windowInSecondary->getInfo()}, {}, 0, 0});
+    windowInPrimary->consumeKeyDown(ADISPLAY_ID_DEFAULT);
+    windowInSecondary->consumeMotionEvent(
+            AllOf(WithMotionAction(ACTION_DOWN), WithDisplayId(SECOND_DISPLAY_ID)));
+}
+
+/**
+ * With per-display dispatch, the key that waits for the paused focused window of the primary
+ * display only holds back the events of the primary display. The touch on the second display is
+ * dispatched right away.
+ */
+TEST_F(InputDispatcherFocusOnTwoDisplaysTest, PerDisplayDispatch_WaitingKeyHoldsBackOwnDisplay) {
+    mDispatcher->setPerDisplayDispatchEnabled(true);
+    windowInPrimary->setPaused(true);
+    mDispatcher->onWindowInfosChanged(
+            {{*windowInPrimary->getInfo(), *windowInSecondary->getInfo()}, {}, 0, 0});
+
+    mDispatcher->notifyKey(generateKeyArgs(AKEY_EVENT_ACTION_DOWN, ADISPLAY_ID_DEFAULT));
+    mDispatcher->notifyMotion(MotionArgsBuilder(ACTION_DOWN, AINPUT_SOURCE_TOUCHSCREEN)
+                                      .deviceId(SECOND_DEVICE_ID)
+                                      .pointer(PointerBuilder(/*id=*/0, ToolType::FINGER)
+                                                       .x(100)
+                                                       .y(200))
+                                      .displayId(SECOND_DISPLAY_ID)
+                                      .build());
+    windowInSecondary->consumeMotionEvent(
+            AllOf(WithMotionAction(ACTION_DOWN), WithDisplayId(SECOND_DISPLAY_ID)));
+    windowInPrimary->assertNoEvents();
+
+    windowInPrimary->setPaused(false);
+    mDispatcher->onWindowInfosChanged(
+            {{*windowInPrimary->getInfo(), *windowInSecondary->getInfo()}, {}, 0, 0});
+    windowInPrimary->consumeKeyDown(ADISPLAY_ID_DEFAULT);
+    windowInSecondary->assertNoEvents();
+}
+
+/**
+ * With per-display dispatch, a key on the primary display waits for its focused application to add
+ * a focused window, while keys from another keyboard keep flowing to the focused window of the
+ * second display. Those keys must not restart the wait of the primary display, so the ANR for the
+ * primary display is raised when its own timeout expires.
+ */
+TEST_F(InputDispatcherFocusOnTwoDisplaysTest, PerDisplayDispatch_KeysOnOtherDisplayKeepAnrTimer) {
+    mDispatcher->setPerDisplayDispatchEnabled(true);
+    const std::chrono::duration appTimeout = 300ms;
+    application1->setDispatchingTimeout(appTimeout);
+    windowInPrimary->setFocusable(false);
+    mDispatcher->onWindowInfosChanged(
+            {{*windowInPrimary->getInfo(), *windowInSecondary->getInfo()}, {}, 0, 0});
+    windowInPrimary->consumeFocusEvent(false);
+
+    const std::chrono::time_point start = std::chrono::steady_clock::now();
+    mDispatcher->notifyKey(generateKeyArgs(AKEY_EVENT_ACTION_DOWN, ADISPLAY_ID_DEFAULT));
+    for (int i = 0; i < 5; i++) {
+        NotifyKeyArgs downArgs = generateKeyArgs(AKEY_EVENT_ACTION_DOWN, SECOND_DISPLAY_ID);
+        downArgs.deviceId = SECOND_DEVICE_ID;
+        mDispatcher->notifyKey(downArgs);
+        NotifyKeyArgs upArgs = generateKeyArgs(AKEY_EVENT_ACTION_UP, SECOND_DISPLAY_ID);
+        upArgs.deviceId = SECOND_DEVICE_ID;
+        mDispatcher->notifyKey(upArgs);
+        windowInSecondary->consumeKeyDown(SECOND_DISPLAY_ID);
+        windowInSecondary->consumeKeyUp(SECOND_DISPLAY_ID);
+        std::this_thread::sleep_for(30ms);
+    }
+
+    const std::chrono::duration elapsed = std::chrono::steady_clock::now() - start;
+    ASSERT_LT(elapsed, appTimeout);
+    mFakePolicy->assertNotifyNoFocusedWindowAnrWasCalled(appTimeout - elapsed, application1);
+    ASSERT_TRUE(mDispatcher->waitForIdle());
+    windowInPrimary->assertNoEvents();
+    windowInSecondary->assertNoEvents();
+}
+
+/**
+ * With per-display dispatch, a key on the primary display waits for an earlier touch on the primary
+ * display to be processed, while keys from another keyboard keep flowing on the second display.
+ * Those keys must not restart the wait of the primary display, so the key is sent to the focused
+ * window of the primary display when its own "key waiting for events" timeout expires.
+ */
+TEST_F(InputDispatcherFocusOnTwoDisplaysTest, PerDisplayDispatch_KeysOnOtherDisplayKeepKeyTimer) {
+    // The timeouts in this test are established by relying on the fact that the "key waiting for
+    // events timeout" is equal to 500ms.
+    ASSERT_EQ(mFakePolicy->getKeyWaitingForEventsTimeout(), 500ms);
+    mDispatcher->setPerDisplayDispatchEnabled(true);
+    // Set a long ANR timeout to prevent it from triggering.
+    windowInPrimary->setDispatchingTimeout(2s);
+    mDispatcher->onWindowInfosChanged(
+            {{*windowInPrimary->getInfo(), *windowInSecondary->getInfo()}, {}, 0, 0});
+
+    // Don't finish the touch, so that the key on the primary display waits for it.
+    mDispatcher->notifyMotion(generateMotionArgs(AMOTION_EVENT_ACTION_DOWN,
+                                                 AINPUT_SOURCE_TOUCHSCREEN, ADISPLAY_ID_DEFAULT));
+    const auto& [touchSequenceNum, _] = windowInPrimary->receiveEvent();
+    ASSERT_TRUE(touchSequenceNum);
+    mDispatcher->notifyKey(generateKeyArgs(AKEY_EVENT_ACTION_DOWN, ADISPLAY_ID_DEFAULT));
+
+    // Keep typing on the second display for longer than the key waits.
+    for (int i = 0; i < 8; i++) {
+        NotifyKeyArgs downArgs = generateKeyArgs(AKEY_EVENT_ACTION_DOWN, SECOND_DISPLAY_ID);
+        downArgs.deviceId = SECOND_DEVICE_ID;
+        mDispatcher->notifyKey(downArgs);
+        NotifyKeyArgs upArgs = generateKeyArgs(AKEY_EVENT_ACTION_UP, SECOND_DISPLAY_ID);
+        upArgs.deviceId = SECOND_DEVICE_ID;
+        mDispatcher->notifyKey(upArgs);
+        windowInSecondary->consumeKeyDown(SECOND_DISPLAY_ID);
+        windowInSecondary->consumeKeyUp(SECOND_DISPLAY_ID);
+        std::this_thread::sleep_for(100ms);
+    }
+
+    // The key was sent when its 500ms wait expired, while the second display was still busy.
+    std::unique_ptr<InputEvent> keyEvent = windowInPrimary->consume(100ms);
+    ASSERT_NE(nullptr, keyEvent);
+    ASSERT_EQ(InputEventType::KEY, keyEvent->getType());
+    ASSERT_THAT(static_cast<KeyEvent&>(*keyEvent), WithKeyAction(AKEY_EVENT_ACTION_DOWN));
+    windowInPrimary->finishEvent(*touchSequenceNum);
+    ASSERT_TRUE(mDispatcher->waitForIdle());
+    windowInPrimary->assertNoEvents();
+    windowInSecondary->assertNoEvents();
+}
+
+/**
+ * With per-display dispatch, a key on the primary display waits for an earlier touch on the primary
+ * display to be processed. A new touch on the second display can not change the focus of the
+ * primary display, so it must not end the wait of the key.
+ */
+TEST_F(InputDispatcherFocusOnTwoDisplaysTest, PerDisplayDispatch_OtherDisplayTouchKeepsKeyWait) {
+    mDispatcher->setPerDisplayDispatchEnabled(true);
+    // Set a long ANR timeout to prevent it from triggering.
+    windowInPrimary->setDispatchingTimeout(2s);
+    mDispatcher->onWindowInfosChanged(
+            {{*windowInPrimary->getInfo(), *windowInSecondary->getInfo()}, {}, 0, 0});
+
+    // Don't finish the touch, so that the key on the primary display waits for it.
+    mDispatcher->notifyMotion(generateMotionArgs(AMOTION_EVENT_ACTION_DOWN,
+                                                 AINPUT_SOURCE_TOUCHSCREEN, ADISPLAY_ID_DEFAULT));
+    const auto& [touchSequenceNum, _] = windowInPrimary->receiveEvent();
+    ASSERT_TRUE(touchSequenceNum);
+    mDispatcher->notifyKey(generateKeyArgs(AKEY_EVENT_ACTION_DOWN, ADISPLAY_ID_DEFAULT));
+
+    mDispatcher->notifyMotion(MotionArgsBuilder(ACTION_DOWN, AINPUT_SOURCE_TOUCHSCREEN)
+                                      .deviceId(SECOND_DEVICE_ID)
+                                      .pointer(PointerBuilder(/*id=*/0, ToolType::FINGER)
+                                                       .x(100)
+                                                       .y(200))
+                                      .displayId(SECOND_DISPLAY_ID)
+                                      .build());
+    windowInSecondary->consumeMotionEvent(
+            AllOf(WithMotionAction(ACTION_DOWN), WithDisplayId(SECOND_DISPLAY_ID)));
+    windowInPrimary->assertNoEvents();
+
+    // Once the touch is processed, the key is sent.
+    windowInPrimary->finishEvent(*touchSequenceNum);
+    windowInPrimary->consumeKeyDown(ADISPLAY_ID_DEFAULT);
+    ASSERT_TRUE(mDispatcher->waitForIdle());
+    windowInPrimary->assertNoEvents();
+    windowInSecondary->assertNoEvents();
+}
+
+/**
+ * With per-display dispatch, a key on the second display that is dispatched ahead of a blocked key,
+ * but has to wait as well, goes back in the inbound queue. Walking the queue again when the
+ * dispatcher wakes up must not poke user activity again for it.
+ */
+TEST_F(InputDispatcherFocusOnTwoDisplaysTest, PerDisplayDispatch_ReinsertedKeyPokesOnce) {
+    mDispatcher->setPerDisplayDispatchEnabled(true);
+    windowInPrimary->setPaused(true);
+    windowInSecondary->setPaused(true);
+    mDispatcher->onWindowInfosChanged(
+            {{*windowInPrimary->getInfo(), *windowInSecondary->getInfo()}, {}, 0, 0});
+
+    mDispatcher->notifyKey(generateKeyArgs(AKEY_EVENT_ACTION_DOWN, ADISPLAY_ID_DEFAULT));
+    NotifyKeyArgs keyArgs = generateKeyArgs(AKEY_EVENT_ACTION_DOWN, SECOND_DISPLAY_ID);
+    keyArgs.deviceId = SECOND_DEVICE_ID;
+    mDispatcher->notifyKey(keyArgs);
+    ASSERT_TRUE(mDispatcher->waitForIdle());
+    mFakePolicy->clearUserActivityPokes();
+
+    // Wake the dispatcher up a few times while both keys are still waiting.
+    for (int i = 0; i < 3; i++) {
+        mDispatcher->onWindowInfosChanged(
+                {{*windowInPrimary->getInfo(), *windowInSecondary->getInfo()}, {}, 0, 0});
+        ASSERT_TRUE(mDispatcher->waitForIdle());
+    }
+    mFakePolicy->assertUserActivityNotPoked();
+
+    windowInPrimary->setPaused(false);
+    windowInSecondary->setPaused(false);
+    mDispatcher->onWindowInfosChanged(
+            {{*windowInPrimary->getInfo(), *windowInSecondary->getInfo()}, {}, 0, 0});
+    windowInPrimary->consumeKeyDown(ADISPLAY_ID_DEFAULT);
+    windowInSecondary->consumeKeyDown(SECOND_DISPLAY_ID);
+}
+
 class InputFilterTest : public InputDispatcherTest {
 protected:
     void testNotifyMotion(int32_t displayId, bool expectToBeFiltered,
@@ -104,6 +104,7 @@ public:
                 (const));
     MOCK_METHOD(void, setExcludedDevices, (const std::vector<std::string>& devices));
     MOCK_METHOD(std::vector<RawEvent>, getEvents, (int timeoutMillis));
+    MOCK_METHOD(size_t, getEvents, (int timeoutMillis, RawEvent* buffer, size_t bufferSize));
     MOCK_METHOD(std::vector<TouchVideoFrame>, getVideoFrames, (int32_t deviceId));
     MOCK_METHOD((base::Result<std::pair<InputDeviceSensorType, int32_t>>), mapSensor,
                 (int32_t deviceId, int32_t absCode), (const, override));
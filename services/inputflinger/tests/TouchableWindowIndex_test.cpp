@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+
+#include "../TouchableWindowIndex.h"
+
+// atest inputflinger_tests:TouchableWindowIndexTest
+
+using android::gui::WindowInfo;
+using android::gui::WindowInfoHandle;
+
+namespace android::inputdispatcher {
+
+namespace {
+
+class FakeWindowHandle : public WindowInfoHandle {
+public:
+    FakeWindowHandle(const std::string& name, const Region& touchableRegion) {
+        mInfo.name = name;
+        mInfo.touchableRegion = touchableRegion;
+    }
+
+    void setInputConfig(WindowInfo::InputConfig config, bool value) {
+        mInfo.setInputConfig(config, value);
+    }
+};
+
+std::vector<sp<WindowInfoHandle>> windowsAt(const TouchableWindowIndex& index, float x, float y,
+                                            bool isStylus = false) {
+    std::vector<sp<WindowInfoHandle>> windows;
+    index.forEachWindowAt(x, y, isStylus, [&](const sp<WindowInfoHandle>& windowHandle) {
+        windows.push_back(windowHandle);
+        return true;
+    });
+    return windows;
+}
+
+// Checks every window, the way InputDispatcher did before it had the index.
+std::vector<sp<WindowInfoHandle>> windowsAtByScanning(
+        const std::vector<sp<WindowInfoHandle>>& windowHandles,
+        const ui::Transform& displayTransform, float x, float y, bool isStylus) {
+    std::vector<sp<WindowInfoHandle>> windows;
+    for (const sp<WindowInfoHandle>& windowHandle : windowHandles) {
+        const WindowInfo& info = *windowHandle->getInfo();
+        if (info.inputConfig.test(WindowInfo::InputConfig::NOT_VISIBLE)) {
+            continue;
+        }
+        if (info.inputConfig.test(WindowInfo::InputConfig::NOT_TOUCHABLE) &&
+            !(isStylus && info.interceptsStylus())) {
+            continue;
+        }
+        const auto touchableRegion = displayTransform.transform(info.touchableRegion);
+        const auto p = displayTransform.transform(x, y);
+        if (touchableRegion.contains(std::floor(p.x), std::floor(p.y))) {
+            windows.push_back(windowHandle);
+        }
+    }
+    return windows;
+}
+
+} // namespace
+
+TEST(TouchableWindowIndexTest, EmptyIndexHasNoWindows) {
+    TouchableWindowIndex index;
+    EXPECT_TRUE(windowsAt(index, 10, 10).empty());
+
+    TouchableWindowIndex indexWithoutWindows({}, ui::Transform());
+    EXPECT_TRUE(windowsAt(indexWithoutWindows, 10, 10).empty());
+}
+
+TEST(TouchableWindowIndexTest, ReturnsWindowsFrontToBack) {
+    auto top = sp<FakeWindowHandle>::make("Top", Region(Rect(50, 50, 100, 100)));
+    auto middle = sp<FakeWindowHandle>::make("Middle", Region(Rect(0, 0, 200, 200)));
+    auto bottom = sp<FakeWindowHandle>::make("Bottom", Region(Rect(0, 0, 1000, 1000)));
+    TouchableWindowIndex index({top, middle, bottom}, ui::Transform());
+
+    EXPECT_EQ((std::vector<sp<WindowInfoHandle>>{top, middle, bottom}), windowsAt(index, 60, 60));
+    EXPECT_EQ((std::vector<sp<WindowInfoHandle>>{middle, bottom}), windowsAt(index, 150, 10));
+    EXPECT_EQ((std::vector<sp<WindowInfoHandle>>{bottom}), windowsAt(index, 500, 999.5));
+    EXPECT_TRUE(windowsAt(index, 1000, 10).empty());
+    EXPECT_TRUE(windowsAt(index, -1, 10).empty());
+}
+
+TEST(TouchableWindowIndexTest, StopsWhenVisitorReturnsFalse) {
+    auto top = sp<FakeWindowHandle>::make("Top", Region(Rect(0, 0, 100, 100)));
+    auto bottom = sp<FakeWindowHandle>::make("Bottom", Region(Rect(0, 0, 100, 100)));
+    TouchableWindowIndex index({top, bottom}, ui::Transform());
+
+    std::vector<sp<WindowInfoHandle>> windows;
+    index.forEachWindowAt(10, 10, /*isStylus=*/false, [&](const sp<WindowInfoHandle>& window) {
+        windows.push_back(window);
+        return false;
+    });
+    EXPECT_EQ((std::vector<sp<WindowInfoHandle>>{top}), windows);
+}
+
+TEST(TouchableWindowIndexTest, SkipsWindowsThatCannotBeTouched) {
+    auto invisible = sp<FakeWindowHandle>::make("Invisible", Region(Rect(0, 0, 100, 100)));
+    invisible->setInputConfig(WindowInfo::InputConfig::NOT_VISIBLE, true);
+    auto untouchable = sp<FakeWindowHandle>::make("Untouchable", Region(Rect(0, 0, 100, 100)));
+    untouchable->setInputConfig(WindowInfo::InputConfig::NOT_TOUCHABLE, true);
+    auto stylusInterceptor =
+            sp<FakeWindowHandle>::make("StylusInterceptor", Region(Rect(0, 0, 100, 100)));
+    stylusInterceptor->setInputConfig(WindowInfo::InputConfig::NOT_TOUCHABLE, true);
+    stylusInterceptor->setInputConfig(WindowInfo::InputConfig::INTERCEPTS_STYLUS, true);
+    auto window = sp<FakeWindowHandle>::make("Window", Region(Rect(0, 0, 100, 100)));
+    TouchableWindowIndex index({invisible, untouchable, stylusInterceptor, window},
+                               ui::Transform());
+
+    EXPECT_EQ((std::vector<sp<WindowInfoHandle>>{window}), windowsAt(index, 10, 10));
+    EXPECT_EQ((std::vector<sp<WindowInfoHandle>>{stylusInterceptor, window}),
+              windowsAt(index, 10, 10, /*isStylus=*/true));
+}
+
+TEST(TouchableWindowIndexTest, UsesTheWholeTouchableRegion) {
+    Region region(Rect(0, 0, 300, 100));
+    region.orSelf(Rect(0, 200, 300, 300));
+    auto window = sp<FakeWindowHandle>::make("Window", region);
+    TouchableWindowIndex index({window}, ui::Transform());
+
+    EXPECT_EQ(1u, windowsAt(index, 10, 10).size());
+    EXPECT_TRUE(windowsAt(index, 10, 150).empty());
+    EXPECT_EQ(1u, windowsAt(index, 10, 250).size());
+}
+
+TEST(TouchableWindowIndexTest, HitTestsInLogicalDisplaySpace) {
+    // A 1000x2000 display rotated by 90 degrees.
+    ui::Transform displayTransform(ui::Transform::ROT_90, 1000, 2000);
+    auto window = sp<FakeWindowHandle>::make("Window", Region(Rect(0, 0, 100, 100)));
+    TouchableWindowIndex index({window}, displayTransform);
+
+    for (float x : {-1.f, 0.f, 0.5f, 50.f, 99.5f, 100.f}) {
+        for (float y : {-1.f, 0.f, 0.5f, 50.f, 99.5f, 100.f}) {
+            EXPECT_EQ(windowsAtByScanning({window}, displayTransform, x, y, /*isStylus=*/false),
+                      windowsAt(index, x, y))
+                    << "at " << x << ", " << y;
+        }
+    }
+}
+
+TEST(TouchableWindowIndexTest, HandlesRegionsSpanningTheWholeCoordinateRange) {
+    auto small = sp<FakeWindowHandle>::make("Small", Region(Rect(0, 0, 100, 100)));
+    auto corner = sp<FakeWindowHandle>::make("Corner",
+                                             Region(Rect(INT32_MAX - 1000, INT32_MAX - 1000,
+                                                         INT32_MAX, INT32_MAX)));
+    auto everywhere = sp<FakeWindowHandle>::make("Everywhere",
+                                                 Region(Rect(INT32_MIN, INT32_MIN, INT32_MAX,
+                                                             INT32_MAX)));
+    const std::vector<sp<WindowInfoHandle>> windows{small, corner, everywhere};
+    TouchableWindowIndex index(windows, ui::Transform());
+
+    // The largest float below INT32_MAX.
+    const float nearMax = 2147483520.f;
+    for (float x : {float(INT32_MIN), -1e9f, -1.f, 0.f, 50.f, 1e9f, nearMax}) {
+        for (float y : {float(INT32_MIN), -1.f, 50.f, nearMax}) {
+            EXPECT_EQ(windowsAtByScanning(windows, ui::Transform(), x, y, /*isStylus=*/false),
+                      windowsAt(index, x, y))
+                    << "at " << x << ", " << y;
+        }
+    }
+    EXPECT_EQ((std::vector<sp<WindowInfoHandle>>{small, everywhere}), windowsAt(index, 50, 50));
+    EXPECT_EQ((std::vector<sp<WindowInfoHandle>>{corner, everywhere}),
+              windowsAt(index, nearMax, nearMax));
+    EXPECT_EQ((std::vector<sp<WindowInfoHandle>>{everywhere}),
+              windowsAt(index, float(INT32_MIN), float(INT32_MIN)));
+    EXPECT_TRUE(windowsAt(index, 1e10f, 50).empty());
+    EXPECT_TRUE(windowsAt(index, 50, -1e10f).empty());
+}
+
+TEST(TouchableWindowIndexTest, MatchesScanningEveryWindow) {
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int32_t> coordinate(-100, 1200);
+    std::uniform_int_distribution<int32_t> size(1, 600);
+    std::bernoulli_distribution oneIn10(0.1);
+
+    for (ui::Transform::RotationFlags rotation :
+         {ui::Transform::ROT_0, ui::Transform::ROT_90, ui::Transform::ROT_180,
+          ui::Transform::ROT_270}) {
+        ui::Transform displayTransform(rotation, 1080, 1080);
+        std::vector<sp<WindowInfoHandle>> windows;
+        for (int i = 0; i < 200; i++) {
+            const int32_t left = coordinate(random);
+            const int32_t top = coordinate(random);
+            Region region(Rect(left, top, left + size(random), top + size(random)));
+            if (oneIn10(random)) {
+                region.subtractSelf(Rect(left + 10, top + 10, left + 20, top + 20));
+            }
+            auto window = sp<FakeWindowHandle>::make("Window" + std::to_string(i), region);
+            window->setInputConfig(WindowInfo::InputConfig::NOT_VISIBLE, oneIn10(random));
+            window->setInputConfig(WindowInfo::InputConfig::NOT_TOUCHABLE, oneIn10(random));
+            window->setInputConfig(WindowInfo::InputConfig::INTERCEPTS_STYLUS, oneIn10(random));
+            windows.push_back(window);
+        }
+        TouchableWindowIndex index(windows, displayTransform);
+
+        for (int i = 0; i < 1000; i++) {
+            const float x = coordinate(random) + 0.5f;
+            const float y = coordinate(random) + 0.5f;
+            const bool isStylus = oneIn10(random);
+            ASSERT_EQ(windowsAtByScanning(windows, displayTransform, x, y, isStylus),
+                      windowsAt(index, x, y, isStylus))
+                    << "at " << x << ", " << y;
+        }
+    }
+}
+
+} // namespace android::inputdispatcher
@@ -151,6 +151,14 @@ public:
         }
         return events;
     }
+    size_t getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSize) override {
+        const size_t count =
+                mFdp->ConsumeIntegralInRange<size_t>(0, std::min(kMaxSize, bufferSize));
+        for (size_t i = 0; i < count; ++i) {
+            buffer[i] = getFuzzedRawEvent(*mFdp);
+        }
+        return count;
+    }
     std::vector<TouchVideoFrame> getVideoFrames(int32_t deviceId) override { return mVideoFrames; }
 
     base::Result<std::pair<InputDeviceSensorType, int32_t>> mapSensor(
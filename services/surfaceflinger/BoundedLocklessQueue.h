@@ -0,0 +1,159 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
+
+#include "LocklessQueue.h"
+
+// What BoundedLocklessQueue::push does when every slot of the ring is occupied.
+enum class BoundedLocklessQueueOverflow {
+    // Fall back to an unbounded LocklessQueue. This allocates, but only while the ring is full.
+    Spill,
+    // Yield until the consumer frees a slot. Must not be used if the consumer thread can push.
+    Block,
+};
+
+template <typename T, size_t Capacity,
+          BoundedLocklessQueueOverflow Overflow = BoundedLocklessQueueOverflow::Spill>
+// Single consumer multi producer FIFO with the same push/pop/isEmpty surface as LocklessQueue, but
+// backed by a fixed ring of preallocated slots so the steady state neither allocates nor frees.
+//
+// Each slot carries a sequence number. A slot at position pos is free for the producer that claims
+// pos when sequence == pos, and holds a value for the consumer when sequence == pos + 1. Producers
+// claim positions by compare exchanging mEnqueuePos, write the value, then publish it by storing
+// pos + 1 with release semantics. The consumer is the only reader of mDequeuePos; once it has moved
+// the value out it hands the slot back to producers by storing pos + Capacity.
+//
+// Because positions are claimed before values are published, pop may return nullopt while a
+// producer that claimed the head slot is still writing, even if later slots are already published.
+// Callers must be prepared to poll again, exactly as they would for a push that has not yet
+// completed.
+//
+// With the Spill policy, values that do not fit go to mSpill. mSpillCount counts values that have
+// been spilled but not yet popped. While it is non-zero producers keep spilling, and the consumer
+// only looks at mSpill once the ring is drained, meaning every claimed position has been published
+// and popped, so values pushed by one thread are still popped in the order that thread pushed
+// them.
+class BoundedLocklessQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+public:
+    BoundedLocklessQueue() : mSlots(std::make_unique<Slot[]>(Capacity)) {
+        for (size_t i = 0; i < Capacity; i++) {
+            mSlots[i].mSequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool isEmpty() {
+        const size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+        const bool ringEmpty =
+                mSlots[pos & kMask].mSequence.load(std::memory_order_acquire) != pos + 1;
+        if constexpr (Overflow == BoundedLocklessQueueOverflow::Spill) {
+            return ringEmpty && mSpill.isEmpty();
+        }
+        return ringEmpty;
+    }
+
+    void push(T value) {
+        if constexpr (Overflow == BoundedLocklessQueueOverflow::Spill) {
+            if (mSpillCount.load(std::memory_order_acquire) == 0 && tryPush(value)) {
+                return;
+            }
+            mSpillCount.fetch_add(1, std::memory_order_acq_rel);
+            mSpill.push(std::move(value));
+        } else {
+            while (!tryPush(value)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    std::optional<T> pop() {
+        const size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+        Slot& slot = mSlots[pos & kMask];
+        if (slot.mSequence.load(std::memory_order_acquire) == pos + 1) {
+            std::optional<T> value = std::move(slot.mValue);
+            slot.mValue.reset();
+            mDequeuePos.store(pos + 1, std::memory_order_relaxed);
+            slot.mSequence.store(pos + Capacity, std::memory_order_release);
+            return value;
+        }
+        if constexpr (Overflow == BoundedLocklessQueueOverflow::Spill) {
+            // A producer has claimed the head slot but not published it yet. Its value, and the
+            // later values of its thread that may be in mSpill, have to wait for it.
+            if (mEnqueuePos.load(std::memory_order_acquire) != pos) {
+                return std::nullopt;
+            }
+            std::optional<T> value = mSpill.pop();
+            if (value) {
+                mSpillCount.fetch_sub(1, std::memory_order_acq_rel);
+            }
+            return value;
+        }
+        return std::nullopt;
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    static constexpr size_t kMask = Capacity - 1;
+
+    struct Slot {
+        std::atomic<size_t> mSequence;
+        std::optional<T> mValue;
+    };
+
+    // Moves value into the ring and returns true, or leaves value untouched and returns false if
+    // the ring is full.
+    bool tryPush(T& value) {
+        size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &mSlots[pos & kMask];
+            const size_t sequence = slot->mSequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        slot->mValue.emplace(std::move(value));
+        slot->mSequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    const std::unique_ptr<Slot[]> mSlots;
+
+    // Producers and the consumer touch these on every operation, keep them on separate lines.
+    alignas(64) std::atomic<size_t> mEnqueuePos = 0;
+    alignas(64) std::atomic<size_t> mDequeuePos = 0;
+
+    alignas(64) std::atomic<size_t> mSpillCount = 0;
+    LocklessQueue<T> mSpill;
+};
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include <com_android_graphics_surfaceflinger_flags.h>
+#include <common/test/FlagUtils.h>
+#include <compositionengine/CompositionRefreshArgs.h>
+#include <compositionengine/LayerFE.h>
+#include <compositionengine/LayerFECompositionState.h>
+#include <compositionengine/impl/CompositionEngine.h>
+#include <compositionengine/impl/Output.h>
+#include <compositionengine/impl/OutputCompositionState.h>
+
+using namespace com::android::graphics::surfaceflinger;
+
+namespace android::compositionengine {
+namespace {
+
+constexpr size_t kLayerCount = 50;
+constexpr ui::Size kDisplaySize{1080, 2400};
+
+// A layer with fixed geometry, which does not need a front end to back it.
+class BenchmarkLayerFE : public LayerFE {
+public:
+    BenchmarkLayerFE(int32_t sequence, const LayerFECompositionState& state)
+          : mSequence(sequence), mName("layer" + std::to_string(sequence)), mState(state) {}
+
+    const LayerFECompositionState* getCompositionState() const override { return &mState; }
+    bool onPreComposition(nsecs_t, bool) override { return false; }
+    std::optional<LayerSettings> prepareClientComposition(
+            ClientCompositionTargetSettings&) const override {
+        return {};
+    }
+    void onLayerDisplayed(ftl::SharedFuture<FenceResult>, ui::LayerStack) override {}
+    const char* getDebugName() const override { return mName.c_str(); }
+    int32_t getSequence() const override { return mSequence; }
+    bool hasRoundedCorners() const override { return false; }
+    const gui::LayerMetadata* getMetadata() const override { return nullptr; }
+    const gui::LayerMetadata* getRelativeMetadata() const override { return nullptr; }
+
+private:
+    const int32_t mSequence;
+    const std::string mName;
+    const LayerFECompositionState mState;
+};
+
+// An output that is only prepared. Presenting it would need a render surface and
+// HWC, which are not what this benchmark measures.
+class BenchmarkOutput : public impl::Output {
+public:
+    ftl::Future<std::monostate> present(const CompositionRefreshArgs&) override {
+        return ftl::yield<std::monostate>({});
+    }
+};
+
+// Builds a stack of layers from back to front: a wallpaper and an app covering
+// the display, then a mix of opaque and translucent windows, some of them with
+// shadows, like the status bar, dialogs and picture-in-picture windows.
+Layers createLayers() {
+    const auto displayWidth = static_cast<float>(kDisplaySize.width);
+    const auto displayHeight = static_cast<float>(kDisplaySize.height);
+
+    Layers layers;
+    for (int32_t i = 0; i < static_cast<int32_t>(kLayerCount); i++) {
+        LayerFECompositionState state;
+        if (i < 2) {
+            state.geomLayerBounds = FloatRect(0, 0, displayWidth, displayHeight);
+        } else {
+            const auto left = static_cast<float>((i * 37) % (kDisplaySize.width / 2));
+            const auto top = static_cast<float>((i * 113) % (kDisplaySize.height / 2));
+            const auto width = static_cast<float>(200 + (i % 5) * 100);
+            const auto height = static_cast<float>(150 + (i % 7) * 120);
+            state.geomLayerBounds = FloatRect(left, top, left + width, top + height);
+            state.isOpaque = i % 3 == 0;
+            if (i % 4 == 0) {
+                state.shadowSettings.length = 24;
+            }
+        }
+        state.contentDirty = i % 2 == 0;
+        layers.push_back(sp<BenchmarkLayerFE>::make(i, state));
+    }
+    return layers;
+}
+
+std::shared_ptr<compositionengine::Output> createOutput(const CompositionEngine& engine) {
+    std::shared_ptr<compositionengine::Output> output =
+            impl::createOutputTemplated<BenchmarkOutput>(engine);
+    auto& state = output->editState();
+    state.isEnabled = true;
+    state.displaySpace.setBounds(kDisplaySize);
+    state.layerStackSpace.setBounds(kDisplaySize);
+    state.layerStackSpace.setContent(Rect(kDisplaySize));
+    return output;
+}
+
+// Presents a frame in which the geometry of every output is rebuilt, as it is when
+// a window moves while the screen is recorded or cast. Only the outputs are
+// prepared, so this measures the visibility and coverage computations.
+void BM_presentWithGeometryUpdate(benchmark::State& state) {
+    const size_t outputCount = static_cast<size_t>(state.range(0));
+    SET_FLAG_FOR_TEST(flags::multithreaded_prepare, state.range(1) != 0);
+
+    impl::CompositionEngine engine;
+    CompositionRefreshArgs args;
+    args.layers = createLayers();
+    for (size_t i = 0; i < outputCount; i++) {
+        args.outputs.push_back(createOutput(engine));
+    }
+
+    for (auto _ : state) {
+        args.updatingOutputGeometryThisFrame = true;
+        engine.present(args);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(outputCount * kLayerCount));
+}
+
+BENCHMARK(BM_presentWithGeometryUpdate)
+        ->ArgNames({"outputs", "multithreaded"})
+        ->ArgsProduct({{1, 2, 3, 4}, {0, 1}})
+        ->UseRealTime();
+
+} // namespace
+} // namespace android::compositionengine
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include <compositionengine/impl/planner/Predictor.h>
+
+#include <aidl/android/hardware/graphics/composer3/Composition.h>
+
+using aidl::android::hardware::graphics::composer3::Composition;
+
+namespace android::compositionengine::impl::planner {
+namespace {
+
+// Number of distinct layer stacks in a recording. A real device cycles through a handful of
+// stacks as the user moves between the launcher, an app and the notification shade.
+constexpr size_t kRecordedStackCount = 8;
+
+// Builds a recording of the composition types chosen for stacks of layerCount layers. Most layers
+// are device composited, with a few client, solid color and decoration layers sprinkled in so that
+// each stack ends up with a distinct plan.
+std::vector<std::vector<Composition>> recordLayerStacks(size_t layerCount) {
+    std::vector<std::vector<Composition>> stacks(kRecordedStackCount);
+    for (size_t s = 0; s < kRecordedStackCount; s++) {
+        auto& stack = stacks[s];
+        stack.reserve(layerCount);
+        for (size_t l = 0; l < layerCount; l++) {
+            if (l == layerCount - 1) {
+                stack.push_back(Composition::DISPLAY_DECORATION);
+            } else if ((l + s) % 7 == 0) {
+                stack.push_back(Composition::CLIENT);
+            } else if ((l * 3 + s) % 11 == 0) {
+                stack.push_back(Composition::SOLID_COLOR);
+            } else {
+                stack.push_back(Composition::DEVICE);
+            }
+        }
+    }
+    return stacks;
+}
+
+Plan toPlan(const std::vector<Composition>& stack) {
+    Plan plan;
+    for (Composition type : stack) {
+        plan.addLayerType(type);
+    }
+    return plan;
+}
+
+// Building and hashing a plan, as Planner::reportFinalPlan and the Predictor maps do every frame.
+void BM_buildAndHashPlan(benchmark::State& state) {
+    const auto stacks = recordLayerStacks(static_cast<size_t>(state.range(0)));
+    size_t frame = 0;
+    for (auto _ : state) {
+        const Plan plan = toPlan(stacks[frame++ % stacks.size()]);
+        benchmark::DoNotOptimize(std::hash<Plan>{}(plan));
+    }
+}
+
+// The previous way of hashing a plan, kept as a baseline for BM_buildAndHashPlan.
+void BM_buildAndHashPlanString(benchmark::State& state) {
+    const auto stacks = recordLayerStacks(static_cast<size_t>(state.range(0)));
+    size_t frame = 0;
+    for (auto _ : state) {
+        const Plan plan = toPlan(stacks[frame++ % stacks.size()]);
+        benchmark::DoNotOptimize(std::hash<std::string>{}(to_string(plan)));
+    }
+}
+
+// Replays the recording through the Predictor, so that every frame looks up a predicted plan by
+// hash and records the result.
+void BM_predictorReplay(benchmark::State& state) {
+    const auto stacks = recordLayerStacks(static_cast<size_t>(state.range(0)));
+    std::vector<Plan> plans;
+    std::transform(stacks.cbegin(), stacks.cend(), std::back_inserter(plans), toPlan);
+
+    Predictor predictor;
+    size_t frame = 0;
+    for (auto _ : state) {
+        const size_t index = frame++ % plans.size();
+        const NonBufferHash hash = index + 1;
+        auto predictedPlan = predictor.getPredictedPlan({}, hash);
+        predictor.recordResult(predictedPlan, hash, {}, false, plans[index]);
+    }
+}
+
+BENCHMARK(BM_buildAndHashPlan)->DenseRange(10, 60, 10);
+BENCHMARK(BM_buildAndHashPlanString)->DenseRange(10, 60, 10);
+BENCHMARK(BM_predictorReplay)->DenseRange(10, 60, 10);
+
+} // namespace
+} // namespace android::compositionengine::impl::planner
+
+BENCHMARK_MAIN();
@@ -264,6 +264,13 @@ public:
     // Prepare the output, updating the OutputLayers used in the output
     virtual void prepare(const CompositionRefreshArgs&, LayerFESet&) = 0;
 
+    // Prepares the output on another thread, so that other outputs can be
+    // prepared at the same time. The returned future must be waited upon before
+    // the output is presented. Every layer must already be in the LayerFESet,
+    // which is only read while the output is prepared.
+    virtual ftl::Future<std::monostate> prepareAsync(const CompositionRefreshArgs&,
+                                                     LayerFESet&) = 0;
+
     // Presents the output, finalizing all composition details. This may happen
     // asynchronously, in which case the returned future must be waited upon.
     virtual ftl::Future<std::monostate> present(const CompositionRefreshArgs&) = 0;
@@ -80,6 +80,7 @@ public:
     void setReleasedLayers(ReleasedLayers&&) override;
 
     void prepare(const CompositionRefreshArgs&, LayerFESet&) override;
+    ftl::Future<std::monostate> prepareAsync(const CompositionRefreshArgs&, LayerFESet&) override;
     ftl::Future<std::monostate> present(const CompositionRefreshArgs&) override;
     bool supportsOffloadPresent() const override { return false; }
     void offloadPresentNextFrame() override;
@@ -17,6 +17,8 @@
 #pragma once
 
 #include <ftl/flags.h>
+#include <ftl/small_vector.h>
+#include <math/HashCombine.h>
 
 #include <compositionengine/impl/planner/LayerState.h>
 
@@ -106,19 +108,50 @@ private:
     constexpr static int kMaxDifferingFields = 6;
 };
 
+// The composition type chosen for each layer of a layer stack, in z-order.
+//
+// Plans are looked up and compared for every frame, so rather than storing one Composition per
+// layer they are packed kBitsPerLayer bits at a time into inline words, and the hash is updated as
+// layers are added. Copying, comparing and hashing a plan for a typical layer stack therefore
+// neither allocates nor builds a string.
 class Plan {
 public:
     static std::optional<Plan> fromString(const std::string&);
 
-    void reset() { mLayerTypes.clear(); }
+    void reset() {
+        mPackedLayerTypes.clear();
+        mLayerCount = 0;
+        mHash = 0;
+    }
+
     void addLayerType(aidl::android::hardware::graphics::composer3::Composition type) {
-        mLayerTypes.emplace_back(type);
+        const uint64_t encoded = encode(type);
+        const size_t shift = (mLayerCount % kLayersPerWord) * kBitsPerLayer;
+        if (shift == 0) {
+            mPackedLayerTypes.push_back(0);
+        }
+        mPackedLayerTypes.back() |= encoded << shift;
+        ++mLayerCount;
+        // Offset by one so that leading INVALID layers still change the hash.
+        hashCombineSingleHashed(mHash, static_cast<size_t>(encoded + 1));
     }
 
+    size_t size() const { return mLayerCount; }
+
+    aidl::android::hardware::graphics::composer3::Composition getLayerType(size_t index) const {
+        const uint64_t word = mPackedLayerTypes[index / kLayersPerWord];
+        const size_t shift = (index % kLayersPerWord) * kBitsPerLayer;
+        return static_cast<aidl::android::hardware::graphics::composer3::Composition>(
+                (word >> shift) & kLayerTypeMask);
+    }
+
+    size_t hash() const { return mHash; }
+
     friend std::string to_string(const Plan& plan);
 
     friend bool operator==(const Plan& lhs, const Plan& rhs) {
-        return lhs.mLayerTypes == rhs.mLayerTypes;
+        return lhs.mHash == rhs.mHash && lhs.mLayerCount == rhs.mLayerCount &&
+                lhs.mPackedLayerTypes == rhs.mPackedLayerTypes;
     }
     friend bool operator!=(const Plan& lhs, const Plan& rhs) { return !(lhs == rhs); }
 
@@ -127,7 +160,23 @@ public:
     }
 
 private:
-    std::vector<aidl::android::hardware::graphics::composer3::Composition> mLayerTypes;
+    static constexpr size_t kBitsPerLayer = 3;
+    static constexpr uint64_t kLayerTypeMask = (1ull << kBitsPerLayer) - 1;
+    static constexpr size_t kLayersPerWord = 64 / kBitsPerLayer;
+    // Enough for 63 layers before spilling to the heap.
+    static constexpr size_t kInlineWords = 3;
+
+    static_assert(static_cast<uint64_t>(aidl::android::hardware::graphics::composer3::Composition::
+                                                REFRESH_RATE_INDICATOR) <= kLayerTypeMask,
+                  "Composition no longer fits in kBitsPerLayer bits");
+
+    static constexpr uint64_t encode(aidl::android::hardware::graphics::composer3::Composition type) {
+        return static_cast<uint64_t>(type) & kLayerTypeMask;
+    }
+
+    ftl::SmallVector<uint64_t, kInlineWords> mPackedLayerTypes;
+    size_t mLayerCount = 0;
+    size_t mHash = 0;
 };
 
 } // namespace android::compositionengine::impl::planner
@@ -136,7 +185,7 @@ namespace std {
 template <>
 struct hash<android::compositionengine::impl::planner::Plan> {
     size_t operator()(const android::compositionengine::impl::planner::Plan& plan) const {
-        return std::hash<std::string>{}(to_string(plan));
+        return plan.hash();
     }
 };
 } // namespace std
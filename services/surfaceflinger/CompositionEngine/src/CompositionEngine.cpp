@@ -125,6 +125,39 @@ void offloadOutputs(Outputs& outputs) {
         output->offloadPresentNextFrame();
     }
 }
+
+// Returns the outputs that can be prepared on their own thread. Rebuilding the
+// layer stack of a HWC-enabled output creates and destroys HWC layers, so it is
+// only done concurrently if all of them support calls from multiple threads.
+ui::DisplayVector<compositionengine::Output*> getOutputsToPrepareAsync(
+        const CompositionRefreshArgs& args) {
+    if (!FlagManager::getInstance().multithreaded_prepare() || args.outputs.size() < 2 ||
+        !args.updatingOutputGeometryThisFrame) {
+        return {};
+    }
+
+    ui::DisplayVector<compositionengine::Output*> outputsToPrepareAsync;
+    for (const auto& output : args.outputs) {
+        // Disabled outputs skip the layer stack rebuild, so there is nothing to
+        // gain from preparing them on another thread.
+        if (!output->getState().isEnabled) {
+            continue;
+        }
+        if (ftl::Optional(output->getDisplayId()).and_then(HalDisplayId::tryCast) &&
+            !output->supportsOffloadPresent()) {
+            return {};
+        }
+        outputsToPrepareAsync.push_back(output.get());
+    }
+
+    if (outputsToPrepareAsync.size() < 2) {
+        return {};
+    }
+
+    // Like for present, the last eligible output is prepared on the main thread.
+    outputsToPrepareAsync.pop_back();
+    return outputsToPrepareAsync;
+}
 } // namespace
 
 void CompositionEngine::present(CompositionRefreshArgs& args) {
@@ -139,8 +172,31 @@ void CompositionEngine::present(CompositionRefreshArgs& args) {
         // needed for anything else.
         LayerFESet latchedLayers;
 
-        for (const auto& output : args.outputs) {
-            output->prepare(args, latchedLayers);
+        const auto outputsToPrepareAsync = getOutputsToPrepareAsync(args);
+        if (outputsToPrepareAsync.empty()) {
+            for (const auto& output : args.outputs) {
+                output->prepare(args, latchedLayers);
+            }
+        } else {
+            // Latch all the layers up front, so that the outputs only read the
+            // set while they are prepared concurrently.
+            latchedLayers.insert(args.layers.begin(), args.layers.end());
+
+            ui::DisplayVector<ftl::Future<std::monostate>> prepareFutures;
+            for (compositionengine::Output* output : outputsToPrepareAsync) {
+                prepareFutures.push_back(output->prepareAsync(args, latchedLayers));
+            }
+            for (const auto& output : args.outputs) {
+                if (std::find(outputsToPrepareAsync.begin(), outputsToPrepareAsync.end(),
+                              output.get()) == outputsToPrepareAsync.end()) {
+                    output->prepare(args, latchedLayers);
+                }
+            }
+
+            ATRACE_NAME("Waiting on prepare");
+            for (auto& future : prepareFutures) {
+                future.get();
+            }
         }
     }
 
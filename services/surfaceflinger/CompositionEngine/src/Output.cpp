@@ -431,6 +431,20 @@ void Output::prepare(const compositionengine::CompositionRefreshArgs& refreshArg
     uncacheBuffers(refreshArgs.bufferIdsToUncache);
 }
 
+ftl::Future<std::monostate> Output::prepareAsync(
+        const compositionengine::CompositionRefreshArgs& refreshArgs, LayerFESet& geomSnapshots) {
+    // The worker is shared with present, which does not run until this future
+    // has been waited upon.
+    if (!mHwComposerAsyncWorker) {
+        mHwComposerAsyncWorker = std::make_unique<HwcAsyncWorker>();
+    }
+    return ftl::Future<bool>(std::move(mHwComposerAsyncWorker->send([&]() {
+               prepare(refreshArgs, geomSnapshots);
+               return true;
+           })))
+            .then([](bool) { return std::monostate{}; });
+}
+
 ftl::Future<std::monostate> Output::present(
         const compositionengine::CompositionRefreshArgs& refreshArgs) {
     const auto stringifyExpectedPresentTime = [this, &refreshArgs]() -> std::string {
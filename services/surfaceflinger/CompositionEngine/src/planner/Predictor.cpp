@@ -127,8 +127,9 @@ std::optional<Plan> Plan::fromString(const std::string& string) {
 
 std::string to_string(const Plan& plan) {
     std::string result;
-    for (auto type : plan.mLayerTypes) {
-        switch (type) {
+    result.reserve(plan.size());
+    for (size_t i = 0; i < plan.size(); ++i) {
+        switch (plan.getLayerType(i)) {
             case aidl::android::hardware::graphics::composer3::Composition::CLIENT:
                 result.append("C");
                 break;
@@ -483,5 +483,109 @@ TEST_F(CompositionEngineOffloadTest, disabledDisplaysDoNotPreventOthersFromOfflo
     mEngine.present(mRefreshArgs);
 }
 
+struct CompositionEnginePrepareOffloadTest : public CompositionEngineOffloadTest {
+    sp<StrictMock<mock::LayerFE>> mLayer1FE = sp<StrictMock<mock::LayerFE>>::make();
+    sp<StrictMock<mock::LayerFE>> mLayer2FE = sp<StrictMock<mock::LayerFE>>::make();
+
+    void SetUp() override {
+        CompositionEngineOffloadTest::SetUp();
+        EXPECT_CALL(*mLayer1FE, onPreComposition(_, _)).WillRepeatedly(Return(false));
+        EXPECT_CALL(*mLayer2FE, onPreComposition(_, _)).WillRepeatedly(Return(false));
+        mRefreshArgs.layers = {mLayer1FE, mLayer2FE};
+        mRefreshArgs.updatingOutputGeometryThisFrame = true;
+    }
+
+    void addOutput(const std::shared_ptr<mock::Output>& output, bool prepareAsync) {
+        if (prepareAsync) {
+            EXPECT_CALL(*output, prepareAsync(Ref(mRefreshArgs), _))
+                    .WillOnce([this](const CompositionRefreshArgs&, LayerFESet& latchedLayers) {
+                        // All the layers are latched before any output is prepared.
+                        EXPECT_EQ(mRefreshArgs.layers.size(), latchedLayers.size());
+                        return ftl::yield<std::monostate>({});
+                    });
+            EXPECT_CALL(*output, prepare(_, _)).Times(0);
+        } else {
+            EXPECT_CALL(*output, prepare(Ref(mRefreshArgs), _)).Times(1);
+            EXPECT_CALL(*output, prepareAsync(_, _)).Times(0);
+        }
+        EXPECT_CALL(*output, present(Ref(mRefreshArgs)))
+                .WillOnce(Return(ftl::yield<std::monostate>({})));
+
+        mRefreshArgs.outputs.push_back(output);
+    }
+};
+
+TEST_F(CompositionEnginePrepareOffloadTest, basic) {
+    EXPECT_CALL(*mDisplay1, supportsOffloadPresent).WillOnce(Return(true));
+    EXPECT_CALL(*mDisplay2, supportsOffloadPresent).WillOnce(Return(true));
+
+    SET_FLAG_FOR_TEST(flags::multithreaded_present, false);
+    SET_FLAG_FOR_TEST(flags::multithreaded_prepare, true);
+    addOutput(mDisplay1, /*prepareAsync=*/true);
+    addOutput(mDisplay2, /*prepareAsync=*/false);
+
+    mEngine.present(mRefreshArgs);
+}
+
+TEST_F(CompositionEnginePrepareOffloadTest, dependsOnFlag) {
+    SET_FLAG_FOR_TEST(flags::multithreaded_present, false);
+    SET_FLAG_FOR_TEST(flags::multithreaded_prepare, false);
+    addOutput(mDisplay1, /*prepareAsync=*/false);
+    addOutput(mDisplay2, /*prepareAsync=*/false);
+
+    mEngine.present(mRefreshArgs);
+}
+
+TEST_F(CompositionEnginePrepareOffloadTest, dependsOnGeometryUpdate) {
+    mRefreshArgs.updatingOutputGeometryThisFrame = false;
+
+    SET_FLAG_FOR_TEST(flags::multithreaded_present, false);
+    SET_FLAG_FOR_TEST(flags::multithreaded_prepare, true);
+    addOutput(mDisplay1, /*prepareAsync=*/false);
+    addOutput(mDisplay2, /*prepareAsync=*/false);
+
+    mEngine.present(mRefreshArgs);
+}
+
+TEST_F(CompositionEnginePrepareOffloadTest, dependsOnAllHwcDisplaysSupportingIt) {
+    EXPECT_CALL(*mDisplay1, supportsOffloadPresent).WillOnce(Return(true));
+    EXPECT_CALL(*mDisplay2, supportsOffloadPresent).WillOnce(Return(false));
+
+    SET_FLAG_FOR_TEST(flags::multithreaded_present, false);
+    SET_FLAG_FOR_TEST(flags::multithreaded_prepare, true);
+    addOutput(mDisplay1, /*prepareAsync=*/false);
+    addOutput(mDisplay2, /*prepareAsync=*/false);
+    addOutput(mVirtualDisplay, /*prepareAsync=*/false);
+
+    mEngine.present(mRefreshArgs);
+}
+
+TEST_F(CompositionEnginePrepareOffloadTest, virtualDisplay) {
+    EXPECT_CALL(*mVirtualDisplay, supportsOffloadPresent).Times(0);
+    EXPECT_CALL(*mDisplay1, supportsOffloadPresent).WillOnce(Return(true));
+
+    SET_FLAG_FOR_TEST(flags::multithreaded_present, false);
+    SET_FLAG_FOR_TEST(flags::multithreaded_prepare, true);
+    addOutput(mVirtualDisplay, /*prepareAsync=*/true);
+    addOutput(mDisplay1, /*prepareAsync=*/false);
+
+    mEngine.present(mRefreshArgs);
+}
+
+TEST_F(CompositionEnginePrepareOffloadTest, disabledDisplaysArePreparedOnMainThread) {
+    // Disable mDisplay2.
+    mOutputStates[1].isEnabled = false;
+    EXPECT_CALL(*mDisplay1, supportsOffloadPresent).WillOnce(Return(true));
+    EXPECT_CALL(*mHalVirtualDisplay, supportsOffloadPresent).WillOnce(Return(true));
+
+    SET_FLAG_FOR_TEST(flags::multithreaded_present, false);
+    SET_FLAG_FOR_TEST(flags::multithreaded_prepare, true);
+    addOutput(mDisplay1, /*prepareAsync=*/true);
+    addOutput(mDisplay2, /*prepareAsync=*/false);
+    addOutput(mHalVirtualDisplay, /*prepareAsync=*/false);
+
+    mEngine.present(mRefreshArgs);
+}
+
 } // namespace
 } // namespace android::compositionengine
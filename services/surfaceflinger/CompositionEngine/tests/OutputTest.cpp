@@ -36,6 +36,7 @@
 
 #include <cmath>
 #include <cstdint>
+#include <thread>
 #include <variant>
 
 #include <common/FlagManager.h>
@@ -1215,6 +1216,20 @@ TEST_F(OutputPrepareTest, skipsUncacheBuffersIfEmptyAndThenRebuildsLayerStacks)
     mOutput.prepare(mRefreshArgs, mGeomSnapshots);
 }
 
+TEST_F(OutputPrepareTest, prepareAsyncRebuildsLayerStacksOnAnotherThread) {
+    const auto mainThreadId = std::this_thread::get_id();
+    std::thread::id prepareThreadId;
+    EXPECT_CALL(mOutput, rebuildLayerStacks(Ref(mRefreshArgs), Ref(mGeomSnapshots)))
+            .WillOnce([&](const compositionengine::CompositionRefreshArgs&,
+                          compositionengine::LayerFESet&) {
+                prepareThreadId = std::this_thread::get_id();
+            });
+
+    mOutput.prepareAsync(mRefreshArgs, mGeomSnapshots).get();
+
+    EXPECT_NE(mainThreadId, prepareThreadId);
+}
+
 /*
  * Output::rebuildLayerStacks()
  */
@@ -332,6 +332,63 @@ TEST_F(LayerStackTest, getApproximateMatch_doesNotMatchMultipleApproximations) {
     EXPECT_FALSE(stack.getApproximateMatch({&layerStateTwo, &layerStateTwo}));
 }
 
+struct PlanTest : public testing::Test {
+    PlanTest() {
+        const ::testing::TestInfo* const test_info =
+                ::testing::UnitTest::GetInstance()->current_test_info();
+        ALOGD("**** Setting up for %s.%s\n", test_info->test_case_name(), test_info->name());
+    }
+
+    ~PlanTest() {
+        const ::testing::TestInfo* const test_info =
+                ::testing::UnitTest::GetInstance()->current_test_info();
+        ALOGD("**** Tearing down after %s.%s\n", test_info->test_case_name(), test_info->name());
+    }
+};
+
+TEST_F(PlanTest, stringRoundTrip) {
+    // Long enough to span several packed words.
+    const std::string planString = "CUDIBSA" + std::string(60, 'D') + "SC";
+    const auto plan = Plan::fromString(planString);
+    ASSERT_TRUE(plan);
+    EXPECT_EQ(planString.size(), plan->size());
+    EXPECT_EQ(planString, to_string(*plan));
+    EXPECT_EQ(Composition::CLIENT, plan->getLayerType(0));
+    EXPECT_EQ(Composition::SOLID_COLOR, plan->getLayerType(planString.size() - 2));
+}
+
+TEST_F(PlanTest, equalPlansHashEqually) {
+    Plan planOne;
+    Plan planTwo;
+    for (int i = 0; i < 40; i++) {
+        const auto type = i % 3 == 0 ? Composition::CLIENT : Composition::DEVICE;
+        planOne.addLayerType(type);
+        planTwo.addLayerType(type);
+    }
+    EXPECT_EQ(planOne, planTwo);
+    EXPECT_EQ(std::hash<Plan>{}(planOne), std::hash<Plan>{}(planTwo));
+
+    planTwo.reset();
+    EXPECT_NE(planOne, planTwo);
+    EXPECT_EQ(Plan{}, planTwo);
+    EXPECT_EQ(std::hash<Plan>{}(Plan{}), std::hash<Plan>{}(planTwo));
+}
+
+TEST_F(PlanTest, layerOrderAndCountAreSignificant) {
+    const auto planOne = Plan::fromString("DC");
+    const auto planTwo = Plan::fromString("CD");
+    ASSERT_TRUE(planOne && planTwo);
+    EXPECT_NE(*planOne, *planTwo);
+    EXPECT_NE(std::hash<Plan>{}(*planOne), std::hash<Plan>{}(*planTwo));
+
+    // INVALID packs to zero bits, so only the layer count distinguishes these.
+    const auto planThree = Plan::fromString("I");
+    const auto planFour = Plan::fromString("II");
+    ASSERT_TRUE(planThree && planFour);
+    EXPECT_NE(*planThree, *planFour);
+    EXPECT_NE(std::hash<Plan>{}(*planThree), std::hash<Plan>{}(*planFour));
+}
+
 struct PredictionTest : public testing::Test {
     PredictionTest() {
         const ::testing::TestInfo* const test_info =
@@ -22,6 +22,7 @@
 #include <numeric>
 #include <optional>
 
+#include <common/FlagManager.h>
 #include <ftl/small_map.h>
 #include <gui/TraceUtils.h>
 #include <ui/DisplayMap.h>
@@ -333,6 +334,20 @@ uint32_t getPrimaryDisplayRotationFlags(
     return 0;
 }
 
+// Changes to a snapshot that its children inherit.
+constexpr ftl::Flags<RequestedLayerState::Changes> CHANGES_INHERITED_BY_CHILDREN =
+        RequestedLayerState::Changes::Hierarchy | RequestedLayerState::Changes::Geometry |
+        RequestedLayerState::Changes::Visibility | RequestedLayerState::Changes::Metadata |
+        RequestedLayerState::Changes::AffectsChildren | RequestedLayerState::Changes::Input |
+        RequestedLayerState::Changes::FrameRate | RequestedLayerState::Changes::GameMode;
+
+// Changes that move layers in the hierarchy, and require walking all of it.
+constexpr ftl::Flags<RequestedLayerState::Changes> HIERARCHY_CHANGES =
+        RequestedLayerState::Changes::Created | RequestedLayerState::Changes::Destroyed |
+        RequestedLayerState::Changes::Hierarchy | RequestedLayerState::Changes::Mirror |
+        RequestedLayerState::Changes::Parent | RequestedLayerState::Changes::RelativeParent |
+        RequestedLayerState::Changes::Z;
+
 } // namespace
 
 LayerSnapshot LayerSnapshotBuilder::getRootSnapshot() {
@@ -433,10 +448,18 @@ void LayerSnapshotBuilder::updateSnapshots(const Args& args) {
         rootSnapshot.clientChanges |= layer_state_t::eReparent;
     }
 
-    for (auto& snapshot : mSnapshots) {
-        if (snapshot->reachablilty == LayerSnapshot::Reachablilty::Reachable) {
-            snapshot->reachablilty = LayerSnapshot::Reachablilty::Unreachable;
+    mUpdateDirtySubtreesOnly = FlagManager::getInstance().incremental_snapshot_update() &&
+            canUpdateDirtySubtreesOnly(args);
+    if (mUpdateDirtySubtreesOnly) {
+        // The hierarchy did not change, so the snapshots that are not visited stay reachable.
+        markDirtySubtrees(args);
+    } else {
+        for (auto& snapshot : mSnapshots) {
+            if (snapshot->reachablilty == LayerSnapshot::Reachablilty::Reachable) {
+                snapshot->reachablilty = LayerSnapshot::Reachablilty::Unreachable;
+            }
         }
+        mMirrorLayerIds.clear();
     }
 
     LayerHierarchy::TraversalPath root = LayerHierarchy::TraversalPath::ROOT;
@@ -451,9 +474,13 @@ void LayerSnapshotBuilder::updateSnapshots(const Args& args) {
             LayerHierarchy::ScopedAddToTraversalPath addChildToPath(root,
                                                                     childHierarchy->getLayer()->id,
                                                                     variant);
+            if (canSkipSubtree(rootSnapshot, root)) {
+                continue;
+            }
             updateSnapshotsInHierarchy(args, *childHierarchy, root, rootSnapshot, /*depth=*/0);
         }
     }
+    mUpdateDirtySubtreesOnly = false;
 
     // Update touchable region crops outside the main update pass. This is because a layer could be
     // cropped by any other layer and it requires both snapshots to be updated.
@@ -514,6 +541,57 @@ void LayerSnapshotBuilder::update(const Args& args) {
     updateSnapshots(args);
 }
 
+bool LayerSnapshotBuilder::canUpdateDirtySubtreesOnly(const Args& args) const {
+    return !mSnapshots.empty() && args.forceUpdate == ForceUpdateFlags::NONE &&
+            !args.displayChanges && !args.parentCrop &&
+            !args.layerLifecycleManager.getGlobalChanges().any(HIERARCHY_CHANGES) &&
+            args.layerLifecycleManager.getDestroyedLayers().empty();
+}
+
+void LayerSnapshotBuilder::markDirtySubtrees(const Args& args) {
+    mDirtyLayerIds.clear();
+    std::vector<uint32_t> layerIds(mMirrorLayerIds.begin(), mMirrorLayerIds.end());
+    for (const RequestedLayerState* changedLayer :
+         args.layerLifecycleManager.getChangedLayers()) {
+        layerIds.push_back(changedLayer->id);
+    }
+
+    while (!layerIds.empty()) {
+        const uint32_t layerId = layerIds.back();
+        layerIds.pop_back();
+        if (layerId == UNASSIGNED_LAYER_ID || !mDirtyLayerIds.insert(layerId).second) {
+            continue;
+        }
+        const RequestedLayerState* layer = args.layerLifecycleManager.getLayerFromId(layerId);
+        if (!layer) {
+            continue;
+        }
+        // A layer is visited through its parent and through its relative parent.
+        layerIds.push_back(layer->parentId);
+        layerIds.push_back(layer->relativeParentId);
+    }
+}
+
+bool LayerSnapshotBuilder::canSkipSubtree(const LayerSnapshot& parentSnapshot,
+                                          const LayerHierarchy::TraversalPath& path) const {
+    if (!mUpdateDirtySubtreesOnly) {
+        return false;
+    }
+
+    // Clones are reached through their mirror, which is always walked. Layers under a relative
+    // parent inherit its relative state without a change of their own.
+    if (path.isClone() ||
+        (path.isRelative() && path.variant != LayerHierarchy::Variant::Relative)) {
+        return false;
+    }
+
+    if (parentSnapshot.changes.any(CHANGES_INHERITED_BY_CHILDREN) ||
+        (parentSnapshot.clientChanges & layer_state_t::AFFECTS_CHILDREN)) {
+        return false;
+    }
+    return mDirtyLayerIds.find(path.id) == mDirtyLayerIds.end();
+}
+
 const LayerSnapshot& LayerSnapshotBuilder::updateSnapshotsInHierarchy(
         const Args& args, const LayerHierarchy& hierarchy,
         LayerHierarchy::TraversalPath& traversalPath, const LayerSnapshot& parentSnapshot,
@@ -547,6 +625,16 @@ const LayerSnapshot& LayerSnapshotBuilder::updateSnapshotsInHierarchy(
         LayerHierarchy::ScopedAddToTraversalPath addChildToPath(traversalPath,
                                                                 childHierarchy->getLayer()->id,
                                                                 variant);
+        if (variant == LayerHierarchy::Variant::Mirror) {
+            mMirrorLayerIds.insert(layer->id);
+        }
+        if (canSkipSubtree(*snapshot, traversalPath)) {
+            // The child is up to date, but this snapshot may need its frame rate.
+            if (const LayerSnapshot* childSnapshot = getSnapshot(traversalPath)) {
+                updateFrameRateFromChildSnapshot(*snapshot, *childSnapshot, args);
+                continue;
+            }
+        }
         const LayerSnapshot& childSnapshot =
                 updateSnapshotsInHierarchy(args, *childHierarchy, traversalPath, *snapshot,
                                            depth + 1);
@@ -705,11 +793,8 @@ void LayerSnapshotBuilder::updateSnapshot(LayerSnapshot& snapshot, const Args& a
                                           const LayerSnapshot& parentSnapshot,
                                           const LayerHierarchy::TraversalPath& path) {
     // Always update flags and visibility
-    ftl::Flags<RequestedLayerState::Changes> parentChanges = parentSnapshot.changes &
-            (RequestedLayerState::Changes::Hierarchy | RequestedLayerState::Changes::Geometry |
-             RequestedLayerState::Changes::Visibility | RequestedLayerState::Changes::Metadata |
-             RequestedLayerState::Changes::AffectsChildren | RequestedLayerState::Changes::Input |
-             RequestedLayerState::Changes::FrameRate | RequestedLayerState::Changes::GameMode);
+    ftl::Flags<RequestedLayerState::Changes> parentChanges =
+            parentSnapshot.changes & CHANGES_INHERITED_BY_CHILDREN;
     snapshot.changes |= parentChanges;
     if (args.displayChanges) snapshot.changes |= RequestedLayerState::Changes::Geometry;
     snapshot.reachablilty = LayerSnapshot::Reachablilty::Reachable;
@@ -98,6 +98,17 @@ private:
 
     void updateSnapshots(const Args& args);
 
+    // Returns true if the changes since the last update can be applied by only walking the
+    // subtrees that contain changed layers. This is not possible if the hierarchy or the
+    // displays changed, or if all the snapshots are force updated.
+    bool canUpdateDirtySubtreesOnly(const Args& args) const;
+    // Collects the changed layers and all their parents and relative parents.
+    void markDirtySubtrees(const Args& args);
+    // Returns true if the snapshots under the given path are up to date and the walk does not
+    // need to visit them.
+    bool canSkipSubtree(const LayerSnapshot& parentSnapshot,
+                        const LayerHierarchy::TraversalPath& path) const;
+
     const LayerSnapshot& updateSnapshotsInHierarchy(const Args&, const LayerHierarchy& hierarchy,
                                                     LayerHierarchy::TraversalPath& traversalPath,
                                                     const LayerSnapshot& parentSnapshot, int depth);
@@ -133,6 +144,14 @@ private:
     std::unordered_set<LayerHierarchy::TraversalPath, LayerHierarchy::TraversalPathHash>
             mNeedsTouchableRegionCrop;
     std::vector<std::unique_ptr<LayerSnapshot>> mSnapshots;
+
+    // Set while updating only the subtrees that contain one of mDirtyLayerIds.
+    bool mUpdateDirtySubtreesOnly = false;
+    std::unordered_set<uint32_t> mDirtyLayerIds;
+    // Layers that mirror another layer or a display. Their subtrees are always walked because
+    // the mirrored layers cannot be traced back to them.
+    std::unordered_set<uint32_t> mMirrorLayerIds;
+
     bool mResortSnapshots = false;
     int mNumInterestingSnapshots = 0;
 };
@@ -36,6 +36,7 @@
 #include <ui/DisplayStatInfo.h>
 #include <utils/Trace.h>
 
+#include <cstring>
 #include <string>
 
 #include "DisplayDevice.h"
@@ -63,6 +64,7 @@ constexpr auto defaultRegionSamplingWorkDuration = 3ms;
 constexpr auto defaultRegionSamplingPeriod = 100ms;
 constexpr auto defaultRegionSamplingTimerTimeout = 100ms;
 constexpr auto maxRegionSamplingDelay = 100ms;
+constexpr int32_t defaultRegionSamplingDownscale = 1;
 // TODO: (b/127403193) duration to string conversion could probably be constexpr
 template <typename Rep, typename Per>
 inline std::string toNsString(std::chrono::duration<Rep, Per> t) {
@@ -96,9 +98,26 @@ RegionSamplingThread::EnvironmentTimingTunables::EnvironmentTimingTunables() {
     }
 }
 
+// debug.sf.region_sampling_downscale
+// The factor by which the sampled region is scaled down when it is rendered. The luma is averaged
+// over the sampled areas, so the filtering of the scaled down render barely changes it, and much
+// fewer pixels are read back on the CPU.
+static int32_t getSamplingDownscale() {
+    char value[PROPERTY_VALUE_MAX] = {};
+    property_get("debug.sf.region_sampling_downscale", value,
+                 std::to_string(defaultRegionSamplingDownscale).c_str());
+    const int32_t downscale = atoi(value);
+    if (downscale < 1) {
+        ALOGW("User-specified sampling downscale nonsensical. Using default");
+        return defaultRegionSamplingDownscale;
+    }
+    return downscale;
+}
+
 RegionSamplingThread::RegionSamplingThread(SurfaceFlinger& flinger, const TimingTunables& tunables)
       : mFlinger(flinger),
         mTunables(tunables),
+        mSamplingDownscale(getSamplingDownscale()),
         mIdleTimer(
                 "RegSampIdle",
                 std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -196,6 +215,28 @@ void RegionSamplingThread::binderDied(const wp<IBinder>& who) {
     mDescriptors.erase(who);
 }
 
+namespace {
+
+// Four RGBA_8888 pixels, which fit in a single NEON or SSE register.
+typedef uint32_t Pixels __attribute__((vector_size(16)));
+constexpr int32_t kPixelsPerVector = sizeof(Pixels) / sizeof(uint32_t);
+
+int32_t divideRoundUp(int32_t value, int32_t divisor) {
+    return (value + divisor - 1) / divisor;
+}
+
+// Calculates luma with approximation of Rec. 709 primaries. This works on single pixels as well
+// as on vectors of pixels.
+template <typename T>
+T getLuma(T pixel) {
+    const T r = pixel & 0xFF;
+    const T g = (pixel >> 8) & 0xFF;
+    const T b = (pixel >> 16) & 0xFF;
+    return (r * 7 + b * 2 + g * 23) >> 5;
+}
+
+} // namespace
+
 float sampleArea(const uint32_t* data, int32_t width, int32_t height, int32_t stride,
                  uint32_t orientation, const Rect& sample_area) {
     if (!sample_area.isValid() || (sample_area.getWidth() > width) ||
@@ -207,19 +248,23 @@ float sampleArea(const uint32_t* data, int32_t width, int32_t height, int32_t st
     const uint32_t pixelCount =
             (sample_area.bottom - sample_area.top) * (sample_area.right - sample_area.left);
     uint32_t accumulatedLuma = 0;
+    Pixels accumulatedLumas = {};
 
-    // Calculates luma with approximation of Rec. 709 primaries
     for (int32_t row = sample_area.top; row < sample_area.bottom; ++row) {
         const uint32_t* rowBase = data + row * stride;
-        for (int32_t column = sample_area.left; column < sample_area.right; ++column) {
-            uint32_t pixel = rowBase[column];
-            const uint32_t r = pixel & 0xFF;
-            const uint32_t g = (pixel >> 8) & 0xFF;
-            const uint32_t b = (pixel >> 16) & 0xFF;
-            const uint32_t luma = (r * 7 + b * 2 + g * 23) >> 5;
-            accumulatedLuma += luma;
+        int32_t column = sample_area.left;
+        for (; column + kPixelsPerVector <= sample_area.right; column += kPixelsPerVector) {
+            Pixels pixels;
+            memcpy(&pixels, rowBase + column, sizeof(pixels));
+            accumulatedLumas += getLuma(pixels);
+        }
+        for (; column < sample_area.right; ++column) {
+            accumulatedLuma += getLuma(rowBase[column]);
         }
     }
+    for (int32_t i = 0; i < kPixelsPerVector; ++i) {
+        accumulatedLuma += accumulatedLumas[i];
+    }
 
     return accumulatedLuma / (255.0f * pixelCount);
 }
@@ -239,8 +284,15 @@ std::vector<float> RegionSamplingThread::sampleBuffer(
     std::vector<float> lumas(descriptors.size());
     std::transform(descriptors.begin(), descriptors.end(), lumas.begin(),
                    [&](auto const& descriptor) {
-                       return sampleArea(data.get(), width, height, stride, orientation,
-                                         descriptor.area - leftTop);
+                       Rect area = descriptor.area - leftTop;
+                       if (mSamplingDownscale > 1) {
+                           // Keep every pixel that the area partially covers.
+                           area = Rect(area.left / mSamplingDownscale,
+                                       area.top / mSamplingDownscale,
+                                       divideRoundUp(area.right, mSamplingDownscale),
+                                       divideRoundUp(area.bottom, mSamplingDownscale));
+                       }
+                       return sampleArea(data.get(), width, height, stride, orientation, area);
                    });
     return lumas;
 }
@@ -276,10 +328,12 @@ void RegionSamplingThread::captureSample() {
     }
 
     const Rect sampledBounds = sampleRegion.bounds();
+    const ui::Size sampledSize(divideRoundUp(sampledBounds.getWidth(), mSamplingDownscale),
+                               divideRoundUp(sampledBounds.getHeight(), mSamplingDownscale));
     constexpr bool kHintForSeamlessTransition = false;
 
     SurfaceFlinger::RenderAreaFuture renderAreaFuture = ftl::defer([=] {
-        return DisplayRenderArea::create(displayWeak, sampledBounds, sampledBounds.getSize(),
+        return DisplayRenderArea::create(displayWeak, sampledBounds, sampledSize,
                                          ui::Dataspace::V0_SRGB, kHintForSeamlessTransition);
     });
 
@@ -354,14 +408,14 @@ void RegionSamplingThread::captureSample() {
     }
 
     std::shared_ptr<renderengine::ExternalTexture> buffer = nullptr;
-    if (mCachedBuffer && mCachedBuffer->getBuffer()->getWidth() == sampledBounds.getWidth() &&
-        mCachedBuffer->getBuffer()->getHeight() == sampledBounds.getHeight()) {
+    if (mCachedBuffer && mCachedBuffer->getBuffer()->getWidth() == sampledSize.getWidth() &&
+        mCachedBuffer->getBuffer()->getHeight() == sampledSize.getHeight()) {
         buffer = mCachedBuffer;
     } else {
         const uint32_t usage =
                 GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_TEXTURE;
         sp<GraphicBuffer> graphicBuffer =
-                sp<GraphicBuffer>::make(sampledBounds.getWidth(), sampledBounds.getHeight(),
+                sp<GraphicBuffer>::make(sampledSize.getWidth(), sampledSize.getHeight(),
                                         PIXEL_FORMAT_RGBA_8888, 1, usage, "RegionSamplingThread");
         const status_t bufferStatus = graphicBuffer->initCheck();
         LOG_ALWAYS_FATAL_IF(bufferStatus != OK, "captureSample: Buffer failed to allocate: %d",
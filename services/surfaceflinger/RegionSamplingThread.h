@@ -104,6 +104,7 @@ private:
 
     SurfaceFlinger& mFlinger;
     const TimingTunables mTunables;
+    const int32_t mSamplingDownscale;
     scheduler::OneShotTimer mIdleTimer;
 
     std::thread mThread;
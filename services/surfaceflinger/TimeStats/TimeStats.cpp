@@ -19,6 +19,7 @@
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
 #include <android-base/stringprintf.h>
+#include <common/FlagManager.h>
 #include <log/log.h>
 #include <timestatsatomsproto/TimeStatsAtomsProtoHeader.h>
 #include <utils/String8.h>
@@ -28,6 +29,7 @@
 #include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <iterator>
 #include <unordered_map>
 
 #include "TimeStats.h"
@@ -97,6 +99,7 @@ bool TimeStats::populateGlobalAtom(std::vector<uint8_t>* pulledData) {
     if (mTimeStats.statsStartLegacy == 0) {
         return false;
     }
+    flushPendingRecordsLocked();
     flushPowerTimeLocked();
     SurfaceflingerStatsGlobalInfoWrapper atomList;
     for (const auto& globalSlice : mTimeStats.stats) {
@@ -146,6 +149,7 @@ bool TimeStats::populateGlobalAtom(std::vector<uint8_t>* pulledData) {
 
 bool TimeStats::populateLayerAtom(std::vector<uint8_t>* pulledData) {
     std::lock_guard<std::mutex> lock(mMutex);
+    flushPendingRecordsLocked();
 
     std::vector<TimeStatsHelper::TimeStatsLayer*> dumpStats;
     uint32_t numLayers = 0;
@@ -308,6 +312,8 @@ std::string TimeStats::miniDump() {
 
     std::string result = "TimeStats miniDump:\n";
     std::lock_guard<std::mutex> lock(mMutex);
+    flushPendingRecordsLocked();
+    std::lock_guard<std::mutex> layerRecordsLock(mLayerRecordsMutex);
     android::base::StringAppendF(&result, "Number of layers currently being tracked is %zu\n",
                                  mTimeStatsTracker.size());
     android::base::StringAppendF(&result, "Number of layers in the stats pool is %zu\n",
@@ -441,31 +447,124 @@ static int32_t clampToNearestBucket(Fps fps, size_t bucketWidth) {
     return std::round(fps.getValue() / bucketWidth) * bucketWidth;
 }
 
-void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerId, Fps displayRefreshRate,
-                                                   std::optional<Fps> renderRate,
-                                                   SetFrameRateVote frameRateVote,
-                                                   GameMode gameMode) {
+std::mutex& TimeStats::layerRecordsMutex() {
+    return FlagManager::getInstance().deferred_timestats_aggregation() ? mLayerRecordsMutex
+                                                                       : mMutex;
+}
+
+void TimeStats::takePresentedRecordsLocked(int32_t layerId, LayerRecord& layerRecord,
+                                           bool destroyed) {
+    const size_t count = static_cast<size_t>(std::max(layerRecord.waitData, 0));
+    if (!destroyed &&
+        (count == 0 || mNumPendingTimeRecords + count > MAX_NUM_PENDING_LAYER_TIME_RECORDS)) {
+        return;
+    }
+
+    PendingLayerRecords& pending = mPendingLayerRecords.emplace_back();
+    pending.layerId = layerId;
+    pending.destroyed = destroyed;
+    LayerRecord& taken = pending.layerRecord;
+    taken.uid = layerRecord.uid;
+    taken.layerName = layerRecord.layerName;
+    taken.gameMode = layerRecord.gameMode;
+    taken.droppedFrames = std::exchange(layerRecord.droppedFrames, 0);
+    taken.lateAcquireFrames = std::exchange(layerRecord.lateAcquireFrames, 0);
+    taken.badDesiredPresentFrames = std::exchange(layerRecord.badDesiredPresentFrames, 0);
+
+    const auto end = layerRecord.timeRecords.begin() + count;
+    taken.timeRecords.assign(std::make_move_iterator(layerRecord.timeRecords.begin()),
+                             std::make_move_iterator(end));
+    layerRecord.timeRecords.erase(layerRecord.timeRecords.begin(), end);
+    layerRecord.waitData -= static_cast<int32_t>(count);
+    mNumPendingTimeRecords += count;
+}
+
+void TimeStats::flushPendingRecordsLocked() {
+    if (!FlagManager::getInstance().deferred_timestats_aggregation()) return;
+
+    ATRACE_CALL();
+
+    std::vector<PendingLayerRecords> pendingLayerRecords;
+    std::vector<JankyFramesInfo> pendingJankyFrames;
+    std::vector<FoldedJankyFrames> foldedJankyFrames;
+    {
+        std::lock_guard<std::mutex> lock(mLayerRecordsMutex);
+        for (auto& [layerId, layerRecord] : mTimeStatsTracker) {
+            takePresentedRecordsLocked(layerId, layerRecord, /*destroyed=*/false);
+        }
+        pendingLayerRecords = std::exchange(mPendingLayerRecords, {});
+        pendingJankyFrames = std::exchange(mPendingJankyFrames, {});
+        foldedJankyFrames = std::exchange(mFoldedJankyFrames, {});
+        mNumPendingTimeRecords = 0;
+    }
+
+    for (PendingLayerRecords& pending : pendingLayerRecords) {
+        const auto [it, inserted] = mAggregatedLayerRecords.try_emplace(pending.layerId);
+        LayerRecord& layerRecord = it->second;
+        LayerRecord& taken = pending.layerRecord;
+        if (inserted) {
+            layerRecord.uid = taken.uid;
+            layerRecord.layerName = std::move(taken.layerName);
+            layerRecord.gameMode = taken.gameMode;
+            layerRecord.waitData = 0;
+        }
+        layerRecord.droppedFrames += taken.droppedFrames;
+        layerRecord.lateAcquireFrames += taken.lateAcquireFrames;
+        layerRecord.badDesiredPresentFrames += taken.badDesiredPresentFrames;
+        layerRecord.waitData += static_cast<int32_t>(taken.timeRecords.size());
+        std::move(taken.timeRecords.begin(), taken.timeRecords.end(),
+                  std::back_inserter(layerRecord.timeRecords));
+
+        flushAvailableRecordsToStatsLocked(pending.layerId, layerRecord);
+        if (layerRecord.timeRecords.size() > MAX_NUM_TIME_RECORDS) {
+            ALOGE("[%d]-[%s]-too many frames with pending fences[%zu]", pending.layerId,
+                  layerRecord.layerName.c_str(), layerRecord.timeRecords.size());
+            mAggregatedLayerRecords.erase(it);
+        } else if (pending.destroyed) {
+            mAggregatedLayerRecords.erase(it);
+        }
+    }
+
+    // The janky frames are aggregated last, so that the stats of the layers
+    // that they are blamed to exist by then.
+    for (const JankyFramesInfo& info : pendingJankyFrames) {
+        aggregateJankyFramesLocked(info);
+    }
+    for (const FoldedJankyFrames& folded : foldedJankyFrames) {
+        aggregateJankyFramesLocked(folded.info, folded.count, /*recordDeltas=*/false);
+    }
+}
+
+void TimeStats::tryFlushPendingRecords() {
+    // If a pull or a dump holds mMutex, the frames are aggregated by the next
+    // flush instead of waiting for it.
+    std::unique_lock<std::mutex> lock(mMutex, std::try_to_lock);
+    if (!lock.owns_lock()) return;
+    flushPendingRecordsLocked();
+}
+
+void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerId, LayerRecord& layerRecord) {
     ATRACE_CALL();
     ALOGV("[%d]-flushAvailableRecordsToStatsLocked", layerId);
 
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     TimeRecord& prevTimeRecord = layerRecord.prevTimeRecord;
     std::optional<int32_t>& prevPresentToPresentMs = layerRecord.prevPresentToPresentMs;
     std::deque<TimeRecord>& timeRecords = layerRecord.timeRecords;
-    const int32_t refreshRateBucket =
-            clampToNearestBucket(displayRefreshRate, REFRESH_RATE_BUCKET_WIDTH);
-    const int32_t renderRateBucket =
-            clampToNearestBucket(renderRate ? *renderRate : displayRefreshRate,
-                                 RENDER_RATE_BUCKET_WIDTH);
     while (!timeRecords.empty()) {
         if (!recordReadyLocked(layerId, &timeRecords[0])) break;
         ALOGV("[%d]-[%" PRIu64 "]-presentFenceTime[%" PRId64 "]", layerId,
               timeRecords[0].frameTime.frameNumber, timeRecords[0].frameTime.presentTime);
 
-        if (prevTimeRecord.ready) {
+        // With deferred aggregation, stats of new layers are not aggregated once there are too
+        // many of them. Otherwise, setPostTime does not record their frames in the first place.
+        if (prevTimeRecord.ready &&
+            (!FlagManager::getInstance().deferred_timestats_aggregation() ||
+             canAddNewAggregatedStats(layerRecord.uid, layerRecord.layerName,
+                                      timeRecords[0].gameMode))) {
             uid_t uid = layerRecord.uid;
             const std::string& layerName = layerRecord.layerName;
-            TimeStatsHelper::TimelineStatsKey timelineKey = {refreshRateBucket, renderRateBucket};
+            const GameMode gameMode = timeRecords[0].gameMode;
+            const TimeStatsHelper::TimelineStatsKey& timelineKey = timeRecords[0].timelineKey;
             if (!mTimeStats.stats.count(timelineKey)) {
                 mTimeStats.stats[timelineKey].key = timelineKey;
             }
@@ -474,12 +573,14 @@ void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerId, Fps displayR
 
             TimeStatsHelper::LayerStatsKey layerKey = {uid, layerName, gameMode};
             if (!displayStats.stats.count(layerKey)) {
-                displayStats.stats[layerKey].displayRefreshRateBucket = refreshRateBucket;
-                displayStats.stats[layerKey].renderRateBucket = renderRateBucket;
+                displayStats.stats[layerKey].displayRefreshRateBucket =
+                        timelineKey.displayRefreshRateBucket;
+                displayStats.stats[layerKey].renderRateBucket = timelineKey.renderRateBucket;
                 displayStats.stats[layerKey].uid = uid;
                 displayStats.stats[layerKey].layerName = layerName;
                 displayStats.stats[layerKey].gameMode = gameMode;
             }
+            const SetFrameRateVote& frameRateVote = timeRecords[0].frameRateVote;
             if (frameRateVote.frameRate > 0.0f) {
                 displayStats.stats[layerKey].setFrameRateVote = frameRateVote;
             }
@@ -572,22 +673,28 @@ void TimeStats::setPostTime(int32_t layerId, uint64_t frameNumber, const std::st
     ALOGV("[%d]-[%" PRIu64 "]-[%s]-PostTime[%" PRId64 "]", layerId, frameNumber, layerName.c_str(),
           postTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!canAddNewAggregatedStats(uid, layerName, gameMode)) {
+    std::lock_guard<std::mutex> lock(layerRecordsMutex());
+    // With deferred aggregation, this is checked when the frames are aggregated, as it needs
+    // mMutex.
+    if (!FlagManager::getInstance().deferred_timestats_aggregation() &&
+        !canAddNewAggregatedStats(uid, layerName, gameMode)) {
         return;
     }
-    if (!mTimeStatsTracker.count(layerId) && mTimeStatsTracker.size() < MAX_NUM_LAYER_RECORDS &&
-        layerNameIsValid(layerName)) {
-        mTimeStatsTracker[layerId].uid = uid;
-        mTimeStatsTracker[layerId].layerName = layerName;
-        mTimeStatsTracker[layerId].gameMode = gameMode;
+    auto it = mTimeStatsTracker.find(layerId);
+    if (it == mTimeStatsTracker.end()) {
+        if (mTimeStatsTracker.size() >= MAX_NUM_LAYER_RECORDS || !layerNameIsValid(layerName)) {
+            return;
+        }
+        it = mTimeStatsTracker.try_emplace(layerId).first;
+        it->second.uid = uid;
+        it->second.layerName = layerName;
+        it->second.gameMode = gameMode;
     }
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.timeRecords.size() == MAX_NUM_TIME_RECORDS) {
         ALOGE("[%d]-[%s]-timeRecords is at its maximum size[%zu]. Ignore this when unittesting.",
               layerId, layerRecord.layerName.c_str(), MAX_NUM_TIME_RECORDS);
-        mTimeStatsTracker.erase(layerId);
+        mTimeStatsTracker.erase(it);
         return;
     }
     // For most media content, the acquireFence is invalid because the buffer is
@@ -615,9 +722,10 @@ void TimeStats::setLatchTime(int32_t layerId, uint64_t frameNumber, nsecs_t latc
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-LatchTime[%" PRId64 "]", layerId, frameNumber, latchTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    std::lock_guard<std::mutex> lock(layerRecordsMutex());
+    const auto it = mTimeStatsTracker.find(layerId);
+    if (it == mTimeStatsTracker.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -634,7 +742,7 @@ void TimeStats::incrementLatchSkipped(int32_t layerId, LatchSkipReason reason) {
     ALOGV("[%d]-LatchSkipped-Reason[%d]", layerId,
           static_cast<std::underlying_type<LatchSkipReason>::type>(reason));
 
-    std::lock_guard<std::mutex> lock(mMutex);
+    std::lock_guard<std::mutex> lock(layerRecordsMutex());
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
 
@@ -651,7 +759,7 @@ void TimeStats::incrementBadDesiredPresent(int32_t layerId) {
     ATRACE_CALL();
     ALOGV("[%d]-BadDesiredPresent", layerId);
 
-    std::lock_guard<std::mutex> lock(mMutex);
+    std::lock_guard<std::mutex> lock(layerRecordsMutex());
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     layerRecord.badDesiredPresentFrames++;
@@ -663,9 +771,10 @@ void TimeStats::setDesiredTime(int32_t layerId, uint64_t frameNumber, nsecs_t de
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-DesiredTime[%" PRId64 "]", layerId, frameNumber, desiredTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    std::lock_guard<std::mutex> lock(layerRecordsMutex());
+    const auto it = mTimeStatsTracker.find(layerId);
+    if (it == mTimeStatsTracker.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -681,9 +790,10 @@ void TimeStats::setAcquireTime(int32_t layerId, uint64_t frameNumber, nsecs_t ac
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-AcquireTime[%" PRId64 "]", layerId, frameNumber, acquireTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    std::lock_guard<std::mutex> lock(layerRecordsMutex());
+    const auto it = mTimeStatsTracker.find(layerId);
+    if (it == mTimeStatsTracker.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -701,9 +811,10 @@ void TimeStats::setAcquireFence(int32_t layerId, uint64_t frameNumber,
     ALOGV("[%d]-[%" PRIu64 "]-AcquireFenceTime[%" PRId64 "]", layerId, frameNumber,
           acquireFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    std::lock_guard<std::mutex> lock(layerRecordsMutex());
+    const auto it = mTimeStatsTracker.find(layerId);
+    if (it == mTimeStatsTracker.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -713,6 +824,13 @@ void TimeStats::setAcquireFence(int32_t layerId, uint64_t frameNumber,
     }
 }
 
+TimeStatsHelper::TimelineStatsKey TimeStats::getTimelineKey(Fps displayRefreshRate,
+                                                            std::optional<Fps> renderRate) {
+    return {clampToNearestBucket(displayRefreshRate, REFRESH_RATE_BUCKET_WIDTH),
+            clampToNearestBucket(renderRate ? *renderRate : displayRefreshRate,
+                                 RENDER_RATE_BUCKET_WIDTH)};
+}
+
 void TimeStats::setPresentTime(int32_t layerId, uint64_t frameNumber, nsecs_t presentTime,
                                Fps displayRefreshRate, std::optional<Fps> renderRate,
                                SetFrameRateVote frameRateVote, GameMode gameMode) {
@@ -721,21 +839,8 @@ void TimeStats::setPresentTime(int32_t layerId, uint64_t frameNumber, nsecs_t pr
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-PresentTime[%" PRId64 "]", layerId, frameNumber, presentTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.frameTime.presentTime = presentTime;
-        timeRecord.ready = true;
-        layerRecord.waitData++;
-    }
-
-    flushAvailableRecordsToStatsLocked(layerId, displayRefreshRate, renderRate, frameRateVote,
-                                       gameMode);
+    setPresent(layerId, frameNumber, presentTime, nullptr, displayRefreshRate, renderRate,
+               frameRateVote, gameMode);
 }
 
 void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
@@ -748,21 +853,50 @@ void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
     ALOGV("[%d]-[%" PRIu64 "]-PresentFenceTime[%" PRId64 "]", layerId, frameNumber,
           presentFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.presentFence = presentFence;
-        timeRecord.ready = true;
-        layerRecord.waitData++;
+    setPresent(layerId, frameNumber, 0, presentFence, displayRefreshRate, renderRate,
+               frameRateVote, gameMode);
+}
+
+void TimeStats::setPresent(int32_t layerId, uint64_t frameNumber, nsecs_t presentTime,
+                           const std::shared_ptr<FenceTime>& presentFence, Fps displayRefreshRate,
+                           std::optional<Fps> renderRate, SetFrameRateVote frameRateVote,
+                           GameMode gameMode) {
+    const bool deferred = FlagManager::getInstance().deferred_timestats_aggregation();
+    {
+        std::lock_guard<std::mutex> lock(layerRecordsMutex());
+        const auto it = mTimeStatsTracker.find(layerId);
+        if (it == mTimeStatsTracker.end()) return;
+        LayerRecord& layerRecord = it->second;
+        if (layerRecord.waitData < 0 ||
+            layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
+            return;
+        TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
+        if (timeRecord.frameTime.frameNumber == frameNumber) {
+            if (presentFence != nullptr) {
+                timeRecord.presentFence = presentFence;
+            } else {
+                timeRecord.frameTime.presentTime = presentTime;
+            }
+            timeRecord.timelineKey = getTimelineKey(displayRefreshRate, renderRate);
+            timeRecord.frameRateVote = frameRateVote;
+            timeRecord.gameMode = gameMode;
+            timeRecord.ready = true;
+            layerRecord.waitData++;
+        }
+
+        if (!deferred) {
+            flushAvailableRecordsToStatsLocked(layerId, layerRecord);
+            return;
+        }
+        // The fences of the taken frames are checked when they are aggregated,
+        // by which time most of them have signaled.
+        if (layerRecord.waitData < static_cast<int32_t>(MAX_NUM_PENDING_TIME_RECORDS)) {
+            return;
+        }
+        takePresentedRecordsLocked(layerId, layerRecord, /*destroyed=*/false);
     }
 
-    flushAvailableRecordsToStatsLocked(layerId, displayRefreshRate, renderRate, frameRateVote,
-                                       gameMode);
+    tryFlushPendingRecords();
 }
 
 static const constexpr int32_t kValidJankyReason = JankType::DisplayHAL |
@@ -771,34 +905,34 @@ static const constexpr int32_t kValidJankyReason = JankType::DisplayHAL |
         JankType::SurfaceFlingerScheduling;
 
 template <class T>
-static void updateJankPayload(T& t, int32_t reasons) {
-    t.jankPayload.totalFrames++;
+static void updateJankPayload(T& t, int32_t reasons, int32_t count) {
+    t.jankPayload.totalFrames += count;
 
     if (reasons & kValidJankyReason) {
-        t.jankPayload.totalJankyFrames++;
+        t.jankPayload.totalJankyFrames += count;
         if ((reasons & JankType::SurfaceFlingerCpuDeadlineMissed) != 0) {
-            t.jankPayload.totalSFLongCpu++;
+            t.jankPayload.totalSFLongCpu += count;
         }
         if ((reasons & JankType::SurfaceFlingerGpuDeadlineMissed) != 0) {
-            t.jankPayload.totalSFLongGpu++;
+            t.jankPayload.totalSFLongGpu += count;
         }
         if ((reasons & JankType::DisplayHAL) != 0) {
-            t.jankPayload.totalSFUnattributed++;
+            t.jankPayload.totalSFUnattributed += count;
         }
         if ((reasons & JankType::AppDeadlineMissed) != 0) {
-            t.jankPayload.totalAppUnattributed++;
+            t.jankPayload.totalAppUnattributed += count;
         }
         if ((reasons & JankType::PredictionError) != 0) {
-            t.jankPayload.totalSFPredictionError++;
+            t.jankPayload.totalSFPredictionError += count;
         }
         if ((reasons & JankType::SurfaceFlingerScheduling) != 0) {
-            t.jankPayload.totalSFScheduling++;
+            t.jankPayload.totalSFScheduling += count;
         }
     }
 
     // We want to track BufferStuffing separately as it can provide info on latency issues
     if (reasons & JankType::BufferStuffing) {
-        t.jankPayload.totalAppBufferStuffing++;
+        t.jankPayload.totalAppBufferStuffing += count;
     }
 }
 
@@ -806,8 +940,48 @@ void TimeStats::incrementJankyFrames(const JankyFramesInfo& info) {
     if (!mEnabled.load()) return;
 
     ATRACE_CALL();
-    std::lock_guard<std::mutex> lock(mMutex);
+    if (!FlagManager::getInstance().deferred_timestats_aggregation()) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        aggregateJankyFramesLocked(info);
+        return;
+    }
 
+    {
+        std::lock_guard<std::mutex> lock(mLayerRecordsMutex);
+        if (mPendingJankyFrames.size() < MAX_NUM_QUEUED_JANKY_FRAMES) {
+            mPendingJankyFrames.push_back(info);
+            if (mPendingJankyFrames.size() < MAX_NUM_PENDING_JANKY_FRAMES) {
+                return;
+            }
+        } else {
+            foldJankyFrameLocked(info);
+        }
+    }
+
+    tryFlushPendingRecords();
+}
+
+void TimeStats::foldJankyFrameLocked(const JankyFramesInfo& info) {
+    JankyFramesInfo folded = info;
+    folded.displayDeadlineDelta = 0;
+    folded.displayPresentJitter = 0;
+    folded.appDeadlineDelta = 0;
+
+    const auto it = std::find_if(mFoldedJankyFrames.begin(), mFoldedJankyFrames.end(),
+                                 [&](const FoldedJankyFrames& f) { return f.info == folded; });
+    if (it != mFoldedJankyFrames.end()) {
+        it->count++;
+        return;
+    }
+    if (mFoldedJankyFrames.empty()) {
+        ALOGW("Too many janky frames while the stats are pulled or dumped, their deadline "
+              "deltas are not recorded");
+    }
+    mFoldedJankyFrames.push_back({std::move(folded), 1});
+}
+
+void TimeStats::aggregateJankyFramesLocked(const JankyFramesInfo& info, int32_t count,
+                                           bool recordDeltas) {
     // Only update layer stats if we're already tracking the layer in TimeStats.
     // Otherwise, continue tracking the statistic but use a default layer name instead.
     // As an implementation detail, we do this because this method is expected to be
@@ -835,7 +1009,7 @@ void TimeStats::incrementJankyFrames(const JankyFramesInfo& info) {
 
     TimeStatsHelper::TimelineStats& timelineStats = mTimeStats.stats[timelineKey];
 
-    updateJankPayload<TimeStatsHelper::TimelineStats>(timelineStats, info.reasons);
+    updateJankPayload<TimeStatsHelper::TimelineStats>(timelineStats, info.reasons, count);
 
     TimeStatsHelper::LayerStatsKey layerKey = {info.uid, info.layerName, info.gameMode};
     if (!timelineStats.stats.count(layerKey)) {
@@ -848,9 +1022,9 @@ void TimeStats::incrementJankyFrames(const JankyFramesInfo& info) {
     }
 
     TimeStatsHelper::TimeStatsLayer& timeStatsLayer = timelineStats.stats[layerKey];
-    updateJankPayload<TimeStatsHelper::TimeStatsLayer>(timeStatsLayer, info.reasons);
+    updateJankPayload<TimeStatsHelper::TimeStatsLayer>(timeStatsLayer, info.reasons, count);
 
-    if (info.reasons & kValidJankyReason) {
+    if (recordDeltas && (info.reasons & kValidJankyReason)) {
         // TimeStats Histograms only retain positive values, so we don't need to check if these
         // deadlines were really missed if we know that the frame had jank, since deadlines
         // that were met will be dropped.
@@ -863,8 +1037,14 @@ void TimeStats::incrementJankyFrames(const JankyFramesInfo& info) {
 void TimeStats::onDestroy(int32_t layerId) {
     ATRACE_CALL();
     ALOGV("[%d]-onDestroy", layerId);
-    std::lock_guard<std::mutex> lock(mMutex);
-    mTimeStatsTracker.erase(layerId);
+    std::lock_guard<std::mutex> lock(layerRecordsMutex());
+    const auto it = mTimeStatsTracker.find(layerId);
+    if (it == mTimeStatsTracker.end()) return;
+    if (FlagManager::getInstance().deferred_timestats_aggregation()) {
+        // The frames that were presented before the layer goes away are still aggregated.
+        takePresentedRecordsLocked(layerId, it->second, /*destroyed=*/true);
+    }
+    mTimeStatsTracker.erase(it);
 }
 
 void TimeStats::removeTimeRecord(int32_t layerId, uint64_t frameNumber) {
@@ -873,7 +1053,7 @@ void TimeStats::removeTimeRecord(int32_t layerId, uint64_t frameNumber) {
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-removeTimeRecord", layerId, frameNumber);
 
-    std::lock_guard<std::mutex> lock(mMutex);
+    std::lock_guard<std::mutex> lock(layerRecordsMutex());
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     size_t removeAt = 0;
@@ -1048,6 +1228,9 @@ void TimeStats::clearAll() {
     mTimeStats.stats.clear();
     clearGlobalLocked();
     clearLayersLocked();
+    std::lock_guard<std::mutex> layerRecordsLock(mLayerRecordsMutex);
+    mPendingJankyFrames.clear();
+    mFoldedJankyFrames.clear();
 }
 
 void TimeStats::clearGlobalLocked() {
@@ -1080,7 +1263,13 @@ void TimeStats::clearGlobalLocked() {
 void TimeStats::clearLayersLocked() {
     ATRACE_CALL();
 
-    mTimeStatsTracker.clear();
+    {
+        std::lock_guard<std::mutex> lock(mLayerRecordsMutex);
+        mTimeStatsTracker.clear();
+        mPendingLayerRecords.clear();
+        mNumPendingTimeRecords = 0;
+    }
+    mAggregatedLayerRecords.clear();
 
     for (auto& globalRecord : mTimeStats.stats) {
         globalRecord.second.stats.clear();
@@ -1102,6 +1291,7 @@ void TimeStats::dump(bool asProto, std::optional<uint32_t> maxLayers, std::strin
 
     mTimeStats.statsEndLegacy = static_cast<int64_t>(std::time(0));
 
+    flushPendingRecordsLocked();
     flushPowerTimeLocked();
 
     if (asProto) {
@@ -22,6 +22,7 @@
 #include <optional>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 #include <android/hardware/graphics/composer/2.4/IComposerClient.h>
 #include <gui/JankInfo.h>
@@ -92,7 +93,8 @@ public:
     virtual void setAcquireFence(int32_t layerId, uint64_t frameNumber,
                                  const std::shared_ptr<FenceTime>& acquireFence) = 0;
     // SetPresent{Time, Fence} are not expected to be called in the critical
-    // rendering path, as they flush prior fences if those fences have fired.
+    // rendering path, as they periodically flush prior fences if those fences
+    // have fired.
     virtual void setPresentTime(int32_t layerId, uint64_t frameNumber, nsecs_t presentTime,
                                 Fps displayRefreshRate, std::optional<Fps> renderRate,
                                 SetFrameRateVote frameRateVote, GameMode) = 0;
@@ -202,6 +204,11 @@ class TimeStats : public android::TimeStats {
         FrameTime frameTime;
         std::shared_ptr<FenceTime> acquireFence;
         std::shared_ptr<FenceTime> presentFence;
+        // The state of the display and the layer when the frame was presented,
+        // which the stats of the frame are aggregated under.
+        TimeStatsHelper::TimelineStatsKey timelineKey;
+        SetFrameRateVote frameRateVote;
+        GameMode gameMode = GameMode::Unsupported;
     };
 
     struct LayerRecord {
@@ -211,6 +218,7 @@ class TimeStats : public android::TimeStats {
         // This is the index in timeRecords, at which the timestamps for that
         // specific frame are still not fully received. This is not waiting for
         // fences to signal, but rather waiting to receive those fences/timestamps.
+        // The records before this index are not aggregated into the stats yet.
         int32_t waitData = -1;
         uint32_t droppedFrames = 0;
         uint32_t lateAcquireFrames = 0;
@@ -287,17 +295,43 @@ public:
     void pushCompositionStrategyState(const ClientCompositionRecord&) override;
 
     static const size_t MAX_NUM_TIME_RECORDS = 64;
+    // Number of presented frames of a layer, and of janky frames, that are
+    // recorded before they are aggregated into the stats.
+    static const size_t MAX_NUM_PENDING_TIME_RECORDS = MAX_NUM_TIME_RECORDS / 2;
+    static const size_t MAX_NUM_PENDING_JANKY_FRAMES = 1024;
 
 private:
     bool populateGlobalAtom(std::vector<uint8_t>* pulledData);
     bool populateLayerAtom(std::vector<uint8_t>* pulledData);
     bool recordReadyLocked(int32_t layerId, TimeRecord* timeRecord);
-    void flushAvailableRecordsToStatsLocked(int32_t layerId, Fps displayRefreshRate,
-                                            std::optional<Fps> renderRate, SetFrameRateVote,
-                                            GameMode);
+    // The mutex that recording a frame holds: mLayerRecordsMutex with deferred
+    // aggregation, otherwise mMutex, as the frame is aggregated when presented.
+    std::mutex& layerRecordsMutex();
+    void setPresent(int32_t layerId, uint64_t frameNumber, nsecs_t presentTime,
+                    const std::shared_ptr<FenceTime>& presentFence, Fps displayRefreshRate,
+                    std::optional<Fps> renderRate, SetFrameRateVote, GameMode);
+    // Moves the presented frames of a layer to mPendingLayerRecords. Requires
+    // mLayerRecordsMutex.
+    void takePresentedRecordsLocked(int32_t layerId, LayerRecord&, bool destroyed);
+    // Aggregates the presented frames taken from the layers, then the janky
+    // frames. mLayerRecordsMutex is only held while they are moved out.
+    void flushPendingRecordsLocked();
+    // Same as flushPendingRecordsLocked, unless a pull or a dump holds mMutex,
+    // in which case the frames are aggregated later.
+    void tryFlushPendingRecords();
+    // Aggregates the frames of layerRecord which are ready. Requires
+    // mLayerRecordsMutex as well if layerRecord is in mTimeStatsTracker.
+    void flushAvailableRecordsToStatsLocked(int32_t layerId, LayerRecord&);
+    // Counts count frames like info. Their deadline deltas are only recorded
+    // if recordDeltas is set.
+    void aggregateJankyFramesLocked(const JankyFramesInfo& info, int32_t count = 1,
+                                    bool recordDeltas = true);
+    void foldJankyFrameLocked(const JankyFramesInfo& info);
     void flushPowerTimeLocked();
     void flushAvailableGlobalRecordsToStatsLocked();
     bool canAddNewAggregatedStats(uid_t uid, const std::string& layerName, GameMode);
+    static TimeStatsHelper::TimelineStatsKey getTimelineKey(Fps displayRefreshRate,
+                                                            std::optional<Fps> renderRate);
 
     void enable();
     void disable();
@@ -307,14 +341,48 @@ private:
     void dump(bool asProto, std::optional<uint32_t> maxLayers, std::string& result);
 
     std::atomic<bool> mEnabled = false;
+    // Guards the aggregated stats. Pulls and dumps hold it while they serialize
+    // the stats.
     std::mutex mMutex;
     TimeStatsHelper::TimeStatsGlobal mTimeStats;
-    // Hashmap for LayerRecord with layerId as the hash key
-    std::unordered_map<int32_t, LayerRecord> mTimeStatsTracker;
     PowerTime mPowerTime;
     GlobalRecord mGlobalRecord;
 
+    // With deferred aggregation, the presented frames taken from the layers
+    // whose fences have not signaled yet, and the previous frame of each layer.
+    std::unordered_map<int32_t, LayerRecord> mAggregatedLayerRecords;
+
+    // Guards the frames that are recorded but not aggregated yet. With deferred
+    // aggregation, recording a frame only holds this mutex, and never waits for
+    // mMutex, so not for a pull or a dump either. When both mutexes are needed,
+    // mMutex is acquired first.
+    std::mutex mLayerRecordsMutex;
+    // Hashmap for LayerRecord with layerId as the hash key
+    std::unordered_map<int32_t, LayerRecord> mTimeStatsTracker;
+    struct PendingLayerRecords {
+        int32_t layerId;
+        // whether the layer was destroyed after these frames
+        bool destroyed;
+        LayerRecord layerRecord;
+    };
+    std::vector<PendingLayerRecords> mPendingLayerRecords;
+    size_t mNumPendingTimeRecords = 0;
+    std::vector<JankyFramesInfo> mPendingJankyFrames;
+    // Janky frames that came while mPendingJankyFrames was full, counted by
+    // everything but their deadline deltas, which are not kept.
+    struct FoldedJankyFrames {
+        JankyFramesInfo info;
+        int32_t count;
+    };
+    std::vector<FoldedJankyFrames> mFoldedJankyFrames;
+
     static const size_t MAX_NUM_LAYER_RECORDS = 200;
+    // Bounds on what is kept for aggregation while mMutex is held by a pull or
+    // a dump. Beyond them, frames stay in their layer, and janky frames are
+    // only counted.
+    static const size_t MAX_NUM_PENDING_LAYER_TIME_RECORDS =
+            MAX_NUM_LAYER_RECORDS * MAX_NUM_TIME_RECORDS;
+    static const size_t MAX_NUM_QUEUED_JANKY_FRAMES = 4 * MAX_NUM_PENDING_JANKY_FRAMES;
 
     static const size_t REFRESH_RATE_BUCKET_WIDTH = 30;
     static const size_t RENDER_RATE_BUCKET_WIDTH = REFRESH_RATE_BUCKET_WIDTH;
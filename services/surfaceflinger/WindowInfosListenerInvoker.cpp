@@ -71,6 +71,7 @@ void WindowInfosListenerInvoker::eraseListenerAndAckMessages(const wp<IBinder>&
     auto it = mWindowInfosListeners.find(binder);
     int64_t listenerId = it->second.first;
     mWindowInfosListeners.erase(binder);
+    mSyncedListenerIds.erase(listenerId);
 
     std::vector<int64_t> vsyncIds;
     for (auto& [vsyncId, state] : mUnackedState) {
@@ -133,14 +134,28 @@ void WindowInfosListenerInvoker::windowInfosChanged(
     mDelayInfo.reset();
     updateMaxSendDelay();
 
+    // Listeners which have the last update only need the windows which changed since then. The
+    // others get every window.
+    update.sequence = mNextSequence++;
+    std::optional<gui::WindowInfosUpdate> delta;
+    if (mLastUpdate && !mSyncedListenerIds.empty()) {
+        delta = update.makeDelta(*mLastUpdate);
+    }
+
     // Call the listeners
+    std::unordered_set<int64_t> syncedListenerIds;
     for (auto& pair : mWindowInfosListeners) {
         auto& [listenerId, listener] = pair.second;
-        auto status = listener->onWindowInfosChanged(update);
-        if (!status.isOk()) {
+        const bool sendDelta = delta && mSyncedListenerIds.count(listenerId) > 0;
+        auto status = listener->onWindowInfosChanged(sendDelta ? *delta : update);
+        if (status.isOk()) {
+            syncedListenerIds.insert(listenerId);
+        } else {
             ackWindowInfosReceived(update.vsyncId, listenerId);
         }
     }
+    mSyncedListenerIds = std::move(syncedListenerIds);
+    mLastUpdate = std::move(update);
 }
 
 WindowInfosListenerInvoker::DebugInfo WindowInfosListenerInvoker::getDebugInfo() {
@@ -203,4 +218,25 @@ binder::Status WindowInfosListenerInvoker::ackWindowInfosReceived(int64_t vsyncI
     return binder::Status::ok();
 }
 
+binder::Status WindowInfosListenerInvoker::requestWindowInfosSnapshot(int64_t listenerId) {
+    BackgroundExecutor::getInstance().sendCallbacks({[this, listenerId]() {
+        ATRACE_NAME("WindowInfosListenerInvoker::requestWindowInfosSnapshot");
+        mSyncedListenerIds.erase(listenerId);
+        if (!mLastUpdate) {
+            return;
+        }
+        for (auto& pair : mWindowInfosListeners) {
+            auto& [id, listener] = pair.second;
+            if (id != listenerId) {
+                continue;
+            }
+            if (listener->onWindowInfosChanged(*mLastUpdate).isOk()) {
+                mSyncedListenerIds.insert(listenerId);
+            }
+            return;
+        }
+    }});
+    return binder::Status::ok();
+}
+
 } // namespace android
@@ -47,6 +47,7 @@ public:
                             bool forceImmediateCall);
 
     binder::Status ackWindowInfosReceived(int64_t, int64_t) override;
+    binder::Status requestWindowInfosSnapshot(int64_t) override;
 
     struct DebugInfo {
         VsyncId maxSendDelayVsyncId;
@@ -69,6 +70,12 @@ private:
     WindowInfosReportedListenerSet mReportedListeners;
     void eraseListenerAndAckMessages(const wp<IBinder>&);
 
+    // The last update which was sent, and the listeners which received it. The next update is sent
+    // to those listeners as a delta from it.
+    int64_t mNextSequence = 1;
+    std::optional<gui::WindowInfosUpdate> mLastUpdate;
+    std::unordered_set<int64_t> mSyncedListenerIds;
+
     struct UnackedState {
         ftl::SmallVector<int64_t, kStaticCapacity> unackedListenerIds;
         WindowInfosReportedListenerSet reportedListeners;
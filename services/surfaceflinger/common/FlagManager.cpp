@@ -132,6 +132,9 @@ void FlagManager::dump(std::string& result) const {
     DUMP_READ_ONLY_FLAG(restore_blur_step);
     DUMP_READ_ONLY_FLAG(dont_skip_on_early_ro);
     DUMP_READ_ONLY_FLAG(protected_if_client);
+    DUMP_READ_ONLY_FLAG(multithreaded_prepare);
+    DUMP_READ_ONLY_FLAG(incremental_snapshot_update);
+    DUMP_READ_ONLY_FLAG(deferred_timestats_aggregation);
 #undef DUMP_READ_ONLY_FLAG
 #undef DUMP_SERVER_FLAG
 #undef DUMP_FLAG_INTERVAL
@@ -212,6 +215,10 @@ FLAG_MANAGER_READ_ONLY_FLAG(renderable_buffer_usage, "")
 FLAG_MANAGER_READ_ONLY_FLAG(restore_blur_step, "debug.renderengine.restore_blur_step")
 FLAG_MANAGER_READ_ONLY_FLAG(dont_skip_on_early_ro, "")
 FLAG_MANAGER_READ_ONLY_FLAG(protected_if_client, "")
+FLAG_MANAGER_READ_ONLY_FLAG(multithreaded_prepare, "debug.sf.multithreaded_prepare")
+FLAG_MANAGER_READ_ONLY_FLAG(incremental_snapshot_update, "debug.sf.incremental_snapshot_update")
+FLAG_MANAGER_READ_ONLY_FLAG(deferred_timestats_aggregation,
+                            "debug.sf.deferred_timestats_aggregation")
 
 /// Trunk stable server flags ///
 FLAG_MANAGER_SERVER_FLAG(refresh_rate_overlay_on_external_display, "")
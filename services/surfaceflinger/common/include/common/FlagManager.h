@@ -72,6 +72,9 @@ public:
     bool restore_blur_step() const;
     bool dont_skip_on_early_ro() const;
     bool protected_if_client() const;
+    bool multithreaded_prepare() const;
+    bool incremental_snapshot_update() const;
+    bool deferred_timestats_aggregation() const;
 
 protected:
     // overridden for unit tests
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include <com_android_graphics_surfaceflinger_flags.h>
+#include <common/test/FlagUtils.h>
+
+#include "FrontEnd/LayerCreationArgs.h"
+#include "FrontEnd/LayerHierarchy.h"
+#include "FrontEnd/LayerLifecycleManager.h"
+#include "FrontEnd/LayerSnapshotBuilder.h"
+#include "TransactionState.h"
+
+using namespace com::android::graphics::surfaceflinger;
+
+namespace android::surfaceflinger::frontend {
+namespace {
+
+// Every window is a container with a surface, which has a few children such as a dim layer
+// and the surfaces of its views.
+constexpr uint32_t kLayersPerWindow = 10;
+
+uint32_t getWindowLayerId(uint32_t window, uint32_t layer) {
+    return window * kLayersPerWindow + layer + 1;
+}
+
+void addLayer(LayerLifecycleManager& lifecycleManager, uint32_t id, uint32_t parentId) {
+    LayerCreationArgs args(std::make_optional(id));
+    args.name = "layer";
+    args.addToRoot = parentId == UNASSIGNED_LAYER_ID;
+    args.parentId = parentId;
+    std::vector<std::unique_ptr<RequestedLayerState>> layers;
+    layers.emplace_back(std::make_unique<RequestedLayerState>(args));
+    lifecycleManager.addLayers(std::move(layers));
+}
+
+// Builds windows that are stacked on top of each other, and whose layers are nested a few levels
+// deep.
+void addWindows(LayerLifecycleManager& lifecycleManager, uint32_t windowCount) {
+    for (uint32_t window = 0; window < windowCount; window++) {
+        addLayer(lifecycleManager, getWindowLayerId(window, 0), UNASSIGNED_LAYER_ID);
+        for (uint32_t layer = 1; layer < kLayersPerWindow; layer++) {
+            const uint32_t parentLayer = layer < 4 ? layer - 1 : 3;
+            addLayer(lifecycleManager, getWindowLayerId(window, layer),
+                     getWindowLayerId(window, parentLayer));
+        }
+    }
+}
+
+void setPosition(LayerLifecycleManager& lifecycleManager, uint32_t id, float x, float y) {
+    std::vector<TransactionState> transactions;
+    transactions.emplace_back();
+    transactions.back().states.push_back({});
+    transactions.back().states.front().state.what = layer_state_t::ePositionChanged;
+    transactions.back().states.front().state.x = x;
+    transactions.back().states.front().state.y = y;
+    transactions.back().states.front().layerId = id;
+    lifecycleManager.applyTransactions(transactions);
+}
+
+// Moves the surface of one window every frame, like an animation does, and updates the
+// snapshots. The snapshots of the other windows do not change.
+void BM_updateSnapshotsAfterGeometryChange(benchmark::State& state) {
+    const uint32_t windowCount = static_cast<uint32_t>(state.range(0));
+    SET_FLAG_FOR_TEST(flags::incremental_snapshot_update, state.range(1) != 0);
+
+    LayerLifecycleManager lifecycleManager;
+    addWindows(lifecycleManager, windowCount);
+    LayerHierarchyBuilder hierarchyBuilder;
+    hierarchyBuilder.update(lifecycleManager);
+
+    DisplayInfos displays;
+    const ShadowSettings globalShadowSettings;
+    const std::unordered_map<std::string, bool> supportedLayerGenericMetadata;
+    const std::unordered_map<std::string, uint32_t> genericLayerMetadataKeyMap;
+    LayerSnapshotBuilder::Args args{.root = hierarchyBuilder.getHierarchy(),
+                                    .layerLifecycleManager = lifecycleManager,
+                                    .displays = displays,
+                                    .globalShadowSettings = globalShadowSettings,
+                                    .supportedLayerGenericMetadata = supportedLayerGenericMetadata,
+                                    .genericLayerMetadataKeyMap = genericLayerMetadataKeyMap};
+    LayerSnapshotBuilder snapshotBuilder;
+    snapshotBuilder.update(args);
+    lifecycleManager.commitChanges();
+
+    const uint32_t animatingLayerId = getWindowLayerId(windowCount / 2, 1);
+    float position = 0;
+    for (auto _ : state) {
+        position += 1.f;
+        setPosition(lifecycleManager, animatingLayerId, position, position);
+        snapshotBuilder.update(args);
+        lifecycleManager.commitChanges();
+    }
+    state.SetItemsProcessed(state.iterations() *
+                            static_cast<int64_t>(windowCount * kLayersPerWindow));
+}
+
+BENCHMARK(BM_updateSnapshotsAfterGeometryChange)
+        ->ArgNames({"windows", "incremental"})
+        ->ArgsProduct({{10, 30, 60}, {0, 1}});
+
+} // namespace
+} // namespace android::surfaceflinger::frontend
+
+BENCHMARK_MAIN();
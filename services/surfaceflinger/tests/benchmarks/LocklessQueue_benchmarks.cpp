@@ -0,0 +1,116 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "BoundedLocklessQueue.h"
+#include "LocklessQueue.h"
+
+namespace android {
+namespace {
+
+// Roughly the size of the small, trivially copyable part of a queued transaction.
+struct Payload {
+    std::array<uint64_t, 8> data;
+};
+
+constexpr size_t kItemsPerProducer = 256;
+
+using LinkedListQueue = LocklessQueue<Payload>;
+using RingSpillQueue = BoundedLocklessQueue<Payload, 1024, BoundedLocklessQueueOverflow::Spill>;
+using RingBlockQueue = BoundedLocklessQueue<Payload, 1024, BoundedLocklessQueueOverflow::Block>;
+
+// Each iteration releases state.range(0) producer threads, which push kItemsPerProducer values
+// each, and pops everything on the benchmark thread, the way the main thread drains transactions
+// queued from binder threads. Producers are kept alive across iterations so that thread creation
+// is not measured.
+template <typename Queue>
+void BM_pushPop(benchmark::State& state) {
+    const auto producerCount = static_cast<size_t>(state.range(0));
+    Queue queue;
+    std::atomic<uint64_t> generation = 0;
+    std::atomic<bool> done = false;
+
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < producerCount; p++) {
+        producers.emplace_back([&]() {
+            uint64_t seen = 0;
+            while (true) {
+                uint64_t current;
+                while ((current = generation.load(std::memory_order_acquire)) == seen) {
+                    if (done.load(std::memory_order_relaxed)) return;
+                    std::this_thread::yield();
+                }
+                seen = current;
+                Payload payload{};
+                for (size_t i = 0; i < kItemsPerProducer; i++) {
+                    payload.data[0] = i;
+                    queue.push(payload);
+                }
+            }
+        });
+    }
+
+    const size_t itemsPerIteration = producerCount * kItemsPerProducer;
+    for (auto _ : state) {
+        generation.fetch_add(1, std::memory_order_release);
+        size_t received = 0;
+        while (received < itemsPerIteration) {
+            auto payload = queue.pop();
+            if (payload) {
+                benchmark::DoNotOptimize(payload->data[0]);
+                received++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    done = true;
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * itemsPerIteration));
+}
+
+// Single threaded push followed by pop, to show the cost of the allocation per value on its own.
+template <typename Queue>
+void BM_pushPopUncontended(benchmark::State& state) {
+    Queue queue;
+    Payload payload{};
+    for (auto _ : state) {
+        queue.push(payload);
+        benchmark::DoNotOptimize(queue.pop());
+    }
+}
+
+BENCHMARK(BM_pushPop<LinkedListQueue>)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+BENCHMARK(BM_pushPop<RingSpillQueue>)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+BENCHMARK(BM_pushPop<RingBlockQueue>)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+
+BENCHMARK(BM_pushPopUncontended<LinkedListQueue>);
+BENCHMARK(BM_pushPopUncontended<RingSpillQueue>);
+BENCHMARK(BM_pushPopUncontended<RingBlockQueue>);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include <ui/Transform.h>
+
+#include "RegionSamplingThread.h"
+
+namespace android {
+namespace {
+
+// Samples square areas of a few sizes. For reference, the status bar of a 1080p display is about
+// 300x300 pixels in area, and about 75x75 when debug.sf.region_sampling_downscale is 4.
+void BM_sampleArea(benchmark::State& state) {
+    const int32_t size = static_cast<int32_t>(state.range(0));
+    // Rows are padded, like the rows of a GraphicBuffer can be.
+    const int32_t stride = size + 16;
+    std::vector<uint32_t> buffer(static_cast<size_t>(stride * size));
+    for (size_t i = 0; i < buffer.size(); i++) {
+        buffer[i] = static_cast<uint32_t>(i) * 2654435761u;
+    }
+
+    const Rect area(size, size);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+                sampleArea(buffer.data(), size, size, stride, ui::Transform::ROT_0, area));
+    }
+    state.SetItemsProcessed(state.iterations() * size * size);
+}
+
+BENCHMARK(BM_sampleArea)->ArgName("size")->Arg(32)->Arg(96)->Arg(300)->Arg(1080);
+
+} // namespace
+} // namespace android
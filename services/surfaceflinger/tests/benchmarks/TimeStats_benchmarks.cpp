@@ -0,0 +1,87 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <com_android_graphics_surfaceflinger_flags.h>
+#include <common/test/FlagUtils.h>
+#include <utils/String16.h>
+#include <utils/Vector.h>
+
+#include "TimeStats/TimeStats.h"
+
+using namespace com::android::graphics::surfaceflinger;
+
+namespace android {
+namespace {
+
+constexpr Fps kRefreshRate = 120_Hz;
+constexpr nsecs_t kVsyncPeriod = 8'333'333;
+constexpr uid_t kUid = 10123;
+
+void enable(TimeStats& timeStats) {
+    Vector<String16> args;
+    args.push_back(String16("-enable"));
+    std::string result;
+    timeStats.parseArgs(/*asProto=*/false, args, result);
+}
+
+// Records what SurfaceFlinger records on the main thread for every frame of every layer: the
+// buffer is posted, latched and presented, and FrameTimeline classifies the frame afterwards.
+void BM_recordFrames(benchmark::State& state) {
+    const int32_t layerCount = static_cast<int32_t>(state.range(0));
+    SET_FLAG_FOR_TEST(flags::deferred_timestats_aggregation, state.range(1) != 0);
+
+    impl::TimeStats timeStats;
+    enable(timeStats);
+
+    std::vector<std::string> layerNames;
+    for (int32_t layerId = 0; layerId < layerCount; layerId++) {
+        layerNames.push_back("com.example.app/com.example.app.MainActivity#" +
+                             std::to_string(layerId));
+    }
+
+    uint64_t frameNumber = 0;
+    nsecs_t frameTime = 0;
+    for (auto _ : state) {
+        frameNumber++;
+        frameTime += kVsyncPeriod;
+        const nsecs_t presentTime = frameTime + kVsyncPeriod;
+        const auto presentFence = std::make_shared<FenceTime>(presentTime);
+        for (int32_t layerId = 0; layerId < layerCount; layerId++) {
+            timeStats.setPostTime(layerId, frameNumber, layerNames[layerId], kUid,
+                                  frameTime - kVsyncPeriod, GameMode::Unsupported);
+            timeStats.setAcquireTime(layerId, frameNumber, frameTime - kVsyncPeriod / 2);
+            timeStats.setDesiredTime(layerId, frameNumber, frameTime);
+            timeStats.setLatchTime(layerId, frameNumber, frameTime);
+            timeStats.setPresentFence(layerId, frameNumber, presentFence, kRefreshRate,
+                                      std::nullopt, {}, GameMode::Unsupported);
+            timeStats.incrementJankyFrames({kRefreshRate, std::nullopt, kUid,
+                                            layerNames[layerId], GameMode::Unsupported,
+                                            JankType::None, 0, 0, 0});
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * layerCount);
+}
+
+BENCHMARK(BM_recordFrames)->ArgNames({"layers", "deferred"})->ArgsProduct({{10, 60}, {0, 1}});
+
+} // namespace
+} // namespace android
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "BoundedLocklessQueue.h"
+
+namespace android {
+
+class BoundedLocklessQueueTest : public testing::Test {};
+
+namespace {
+
+TEST_F(BoundedLocklessQueueTest, emptyQueue) {
+    BoundedLocklessQueue<int, 4> queue;
+    EXPECT_TRUE(queue.isEmpty());
+    EXPECT_FALSE(queue.pop().has_value());
+}
+
+TEST_F(BoundedLocklessQueueTest, fifoWithinCapacity) {
+    BoundedLocklessQueue<int, 4> queue;
+    for (int i = 0; i < 4; i++) {
+        queue.push(i);
+    }
+    EXPECT_FALSE(queue.isEmpty());
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(i, queue.pop());
+    }
+    EXPECT_TRUE(queue.isEmpty());
+}
+
+TEST_F(BoundedLocklessQueueTest, slotsAreReused) {
+    BoundedLocklessQueue<int, 2> queue;
+    for (int i = 0; i < 100; i++) {
+        queue.push(i);
+        EXPECT_EQ(i, queue.pop());
+    }
+    EXPECT_TRUE(queue.isEmpty());
+}
+
+TEST_F(BoundedLocklessQueueTest, spillPreservesOrder) {
+    BoundedLocklessQueue<int, 4> queue;
+    for (int i = 0; i < 10; i++) {
+        queue.push(i);
+    }
+    // Free a slot while values are still spilled. Later pushes must keep going to the spill list
+    // so they are not popped ahead of earlier ones.
+    EXPECT_EQ(0, queue.pop());
+    queue.push(10);
+    for (int i = 1; i <= 10; i++) {
+        EXPECT_EQ(i, queue.pop());
+    }
+    EXPECT_TRUE(queue.isEmpty());
+
+    // Once the spill list is drained the ring is used again.
+    queue.push(11);
+    EXPECT_EQ(11, queue.pop());
+}
+
+TEST_F(BoundedLocklessQueueTest, movesValues) {
+    BoundedLocklessQueue<std::unique_ptr<int>, 2> queue;
+    queue.push(std::make_unique<int>(1));
+    queue.push(std::make_unique<int>(2));
+    queue.push(std::make_unique<int>(3));
+    for (int i = 1; i <= 3; i++) {
+        auto value = queue.pop();
+        ASSERT_TRUE(value.has_value());
+        EXPECT_EQ(i, **value);
+    }
+}
+
+template <BoundedLocklessQueueOverflow Overflow>
+void runMultipleProducers() {
+    constexpr int kProducerCount = 4;
+    constexpr int kValuesPerProducer = 10000;
+    BoundedLocklessQueue<std::pair<int, int>, 16, Overflow> queue;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducerCount; p++) {
+        producers.emplace_back([&queue, p]() {
+            for (int i = 0; i < kValuesPerProducer; i++) {
+                queue.push({p, i});
+            }
+        });
+    }
+
+    std::vector<int> nextExpected(kProducerCount, 0);
+    int received = 0;
+    while (received < kProducerCount * kValuesPerProducer) {
+        auto value = queue.pop();
+        if (!value) {
+            std::this_thread::yield();
+            continue;
+        }
+        auto [producer, index] = *value;
+        ASSERT_EQ(nextExpected[static_cast<size_t>(producer)], index);
+        nextExpected[static_cast<size_t>(producer)]++;
+        received++;
+    }
+
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    EXPECT_TRUE(queue.isEmpty());
+}
+
+TEST_F(BoundedLocklessQueueTest, multipleProducersSpill) {
+    runMultipleProducers<BoundedLocklessQueueOverflow::Spill>();
+}
+
+TEST_F(BoundedLocklessQueueTest, multipleProducersBlock) {
+    runMultipleProducers<BoundedLocklessQueueOverflow::Block>();
+}
+
+} // namespace
+
+} // namespace android
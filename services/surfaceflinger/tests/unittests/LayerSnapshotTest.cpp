@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <common/test/FlagUtils.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -26,6 +27,8 @@
 #include "LayerHierarchyTest.h"
 #include "ui/GraphicTypes.h"
 
+#include <com_android_graphics_surfaceflinger_flags.h>
+
 #define UPDATE_AND_VERIFY(BUILDER, ...)                                    \
     ({                                                                     \
         SCOPED_TRACE("");                                                  \
@@ -42,6 +45,7 @@ namespace android::surfaceflinger::frontend {
 
 using ftl::Flags;
 using namespace ftl::flag_operators;
+using namespace com::android::graphics::surfaceflinger;
 
 // To run test:
 /**
@@ -1258,4 +1262,65 @@ TEST_F(LayerSnapshotTest, canOccludePresentation) {
     EXPECT_EQ(getSnapshot(1221)->inputInfo.canOccludePresentation, true);
 }
 
+TEST_F(LayerSnapshotTest, incrementalUpdateUpdatesChildrenOfChangedLayer) {
+    SET_FLAG_FOR_TEST(flags::incremental_snapshot_update, true);
+    setCrop(111, Rect(0, 0, 50, 50));
+    UPDATE_AND_VERIFY(mSnapshotBuilder, STARTING_ZORDER);
+
+    const Rect layerCrop(0, 0, 10, 20);
+    setCrop(12, layerCrop);
+    setAlpha(12, 0.5);
+    UPDATE_AND_VERIFY(mSnapshotBuilder, STARTING_ZORDER);
+    EXPECT_EQ(getSnapshot(121)->geomLayerBounds, layerCrop.toFloatRect());
+    EXPECT_EQ(getSnapshot(1221)->geomLayerBounds, layerCrop.toFloatRect());
+    EXPECT_EQ(getSnapshot(1221)->alpha, 0.5f);
+    EXPECT_TRUE(getSnapshot(1221)->changes.test(RequestedLayerState::Changes::Geometry));
+
+    // Layers outside of the changed subtree keep their state.
+    EXPECT_EQ(getSnapshot(111)->geomLayerBounds, FloatRect(0, 0, 50, 50));
+    EXPECT_EQ(getSnapshot(111)->alpha, 1.f);
+    EXPECT_EQ(getSnapshot(111)->changes.get(), 0u);
+    EXPECT_EQ(getSnapshot(2)->changes.get(), 0u);
+}
+
+TEST_F(LayerSnapshotTest, incrementalUpdateUpdatesRelativeChildren) {
+    SET_FLAG_FOR_TEST(flags::incremental_snapshot_update, true);
+    reparentRelativeLayer(13, 11);
+    UPDATE_AND_VERIFY(mSnapshotBuilder, {1, 11, 13, 111, 12, 121, 122, 1221, 2});
+
+    hideLayer(11);
+    UPDATE_AND_VERIFY(mSnapshotBuilder, {1, 12, 121, 122, 1221, 2});
+    EXPECT_TRUE(getSnapshot(13)->isHiddenByPolicyFromRelativeParent);
+
+    showLayer(11);
+    UPDATE_AND_VERIFY(mSnapshotBuilder, {1, 11, 13, 111, 12, 121, 122, 1221, 2});
+    EXPECT_FALSE(getSnapshot(13)->isHiddenByPolicyFromRelativeParent);
+}
+
+TEST_F(LayerSnapshotTest, incrementalUpdateUpdatesMirroredLayers) {
+    SET_FLAG_FOR_TEST(flags::incremental_snapshot_update, true);
+    reparentLayer(12, UNASSIGNED_LAYER_ID);
+    createDisplayMirrorLayer(3, ui::LayerStack::fromValue(0));
+    setLayerStack(3, 3);
+    std::vector<uint32_t> expected = {1, 11, 111, 13, 2, 3, 1, 11, 111, 13, 2};
+    UPDATE_AND_VERIFY(mSnapshotBuilder, expected);
+
+    const Rect layerCrop(0, 0, 10, 20);
+    setCrop(11, layerCrop);
+    UPDATE_AND_VERIFY(mSnapshotBuilder, expected);
+    EXPECT_EQ(getSnapshot({.id = 111})->geomLayerBounds, layerCrop.toFloatRect());
+    EXPECT_EQ(getSnapshot({.id = 111, .mirrorRootIds = 3u})->geomLayerBounds,
+              layerCrop.toFloatRect());
+}
+
+TEST_F(LayerSnapshotTest, incrementalUpdatePropagatesFrameRateToParent) {
+    SET_FLAG_FOR_TEST(flags::incremental_snapshot_update, true);
+    setFrameRate(111, 90.0, ANATIVEWINDOW_FRAME_RATE_EXACT, ANATIVEWINDOW_CHANGE_FRAME_RATE_ALWAYS);
+    UPDATE_AND_VERIFY(mSnapshotBuilder, STARTING_ZORDER);
+    EXPECT_EQ(getSnapshot(111)->frameRate.vote.rate.getIntValue(), 90);
+    EXPECT_EQ(getSnapshot(11)->frameRate.vote.type, scheduler::FrameRateCompatibility::NoVote);
+    EXPECT_EQ(getSnapshot(1)->frameRate.vote.type, scheduler::FrameRateCompatibility::NoVote);
+    EXPECT_FALSE(getSnapshot(12)->frameRate.vote.rate.isValid());
+}
+
 } // namespace android::surfaceflinger::frontend
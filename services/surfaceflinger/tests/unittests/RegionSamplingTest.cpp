@@ -85,6 +85,18 @@ TEST_F(RegionSamplingTest, bimodal_tiebreaker) {
                 testing::FloatEq(0.5f));
 }
 
+TEST_F(RegionSamplingTest, calculate_mean_unaligned_region) {
+    // Every fourth column is black, starting with column 3.
+    std::generate(buffer.begin(), buffer.end(),
+                  [n = 0]() mutable { return (n++ % kStride) % 4 == 3 ? kBlack : kWhite; });
+
+    // Columns 3, 7 and 11 of the 9 sampled columns are black.
+    Rect const unaligned_region{3, 2, 12, 7};
+    EXPECT_THAT(sampleArea(buffer.data(), kWidth, kHeight, kStride, kOrientation,
+                           unaligned_region),
+                testing::FloatEq(2.0f / 3.0f));
+}
+
 TEST_F(RegionSamplingTest, bounds_checking) {
     std::generate(buffer.begin(), buffer.end(),
                   [n = 0]() mutable { return (n++ > (kStride * kHeight >> 1)) ? kBlack : kWhite; });
@@ -23,6 +23,8 @@
 #define LOG_TAG "LibSurfaceFlingerUnittests"
 
 #include <TimeStats/TimeStats.h>
+#include <com_android_graphics_surfaceflinger_flags.h>
+#include <common/test/FlagUtils.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <log/log.h>
@@ -37,6 +39,7 @@
 #include "libsurfaceflinger_unittest_main.h"
 
 using namespace android::surfaceflinger;
+using namespace com::android::graphics::surfaceflinger;
 using namespace google::protobuf;
 using namespace std::chrono_literals;
 
@@ -1539,6 +1542,74 @@ TEST_F(TimeStatsTest, layerStatsCallback_limitsLayers) {
     EXPECT_EQ(atomList.atom(0).layer_name(), genLayerName(LAYER_ID_1));
 }
 
+TEST_F(TimeStatsTest, canAggregateDeferredLayerTimeStats) {
+    SET_FLAG_FOR_TEST(flags::deferred_timestats_aggregation, true);
+    EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
+
+    // More frames than a layer can hold, so some of them are aggregated while they are recorded.
+    constexpr size_t kFrameCount = impl::TimeStats::MAX_NUM_TIME_RECORDS * 2;
+    for (size_t i = 1; i <= kFrameCount; i++) {
+        insertTimeRecord(NORMAL_SEQUENCE_2, LAYER_ID_0, i, i * 1000000);
+    }
+
+    SFTimeStatsGlobalProto globalProto;
+    ASSERT_TRUE(globalProto.ParseFromString(inputCommand(InputCommand::DUMP_ALL, FMT_PROTO)));
+
+    ASSERT_EQ(1, globalProto.stats_size());
+    const SFTimeStatsLayerProto& layerProto = globalProto.stats().Get(0);
+    ASSERT_TRUE(layerProto.has_total_frames());
+    EXPECT_EQ(kFrameCount - 1, layerProto.total_frames());
+}
+
+TEST_F(TimeStatsTest, layerTimeStatsOnDestroyWithDeferredAggregation) {
+    SET_FLAG_FOR_TEST(flags::deferred_timestats_aggregation, true);
+    EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
+
+    insertTimeRecord(NORMAL_SEQUENCE, LAYER_ID_0, 1, 1000000);
+    insertTimeRecord(NORMAL_SEQUENCE, LAYER_ID_0, 2, 2000000);
+    ASSERT_NO_FATAL_FAILURE(mTimeStats->onDestroy(0));
+    insertTimeRecord(NORMAL_SEQUENCE, LAYER_ID_0, 3, 3000000);
+
+    SFTimeStatsGlobalProto globalProto;
+    ASSERT_TRUE(globalProto.ParseFromString(inputCommand(InputCommand::DUMP_ALL, FMT_PROTO)));
+
+    ASSERT_EQ(1, globalProto.stats_size());
+    const SFTimeStatsLayerProto& layerProto = globalProto.stats().Get(0);
+    ASSERT_TRUE(layerProto.has_total_frames());
+    EXPECT_EQ(1, layerProto.total_frames());
+}
+
+TEST_F(TimeStatsTest, layerStatsCallback_pullsDeferredJankyFrames) {
+    SET_FLAG_FOR_TEST(flags::deferred_timestats_aggregation, true);
+    EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
+
+    insertTimeRecord(NORMAL_SEQUENCE, LAYER_ID_0, 1, 1000000);
+    insertTimeRecord(NORMAL_SEQUENCE, LAYER_ID_0, 2, 2000000);
+    // More janky frames than are kept pending, so some of them are aggregated before the pull.
+    // They are still blamed to the layer, whose frames are aggregated first.
+    constexpr size_t kJankyFrameCount = impl::TimeStats::MAX_NUM_PENDING_JANKY_FRAMES + 1;
+    for (size_t i = 0; i < kJankyFrameCount; i++) {
+        mTimeStats->incrementJankyFrames({kRefreshRate0, kRenderRate0, UID_0,
+                                          genLayerName(LAYER_ID_0), kGameMode,
+                                          JankType::AppDeadlineMissed, 1, 2, 3});
+    }
+
+    std::vector<uint8_t> pulledBytes;
+    EXPECT_TRUE(mTimeStats->onPullAtom(10063 /*SURFACEFLINGER_STATS_LAYER_INFO*/, &pulledBytes));
+    std::string pulledData;
+    pulledData.assign(pulledBytes.begin(), pulledBytes.end());
+
+    SurfaceflingerStatsLayerInfoWrapper atomList;
+    ASSERT_TRUE(atomList.ParseFromString(pulledData));
+    ASSERT_EQ(atomList.atom_size(), 1);
+    const SurfaceflingerStatsLayerInfo& atom = atomList.atom(0);
+    EXPECT_EQ(atom.layer_name(), genLayerName(LAYER_ID_0));
+    EXPECT_EQ(atom.total_frames(), 1);
+    EXPECT_EQ(atom.total_timeline_frames(), kJankyFrameCount);
+    EXPECT_EQ(atom.total_janky_frames(), kJankyFrameCount);
+    EXPECT_EQ(atom.total_janky_frames_app_unattributed(), kJankyFrameCount);
+}
+
 TEST_F(TimeStatsTest, canSurviveMonkey) {
     if (g_noSlowTests) {
         GTEST_SKIP();
@@ -283,4 +283,111 @@ TEST_F(WindowInfosListenerInvokerTest, removeListenerAcks) {
     EXPECT_EQ(callCount, 2);
 }
 
+gui::WindowInfo windowInfo(int32_t id, const std::string& name) {
+    gui::WindowInfo info;
+    info.id = id;
+    info.name = name;
+    return info;
+}
+
+// Test that WindowInfosListenerInvoker#windowInfosChanged sends a listener which has the last
+// update only the windows which changed since then.
+TEST_F(WindowInfosListenerInvokerTest, sendsDeltaToListenerWithLastUpdate) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<gui::WindowInfosUpdate> updates;
+    gui::WindowInfosListenerInfo listenerInfo;
+    mInvoker->addWindowInfosListener(sp<Listener>::make([&](const gui::WindowInfosUpdate& update) {
+                                         std::scoped_lock lock{mutex};
+                                         updates.push_back(update);
+                                         cv.notify_one();
+                                         listenerInfo.windowInfosPublisher
+                                                 ->ackWindowInfosReceived(update.vsyncId,
+                                                                          listenerInfo.listenerId);
+                                     }),
+                                     &listenerInfo);
+
+    BackgroundExecutor::getInstance().sendCallbacks({[&]() {
+        mInvoker->windowInfosChanged(gui::WindowInfosUpdate{{windowInfo(1, "a"),
+                                                             windowInfo(2, "b")},
+                                                            {},
+                                                            /* vsyncId= */ 0,
+                                                            /* timestamp= */ 0},
+                                     {}, false);
+    }});
+    {
+        std::unique_lock lock{mutex};
+        cv.wait(lock, [&]() { return updates.size() == 1; });
+    }
+    BackgroundExecutor::getInstance().sendCallbacks({[&]() {
+        mInvoker->windowInfosChanged(gui::WindowInfosUpdate{{windowInfo(1, "a"),
+                                                             windowInfo(2, "c")},
+                                                            {},
+                                                            /* vsyncId= */ 1,
+                                                            /* timestamp= */ 0},
+                                     {}, false);
+    }});
+    std::unique_lock lock{mutex};
+    cv.wait(lock, [&]() { return updates.size() == 2; });
+
+    EXPECT_FALSE(updates[0].isDelta());
+    EXPECT_EQ(2u, updates[0].windowInfos.size());
+    ASSERT_TRUE(updates[1].isDelta());
+    EXPECT_EQ(updates[0].sequence, *updates[1].baseSequence);
+    EXPECT_EQ((std::vector<int32_t>{1, 2}), updates[1].windowIds);
+    ASSERT_EQ(1u, updates[1].windowInfos.size());
+    EXPECT_EQ("c", updates[1].windowInfos[0].name);
+}
+
+// Test that WindowInfosListenerInvoker#requestWindowInfosSnapshot sends the last update again with
+// every window.
+TEST_F(WindowInfosListenerInvokerTest, sendsSnapshotWhenRequested) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<gui::WindowInfosUpdate> updates;
+    gui::WindowInfosListenerInfo listenerInfo;
+    mInvoker->addWindowInfosListener(sp<Listener>::make([&](const gui::WindowInfosUpdate& update) {
+                                         std::scoped_lock lock{mutex};
+                                         updates.push_back(update);
+                                         cv.notify_one();
+                                         // Like WindowInfosListenerReporter, ask for a snapshot
+                                         // instead of applying the delta, and ack the delta once
+                                         // the snapshot is received.
+                                         if (update.isDelta()) {
+                                             listenerInfo.windowInfosPublisher
+                                                     ->requestWindowInfosSnapshot(
+                                                             listenerInfo.listenerId);
+                                         } else {
+                                             listenerInfo.windowInfosPublisher
+                                                     ->ackWindowInfosReceived(update.vsyncId,
+                                                                              listenerInfo
+                                                                                      .listenerId);
+                                         }
+                                     }),
+                                     &listenerInfo);
+
+    for (int64_t vsyncId : {0, 1}) {
+        BackgroundExecutor::getInstance().sendCallbacks({[&, vsyncId]() {
+            mInvoker->windowInfosChanged(gui::WindowInfosUpdate{{windowInfo(1, "a"),
+                                                                 windowInfo(2,
+                                                                            std::to_string(
+                                                                                    vsyncId))},
+                                                                {},
+                                                                vsyncId,
+                                                                /* timestamp= */ 0},
+                                         {}, false);
+        }});
+        std::unique_lock lock{mutex};
+        cv.wait(lock, [&]() { return updates.size() == static_cast<size_t>(vsyncId + 1); });
+    }
+    std::unique_lock lock{mutex};
+    cv.wait(lock, [&]() { return updates.size() == 3; });
+
+    ASSERT_TRUE(updates[1].isDelta());
+    EXPECT_FALSE(updates[2].isDelta());
+    EXPECT_EQ(updates[1].sequence, updates[2].sequence);
+    ASSERT_EQ(2u, updates[2].windowInfos.size());
+    EXPECT_EQ("1", updates[2].windowInfos[1].name);
+}
+
 } // namespace android